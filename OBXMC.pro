@@ -17,7 +17,7 @@
 #* http://www.gnu.org/copyleft/gpl.html.
 #*/
 
-QT       += core
+QT       += core network
 
 QT       -= gui
 
@@ -33,18 +33,22 @@ INCLUDEPATH += ..
 
 SOURCES += \
     ObxMcMain.cpp \
+    ObxMcServer.cpp \
     ObxIlEmitter.cpp \
     ObxPelibGen.cpp \
     ObxCilGen.cpp \
     ../MonoTools/MonoMdbGen.cpp \
-    ObxCGen2.cpp
+    ObxCGen2.cpp \
+    ObxOptimizer.cpp
 
 HEADERS += \
+    ObxMcServer.h \
     ObxIlEmitter.h \
     ObxPelibGen.h \
     ObxCilGen.h \
     ../MonoTools/MonoMdbGen.h \
-    ObxCGen2.h
+    ObxCGen2.h \
+    ObxOptimizer.h
 
 include( ../PeLib/PeLib.pri )
 include( ObxParser.pri )
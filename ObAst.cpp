@@ -78,7 +78,7 @@ static inline RowCol toRowCol(SynTree* st)
     Q_ASSERT( st != 0 );
     RowCol res;
     if( !res.setRowCol( st->d_tok.d_lineNr, st->d_tok.d_colNr ) )
-        qWarning() << "exceeding maximum row or column number at" << st->d_tok.d_sourcePath << st->d_tok.d_lineNr;
+        qWarning() << "exceeding maximum row or column number at" << st->d_tok.getSourcePath() << st->d_tok.d_lineNr;
     return res;
 }
 
@@ -529,10 +529,10 @@ void Ast::Model::parseFile(QIODevice* in, const QString& path, ParseResultList&
 #endif
             SynTree* id = findFirstChild(st,Tok_ident);
             Q_ASSERT( id != 0 );
-            ParseResult& pr = res[ id->d_tok.d_val.constData() ];
+            ParseResult& pr = res[ id->d_tok.getVal().constData() ];
             if( pr.d_modName != 0 )
             {
-                error(id,tr("duplicate module name '%1'").arg(id->d_tok.d_val.constData()));
+                error(id,tr("duplicate module name '%1'").arg(id->d_tok.getVal().constData()));
                 toDelete << st;
             }else
             {
@@ -599,7 +599,7 @@ bool Ast::Model::module(Ast::Module* m, SynTree* st)
             declarationSequence(m,sub,true);
             break;
         case Tok_ident:
-            if( sub->d_tok.d_val != m->d_name )
+            if( sub->d_tok.getVal() != m->d_name )
                 return error(sub,tr("ident after END is supposed to be equal to module name") );
             break;
         case SynTree::R_StatementSequence:
@@ -635,14 +635,14 @@ bool Ast::Model::importList(Ast::Module* m, SynTree* st)
             moduleName = imp->d_children.last();
         }
         Q_ASSERT( m->d_scope );
-        Named* n = m->d_scope->find(moduleName->d_tok.d_val);
+        Named* n = m->d_scope->find(moduleName->d_tok.getVal());
         if( n && n->getTag() == Thing::T_Module )
         {
             Module* mi = Ast::thing_cast<Module*>(n);
             Ref<Import> ii = new Import();
             ii->d_mod = mi;
             ii->d_loc = toRowCol(imp);
-            ii->d_name = nickname->d_tok.d_val;
+            ii->d_name = nickname->d_tok.getVal();
             ii->d_scope = m;
             if( d_fillXref )
             {
@@ -721,7 +721,7 @@ bool Ast::Model::procedureDeclaration(Ast::Scope* m, SynTree* st, bool headingOn
     {
         Q_ASSERT( st->d_children.size() == 3 );
         procedureBody(p.data(),st->d_children[1]);
-        if( st->d_children.last()->d_tok.d_val != p->d_name )
+        if( st->d_children.last()->d_tok.getVal() != p->d_name )
             error( st->d_children.last(), tr("final ident doesn't correspond to procedure name") );
     }
 
@@ -739,7 +739,7 @@ SynTree* Ast::Model::procedureHeading(Ast::Procedure* p, SynTree* st)
     Q_ASSERT( st->d_children.size() >= 2 && st->d_children[1]->d_tok.d_type == SynTree::R_identdef );
     SynTree* idef = st->d_children[1];
     Q_ASSERT( !idef->d_children.isEmpty() && idef->d_children.first()->d_tok.d_type == Tok_ident );
-    p->d_name = idef->d_children.first()->d_tok.d_val;
+    p->d_name = idef->d_children.first()->d_tok.getVal();
     if( idef->d_children.size() > 1 )
     {
         Q_ASSERT( idef->d_children.size() == 2 &&  idef->d_children.last()->d_tok.d_type == Tok_Star );
@@ -837,7 +837,7 @@ Ast::Named* Ast::Model::typeDeclaration(Scope* m, SynTree* st)
     Q_ASSERT( st->d_children.size() == 3 && st->d_children.first()->d_tok.d_type == SynTree::R_identdef );
     SynTree* idef = st->d_children.first();
     Q_ASSERT( !idef->d_children.isEmpty() && idef->d_children.first()->d_tok.d_type == Tok_ident );
-    const QByteArray name = idef->d_children.first()->d_tok.d_val;
+    const QByteArray name = idef->d_children.first()->d_tok.getVal();
     bool pub = false;
     if( idef->d_children.size() > 1 )
     {
@@ -1096,7 +1096,7 @@ bool Ast::Model::variableDeclaration(Ast::Scope* ds, SynTree* t)
         const bool pub = i->d_children.size() > 1;
 
         Ref<Named> v = ( ds->getTag() == Thing::T_Module ? (Named*)new Variable() : (Named*)new LocalVar() );
-        v->d_name = id->d_tok.d_val;
+        v->d_name = id->d_tok.getVal();
         v->d_public = pub;
         v->d_isDef = d_curModule->d_isDef;
         v->d_type = tp;
@@ -1126,7 +1126,7 @@ bool Ast::Model::constDeclaration(Ast::Scope* m, SynTree* st)
     const bool pub = st->d_children.first()->d_children.size() > 1;
 
     Ref<Const> c = new Const();
-    c->d_name = id->d_tok.d_val;
+    c->d_name = id->d_tok.getVal();
     c->d_public = pub;
     c->d_isDef = d_curModule->d_isDef;
     c->d_scope = m;
@@ -1201,7 +1201,7 @@ bool Ast::Model::fpSection(Scope* s, Ast::ProcType* p, SynTree* st)
         {
             Ref<Parameter> v = new Parameter();
             v->d_type = t;
-            v->d_name = st->d_children[i]->d_tok.d_val;
+            v->d_name = st->d_children[i]->d_tok.getVal();
             v->d_loc = toRowCol(st->d_children[i]);
             v->d_scope = s;
             v->d_var = var;
@@ -1242,7 +1242,7 @@ bool Ast::Model::fieldList(Scope* s, Ast::Record* rec, SynTree* st )
         {
             SynTree* idef = fl->d_children[i];
             Q_ASSERT( !idef->d_children.isEmpty() && idef->d_children.first()->d_tok.d_type == Tok_ident );
-            const QByteArray name = idef->d_children.first()->d_tok.d_val;
+            const QByteArray name = idef->d_children.first()->d_tok.getVal();
             bool pub = false;
             if( idef->d_children.size() > 1 )
             {
@@ -1461,7 +1461,7 @@ Ast::Ref<Ast::Statement> Ast::Model::forStatement(Ast::Scope* s, SynTree* st)
     Ref<ForLoop> f = new ForLoop();
     f->d_loc = toRowCol(st);
     Q_ASSERT( st->d_children[1]->d_tok.d_type == Tok_ident );
-    Named* id = s->find(st->d_children[1]->d_tok.d_val );
+    Named* id = s->find(st->d_children[1]->d_tok.getVal() );
     if( id == 0 )
         error(st->d_children[1],tr("identifier not declared") );
     else
@@ -1764,14 +1764,14 @@ Ast::Ref<Ast::Expression> Ast::Model::literal(Ast::Scope* s, SynTree* st)
         switch( st->d_children.first()->d_children.first()->d_tok.d_type)
         {
         case Tok_real:
-            val = first->d_children.first()->d_tok.d_val.toDouble();
+            val = first->d_children.first()->d_tok.getVal().toDouble();
             return new Literal(d_realType.data(), toRowCol(first->d_children.first()),val);
         case Tok_integer:
-            if( first->d_children.first()->d_tok.d_val.endsWith('H') )
-                val = first->d_children.first()->d_tok.d_val.
-                                           left(first->d_children.first()->d_tok.d_val.size()-1).toLongLong(0,16);
+            if( first->d_children.first()->d_tok.getVal().endsWith('H') )
+                val = first->d_children.first()->d_tok.getVal().
+                                           left(first->d_children.first()->d_tok.getVal().size()-1).toLongLong(0,16);
             else
-                val = first->d_children.first()->d_tok.d_val.toLongLong();
+                val = first->d_children.first()->d_tok.getVal().toLongLong();
             return new Literal(d_intType.data(), toRowCol(first->d_children.first()),val);
         default:
             Q_ASSERT(false);
@@ -1779,13 +1779,13 @@ Ast::Ref<Ast::Expression> Ast::Model::literal(Ast::Scope* s, SynTree* st)
         }
         break;
     case Tok_string:
-        return new Literal(d_stringType.data(), toRowCol(first),first->d_tok.d_val.mid(1,first->d_tok.d_val.size()-2));
+        return new Literal(d_stringType.data(), toRowCol(first),first->d_tok.getVal().mid(1,first->d_tok.getVal().size()-2));
     case Tok_hexstring:
         return new Literal(d_stringType.data(), toRowCol(first), QByteArray::fromHex(
-                               first->d_tok.d_val.mid(1, first->d_tok.d_val.size() - 2)));
+                               first->d_tok.getVal().mid(1, first->d_tok.getVal().size() - 2)));
     case Tok_hexchar:
         return new Literal(d_charType.data(), toRowCol(first), QByteArray::fromHex(
-                               first->d_tok.d_val.left( first->d_tok.d_val.size() - 1 ) ));
+                               first->d_tok.getVal().left( first->d_tok.getVal().size() - 1 ) ));
     case Tok_NIL:
         return new Literal(d_nilType.data(), toRowCol(first));
 #ifndef OB_BBOX
@@ -1817,7 +1817,7 @@ Ast::Ref<Ast::Expression> Ast::Model::designator(Ast::Scope* s, SynTree* st)
 
     // deref first ident of quali
     {
-        Named* n = s->find(quali->d_children.first()->d_tok.d_val);
+        Named* n = s->find(quali->d_children.first()->d_tok.getVal());
         if( n == 0 )
         {
             error(quali->d_children.first(),tr("cannot resolve identifier") );
@@ -1868,7 +1868,7 @@ Ast::Ref<Ast::Expression> Ast::Model::designator(Ast::Scope* s, SynTree* st)
             {
                 Q_ASSERT( cur->getIdent() != 0 && cur->getIdent()->getTag() == Thing::T_Import );
                 Import* imp = Ast::thing_cast<Import*>( cur->getIdent() );
-                Named* v = imp->d_mod->find(first->d_tok.d_val, false );
+                Named* v = imp->d_mod->find(first->d_tok.getVal(), false );
                 if( v == 0 )
                 {
                     error(first,tr("cannot resolve identifier in '%1'").arg(imp->d_mod->d_name.constData() ) );
@@ -1908,7 +1908,7 @@ Ast::Ref<Ast::Expression> Ast::Model::designator(Ast::Scope* s, SynTree* st)
             if( td->getTag() == Thing::T_Record )
             {
                 Record* r = Ast::thing_cast<Record*>(td);
-                Named* f = r->find(first->d_tok.d_val, true);
+                Named* f = r->find(first->d_tok.getVal(), true);
                 if( f == 0 )
                 {
                     error(first,tr("record field doesn't exist") );
@@ -2076,7 +2076,7 @@ Ast::Ref<Ast::Expression> Ast::Model::qualident(Ast::Scope* s, SynTree* quali)
 
     // deref first ident of quali (nearly identical to designator)
     {
-        ident = s->find(quali->d_children.first()->d_tok.d_val);
+        ident = s->find(quali->d_children.first()->d_tok.getVal());
         if( ident == 0 )
         {
             error(quali->d_children.first(),tr("cannot resolve identifier") );
@@ -2108,7 +2108,7 @@ Ast::Ref<Ast::Expression> Ast::Model::qualident(Ast::Scope* s, SynTree* quali)
         }
         Q_ASSERT( imp != 0 );
         SynTree* st = quali->d_children.last();
-        ident = imp->d_mod->find(st->d_tok.d_val, false );
+        ident = imp->d_mod->find(st->d_tok.getVal(), false );
         if( ident == 0 )
         {
             error(st,tr("cannot resolve identifier in '%1'").arg(imp->d_mod->d_name.constData() ) );
@@ -2192,20 +2192,20 @@ Ast::Ref<Ast::Expression> Ast::Model::label(Ast::Scope* s, SynTree* st)
     switch( first->d_tok.d_type )
     {
     case Tok_integer:
-        if( first->d_tok.d_val.endsWith('H') )
-            val = first->d_tok.d_val.left(first->d_tok.d_val.size()-1).toLongLong(0,16);
+        if( first->d_tok.getVal().endsWith('H') )
+            val = first->d_tok.getVal().left(first->d_tok.getVal().size()-1).toLongLong(0,16);
         else
-            val = first->d_tok.d_val.toLongLong();
+            val = first->d_tok.getVal().toLongLong();
         return new Literal(d_intType.data(),toRowCol(first),val);
         break;
     case Tok_string:
-        return new Literal(d_stringType.data(),toRowCol(first),first->d_tok.d_val.mid(1,first->d_tok.d_val.size()-2));
+        return new Literal(d_stringType.data(),toRowCol(first),first->d_tok.getVal().mid(1,first->d_tok.getVal().size()-2));
     case Tok_hexstring:
         return new Literal(d_stringType.data(),toRowCol(first),QByteArray::fromHex(
-                               first->d_tok.d_val.mid(1, first->d_tok.d_val.size() - 2)));
+                               first->d_tok.getVal().mid(1, first->d_tok.getVal().size() - 2)));
     case Tok_hexchar:
         return new Literal(d_charType.data(),toRowCol(first), QByteArray::fromHex(
-                               first->d_tok.d_val.left( first->d_tok.d_val.size() - 1 ) ));
+                               first->d_tok.getVal().left( first->d_tok.getVal().size() - 1 ) ));
     case SynTree::R_qualident:
         {
             return qualident( s, first ).data();
@@ -2294,52 +2294,52 @@ void Ast::Model::createModules(Mods& mods, ParseResultList& prl)
             m->d_helper << new IdentLeaf(m.data(),pr.d_modName,m.data(), 0);
             d_xref[m.data()].append( m->d_helper.back().data() );
         }
-        m->d_name = pr.d_modName->d_tok.d_val;
+        m->d_name = pr.d_modName->d_tok.getVal();
         m->d_loc = toRowCol(pr.d_modName);
-        m->d_file = pr.d_modName->d_tok.d_sourcePath;
+        m->d_file = pr.d_modName->d_tok.getSourcePath();
         m->d_useExt = pr.d_isExt;
         m->d_isDef = modRoot->d_tok.d_type == SynTree::R_definition;
 
-        if( m->d_scope->d_names.contains(pr.d_modName->d_tok.d_val.constData()) )
-            error(modRoot,tr("invalid module name '%1'").arg(pr.d_modName->d_tok.d_val.constData()));
+        if( m->d_scope->d_names.contains(pr.d_modName->d_tok.getVal().constData()) )
+            error(modRoot,tr("invalid module name '%1'").arg(pr.d_modName->d_tok.getVal().constData()));
         else
         {
-            Usage& u = mods[pr.d_modName->d_tok.d_val.constData()];
+            Usage& u = mods[pr.d_modName->d_tok.getVal().constData()];
             Q_ASSERT( u.d_st == 0 );
             u.d_st = modRoot;
             pr.d_modRoot = 0; // avoid deleting modRoot
         }
 
-        if( !d_global->d_names.contains(pr.d_modName->d_tok.d_val.constData()) )
-            d_global->d_names.insert(pr.d_modName->d_tok.d_val.constData(), m.data());
-        if( !d_globalLc->d_names.contains(pr.d_modName->d_tok.d_val.constData()) )
-            d_globalLc->d_names.insert(pr.d_modName->d_tok.d_val.constData(), m.data());
+        if( !d_global->d_names.contains(pr.d_modName->d_tok.getVal().constData()) )
+            d_global->d_names.insert(pr.d_modName->d_tok.getVal().constData(), m.data());
+        if( !d_globalLc->d_names.contains(pr.d_modName->d_tok.getVal().constData()) )
+            d_globalLc->d_names.insert(pr.d_modName->d_tok.getVal().constData(), m.data());
 
         const QList<SynTree*> imports = getImports(modRoot);
         foreach( SynTree* imp, imports )
         {
-            if( imp->d_tok.d_val.constData() == d_system.constData() )
+            if( imp->d_tok.getVal().constData() == d_system.constData() )
             {
                 // NOP, importing SYSTEM
                 if( false ) // d_fillXref )
                 {
                     // not needed, leads to double entries
-                    Named* system = d_global->d_names.value( imp->d_tok.d_val.constData() ).data();
+                    Named* system = d_global->d_names.value( imp->d_tok.getVal().constData() ).data();
                     d_xref[system].append( m->d_helper.back().data() );
                 }
-            }else if( !mods.contains(imp->d_tok.d_val.constData()) && !prl.contains(imp->d_tok.d_val.constData()) )
+            }else if( !mods.contains(imp->d_tok.getVal().constData()) && !prl.contains(imp->d_tok.getVal().constData()) )
             {
                 // the required import is not in the parsed files, either because it references a
                 // library outside of the parsed files or a parsed file is missing due to syntax errors
-                if( Named* test = d_global->d_names.value( imp->d_tok.d_val.constData() ).data() )
+                if( Named* test = d_global->d_names.value( imp->d_tok.getVal().constData() ).data() )
                 {
                     if( !test->isScope() )
-                        error(imp,tr("import is not a module '%1'").arg(imp->d_tok.d_val.constData()));
-                }else if( !resolveImport( mods, imp->d_tok.d_val ) )
-                    error(imp,tr("cannot resolve import '%1'").arg(imp->d_tok.d_val.constData()));
+                        error(imp,tr("import is not a module '%1'").arg(imp->d_tok.getVal().constData()));
+                }else if( !resolveImport( mods, imp->d_tok.getVal() ) )
+                    error(imp,tr("cannot resolve import '%1'").arg(imp->d_tok.getVal().constData()));
             }
-            mods[ m->d_name.constData() ].d_uses.insert( imp->d_tok.d_val.constData() );
-            mods[ imp->d_tok.d_val.constData() ].d_usedBy.insert( m->d_name.constData() );
+            mods[ m->d_name.constData() ].d_uses.insert( imp->d_tok.getVal().constData() );
+            mods[ imp->d_tok.getVal().constData() ].d_usedBy.insert( m->d_name.constData() );
         }
     }
 }
@@ -220,7 +220,7 @@ bool CodeModel::parseFiles(const QStringList& files)
     {
         if( m->d_def != 0 )
         {
-            qDebug() << "analyzing" << m->d_def->d_tok.d_sourcePath;
+            qDebug() << "analyzing" << m->d_def->d_tok.getSourcePath();
 #ifdef OB_BBOX
             if( m->d_def->d_children.size() >= 3 && m->d_def->d_children[3]->d_tok.d_type == SynTree::R_SysString )
             {
@@ -235,7 +235,7 @@ bool CodeModel::parseFiles(const QStringList& files)
 
             if( d_trackIds )
             {
-                IdentUseList& l = d_dir[m->d_def->d_tok.d_sourcePath];
+                IdentUseList& l = d_dir[m->d_def->d_tok.getSourcePath()];
                 std::sort( l.begin(), l.end(), IdenUseLessThan );
             }
         }
@@ -254,7 +254,7 @@ void CodeModel::dump(QTextStream& out, const SynTree* node, int level)
         if( Ob::tokenTypeIsKeyword( node->d_tok.d_type ) )
             str = Ob::tokenTypeString(node->d_tok.d_type);
         else if( node->d_tok.d_type > Ob::TT_Specials )
-            str = QByteArray("\"") + node->d_tok.d_val + QByteArray("\"");
+            str = QByteArray("\"") + node->d_tok.getVal() + QByteArray("\"");
         else
             str = QByteArray("\"") + node->d_tok.getString() + QByteArray("\"");
 
@@ -262,7 +262,7 @@ void CodeModel::dump(QTextStream& out, const SynTree* node, int level)
         str = Ob::SynTree::rToStr( node->d_tok.d_type );
     if( !str.isEmpty() )
     {
-        str += QByteArray("\t") + QFileInfo(node->d_tok.d_sourcePath).baseName().toUtf8() +
+        str += QByteArray("\t") + QFileInfo(node->d_tok.getSourcePath()).baseName().toUtf8() +
                 ":" + QByteArray::number(node->d_tok.d_lineNr) +
                 ":" + QByteArray::number(node->d_tok.d_colNr);
         QByteArray ws;
@@ -318,7 +318,7 @@ QList<const SynTree*> CodeModel::findReferencingSymbols(const CodeModel::NamedTh
     QList<const SynTree*> res;
     foreach( const SynTree* s, tmp )
     {
-        if( s->d_tok.d_sourcePath == file )
+        if( s->d_tok.getSourcePath() == file )
             res.append( s );
     }
     return res;
@@ -363,7 +363,7 @@ quint32 CodeModel::parseFile(QIODevice* in, const QString& path)
                 toDelete << st;
             }else
             {
-                const QByteArray name = id->d_tok.d_val;
+                const QByteArray name = id->d_tok.getVal();
                 Module* m = new Module();
                 m->d_outer = &d_scope;
                 m->d_name = name;
@@ -382,7 +382,7 @@ quint32 CodeModel::parseFile(QIODevice* in, const QString& path)
     foreach( SynTree* st, toDelete )
         delete st;
     foreach( const Token& t, p.d_comments )
-        d_comments[t.d_sourcePath].append(t);
+        d_comments[t.getSourcePath()].append(t);
     return sloc;
 }
 
@@ -399,13 +399,13 @@ void CodeModel::checkModuleDependencies()
                 if( i->d_tok.d_type == SynTree::R_import )
                 {
                     Q_ASSERT( !i->d_children.isEmpty() && i->d_children.first()->d_tok.d_type == Tok_ident );
-                    const QByteArray localName = i->d_children.first()->d_tok.d_val;
+                    const QByteArray localName = i->d_children.first()->d_tok.getVal();
                     QByteArray globalName = localName;
                     if( i->d_children.size() > 1 )
                     {
                         Q_ASSERT( i->d_children[1]->d_tok.d_type == Tok_ColonEq &&
                                 i->d_children[2]->d_tok.d_type == Tok_ident );
-                        globalName = i->d_children[2]->d_tok.d_val;
+                        globalName = i->d_children[2]->d_tok.getVal();
                     }
                     NamedThing* nt = d_scope.d_names.value(globalName);
                     Module* other = dynamic_cast<Module*>( nt );
@@ -499,7 +499,7 @@ QList<CodeModel::Module*> CodeModel::findProcessingOrder()
         foreach( Module* m, mods )
         {
             if( m->d_def )
-                d_errs->error(Errors::Semantics, m->d_def->d_tok.d_sourcePath, 0, 0,
+                d_errs->error(Errors::Semantics, m->d_def->d_tok.getSourcePath(), 0, 0,
                               tr("module '%1' has circular import dependencies").arg(m->d_name.data() ) );
         }
     }
@@ -559,7 +559,7 @@ void CodeModel::processConstDeclaration(Unit* m, SynTree* d)
     {
         Element* c = new Element();
         c->d_kind = Element::Constant;
-        c->d_name = id.first->d_tok.d_val;
+        c->d_name = id.first->d_tok.getVal();
         c->d_public = id.second;
         c->d_def = d;
         c->d_id = id.first;
@@ -584,7 +584,7 @@ void CodeModel::processTypeDeclaration(Unit* m, SynTree* t)
         if( tp == 0 )
             return;
         tp->d_def = t;
-        tp->d_name = id.first->d_tok.d_val;
+        tp->d_name = id.first->d_tok.getVal();
         tp->d_id = id.first;
         tp->d_public = id.second;
         m->addToScope( tp );
@@ -607,7 +607,7 @@ void CodeModel::processVariableDeclaration(Unit* m, SynTree* t)
         {
             Element* c = new Element();
             c->d_kind = Element::Variable;
-            c->d_name = id.first->d_tok.d_val;
+            c->d_name = id.first->d_tok.getVal();
             c->d_public = id.second;
             c->d_def = t;
             c->d_type = tp;
@@ -652,7 +652,7 @@ void CodeModel::processProcedureDeclaration(Unit* ds, SynTree* t)
     Procedure* res = new Procedure();
     res->d_outer = ds;
     res->d_def = t;
-    res->d_name = id.first->d_tok.d_val;
+    res->d_name = id.first->d_tok.getVal();
     res->d_id = id.first;
     res->d_public = id.second;
     ds->d_procs.append(res); // proc is added to owning scope procs list in any case, but to names only if not bound
@@ -684,7 +684,7 @@ void CodeModel::processProcedureDeclaration(Unit* ds, SynTree* t)
         SynTree* tpid = receiver->d_children[receiver->d_children.size()-2];
         Q_ASSERT( name != tpid && tpid->d_tok.d_type == Tok_ident );
 
-        const Type* nt = dynamic_cast<const Type*>(ds->findByName(tpid->d_tok.d_val));
+        const Type* nt = dynamic_cast<const Type*>(ds->findByName(tpid->d_tok.getVal()));
         Type* rt = const_cast<Type*>(nt);
         if( rt && rt->d_kind == Type::Pointer )
             rt = const_cast<Type*>(derefed(rt->d_type));
@@ -700,7 +700,7 @@ void CodeModel::processProcedureDeclaration(Unit* ds, SynTree* t)
             p->d_type = nt;
             p->d_var = receiver->d_children[1]->d_tok.d_type == Tok_VAR ||
                     receiver->d_children[1]->d_tok.d_type == Tok_IN;
-            p->d_name = name->d_tok.d_val;
+            p->d_name = name->d_tok.getVal();
             p->d_def = receiver;
             p->d_id = name;
             index(name,p);
@@ -718,7 +718,7 @@ void CodeModel::processProcedureDeclaration(Unit* ds, SynTree* t)
         }else
         {
             error( Errors::Semantics, tpid, tr("identifier is not a record type: %1 %2").
-                   arg( tpid->d_tok.d_val.constData() ).arg( t ? rt->typeName().constData() : "" ) );
+                   arg( tpid->d_tok.getVal().constData() ).arg( t ? rt->typeName().constData() : "" ) );
             return;
         }
     }else
@@ -769,7 +769,7 @@ void CodeModel::processProcedureDeclaration(Unit* ds, SynTree* t)
 bool CodeModel::checkNameNotInScope(Scope* scope, SynTree* id)
 {
     Q_ASSERT( id != 0 );
-    const QByteArray name = id->d_tok.d_val;
+    const QByteArray name = id->d_tok.getVal();
     if( scope->d_names.contains(name) )
     {
         error( Errors::Semantics, id, tr("duplicate name: '%1'").arg(name.data()));
@@ -781,7 +781,7 @@ bool CodeModel::checkNameNotInScope(Scope* scope, SynTree* id)
 bool CodeModel::checkNameNotInRecord(const Type* scope, SynTree* id)
 {
     Q_ASSERT( id != 0 && scope->d_kind == Type::Record );
-    const QByteArray name = id->d_tok.d_val;
+    const QByteArray name = id->d_tok.getVal();
     if( scope->d_vals.contains(name) )
     {
         error( Errors::Semantics, id, tr("duplicate name: '%1'").arg(name.data()));
@@ -884,11 +884,11 @@ static QString toString( const CodeModel::DesigOpList& l, bool mid = false, bool
         case CodeModel::IdentOp:
             if( mid || i != 0 )
                 res += ".";
-            res += l[i].d_arg->d_tok.d_val;
+            res += l[i].d_arg->d_tok.getVal();
             if( sym ) res += notNull(l[i].d_sym);
             break;
         case CodeModel::PointerOp:
-            res += l[i].d_arg->d_tok.d_val;
+            res += l[i].d_arg->d_tok.getVal();
             if( sym ) res += notNull(l[i].d_sym);
             break;
         case CodeModel::TypeOp:
@@ -1060,7 +1060,7 @@ void CodeModel::checkAssig(CodeModel::Unit* ds, const CodeModel::DesigOpList& lh
                 {
                     s->d_type = typeOfExpression(ds,expr);
                     if( s->d_type == 0 || s->d_type->deref() == 0 )
-                        qWarning() << "unknown type of expression in" << expr->d_tok.d_sourcePath
+                        qWarning() << "unknown type of expression in" << expr->d_tok.getSourcePath()
                                    << expr->d_tok.d_lineNr << ":" << expr->d_tok.d_colNr;
                 }
             }
@@ -1101,7 +1101,7 @@ void CodeModel::checkCaseStatement(CodeModel::Unit* ds, SynTree* st)
         const NamedThing* var = 0;
         SynTree* id = flatten(st->d_children[1]);
         if( id->d_tok.d_type == Tok_ident )
-            var = ds->findByName( id->d_tok.d_val ) ;
+            var = ds->findByName( id->d_tok.getVal() ) ;
         if( var == 0 )
         {
             error(Errors::Semantics,st,tr("only simple type case variables supported"));
@@ -1125,14 +1125,14 @@ void CodeModel::checkCaseStatement(CodeModel::Unit* ds, SynTree* st)
                     goto NormalCaseStatement;
             }
         }
-        // qDebug() << "typecase at" << st->d_tok.d_sourcePath << st->d_tok.d_lineNr;
+        // qDebug() << "typecase at" << st->d_tok.getSourcePath() << st->d_tok.d_lineNr;
         for( int i = 0; i < cases.size(); i++ )
         {
             checkNames(ds,cases[i].first.second);
             Unit scope;
             scope.d_outer = ds;
             TypeAlias alias;
-            alias.d_name = id->d_tok.d_val;
+            alias.d_name = id->d_tok.getVal();
             alias.d_newType = cases[i].first.first;
             alias.d_alias = const_cast<NamedThing*>(var);
             scope.addToScope(&alias);
@@ -1189,7 +1189,7 @@ void CodeModel::checkGuard(CodeModel::Unit* ds, SynTree* guard, SynTree* stats)
         const NamedThing* var = 0;
         SynTree* id = flatten(lhs);
         if( id->d_tok.d_type == Tok_ident )
-            var = ds->findByName( id->d_tok.d_val ) ;
+            var = ds->findByName( id->d_tok.getVal() ) ;
         if( var == 0 )
         {
             error(Errors::Semantics,lhs,tr("only simple type case variables supported"));
@@ -1202,7 +1202,7 @@ void CodeModel::checkGuard(CodeModel::Unit* ds, SynTree* guard, SynTree* stats)
             Unit scope;
             scope.d_outer = ds;
             TypeAlias alias;
-            alias.d_name = id->d_tok.d_val;
+            alias.d_name = id->d_tok.getVal();
             alias.d_newType = rhsT;
             alias.d_alias = const_cast<NamedThing*>(var);
             scope.addToScope(&alias);
@@ -1288,7 +1288,7 @@ CodeModel::Type*CodeModel::parseRecordType(CodeModel::Unit* ds, SynTree* t)
                 QPair<SynTree*,bool> id = getIdentFromIdentDef(i);
                 if( checkNameNotInRecord(res,id.first) )
                 {
-                    const QByteArray name = id.first->d_tok.d_val;
+                    const QByteArray name = id.first->d_tok.getVal();
                     Element* f = new Element();
                     f->d_kind = Element::Variable;
                     f->d_name = name;
@@ -1418,7 +1418,7 @@ CodeModel::Type*CodeModel::parseFormalParams(CodeModel::Unit* ds, SynTree* fp, Q
                         p->d_kind = Element::Variable;
                         p->d_type = tp;
                         p->d_var = var;
-                        p->d_name = id->d_tok.d_val;
+                        p->d_name = id->d_tok.getVal();
                         p->d_def = sec;
                         p->d_id = id;
                         params.append(p);
@@ -1485,11 +1485,11 @@ CodeModel::Quali CodeModel::derefQualident(CodeModel::Unit* ds, SynTree* t, bool
     if( t->d_children.size() > 1 )
     {
         id1 = t->d_children.first();
-        nt = ds->findByName(id1->d_tok.d_val);
+        nt = ds->findByName(id1->d_tok.getVal());
         if( nt == 0 )
         {
             if( report )
-                error( Errors::Semantics, id1, tr("module '%1' not imported").arg(id1->d_tok.d_val.data()) );
+                error( Errors::Semantics, id1, tr("module '%1' not imported").arg(id1->d_tok.getVal().data()) );
             Q_ASSERT( m == 0 && id1 != 0 && nt == 0 && id2 == 0 );
             return Quali(qMakePair(m,id1),qMakePair(nt,id2));
         }
@@ -1498,28 +1498,28 @@ CodeModel::Quali CodeModel::derefQualident(CodeModel::Unit* ds, SynTree* t, bool
         if( m == 0 )
         {
             if( report )
-                error( Errors::Semantics, id1, tr("referenced '%1' is not a module").arg(id1->d_tok.d_val.data()) );
+                error( Errors::Semantics, id1, tr("referenced '%1' is not a module").arg(id1->d_tok.getVal().data()) );
             nt = 0;
             Q_ASSERT( m == 0 && id1 != 0 && nt == 0 && id2 == 0 );
             return Quali(qMakePair(m,id1),qMakePair(nt,id2));
         }
         id2 = t->d_children.last();
-        nt = m->findByName(id2->d_tok.d_val);
+        nt = m->findByName(id2->d_tok.getVal());
         if( synthesize && nt == 0 && m->d_def == 0 )
         {
             Module* mm = const_cast<Module*>(m);
             // Stub Module wurde gefunden, aber ident darin nicht
-            qDebug() << "synthesizing type" << id2->d_tok.d_val << "in module" << id1->d_tok.d_val;
+            qDebug() << "synthesizing type" << id2->d_tok.getVal() << "in module" << id1->d_tok.getVal();
             Type* s = new Type();
             mm->d_types.append(s);
-            s->d_name = id2->d_tok.d_val;
+            s->d_name = id2->d_tok.getVal();
             s->d_public = true;
             mm->addToScope( s );
             nt = s;
         }else if( nt == 0 && report )
         {
-            error( Errors::Semantics, id1, tr("ident '%2' not found in module '%1'").arg(id1->d_tok.d_val.data())
-                           .arg(id2->d_tok.d_val.data()) );
+            error( Errors::Semantics, id1, tr("ident '%2' not found in module '%1'").arg(id1->d_tok.getVal().data())
+                           .arg(id2->d_tok.getVal().data()) );
         }
         Q_ASSERT( m != 0 && id1 != 0 && id2 != 0 );
         if( report )
@@ -1532,10 +1532,10 @@ CodeModel::Quali CodeModel::derefQualident(CodeModel::Unit* ds, SynTree* t, bool
     }else
     {
         id2 = t->d_children.first();
-        nt = ds->findByName(id2->d_tok.d_val);
+        nt = ds->findByName(id2->d_tok.getVal());
         if( nt == 0 && report )
         {
-            error( Errors::Semantics, id2, tr("local ident '%1' not found").arg(id2->d_tok.d_val.data()) );
+            error( Errors::Semantics, id2, tr("local ident '%1' not found").arg(id2->d_tok.getVal().data()) );
         }
         Q_ASSERT( m == 0 && id1 == 0 && id2 != 0 );
         if( report && nt != 0 )
@@ -1573,7 +1573,7 @@ CodeModel::DesigOpList CodeModel::derefDesignator(CodeModel::Unit* ds, SynTree*
             bool isPredefProc = false;
             if( desig.size() == 2 && desig.first().d_op == IdentOp )
             {
-                const NamedThing* n = ds->findByName( desig.first().d_arg->d_tok.d_val );
+                const NamedThing* n = ds->findByName( desig.first().d_arg->d_tok.getVal() );
                 if( n )
                 {
                     isPredefProc = n->isPredefProc();
@@ -1587,7 +1587,7 @@ CodeModel::DesigOpList CodeModel::derefDesignator(CodeModel::Unit* ds, SynTree*
         }
     }
 
-    desig.first().d_sym = ds->findByName(desig.first().d_arg->d_tok.d_val);
+    desig.first().d_sym = ds->findByName(desig.first().d_arg->d_tok.getVal());
     if( desig.first().d_sym == 0 )
     {
         SynTree* dP = desig[0].d_arg;
@@ -1667,15 +1667,15 @@ const CodeModel::NamedThing*CodeModel::applyDesigOp(Unit* ds, const CodeModel::N
     {
         if( dop.d_op == IdentOp )
         {
-            res = m->findByName(dop.d_arg->d_tok.d_val);
+            res = m->findByName(dop.d_arg->d_tok.getVal());
             if( res == 0 )
             {
                 if( m->d_def == 0 && synthesize )
                 {
                     Module* mm = const_cast<Module*>( m );
-                    qDebug() << "synthesizing member" << dop.d_arg->d_tok.d_val << "in module" << m->d_name;
+                    qDebug() << "synthesizing member" << dop.d_arg->d_tok.getVal() << "in module" << m->d_name;
                     Element* c = new Element();
-                    c->d_name = dop.d_arg->d_tok.d_val;
+                    c->d_name = dop.d_arg->d_tok.getVal();
                     c->d_public = true;
                     c->d_scope = mm;
                     mm->d_elems.append(c);
@@ -1819,19 +1819,19 @@ const CodeModel::NamedThing*CodeModel::applyDesigOp(Unit* ds, const CodeModel::N
         {
             if( dop.d_op == IdentOp )
             {
-                res = t->find(dop.d_arg->d_tok.d_val);
+                res = t->find(dop.d_arg->d_tok.getVal());
                 if( res == 0 && synthesize )
                 {
                     Type* t2 = const_cast<Type*>(t);
                     if( t2->d_kind != Type::Record && t2->d_kind != Type::Unknown )
                         qWarning() << "stubed" << t2->d_name << "first seen as" << Type::s_kindName[t2->d_kind] <<
                                       "redeclaring to" << Type::s_kindName[Type::Record];
-                    qDebug() << "synthesizing field" << dop.d_arg->d_tok.d_val << "in record" << t2->d_name <<
+                    qDebug() << "synthesizing field" << dop.d_arg->d_tok.getVal() << "in record" << t2->d_name <<
                                 "of module" << t2->d_scope->d_name;
                     t2->d_kind = Type::Record;
                     Element* c = new Element();
                     c->d_kind = Element::Variable;
-                    c->d_name = dop.d_arg->d_tok.d_val;
+                    c->d_name = dop.d_arg->d_tok.getVal();
                     c->d_public = true;
                     c->d_type = expected;
                     c->d_scope = t->d_scope;
@@ -1874,7 +1874,7 @@ const CodeModel::NamedThing*CodeModel::applyDesigOp(Unit* ds, const CodeModel::N
                     err = MissingType;
             }else if( dop.d_op == IdentOp )
             {
-                res = t->find(dop.d_arg->d_tok.d_val);
+                res = t->find(dop.d_arg->d_tok.getVal());
                 if( res == 0 )
                     err = NotFound;
             }
@@ -1885,7 +1885,7 @@ const CodeModel::NamedThing*CodeModel::applyDesigOp(Unit* ds, const CodeModel::N
         {
             if( dop.d_op == IdentOp )
             {
-                res = t->find(dop.d_arg->d_tok.d_val);
+                res = t->find(dop.d_arg->d_tok.getVal());
                 if( res == 0 )
                     err = NotFound;
             }
@@ -2414,23 +2414,23 @@ QVariant CodeModel::evalLiteral(const CodeModel::Unit* u, SynTree* expr) const
     case SynTree::R_number:
         Q_ASSERT( expr->d_children.size() == 1 );
         if( first->d_children.first()->d_tok.d_type == Tok_real )
-            return first->d_children.first()->d_tok.d_val.toDouble();
+            return first->d_children.first()->d_tok.getVal().toDouble();
         else if( first->d_children.first()->d_tok.d_type == Tok_integer )
         {
-            if( first->d_children.first()->d_tok.d_val.endsWith('H') )
-                return first->d_children.first()->d_tok.d_val.
-                                           left(first->d_children.first()->d_tok.d_val.size()-1).toLongLong(0,16);
+            if( first->d_children.first()->d_tok.getVal().endsWith('H') )
+                return first->d_children.first()->d_tok.getVal().
+                                           left(first->d_children.first()->d_tok.getVal().size()-1).toLongLong(0,16);
             else
-                return first->d_children.first()->d_tok.d_val.toLongLong();
+                return first->d_children.first()->d_tok.getVal().toLongLong();
         }else
             Q_ASSERT(false);
         break;
     case Tok_string:
-        return first->d_tok.d_val.mid(1,first->d_tok.d_val.size()-2);
+        return first->d_tok.getVal().mid(1,first->d_tok.getVal().size()-2);
     case Tok_hexstring:
-        return QByteArray::fromHex(first->d_tok.d_val.mid(1, first->d_tok.d_val.size() - 2));
+        return QByteArray::fromHex(first->d_tok.getVal().mid(1, first->d_tok.getVal().size() - 2));
     case Tok_hexchar:
-        return QByteArray::fromHex( first->d_tok.d_val.left( first->d_tok.d_val.size() - 1 ) );
+        return QByteArray::fromHex( first->d_tok.getVal().left( first->d_tok.getVal().size() - 1 ) );
     case Tok_NIL:
         error(Errors::Semantics, first, tr("NIL not allowed as a constant value") );
         break;
@@ -2590,7 +2590,7 @@ void CodeModel::index(const SynTree* idUse, const CodeModel::NamedThing* decl)
     if( !d_trackIds || idUse == 0 || decl == 0 )
         return;
     Q_ASSERT( idUse != 0 && decl != 0 );
-    d_dir[idUse->d_tok.d_sourcePath].append( IdentUse(idUse,decl) );
+    d_dir[idUse->d_tok.getSourcePath()].append( IdentUse(idUse,decl) );
     d_revDir.insert(decl,idUse);
 }
 
@@ -323,7 +323,7 @@ namespace Ob
         {
 #ifdef _DEBUG
             qDebug() << "*** invalid op" << dop.d_op << "with input" << input <<
-                        (dop.d_arg ? dop.d_arg->d_tok.d_sourcePath : QString()) <<
+                        (dop.d_arg ? dop.d_arg->d_tok.getSourcePath() : QString()) <<
                         (dop.d_arg ? dop.d_arg->d_tok.d_lineNr : -1 );
 #endif
             return InvalidOperation;
@@ -37,9 +37,9 @@ static QByteArray quali( const SynTree* st )
 {
     Q_ASSERT( st != 0 && st->d_tok.d_type == SynTree::R_qualident );
     if( st->d_children.size() == 1 )
-        return st->d_children.first()->d_tok.d_val;
+        return st->d_children.first()->d_tok.getVal();
     else
-        return st->d_children.first()->d_tok.d_val + "::" + st->d_children.last()->d_tok.d_val;
+        return st->d_children.first()->d_tok.getVal() + "::" + st->d_children.last()->d_tok.getVal();
 }
 
 CppGen::CppGen(CodeModel* mdl):d_mdl(mdl),d_errs(0),d_genStubs(true)
@@ -116,7 +116,7 @@ void CppGen::emitModule(const CodeModel::Module* m)
 
     d_cmts.clear();
     if( m->d_def )
-        d_cmts = d_mdl->getComments(m->d_def->d_tok.d_sourcePath);
+        d_cmts = d_mdl->getComments(m->d_def->d_tok.getSourcePath());
     d_nextCmt = 0;
 
     emitHeader(m,hout,lh);
@@ -393,11 +393,11 @@ void CppGen::emitLiteral(const CodeModel::Unit* ds,const SynTree* st, QTextStrea
         break;
     case SynTree::R_number:
         Q_ASSERT( !st->d_children.first()->d_children.isEmpty() );
-        if( st->d_children.first()->d_children.first()->d_tok.d_val.endsWith('H') )
-            out << "0x" << st->d_children.first()->d_children.first()->d_tok.d_val.left(
-                       st->d_children.first()->d_children.first()->d_tok.d_val.size() - 1 );
+        if( st->d_children.first()->d_children.first()->d_tok.getVal().endsWith('H') )
+            out << "0x" << st->d_children.first()->d_children.first()->d_tok.getVal().left(
+                       st->d_children.first()->d_children.first()->d_tok.getVal().size() - 1 );
         else
-            out << st->d_children.first()->d_children.first()->d_tok.d_val;
+            out << st->d_children.first()->d_children.first()->d_tok.getVal();
         break;
 #ifndef OB_BBOX
     case Tok_TRUE:
@@ -411,16 +411,16 @@ void CppGen::emitLiteral(const CodeModel::Unit* ds,const SynTree* st, QTextStrea
         out << "0";
         break;
     case Tok_string:
-        if( first->d_tok.d_val.size() == 3 )
-            out << "'" << ( first->d_tok.d_val[1] == '\'' ? "\\" : "" ) << first->d_tok.d_val[1] << "'"; // CHAR
+        if( first->d_tok.getVal().size() == 3 )
+            out << "'" << ( first->d_tok.getVal()[1] == '\'' ? "\\" : "" ) << first->d_tok.getVal()[1] << "'"; // CHAR
         else
-            out << first->d_tok.d_val;
+            out << first->d_tok.getVal();
         break;
     case Tok_hexchar:
-        out << "0x" << first->d_tok.d_val.left(first->d_tok.d_val.size() - 1 );
+        out << "0x" << first->d_tok.getVal().left(first->d_tok.getVal().size() - 1 );
         break;
     case Tok_hexstring:
-        out << "\"" << first->d_tok.d_val << "\"";
+        out << "\"" << first->d_tok.getVal() << "\"";
         break;
     default:
         Q_ASSERT( false );
@@ -441,7 +441,7 @@ bool CppGen::emitDesig(const CodeModel::Unit* ds, const SynTree* st, bool procCa
         {
         case CodeModel::IdentOp:
             if( dopl[i].d_sym == 0 )
-                out << "/* ERROR: emitDesig: ident with no symbol: " << dopl[i].d_arg->d_tok.d_val << " */";
+                out << "/* ERROR: emitDesig: ident with no symbol: " << dopl[i].d_arg->d_tok.getVal() << " */";
             if( i == 0 && dynamic_cast<const CodeModel::Module*>(dopl[i].d_sym) )
             {
                 out << escape(dopl[i].d_sym->d_name) + "::_inst()";
@@ -1061,7 +1061,7 @@ void CppGen::emitForStatement(const CodeModel::Unit* ds, const SynTree* st, QTex
 {
     Q_ASSERT( st != 0 && st->d_tok.d_type == SynTree::R_ForStatement && st->d_children.size() >= 9 &&
             st->d_children[1]->d_tok.d_type == Tok_ident );
-    out << ws(level) << "for( " << st->d_children[1]->d_tok.d_val << " = ";
+    out << ws(level) << "for( " << st->d_children[1]->d_tok.getVal() << " = ";
     emitExpression(ds,st->d_children[3],out,level);
     out << "; ";
     if( st->d_children[6]->d_tok.d_type == Tok_BY )
@@ -1069,17 +1069,17 @@ void CppGen::emitForStatement(const CodeModel::Unit* ds, const SynTree* st, QTex
         // support for both inc > 0 and inc < 0
         emitExpression(ds,st->d_children[7],out,level);
         out << " > 0 ? ";
-        out << st->d_children[1]->d_tok.d_val << " <= ";
+        out << st->d_children[1]->d_tok.getVal() << " <= ";
         emitExpression(ds,st->d_children[5],out,level);
         out << " : ";
-        out << st->d_children[1]->d_tok.d_val << " >= ";
+        out << st->d_children[1]->d_tok.getVal() << " >= ";
         emitExpression(ds,st->d_children[5],out,level);
     }else
     {
-        out << st->d_children[1]->d_tok.d_val << " <= ";
+        out << st->d_children[1]->d_tok.getVal() << " <= ";
         emitExpression(ds,st->d_children[5],out,level);
     }
-    out << "; " << st->d_children[1]->d_tok.d_val;
+    out << "; " << st->d_children[1]->d_tok.getVal();
     if( st->d_children[6]->d_tok.d_type == Tok_BY )
     {
         out << " += ";
@@ -1142,13 +1142,13 @@ void CppGen::emitCaseStatement(const CodeModel::Unit* ds, const SynTree* st, QTe
             SynTree* id = CodeModel::flatten(st->d_children[1]);
             const CodeModel::NamedThing* var = 0;
             Q_ASSERT( id->d_tok.d_type == Tok_ident );
-            var = ds->findByName( id->d_tok.d_val );
+            var = ds->findByName( id->d_tok.getVal() );
             Q_ASSERT( var != 0 );
 
             CodeModel::Unit scope;
             scope.d_outer = const_cast<CodeModel::Unit*>(ds);
             CodeModel::TypeAlias alias;
-            alias.d_name = id->d_tok.d_val;
+            alias.d_name = id->d_tok.getVal();
             alias.d_newType = dynamic_cast<const CodeModel::Type*>( quali.second.first );
             alias.d_alias = const_cast<CodeModel::NamedThing*>(var);
             scope.addToScope(&alias);
@@ -1169,7 +1169,7 @@ void CppGen::emitCaseStatement(const CodeModel::Unit* ds, const SynTree* st, QTe
         out << " " << name << " = ";
         emitExpression( ds, st->d_children[1], out, level );
         out << ";" << endl;
-        qDebug() << ds->d_id->d_tok.d_sourcePath;
+        qDebug() << ds->d_id->d_tok.getSourcePath();
         out << ws(level);
 
         int n = 0;
@@ -1264,7 +1264,7 @@ void CppGen::emitComment(const SynTree* st, QTextStream& out, int level )
 
     while( d_nextCmt < d_cmts.size() && d_cmts[d_nextCmt].d_lineNr <= st->d_tok.d_lineNr )
     {
-        const QByteArray str = d_cmts[d_nextCmt++].d_val;
+        const QByteArray str = d_cmts[d_nextCmt++].getVal();
         out << ws(level) << "/* " << str.mid(2,str.size()-4) << " */" << endl;
     }
 }
@@ -1277,19 +1277,19 @@ void CppGen::emitLabel(const CodeModel::Unit* ds, const SynTree* st, QTextStream
     switch( first->d_tok.d_type )
     {
     case Tok_integer:
-        out << first->d_tok.d_val;
+        out << first->d_tok.getVal();
         break;
     case Tok_string:
-        if( first->d_tok.d_val.size() == 3 )
-            out << "'" << ( first->d_tok.d_val[1] == '\'' ? "\\" : "" ) << first->d_tok.d_val[1] << "'"; // CHAR
+        if( first->d_tok.getVal().size() == 3 )
+            out << "'" << ( first->d_tok.getVal()[1] == '\'' ? "\\" : "" ) << first->d_tok.getVal()[1] << "'"; // CHAR
         else
-            out << first->d_tok.d_val;
+            out << first->d_tok.getVal();
         break;
     case Tok_hexchar:
-        out << "0x" << first->d_tok.d_val.left(first->d_tok.d_val.size() - 1 );
+        out << "0x" << first->d_tok.getVal().left(first->d_tok.getVal().size() - 1 );
         break;
     case Tok_hexstring:
-        out << "\"" << first->d_tok.d_val << "\"";
+        out << "\"" << first->d_tok.getVal() << "\"";
         break;
     case SynTree::R_qualident:
         out << quali(first);
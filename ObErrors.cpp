@@ -27,7 +27,7 @@ using namespace Ob;
 Errors::Errors(QObject *parent, bool threadExclusive) :
     QObject(parent),
     d_numOfErrs(0),d_numOfWrns(0),d_showWarnings(true),d_threadExclusive(threadExclusive),
-    d_reportToConsole(false),d_record(false),d_numOfSyntaxErrs(0)
+    d_reportToConsole(false),d_record(false),d_keepLog(false),d_numOfSyntaxErrs(0)
 {
 
 }
@@ -49,6 +49,8 @@ bool Errors::error(Errors::Source s, const QString& file, int line, int col, con
     e.d_source = s;
     e.d_file = file;
     e.d_isErr = true;
+    if( d_keepLog )
+        d_log.append(e);
     if( d_record )
     {
         const int count = d_errs.size();
@@ -87,6 +89,8 @@ void Errors::warning(Errors::Source s, const QString& file, int line, int col, c
         e.d_source = s;
         e.d_file = file;
         e.d_isErr = false;
+        if( d_keepLog )
+            d_log.append(e);
         if( d_record )
         {
             const int count = d_errs.size();
@@ -146,6 +150,21 @@ void Errors::setRecord(bool on)
     if( !d_threadExclusive ) d_lock.unlock();
 }
 
+void Errors::setLog(bool on)
+{
+    if( !d_threadExclusive ) d_lock.lockForWrite();
+    d_keepLog = on;
+    if( !d_threadExclusive ) d_lock.unlock();
+}
+
+QList<Errors::Entry> Errors::getLog() const
+{
+    if( !d_threadExclusive ) d_lock.lockForRead();
+    const QList<Entry> res = d_log;
+    if( !d_threadExclusive ) d_lock.unlock();
+    return res;
+}
+
 quint32 Errors::getErrCount() const
 {
     if( !d_threadExclusive ) d_lock.lockForRead();
@@ -169,6 +188,7 @@ void Errors::clear()
     d_numOfWrns = 0;
     d_numOfSyntaxErrs = 0;
     d_errs.clear();
+    d_log.clear();
     if( !d_threadExclusive ) d_lock.unlock();
 }
 
@@ -60,6 +60,8 @@ namespace Ob
         void setReportToConsole(bool on);
         bool record() const;
         void setRecord(bool on);
+        void setLog(bool on); // keep all errors and warnings in the order reported, including repetitions
+        QList<Entry> getLog() const;
 
         quint32 getErrCount() const;
         quint32 getWrnCount() const;
@@ -77,10 +79,12 @@ namespace Ob
         quint32 d_numOfSyntaxErrs;
         quint32 d_numOfWrns;
         EntryList d_errs;
+        QList<Entry> d_log;
         bool d_showWarnings;
         bool d_threadExclusive;
         bool d_reportToConsole;
         bool d_record;
+        bool d_keepLog;
     };
 #if QT_VERSION >= 0x050000
 	inline uint qHash(const Errors::Entry & e, uint seed) {
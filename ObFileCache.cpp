@@ -21,12 +21,16 @@
 #include <QFile>
 #include <QBuffer>
 #include <QFileInfo>
+#include <QCryptographicHash>
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
 using namespace Ob;
 
 // TODO: brauchen wir hier canonicalPaths?
 // #define _USE_CANONOCALS
 
-FileCache::FileCache(QObject *parent) : QObject(parent)
+FileCache::FileCache(QObject *parent) : QObject(parent),d_tick(0),d_diskBytes(0),d_budget(64 * 1024 * 1024)
 {
 }
 
@@ -39,6 +43,8 @@ void FileCache::addFile(const QString& filePath, const QByteArray& code, bool is
 #endif
     Entry e;
     e.d_code = code;
+    e.d_hash = hash(code);
+    e.d_size = code.size();
     e.d_desig = cpath;
     e.d_isModuleName = isModuleName;
     e.d_modified = QDateTime::currentDateTime();
@@ -59,6 +65,30 @@ void FileCache::removeFile(const QString& path)
     d_lock.unlock();
 }
 
+void FileCache::copyFrom(const FileCache& rhs)
+{
+    if( &rhs == this )
+        return;
+    rhs.d_lock.lockForRead();
+    const Files files = rhs.d_files;
+    const Files disk = rhs.d_disk;
+    const QHash<QString,quint64> used = rhs.d_used;
+    const QMap<quint64,QString> lru = rhs.d_lru;
+    const quint64 tick = rhs.d_tick;
+    const qint64 diskBytes = rhs.d_diskBytes;
+    const qint64 budget = rhs.d_budget;
+    rhs.d_lock.unlock();
+    d_lock.lockForWrite();
+    d_files = files;
+    d_disk = disk;
+    d_used = used;
+    d_lru = lru;
+    d_tick = tick;
+    d_diskBytes = diskBytes;
+    d_budget = budget;
+    d_lock.unlock();
+}
+
 FileCache::Entry FileCache::getFile(const QString& path, bool* found) const
 {
     Entry res;
@@ -84,3 +114,150 @@ FileCache::Entry FileCache::getFile(const QString& path, bool* found) const
 
     return res;
 }
+
+FileCache::Entry FileCache::readFile(const QString& path, bool* found)
+{
+#ifdef _USE_CANONOCALS
+    const QString cpath = QFileInfo(path).canonicalFilePath();
+#else
+    const QString cpath = path;
+#endif
+    if( found )
+        *found = false;
+
+    d_lock.lockForRead();
+    Files::const_iterator i = d_files.find(cpath);
+    if( i != d_files.end() )
+    {
+        const Entry res = i.value();
+        d_lock.unlock();
+        if( found )
+            *found = true;
+        return res;
+    }
+    d_lock.unlock();
+
+    // taken before the file is read; if the file changes in between, the next call reads it again
+    const QByteArray id = identity(cpath);
+    if( id.isEmpty() )
+        return Entry();
+
+    d_lock.lockForWrite();
+    Files::iterator j = d_disk.find(cpath);
+    if( j != d_disk.end() && j.value().d_id == id )
+    {
+        const Entry res = j.value();
+        d_lru.remove( d_used.value(cpath) );
+        d_used[cpath] = ++d_tick;
+        d_lru.insert( d_tick, cpath );
+        d_lock.unlock();
+        if( found )
+            *found = true;
+        return res;
+    }
+    d_lock.unlock();
+
+    // the content is copied, so the cached text and the ASTs referring to it are not affected if the file
+    // is modified or truncated on disk
+    QFile f(cpath);
+    if( !f.open(QIODevice::ReadOnly) )
+        return Entry();
+    Entry e;
+    e.d_desig = cpath;
+    e.d_modified = QFileInfo(f).lastModified();
+    e.d_id = id;
+    e.d_code = f.readAll();
+    e.d_size = e.d_code.size();
+    e.d_hash = hash(e.d_code);
+    f.close();
+    const qint64 size = e.d_size;
+
+    d_lock.lockForWrite();
+    j = d_disk.find(cpath);
+    if( j != d_disk.end() )
+    {
+        d_diskBytes -= j.value().d_size;
+        d_lru.remove( d_used.value(cpath) );
+    }
+    d_disk[cpath] = e;
+    d_diskBytes += size;
+    d_used[cpath] = ++d_tick;
+    d_lru.insert( d_tick, cpath );
+    evict();
+    d_lock.unlock();
+
+    if( found )
+        *found = true;
+    return e;
+}
+
+void FileCache::evict()
+{
+    // the most recently read file is kept even if it alone exceeds the budget; entries still referenced
+    // by a caller share the text until released
+    while( d_diskBytes > d_budget && d_lru.size() > 1 )
+    {
+        const QString path = d_lru.begin().value();
+        d_lru.erase( d_lru.begin() );
+        d_used.remove(path);
+        d_diskBytes -= d_disk.value(path).d_size;
+        d_disk.remove(path);
+    }
+}
+
+void FileCache::setBudget(qint64 bytes)
+{
+    d_lock.lockForWrite();
+    d_budget = bytes;
+    evict();
+    d_lock.unlock();
+}
+
+qint64 FileCache::getBudget() const
+{
+    d_lock.lockForRead();
+    const qint64 res = d_budget;
+    d_lock.unlock();
+    return res;
+}
+
+qint64 FileCache::getDiskBytes() const
+{
+    d_lock.lockForRead();
+    const qint64 res = d_diskBytes;
+    d_lock.unlock();
+    return res;
+}
+
+QByteArray FileCache::hash(const QByteArray& code)
+{
+    return QCryptographicHash::hash( code, QCryptographicHash::Sha1 );
+}
+
+QByteArray FileCache::identity(const QString& path)
+{
+    // the modification time alone misses edits within its resolution and files replaced by older ones
+    QByteArray res;
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if( ::stat( QFile::encodeName(path).constData(), &st ) != 0 || !S_ISREG(st.st_mode) )
+        return res;
+#ifdef Q_OS_MAC
+    const struct timespec& mt = st.st_mtimespec;
+    const struct timespec& ct = st.st_ctimespec;
+#else
+    const struct timespec& mt = st.st_mtim;
+    const struct timespec& ct = st.st_ctim;
+#endif
+    const qint64 fields[] = { qint64(st.st_dev), qint64(st.st_ino), qint64(st.st_size),
+                              qint64(mt.tv_sec), qint64(mt.tv_nsec), qint64(ct.tv_sec), qint64(ct.tv_nsec) };
+    res = QByteArray( (const char*)fields, sizeof(fields) );
+#else
+    QFileInfo info(path);
+    if( !info.isFile() )
+        return res;
+    res = QByteArray::number(info.size()) + ":" + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) +
+            ":" + QByteArray::number(info.metadataChangeTime().toMSecsSinceEpoch());
+#endif
+    return res;
+}
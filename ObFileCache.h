@@ -21,6 +21,7 @@
 */
 
 #include <QHash>
+#include <QMap>
 #include <QObject>
 #include <QReadWriteLock>
 #include <QStringList>
@@ -33,25 +34,46 @@ namespace Ob
     class FileCache : public QObject
     {
         // this class is thread-safe
+        // Files added with addFile (i.e. edited or built-in) are kept until removed. Files read from disk by
+        // readFile are kept as long as they fit into the budget; the least recently used ones are dropped first.
+        // A file read from disk is read again as soon as its identity (see identity()) changes.
     public:
         struct Entry
         {
             QString d_desig; // file path or module name
             bool d_isModuleName;
             QByteArray d_code;
+            QByteArray d_hash; // of d_code
             QDateTime d_modified;
-            Entry():d_isModuleName(false) {}
+            qint64 d_size; // on disk
+            QByteArray d_id; // identity of the file on disk when it was read
+            Entry():d_isModuleName(false),d_size(-1) {}
         };
 
         explicit FileCache(QObject *parent = 0);
 
         void addFile( const QString& path, const QByteArray& code, bool isModuleName = false );
         void removeFile( const QString& path );
-        Entry getFile( const QString& path, bool* found = 0) const;
+        Entry getFile( const QString& path, bool* found = 0) const; // only files added with addFile
+        Entry readFile( const QString& path, bool* found = 0 ); // the added file or otherwise the one on disk
+        void copyFrom( const FileCache& ); // replaces all entries by the ones of the other cache
 
+        void setBudget( qint64 bytes ); // for files read from disk
+        qint64 getBudget() const;
+        qint64 getDiskBytes() const;
+
+        static QByteArray hash( const QByteArray& code );
+        static QByteArray identity( const QString& path ); // empty if not a file
     private:
+        void evict();
         typedef QHash<QString,Entry> Files; // filepath -> Entry
         Files d_files;
+        Files d_disk;
+        QHash<QString,quint64> d_used; // filepath -> tick of the last readFile, for d_disk
+        QMap<quint64,QString> d_lru; // tick -> filepath, for d_disk
+        quint64 d_tick;
+        qint64 d_diskBytes;
+        qint64 d_budget;
         mutable QReadWriteLock d_lock;
     };
 }
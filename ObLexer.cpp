@@ -20,23 +20,43 @@
 #include "ObLexer.h"
 #include "ObErrors.h"
 #include "ObFileCache.h"
+#include "ObSymbolTable.h"
+#include "ObScan.h"
 #include <QBuffer>
 #include <QFile>
+#include <QFileInfo>
 #include <QIODevice>
 #include <QtDebug>
 #include <ctype.h>
 using namespace Ob;
 
-QHash<QByteArray,QByteArray> Lexer::d_symbols;
-
 Lexer::Lexer(QObject *parent) : QObject(parent),
-    d_lastToken(Tok_Invalid),d_lineNr(0),d_colNr(0),d_in(0),d_err(0),d_fcache(0),
+    d_lineNr(0),d_colNr(0),d_in(0),d_err(0),d_fcache(0),
     d_ignoreComments(true), d_packComments(true),d_enableExt(false), d_sensExt(false),
-    d_sensed(false), d_sloc(0), d_lineCounted(false)
+    d_sensed(false), d_sloc(0), d_lineCounted(false), d_pos(0), d_mapped(0), d_bufMode(false),
+    d_fileId(0), d_ringStart(0), d_ringCount(0)
 {
 
 }
 
+void Lexer::resetState(const QString& sourcePath, const QDateTime& ts)
+{
+    d_lineNr = 0;
+    d_colNr = 0;
+    d_line.clear();
+    d_ringStart = 0;
+    d_ringCount = 0;
+    d_sourcePath = sourcePath;
+    d_fileId = Token::toFileId(sourcePath);
+    d_sensed = false;
+    d_sloc = 0;
+    d_lineCounted = false;
+    if( ts.isValid() )
+        d_when = ts;
+    else
+        d_when = QDateTime::currentDateTime();
+}
+
 void Lexer::setStream(QIODevice* in, const QString& sourcePath, const QDateTime& ts)
 {
     if( in == 0 )
@@ -46,17 +66,9 @@ void Lexer::setStream(QIODevice* in, const QString& sourcePath, const QDateTime&
         if( d_in != 0 && d_in->parent() == this )
             d_in->deleteLater();
         d_in = in;
-        d_lineNr = 0;
-        d_colNr = 0;
-        d_sourcePath = sourcePath;
-        d_lastToken = Tok_Invalid;
-        d_sensed = false;
-        d_sloc = 0;
-        d_lineCounted = false;
-        if( ts.isValid() )
-            d_when = ts;
-        else
-            d_when = QDateTime::currentDateTime();
+        d_bufMode = false;
+        d_buf.clear();
+        resetState( sourcePath, ts );
 
 #if 0
         if( isV4File(d_in) )
@@ -135,14 +147,72 @@ bool Lexer::setStream(const QString& sourcePath)
     return true;
 }
 
-Token Lexer::nextToken()
+void Lexer::setBuffer(const QByteArray& text, const QString& sourcePath, const QDateTime& ts)
 {
-    Token t;
-    if( !d_buffer.isEmpty() )
+    if( d_in != 0 && d_in->parent() == this )
+        d_in->deleteLater();
+    d_in = 0;
+    d_bufMode = true;
+    resetState( sourcePath, ts );
+    d_lineStarts.clear();
+    d_pos = 0;
+
+    QBuffer in;
+    in.setData(text);
+    in.open(QIODevice::ReadOnly);
+    const bool oberonFormat = isV4File(&in) || inferTextRange(&in).first != 0;
+    if( oberonFormat )
     {
-        t = d_buffer.first();
-        d_buffer.pop_front();
+        in.reset();
+        d_buf = extractText(&in); // Oberon file formats have to be converted; this is a copy
     }else
+    {
+        d_buf = text;
+        if( d_buf.size() >= 3 && quint8(d_buf[0]) == 0xef && quint8(d_buf[1]) == 0xbb && quint8(d_buf[2]) == 0xbf )
+            d_pos = 3; // skip BOM
+    }
+}
+
+bool Lexer::mapFile(const QString& sourcePath)
+{
+    if( d_mapped )
+        delete d_mapped; // also unmaps
+    d_mapped = new QFile(sourcePath,this);
+    if( !d_mapped->open(QIODevice::ReadOnly) )
+    {
+        delete d_mapped;
+        d_mapped = 0;
+        return false;
+    }
+    const QDateTime ts = QFileInfo(*d_mapped).lastModified();
+    const qint64 size = d_mapped->size();
+    uchar* data = size > 0 ? d_mapped->map(0,size) : 0;
+    if( data )
+        // the mapping lives as long as d_mapped, i.e. as long as this lexer or until the next mapFile
+        setBuffer( QByteArray::fromRawData( (const char*)data, size ), sourcePath, ts );
+    else
+        setBuffer( d_mapped->readAll(), sourcePath, ts );
+    return true;
+}
+
+void Lexer::seek(quint32 lineStart, quint32 lineNr, quint16 colNr)
+{
+    Q_ASSERT( d_bufMode && lineNr > 0 && colNr > 0 );
+    d_ringStart = 0;
+    d_ringCount = 0;
+    d_pos = qMin( int(lineStart), d_buf.size() );
+    d_lineNr = lineNr - 1;
+    d_lineStarts.resize( lineNr - 1 ); // keep the index of the following lines
+    nextLine();
+    d_colNr = colNr - 1;
+}
+
+Token Lexer::nextToken()
+{
+    Token t;
+    if( d_ringCount > 0 )
+        t = popFront();
+    else
         t = nextTokenImp();
     while( t.d_type == Tok_Comment && d_ignoreComments )
         t = nextToken();
@@ -151,15 +221,31 @@ Token Lexer::nextToken()
 
 Token Lexer::peekToken(quint8 lookAhead)
 {
-    Q_ASSERT( lookAhead > 0 );
-    while( d_buffer.size() < lookAhead )
+    Q_ASSERT( lookAhead > 0 && lookAhead < RingLen );
+    while( d_ringCount < lookAhead )
     {
         Token t = nextTokenImp();
         while( t.d_type == Tok_Comment && d_ignoreComments )
             t = nextTokenImp();
-        d_buffer.push_back( t );
+        pushBack( t );
     }
-    return d_buffer[ lookAhead - 1 ];
+    return d_ring[ ( d_ringStart + lookAhead - 1 ) & ( RingLen - 1 ) ];
+}
+
+void Lexer::pushBack(const Token& t)
+{
+    Q_ASSERT( d_ringCount < RingLen );
+    d_ring[ ( d_ringStart + d_ringCount ) & ( RingLen - 1 ) ] = t;
+    d_ringCount++;
+}
+
+Token Lexer::popFront()
+{
+    Q_ASSERT( d_ringCount > 0 );
+    const Token t = d_ring[d_ringStart];
+    d_ringStart = ( d_ringStart + 1 ) & ( RingLen - 1 );
+    d_ringCount--;
+    return t;
 }
 
 QList<Token> Lexer::tokens(const QString& code)
@@ -186,12 +272,12 @@ QList<Token> Lexer::tokens(const QByteArray& code, const QString& path)
 
 QByteArray Lexer::getSymbol(const QByteArray& str)
 {
-    if( str.isEmpty() )
-        return str;
-    QByteArray& sym = d_symbols[str];
-    if( sym.isEmpty() )
-        sym = str;
-    return sym;
+    return SymbolTable::inst()->intern(str);
+}
+
+quint32 Lexer::getSymbolId(const QByteArray& sym)
+{
+    return SymbolTable::idOf(sym);
 }
 
 static inline bool isHexDigit( char c )
@@ -202,16 +288,16 @@ static inline bool isHexDigit( char c )
 
 Token Lexer::nextTokenImp()
 {
-    if( d_in == 0 )
+    if( d_in == 0 && !d_bufMode )
         return token(Tok_Eof);
     skipWhiteSpace();
 
     while( d_colNr >= d_line.size() )
     {
-        if( d_in->atEnd() )
+        if( atEnd() )
         {
             Token t = token( Tok_Eof, 0 );
-            if( d_in->parent() == this )
+            if( d_in && d_in->parent() == this )
                 d_in->deleteLater();
             return t;
         }
@@ -247,12 +333,12 @@ Token Lexer::nextTokenImp()
         else if( tt == Tok_2Slash )
         {
             const int len = d_line.size() - d_colNr;
-            return token( Tok_Comment, len, d_line.mid(d_colNr,len) );
+            return token( Tok_Comment, len, d_ignoreComments ? QByteArray() : d_line.mid(d_colNr,len) );
         }else if( tt == Tok_Invalid || pos == d_colNr )
             return token( Tok_Invalid, 1, QString("unexpected character '%1' %2").arg(char(ch)).arg(int(ch)).toUtf8() );
         else {
             const int len = pos - d_colNr;
-            return token( tt, len, d_line.mid(d_colNr,len) );
+            return token( tt, len, slice(d_colNr,len) );
         }
     }
     Q_ASSERT(false);
@@ -261,25 +347,61 @@ Token Lexer::nextTokenImp()
 
 int Lexer::skipWhiteSpace()
 {
-    const int colNr = d_colNr;
-    while( d_colNr < d_line.size() && ( ( ::isspace( d_line[d_colNr] ) || d_line[d_colNr] == char(28) ) ) )
-        d_colNr++;
-    return d_colNr - colNr;
+    if( d_colNr >= d_line.size() )
+        return 0;
+    const int n = Scan::skipSpace( d_line.constData() + d_colNr, d_line.size() - d_colNr );
+    d_colNr += n;
+    return n;
 }
 
 void Lexer::nextLine()
 {
     d_colNr = 0;
     d_lineNr++;
-    d_line = d_in->readLine();
     d_lineCounted = false;
 
+    if( d_bufMode )
+    {
+        // same semantics as QIODevice::readLine, but d_line is only a view into d_buf
+        const char* start = d_buf.constData() + d_pos;
+        const int left = d_buf.size() - d_pos;
+        const char* nl = (const char*)::memchr( start, '\n', left );
+        const int len = nl ? nl - start + 1 : left;
+        d_lineStarts.append(d_pos);
+        d_pos += len;
+        int chop = 0;
+        if( len >= 2 && start[len-2] == '\r' && start[len-1] == '\n' )
+            chop = 2;
+        else if( len >= 1 && ( start[len-1] == '\n' || start[len-1] == '\r' || start[len-1] == '\025' ) )
+            chop = 1;
+        d_line = QByteArray::fromRawData( start, len - chop );
+        return;
+    }
+
+    d_line = d_in->readLine();
+
     if( d_line.endsWith("\r\n") )
         d_line.chop(2);
     else if( d_line.endsWith('\n') || d_line.endsWith('\r') || d_line.endsWith('\025') )
         d_line.chop(1);
 }
 
+bool Lexer::atEnd() const
+{
+    if( d_bufMode )
+        return d_pos >= d_buf.size();
+    else
+        return d_in->atEnd();
+}
+
+QByteArray Lexer::slice(int pos, int len) const
+{
+    if( d_bufMode )
+        return QByteArray::fromRawData( d_line.constData() + pos, len ); // the value is interned or copied by token()
+    else
+        return d_line.mid(pos,len);
+}
+
 int Lexer::lookAhead(int off) const
 {
     if( int( d_colNr + off ) < d_line.size() )
@@ -294,15 +416,10 @@ Token Lexer::token(TokenType tt, int len, const QByteArray& val)
     if( tt != Tok_Invalid && tt != Tok_Comment && tt != Tok_Eof )
         countLine();
 
-    QByteArray v = val;
-    if( tt != Tok_Comment && tt != Tok_Invalid )
-        v = getSymbol(v);
-    Token t( tt, d_lineNr, d_colNr + 1, len, v );
-    d_lastToken = t;
+    Token t( tt, d_lineNr, d_colNr + 1, len, val, d_fileId ); // interns or copies val
     d_colNr += len;
-    t.d_sourcePath = d_sourcePath;
     if( tt == Tok_Invalid && d_err != 0 )
-        d_err->error(Errors::Syntax, t.d_sourcePath, t.d_lineNr, t.d_colNr, t.d_val );
+        d_err->error(Errors::Syntax, d_sourcePath, t.d_lineNr, t.d_colNr, val );
     return t;
 }
 
@@ -318,16 +435,13 @@ static inline bool isAllLowerCase( const QByteArray& str )
 
 Token Lexer::ident()
 {
-    int off = 1;
-    while( true )
-    {
-        const char c = lookAhead(off);
-        if( !::isalnum(c) && c != '_' )
-            break;
-        else
-            off++;
-    }
-    const QByteArray str = d_line.mid(d_colNr, off );
+    const char* line = d_line.constData() + d_colNr;
+    const int len = d_line.size() - d_colNr;
+    int off = 1 + Scan::identLen( line + 1, len - 1 );
+    // Scan::identLen stops at non-ASCII bytes; take them into the identifier so it is reported as a whole
+    while( off < len && quint8(line[off]) >= 0x80 )
+        off += 1 + Scan::identLen( line + off + 1, len - off - 1 );
+    const QByteArray str = slice(d_colNr, off );
     if( !isAscii(str) )
         return token( Tok_Invalid, off, "invalid characters in identifier" );
     Q_ASSERT( !str.isEmpty() );
@@ -437,7 +551,7 @@ Token Lexer::number()
         ; // look for decimal point but not for range
     }else if( o1 == '.'  )
     {
-        if( !checkDecNumber(d_line.mid(d_colNr, off) ) )
+        if( !checkDecNumber(slice(d_colNr, off) ) )
                 return token( Tok_Invalid, off, "invalid mantissa" );
         commaPos = off;
         off++;
@@ -478,7 +592,7 @@ Token Lexer::number()
             }
         }
     }
-    QByteArray str = d_line.mid(d_colNr, off );
+    QByteArray str = slice(d_colNr, off );
     Q_ASSERT( !str.isEmpty() );
     if( isHex && !checkHexNumber(str) )
         return token( Tok_Invalid, off, "invalid hexadecimal integer" );
@@ -540,7 +654,13 @@ void Lexer::parseComment( const QByteArray& str, int& pos, int& level )
     enum State { Idle, Lb, Star } state = Idle;
     while( pos < str.size() )
     {
-        const char* tmp = str.constData() + pos;
+        if( state == Idle )
+        {
+            // only a bracket or a star can change the state
+            pos += Scan::findEither( str.constData() + pos, str.size() - pos, '(', '*' );
+            if( pos >= str.size() )
+                break;
+        }
         const char c = str[pos++];
         switch( state )
         {
@@ -899,39 +1019,40 @@ Token Lexer::comment()
     const int startCol = d_colNr;
 
 
+    // the text is not needed if the comment is skipped anyway
+    const bool collect = !d_ignoreComments || !d_packComments;
     int level = 0;
     int pos = d_colNr;
     parseComment( d_line, pos, level );
-    QByteArray str = d_line.mid(d_colNr,pos-d_colNr);
-    while( level > 0 && !d_in->atEnd() )
+    QByteArray str;
+    if( collect )
+        str = d_line.mid(d_colNr,pos-d_colNr);
+    while( level > 0 && !atEnd() )
     {
         nextLine();
         pos = 0;
         parseComment( d_line, pos, level );
+        if( !collect )
+            continue;
         if( !str.isEmpty() )
             str += '\n';
         str += d_line.mid(d_colNr,pos-d_colNr);
     }
-    if( d_packComments && level > 0 && d_in->atEnd() )
+    if( d_packComments && level > 0 && atEnd() )
     {
         d_colNr = d_line.size();
-        Token t( Tok_Invalid, startLine, startCol + 1, str.size(), tr("non-terminated comment").toLatin1() );
-        t.d_sourcePath = d_sourcePath;
+        Token t( Tok_Invalid, startLine, startCol + 1, str.size(), tr("non-terminated comment").toLatin1(), d_fileId );
         if( d_err )
-            d_err->error(Errors::Syntax, t.d_sourcePath, t.d_lineNr, t.d_colNr, t.d_val );
+            d_err->error(Errors::Syntax, d_sourcePath, t.d_lineNr, t.d_colNr, t.getVal() );
         return t;
     }
     // Col + 1 weil wir immer bei Spalte 1 beginnen, nicht bei Spalte 0
-    Token t( ( d_packComments ? Tok_Comment : Tok_Latt ), startLine, startCol + 1, str.size(), str );
-    t.d_sourcePath = d_sourcePath;
-    d_lastToken = t;
+    Token t( ( d_packComments ? Tok_Comment : Tok_Latt ), startLine, startCol + 1, str.size(), str, d_fileId );
     d_colNr = pos;
     if( !d_packComments && level == 0 )
     {
-        Token t(Tok_Ratt,d_lineNr, pos - 2 + 1, 2 );
-        t.d_sourcePath = d_sourcePath;
-        d_lastToken = t;
-        d_buffer.append( t );
+        Token t(Tok_Ratt,d_lineNr, pos - 2 + 1, 2, QByteArray(), d_fileId );
+        pushBack( t );
     }
     return t;
 }
@@ -956,17 +1077,12 @@ static bool isPotentialIdent( const QByteArray& str )
 Token Lexer::string()
 {
     const char quote = lookAhead(0);
-    int off = 1;
-    while( true )
-    {
-        const char c = lookAhead(off);
-        off++;
-        if( c == quote )
-            break;
-        if( c == 0 )
-            return token( Tok_Invalid, off, "non-terminated string" );
-    }
-    const QByteArray str = d_line.mid(d_colNr, off );
+    const int left = d_line.size() - d_colNr - 1;
+    const int i = Scan::findEither( d_line.constData() + d_colNr + 1, left, quote, 0 );
+    const int off = i + 2; // including both quotes
+    if( i == left || d_line[d_colNr + 1 + i] == 0 )
+        return token( Tok_Invalid, off, "non-terminated string" );
+    const QByteArray str = slice(d_colNr, off );
 #if 0
     const QByteArray cropped = str.mid(1,str.size()-2);
     const QByteArray trimmed = str.trimmed();
@@ -1018,7 +1134,7 @@ Token Lexer::hexstring()
     int pos = d_colNr + 1;
     int res = readHex(str, d_line, pos);
 
-    while( res == HEX_PENDING && !d_in->atEnd() )
+    while( res == HEX_PENDING && !atEnd() )
     {
         nextLine();
         countLine();
@@ -1028,10 +1144,9 @@ Token Lexer::hexstring()
     if( d_packComments && res != HEX_END )
     {
         d_colNr = pos;
-        Token t( Tok_Invalid, startLine, startCol + 1, str.size(), tr("non-terminated hexadecimal string").toLatin1() );
-        t.d_sourcePath = d_sourcePath;
+        Token t( Tok_Invalid, startLine, startCol + 1, str.size(), tr("non-terminated hexadecimal string").toLatin1(), d_fileId );
         if( d_err )
-            d_err->error(Errors::Syntax, t.d_sourcePath, t.d_lineNr, t.d_colNr, t.d_val );
+            d_err->error(Errors::Syntax, d_sourcePath, t.d_lineNr, t.d_colNr, t.getVal() );
         return t;
     }
     // else
@@ -1039,24 +1154,18 @@ Token Lexer::hexstring()
     if( d_packComments || ( res == HEX_END && startLine == d_lineNr ) )
     {
         Token t( Tok_hexstring, startLine, startCol + 1,
-                 startLine == d_lineNr ? pos - startCol : str.size(), str );
-        t.d_sourcePath = d_sourcePath;
-        d_lastToken = t;
+                 startLine == d_lineNr ? pos - startCol : str.size(), str, d_fileId );
         d_colNr = pos;
         return t;
     }else
     {
         Token t1( Tok_Dlr, startLine, startCol + 1,
-                 startLine == d_lineNr ? pos - startCol : str.size(), str );
-        t1.d_sourcePath = d_sourcePath;
-        d_lastToken = t1;
+                 startLine == d_lineNr ? pos - startCol : str.size(), str, d_fileId );
         d_colNr = pos;
         if( res == HEX_END )
         {
-            Token t2(Tok_Dlr,d_lineNr, pos - 1, 2 );
-            t2.d_sourcePath = d_sourcePath;
-            d_lastToken = t2;
-            d_buffer.append( t2 );
+            Token t2(Tok_Dlr,d_lineNr, pos - 1, 2, QByteArray(), d_fileId );
+            pushBack( t2 );
         }
         return t1;
     }
@@ -1072,7 +1181,7 @@ bool Lexer::isHexstring(int off) const
         if( !isHexDigit(ch) && !::isspace(ch) )
             return false;
     }
-    const QByteArray buf = d_in->peek(1000); // RISK
+    const QByteArray buf = d_bufMode ? d_buf.mid(d_pos,1000) : d_in->peek(1000); // RISK
     for( int i = 0; i < buf.size(); i++ )
     {
         const char ch = buf[i];
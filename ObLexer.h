@@ -24,8 +24,10 @@
 #include <Oberon/ObToken.h>
 #include <QDateTime>
 #include <QHash>
+#include <QVector>
 
 class QIODevice;
+class QFile;
 
 namespace Ob
 {
@@ -39,6 +41,9 @@ namespace Ob
 
         void setStream( QIODevice*, const QString& sourcePath, const QDateTime& ts = QDateTime() );
         bool setStream(const QString& sourcePath);
+        // whole-buffer mode: lines and token values are views into text, which is shared, not copied
+        void setBuffer( const QByteArray& text, const QString& sourcePath, const QDateTime& ts = QDateTime() );
+        bool mapFile( const QString& sourcePath ); // whole-buffer mode with the file mapped to memory
         void setErrors(Errors* p) { d_err = p; }
         void setCache(FileCache* p) { d_fcache = p; }
         void setIgnoreComments( bool b ) { d_ignoreComments = b; }
@@ -53,8 +58,13 @@ namespace Ob
         QList<Token> tokens( const QString& code );
         QList<Token> tokens( const QByteArray& code, const QString& path = QString() );
         quint32 getSloc() const { return d_sloc; }
+        const QVector<quint32>& getLineStarts() const { return d_lineStarts; } // buffer offset of line n+1
+        const QByteArray& getBuffer() const { return d_buf; } // whole-buffer mode
+        // whole-buffer mode: continue with the token at lineNr/colNr; lineStart is the buffer offset of lineNr
+        void seek( quint32 lineStart, quint32 lineNr, quint16 colNr );
 
         static QByteArray getSymbol( const QByteArray& );
+        static quint32 getSymbolId( const QByteArray& sym ); // 0 if sym was never interned
         static void parseComment( const QByteArray& str, int& pos, int& level );
 
         static QPair<quint32,quint32> inferTextRange(QIODevice*); // offset, len (or 0 for all)
@@ -80,6 +90,11 @@ namespace Ob
         Token hexstring();
         bool isHexstring(int off = 1) const;
         void countLine();
+        bool atEnd() const;
+        void pushBack( const Token& );
+        Token popFront();
+        QByteArray slice( int pos, int len ) const;
+        void resetState( const QString& sourcePath, const QDateTime& ts );
     private:
         QIODevice* d_in;
         Errors* d_err;
@@ -87,18 +102,25 @@ namespace Ob
         quint32 d_lineNr;
         quint16 d_colNr;
         QString d_sourcePath;
+        quint32 d_fileId;
         QDateTime d_when;
         QByteArray d_line;
-        QList<Token> d_buffer;
+        QByteArray d_buf; // the whole text in buffer mode
+        QVector<quint32> d_lineStarts;
+        int d_pos; // offset of the next line in d_buf
+        QFile* d_mapped;
+        enum { RingLen = 8 }; // lookahead buffer, power of two
+        Token d_ring[RingLen];
+        quint8 d_ringStart;
+        quint8 d_ringCount;
         quint32 d_sloc; // number of lines of code without empty or comment lines
-        static QHash<QByteArray,QByteArray> d_symbols;
-        Token d_lastToken;
         bool d_ignoreComments;  // don't deliver comment tokens
         bool d_packComments;    // Only deliver one Tok_Comment for (*...*) instead of Tok_Latt and Tok_Ratt
         bool d_enableExt; // Allow for both uppercase and lowercase keywords and for idents with underscores as in C
         bool d_sensExt; // Autosense language extension (first keyword MODULE, module, DEFINITION, definition)
         bool d_sensed;
         bool d_lineCounted;
+        bool d_bufMode;
     };
 }
 
@@ -120,9 +120,9 @@ static QByteArray quali( const SynTree* st )
 {
     Q_ASSERT( st != 0 && st->d_tok.d_type == SynTree::R_qualident );
     if( st->d_children.size() == 1 )
-        return st->d_children.first()->d_tok.d_val;
+        return st->d_children.first()->d_tok.getVal();
     else
-        return st->d_children.first()->d_tok.d_val + "." + st->d_children.last()->d_tok.d_val;
+        return st->d_children.first()->d_tok.getVal() + "." + st->d_children.last()->d_tok.getVal();
 }
 
 LuaGen::LuaGen(CodeModel* mdl):d_mdl(mdl),d_errs(0),d_curMod(0),d_suppressVar(false)
@@ -177,7 +177,7 @@ QByteArray LuaGen::emitModule(const CodeModel::Module* m)
 
     d_cmts.clear();
     if( m->d_def )
-        d_cmts = d_mdl->getComments(m->d_def->d_tok.d_sourcePath);
+        d_cmts = d_mdl->getComments(m->d_def->d_tok.getSourcePath());
     d_nextCmt = 0;
 
     out << "---------- MODULE " << m->d_name << " ----------" << endl;
@@ -241,19 +241,19 @@ static void renderString( QTextStream& out, const SynTree* st )
     {
     case Tok_string:
         // we need obnlj.Str here because Lua __eq only works of lhs and rhs same type
-        out << "obnlj.Str(\"" << luaStringEscape( st->d_tok.d_val.mid(1, st->d_tok.d_val.size() - 2 ) ) << "\")";
+        out << "obnlj.Str(\"" << luaStringEscape( st->d_tok.getVal().mid(1, st->d_tok.getVal().size() - 2 ) ) << "\")";
         break;
     case Tok_hexchar:
         //out << "obnlj.Str(\"" << luaStringEscape(
-        //           QByteArray::fromHex( first->d_tok.d_val.left( first->d_tok.d_val.size() - 1 ) ) ) << "\")";
+        //           QByteArray::fromHex( first->d_tok.getVal().left( first->d_tok.getVal().size() - 1 ) ) ) << "\")";
         out << "obnlj.Str(\"" << QString("\\%1").arg(
-                   st->d_tok.d_val.left( st->d_tok.d_val.size() - 1 ).toUInt(0,16),3,10,QChar('0')
+                   st->d_tok.getVal().left( st->d_tok.getVal().size() - 1 ).toUInt(0,16),3,10,QChar('0')
                    ).toUtf8() << "\")";
         break;
     case Tok_hexstring:
         // TODO: convert to \xxx form?
         out << "obnlj.Str(\"" << luaStringEscape(
-                   QByteArray::fromHex(st->d_tok.d_val.mid(1, st->d_tok.d_val.size() - 2)) ) << "\")";
+                   QByteArray::fromHex(st->d_tok.getVal().mid(1, st->d_tok.getVal().size() - 2)) ) << "\")";
         break;
     default:
         Q_ASSERT( false );
@@ -302,11 +302,11 @@ void LuaGen::emitLiteral(const CodeModel::Unit* ds,const SynTree* st, QTextStrea
         break;
     case SynTree::R_number:
         Q_ASSERT( !st->d_children.first()->d_children.isEmpty() );
-        if( st->d_children.first()->d_children.first()->d_tok.d_val.endsWith('H') )
-            out << "0x" << st->d_children.first()->d_children.first()->d_tok.d_val.left(
-                       st->d_children.first()->d_children.first()->d_tok.d_val.size() - 1 );
+        if( st->d_children.first()->d_children.first()->d_tok.getVal().endsWith('H') )
+            out << "0x" << st->d_children.first()->d_children.first()->d_tok.getVal().left(
+                       st->d_children.first()->d_children.first()->d_tok.getVal().size() - 1 );
         else
-            out << st->d_children.first()->d_children.first()->d_tok.d_val;
+            out << st->d_children.first()->d_children.first()->d_tok.getVal();
         break;
 #ifndef OB_OBN2
     case Tok_TRUE:
@@ -458,7 +458,7 @@ bool LuaGen::emitDesig(const CodeModel::Unit* ds, const CodeModel::NamedThing* p
         Q_ASSERT( dop.d_sym );
         Q_ASSERT( dop.d_arg->d_tok.d_type == Tok_ident );
         //out << escape(dop.d_sym->d_name);
-        out << escape(dop.d_arg->d_tok.d_val); // sonst wird bei importierten Modulen deren Name statt der lokale name verwendet!
+        out << escape(dop.d_arg->d_tok.getVal()); // sonst wird bei importierten Modulen deren Name statt der lokale name verwendet!
         printedSomething = true;
         break;
     case CodeModel::PointerOp:
@@ -1006,7 +1006,7 @@ bool LuaGen::emitPredefProc(const CodeModel::Unit* ds, const CodeModel::DesigOpL
         {
             out << "obnlj.ASSERT(";
             emitExpression(ds, args.first(), out, level );
-            out << ",\"" << args.first()->d_tok.d_sourcePath << "\"," << args.first()->d_tok.d_lineNr << ")";
+            out << ",\"" << args.first()->d_tok.getSourcePath() << "\"," << args.first()->d_tok.d_lineNr << ")";
             return true;
         }
         error( Errors::Semantics, dopl.last().d_arg, tr("'ASSERT()' with invalid arguments") );
@@ -1264,7 +1264,7 @@ void LuaGen::emitCaseStatement(const CodeModel::Unit* ds, const SynTree* st, QTe
         // type case
         SynTree* id = CodeModel::flatten(st->d_children[1]);
         Q_ASSERT( id->d_tok.d_type == Tok_ident );
-        const CodeModel::NamedThing* var = ds->findByName( id->d_tok.d_val ) ;
+        const CodeModel::NamedThing* var = ds->findByName( id->d_tok.getVal() ) ;
         Q_ASSERT( var != 0 );
 
         int n = 0;
@@ -1302,7 +1302,7 @@ void LuaGen::emitCaseStatement(const CodeModel::Unit* ds, const SynTree* st, QTe
             CodeModel::Unit scope;
             scope.d_outer = const_cast<CodeModel::Unit*>(ds);
             CodeModel::TypeAlias alias;
-            alias.d_name = id->d_tok.d_val;
+            alias.d_name = id->d_tok.getVal();
             alias.d_newType = newType;
             alias.d_alias = const_cast<CodeModel::NamedThing*>(var);
             alias.d_var = var->d_var;
@@ -1377,7 +1377,7 @@ void LuaGen::emitForStatement(const CodeModel::Unit* ds, const SynTree* st, QTex
     Q_ASSERT( st != 0 && st->d_tok.d_type == SynTree::R_ForStatement && st->d_children.size() >= 9 &&
             st->d_children[1]->d_tok.d_type == Tok_ident );
 #if 0
-    out << ws(level) << "for " << st->d_children[1]->d_tok.d_val << " = ";
+    out << ws(level) << "for " << st->d_children[1]->d_tok.getVal() << " = ";
     emitExpression(ds,st->d_children[3],out,level);
     out << ", ";
     emitExpression(ds,st->d_children[5],out,level);
@@ -1393,7 +1393,7 @@ void LuaGen::emitForStatement(const CodeModel::Unit* ds, const SynTree* st, QTex
     out << ws(level) << "end" << endl;
 #endif
     // the same as while because in Lua the TO expression is only executed once
-    out << ws(level) << st->d_children[1]->d_tok.d_val << " = "; // ASSIG
+    out << ws(level) << st->d_children[1]->d_tok.getVal() << " = "; // ASSIG
     emitExpression(ds,st->d_children[3],out,level);
     out << endl;
 
@@ -1405,7 +1405,7 @@ void LuaGen::emitForStatement(const CodeModel::Unit* ds, const SynTree* st, QTex
         if( ok )
             inc = res;
     }
-    out << ws(level) << "while " << st->d_children[1]->d_tok.d_val;
+    out << ws(level) << "while " << st->d_children[1]->d_tok.getVal();
     if( inc > 0 )
         out << " <= ";
     else
@@ -1415,8 +1415,8 @@ void LuaGen::emitForStatement(const CodeModel::Unit* ds, const SynTree* st, QTex
     SynTree* stat = CodeModel::findFirstChild( st, SynTree::R_StatementSequence, 6 );
     Q_ASSERT( stat != 0 );
     emitStatementSeq(ds, stat->d_children, out, level + 1);
-    out << ws(level+1) << st->d_children[1]->d_tok.d_val << " = " << // ASSIG
-           st->d_children[1]->d_tok.d_val << " + " << inc << endl;
+    out << ws(level+1) << st->d_children[1]->d_tok.getVal() << " = " << // ASSIG
+           st->d_children[1]->d_tok.getVal() << " + " << inc << endl;
     out << ws(level) << "end" << endl;
 }
 
@@ -1454,7 +1454,7 @@ void LuaGen::emitComment(const SynTree* st, QTextStream& out, int level )
 
     while( d_nextCmt < d_cmts.size() && d_cmts[d_nextCmt].d_lineNr <= st->d_tok.d_lineNr )
     {
-        const QByteArray str = d_cmts[d_nextCmt++].d_val;
+        const QByteArray str = d_cmts[d_nextCmt++].getVal();
         out << ws(level) << "--[[ " << str.mid(2,str.size()-4) << " ]]--" << endl;
     }
 #endif
@@ -1468,7 +1468,7 @@ void LuaGen::emitLabel(const SynTree* st, QTextStream& out)
     switch( first->d_tok.d_type )
     {
     case Tok_integer:
-        out << first->d_tok.d_val;
+        out << first->d_tok.getVal();
         break;
     case Tok_string:
     case Tok_hexchar:
@@ -1480,7 +1480,7 @@ void LuaGen::emitLabel(const SynTree* st, QTextStream& out)
         break;
     default:
         qWarning() << "unexpected" << SynTree::rToStr(first->d_tok.d_type) <<
-                      first->d_tok.d_sourcePath << first->d_tok.d_lineNr;
+                      first->d_tok.getSourcePath() << first->d_tok.d_lineNr;
         Q_ASSERT( false );
         break;
     }
@@ -120,7 +120,7 @@ void ObxGen::emitModule(const CodeModel::Module* m)
 
     d_cmts.clear();
     if( m->d_def )
-        d_cmts = d_mdl->getComments(m->d_def->d_tok.d_sourcePath);
+        d_cmts = d_mdl->getComments(m->d_def->d_tok.getSourcePath());
     d_nextCmt = 0;
 
     d_isDef = m->d_isDef;
@@ -355,7 +355,7 @@ void ObxGen::ident(const CodeModel::Unit* u, SynTree* st, bool leafIdent)
 {
     Q_ASSERT( st->d_tok.d_type == Tok_ident );
 
-    QByteArray id = st->d_tok.d_val;
+    QByteArray id = st->d_tok.getVal();
 
     bool dontTouchKeyword = false;
 
@@ -592,7 +592,7 @@ void ObxGen::procedureDeclaration(const CodeModel::Unit* u, SynTree* st)
         QByteArrayList attrs;
         if( st->d_children[off]->d_tok.d_type == Tok_ident )
         {
-            attrs << st->d_children[off]->d_tok.d_val.toLower();
+            attrs << st->d_children[off]->d_tok.getVal().toLower();
             off++;
         }
         switch( st->d_children[off]->d_tok.d_type )
@@ -608,9 +608,9 @@ void ObxGen::procedureDeclaration(const CodeModel::Unit* u, SynTree* st)
             }
             break;
         case Tok_integer:
-            attrs << st->d_children[off++]->d_tok.d_val;
+            attrs << st->d_children[off++]->d_tok.getVal();
             for( int i = off; i < st->d_children.size(); i++ )
-                attrs << st->d_children[i]->d_tok.d_val;
+                attrs << st->d_children[i]->d_tok.getVal();
             print(" end");
             if( !attrs.isEmpty() )
             {
@@ -735,7 +735,7 @@ void ObxGen::identdef(const CodeModel::Unit* u, SynTree* st)
 
     SynTree* first = st->d_children.first();
     Q_ASSERT( first->d_tok.d_type == Tok_ident );
-    QByteArray id = first->d_tok.d_val;
+    QByteArray id = first->d_tok.getVal();
     id = escapeName(id);
     print(id,first);
 
@@ -877,7 +877,7 @@ void ObxGen::number(const CodeModel::Unit* u, SynTree* st)
     {
     case Tok_integer:
         {
-            QByteArray num = first->d_tok.d_val.toLower();
+            QByteArray num = first->d_tok.getVal().toLower();
             if( num.endsWith('l') )
                 num[num.size()-1] = 'h';
             print( num, first );
@@ -974,7 +974,7 @@ void ObxGen::selector(const CodeModel::Unit* u, SynTree* st)
         break;
     case Tok_Lbrack:
         Q_ASSERT( st->d_children.size() == 3 );
-        print( first->d_tok.d_val, first );
+        print( first->d_tok.getVal(), first );
         expList( u, st->d_children[1] );
         print( st->d_children.last() );
         break;
@@ -1222,7 +1222,7 @@ void ObxGen::recordType(const CodeModel::Unit* u, SynTree* st)
     if( genUnsafe && flag )
     {
         SynTree* id = CodeModel::flatten(flag, Tok_ident );
-        if( id && id->d_tok.d_val == "union" )
+        if( id && id->d_tok.getVal() == "union" )
             print( "cunion ", first );
         else
             print( "cstruct ", first );
@@ -2142,7 +2142,7 @@ void ObxGen::print(const QByteArray& str, SynTree* curRowCol)
 void ObxGen::print(SynTree* st, bool toLower )
 {
     Q_ASSERT( st );
-    QByteArray str = st->d_tok.d_val;
+    QByteArray str = st->d_tok.getVal();
     if( str.isEmpty() )
         str = tokenTypeString(st->d_tok.d_type);
     if( toLower )
@@ -2189,7 +2189,7 @@ void ObxGen::printComments(SynTree* st)
         {
             if( rowPrinted )
                 space();
-            printComment( d_cmts[d_nextCmt].d_val, true );
+            printComment( d_cmts[d_nextCmt].getVal(), true );
             d_nextCmt++;
         }
     }
@@ -2208,7 +2208,7 @@ void ObxGen::printComments(SynTree* st)
         const int toInsert = d_cmts[d_nextCmt].d_lineNr - prevRow;
         for( int i = 0; i < toInsert; i++ )
             out << endl << ind();
-        const int lines = printComment( d_cmts[d_nextCmt].d_val, true );
+        const int lines = printComment( d_cmts[d_nextCmt].getVal(), true );
         prevRow = d_cmts[d_nextCmt].d_lineNr + lines - 1;
         rowPrinted = true;
         d_nextCmt++;
@@ -2217,7 +2217,7 @@ void ObxGen::printComments(SynTree* st)
     // consider line in progress
     while( d_cmts.size() > d_nextCmt && d_cmts[d_nextCmt].d_lineNr == curRow && d_cmts[d_nextCmt].d_colNr < curCol )
     {
-        printComment( d_cmts[d_nextCmt].d_val, false );
+        printComment( d_cmts[d_nextCmt].getVal(), false );
         d_nextCmt++;
     }
 }
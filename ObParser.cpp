@@ -31,19 +31,19 @@ void Parser::RunParser()
     Parse();
     d_stack.pop();
     if( la->kind != 0 && errors->getErrCount() == before )
-        errors->warning( Errors::Syntax, d_next.d_sourcePath, d_next.d_lineNr, d_next.d_colNr, "found text after end of module");
+        errors->warning( Errors::Syntax, d_next.getSourcePath(), d_next.d_lineNr, d_next.d_colNr, "found text after end of module");
 }
     
 void Parser::SynErr(int n, const char* ctx) {
     if (errDist >= minErrDist)
     {
-       SynErr(d_next.d_sourcePath,d_next.d_lineNr, d_next.d_colNr, n, errors, ctx);
+       SynErr(d_next.getSourcePath(),d_next.d_lineNr, d_next.d_colNr, n, errors, ctx);
     }
 	errDist = 0;
 }
 
 void Parser::SemErr(const char* msg) {
-	if (errDist >= minErrDist) errors->error(Ob::Errors::Semantics,d_cur.d_sourcePath,d_cur.d_lineNr, d_cur.d_colNr, msg);
+	if (errDist >= minErrDist) errors->error(Ob::Errors::Semantics,d_cur.getSourcePath(),d_cur.d_lineNr, d_cur.d_colNr, msg);
 	errDist = 0;
 }
 
@@ -55,8 +55,8 @@ void Parser::Get() {
         switch( d_next.d_type )
         {
         case Ob::Tok_Invalid:
-        	if( !d_next.d_val.isEmpty() )
-            	SynErr( d_next.d_type, d_next.d_val );
+        	if( !d_next.getVal().isEmpty() )
+            	SynErr( d_next.d_type, d_next.getVal() );
             // else errors already handeled in lexer
             break;
         case Ob::Tok_Comment:
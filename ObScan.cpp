@@ -0,0 +1,233 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ObScan.h"
+#include <QtAlgorithms>
+using namespace Ob;
+
+#ifndef OB_NO_SIMD_SCAN
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define OB_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(OB_SCAN_SSE2) && defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define OB_SCAN_AVX2 // needs the target attribute and __builtin_cpu_supports
+#include <immintrin.h>
+#endif
+#endif
+
+static inline bool isSpace( quint8 ch )
+{
+    return ch == ' ' || ( ch >= 9 && ch <= 13 ) || ch == 28;
+}
+
+static inline bool isIdentChar( quint8 ch )
+{
+    return ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' ) || ( ch >= '0' && ch <= '9' ) || ch == '_';
+}
+
+int Scan::skipSpaceScalar(const char* str, int len)
+{
+    int i = 0;
+    while( i < len && isSpace(str[i]) )
+        i++;
+    return i;
+}
+
+int Scan::identLenScalar(const char* str, int len)
+{
+    int i = 0;
+    while( i < len && isIdentChar(str[i]) )
+        i++;
+    return i;
+}
+
+int Scan::findEitherScalar(const char* str, int len, char a, char b)
+{
+    int i = 0;
+    while( i < len && str[i] != a && str[i] != b )
+        i++;
+    return i;
+}
+
+#ifdef OB_SCAN_SSE2
+
+// the comparisons produce 0xff for the bytes which continue the run; the tail is left to the scalar version
+
+static inline __m128i inRange128( __m128i v, char lo, quint8 count ) // lo <= v < lo + count, unsigned
+{
+    const __m128i t = _mm_sub_epi8( v, _mm_set1_epi8(lo) );
+    return _mm_cmpeq_epi8( _mm_min_epu8( t, _mm_set1_epi8( char(count - 1) ) ), t );
+}
+
+static int skipSpaceSse2(const char* str, int len)
+{
+    int i = 0;
+    for( ; i + 16 <= len; i += 16 )
+    {
+        const __m128i v = _mm_loadu_si128( (const __m128i*)( str + i ) );
+        const __m128i run = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8(' ') ),
+                                                        _mm_cmpeq_epi8( v, _mm_set1_epi8(28) ) ),
+                                          inRange128( v, 9, 5 ) );
+        const quint32 stop = ~quint32( _mm_movemask_epi8(run) ) & 0xffff;
+        if( stop )
+            return i + qCountTrailingZeroBits(stop);
+    }
+    return i + Scan::skipSpaceScalar( str + i, len - i );
+}
+
+static int identLenSse2(const char* str, int len)
+{
+    int i = 0;
+    for( ; i + 16 <= len; i += 16 )
+    {
+        const __m128i v = _mm_loadu_si128( (const __m128i*)( str + i ) );
+        const __m128i lower = _mm_or_si128( v, _mm_set1_epi8(0x20) ); // 'A'..'Z' -> 'a'..'z'
+        const __m128i run = _mm_or_si128( _mm_or_si128( inRange128( lower, 'a', 26 ), inRange128( v, '0', 10 ) ),
+                                          _mm_cmpeq_epi8( v, _mm_set1_epi8('_') ) );
+        const quint32 stop = ~quint32( _mm_movemask_epi8(run) ) & 0xffff;
+        if( stop )
+            return i + qCountTrailingZeroBits(stop);
+    }
+    return i + Scan::identLenScalar( str + i, len - i );
+}
+
+static int findEitherSse2(const char* str, int len, char a, char b)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    int i = 0;
+    for( ; i + 16 <= len; i += 16 )
+    {
+        const __m128i v = _mm_loadu_si128( (const __m128i*)( str + i ) );
+        const quint32 hit = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( v, va ), _mm_cmpeq_epi8( v, vb ) ) );
+        if( hit )
+            return i + qCountTrailingZeroBits(hit);
+    }
+    return i + Scan::findEitherScalar( str + i, len - i, a, b );
+}
+#endif
+
+#ifdef OB_SCAN_AVX2
+#define OB_AVX2 __attribute__((target("avx2")))
+
+OB_AVX2 static inline __m256i inRange256( __m256i v, char lo, quint8 count )
+{
+    const __m256i t = _mm256_sub_epi8( v, _mm256_set1_epi8(lo) );
+    return _mm256_cmpeq_epi8( _mm256_min_epu8( t, _mm256_set1_epi8( char(count - 1) ) ), t );
+}
+
+OB_AVX2 static int skipSpaceAvx2(const char* str, int len)
+{
+    int i = 0;
+    for( ; i + 32 <= len; i += 32 )
+    {
+        const __m256i v = _mm256_loadu_si256( (const __m256i*)( str + i ) );
+        const __m256i run = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8(' ') ),
+                                                              _mm256_cmpeq_epi8( v, _mm256_set1_epi8(28) ) ),
+                                             inRange256( v, 9, 5 ) );
+        const quint32 stop = ~quint32( _mm256_movemask_epi8(run) );
+        if( stop )
+            return i + qCountTrailingZeroBits(stop);
+    }
+    return i + skipSpaceSse2( str + i, len - i );
+}
+
+OB_AVX2 static int identLenAvx2(const char* str, int len)
+{
+    int i = 0;
+    for( ; i + 32 <= len; i += 32 )
+    {
+        const __m256i v = _mm256_loadu_si256( (const __m256i*)( str + i ) );
+        const __m256i lower = _mm256_or_si256( v, _mm256_set1_epi8(0x20) );
+        const __m256i run = _mm256_or_si256( _mm256_or_si256( inRange256( lower, 'a', 26 ), inRange256( v, '0', 10 ) ),
+                                             _mm256_cmpeq_epi8( v, _mm256_set1_epi8('_') ) );
+        const quint32 stop = ~quint32( _mm256_movemask_epi8(run) );
+        if( stop )
+            return i + qCountTrailingZeroBits(stop);
+    }
+    return i + identLenSse2( str + i, len - i );
+}
+
+OB_AVX2 static int findEitherAvx2(const char* str, int len, char a, char b)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    int i = 0;
+    for( ; i + 32 <= len; i += 32 )
+    {
+        const __m256i v = _mm256_loadu_si256( (const __m256i*)( str + i ) );
+        const quint32 hit = _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8( v, va ),
+                                                                   _mm256_cmpeq_epi8( v, vb ) ) );
+        if( hit )
+            return i + qCountTrailingZeroBits(hit);
+    }
+    return i + findEitherSse2( str + i, len - i, a, b );
+}
+#endif
+
+Scan::Level Scan::maxLevel()
+{
+#ifdef OB_SCAN_AVX2
+    if( __builtin_cpu_supports("avx2") )
+        return AVX2;
+#endif
+#ifdef OB_SCAN_SSE2
+    return SSE2;
+#else
+    return Scalar;
+#endif
+}
+
+void Scan::setLevel(Scan::Level l)
+{
+    l = qMin( l, maxLevel() );
+    s_level = l;
+    switch( l )
+    {
+#ifdef OB_SCAN_AVX2
+    case AVX2:
+        s_skipSpace = skipSpaceAvx2;
+        s_identLen = identLenAvx2;
+        s_findEither = findEitherAvx2;
+        break;
+#endif
+#ifdef OB_SCAN_SSE2
+    case SSE2:
+        s_skipSpace = skipSpaceSse2;
+        s_identLen = identLenSse2;
+        s_findEither = findEitherSse2;
+        break;
+#endif
+    default:
+        s_level = Scalar;
+        s_skipSpace = skipSpaceScalar;
+        s_identLen = identLenScalar;
+        s_findEither = findEitherScalar;
+        break;
+    }
+}
+
+Scan::Level Scan::s_level = Scan::Scalar;
+int (*Scan::s_skipSpace)( const char*, int ) = Scan::skipSpaceScalar;
+int (*Scan::s_identLen)( const char*, int ) = Scan::identLenScalar;
+int (*Scan::s_findEither)( const char*, int, char, char ) = Scan::findEitherScalar;
+
+// selects the best level when the library is loaded; until then the (constant initialized) scalar versions are used
+static struct ScanInit { ScanInit() { Scan::setLevel( Scan::maxLevel() ); } } s_init;
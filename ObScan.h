@@ -0,0 +1,57 @@
+#ifndef OBSCAN_H
+#define OBSCAN_H
+
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QtGlobal>
+
+namespace Ob
+{
+    class Scan
+    {
+        // The inner loops of the Lexer on contiguous memory. Each function returns the offset of the first
+        // byte in str[0..len) which ends the run, or len if there is none; no byte outside of this range is
+        // read. SSE2 and AVX2 versions are used if the CPU supports them (see getLevel); define
+        // OB_NO_SIMD_SCAN to only build the scalar versions.
+    public:
+        enum Level { Scalar, SSE2, AVX2 };
+
+        static int skipSpace( const char* str, int len ) { return s_skipSpace(str,len); } // ' ', \t..\r and 28
+        static int identLen( const char* str, int len ) { return s_identLen(str,len); } // [A-Za-z0-9_]
+        static int findEither( const char* str, int len, char a, char b ) { return s_findEither(str,len,a,b); }
+
+        static Level getLevel() { return s_level; }
+        static Level maxLevel(); // supported by this CPU and build
+        static void setLevel( Level ); // at most maxLevel(); not thread-safe, only meant for tests
+
+        // the reference implementations used by Level Scalar
+        static int skipSpaceScalar( const char* str, int len );
+        static int identLenScalar( const char* str, int len );
+        static int findEitherScalar( const char* str, int len, char a, char b );
+    private:
+        Scan();
+        static Level s_level;
+        static int (*s_skipSpace)( const char*, int );
+        static int (*s_identLen)( const char*, int );
+        static int (*s_findEither)( const char*, int, char, char );
+    };
+}
+
+#endif // OBSCAN_H
@@ -0,0 +1,236 @@
+/*
+* Copyright 2019, 2020 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ObSymbolTable.h"
+#include <QtDebug>
+#include <string.h>
+using namespace Ob;
+
+static const QByteArray s_empty;
+
+SymbolTable::SymbolTable()
+{
+}
+
+SymbolTable::~SymbolTable()
+{
+    for( int i = 0; i < ShardCount; i++ )
+    {
+        Shard& s = d_shards[i];
+        Table* t = s.d_table.load();
+        if( t )
+        {
+            delete[] t->d_slots;
+            delete t;
+        }
+        foreach( Table* old, s.d_retired )
+        {
+            delete[] old->d_slots;
+            delete old;
+        }
+        for( int j = 0; j < DirLen; j++ )
+            delete[] s.d_dir[j].load();
+        foreach( char* a, s.d_arenas )
+            delete[] a;
+    }
+}
+
+SymbolTable* SymbolTable::inst()
+{
+    // never deleted; symbols are referenced by all ASTs up to the end of the process
+    static SymbolTable* s_inst = new SymbolTable();
+    return s_inst;
+}
+
+const QByteArray& SymbolTable::intern(const char* str, int len)
+{
+    if( len <= 0 )
+        return s_empty;
+    return internEntry( str, len )->d_str;
+}
+
+SymbolTable::Id SymbolTable::internId(const char* str, int len)
+{
+    if( len <= 0 )
+        return 0;
+    return internEntry( str, len )->d_id;
+}
+
+const SymbolTable::Entry* SymbolTable::internEntry(const char* str, int len)
+{
+    const quint32 h = hash(str,len);
+    const quint32 shardNr = h >> ( 32 - ShardBits );
+    Shard& s = d_shards[shardNr];
+
+    // fast path, no locking
+    const Entry* e = lookup( s.d_table.loadAcquire(), h, str, len );
+    if( e )
+        return e;
+
+    QMutexLocker lock(&s.d_lock);
+    Table* t = s.d_table.loadAcquire();
+    e = lookup( t, h, str, len ); // another thread might have been faster
+    if( e )
+        return e;
+
+    const quint32 index = s.d_count;
+    const quint32 chunk = index >> ChunkBits;
+    if( chunk >= DirLen )
+        qFatal("SymbolTable: maximum number of symbols exceeded");
+    Entry* entries = s.d_dir[chunk].load();
+    if( entries == 0 )
+    {
+        entries = new Entry[ChunkLen];
+        s.d_dir[chunk].storeRelease(entries);
+    }
+    Entry* ne = entries + ( index & ( ChunkLen - 1 ) );
+
+    char* raw = allocate( s, len + 1 );
+    ::memcpy( raw, str, len );
+    raw[len] = 0;
+    ne->d_str = QByteArray::fromRawData( raw, len );
+    ne->d_hash = h;
+    ne->d_id = ( ( index << ShardBits ) | shardNr ) + 1;
+    s.d_count++;
+
+    if( t == 0 || s.d_count * 2 > t->d_cap )
+    {
+        // readers can continue to use the old table; it is only retired, not deleted
+        Table* nt = createTable( t ? t->d_cap * 2 : 64 );
+        if( t )
+        {
+            for( quint32 i = 0; i < t->d_cap; i++ )
+            {
+                Entry* old = t->d_slots[i].load();
+                if( old )
+                    insert( nt, old );
+            }
+            s.d_retired.append(t);
+        }
+        insert( nt, ne );
+        s.d_table.storeRelease(nt);
+    }else
+        insert( t, ne );
+    return ne;
+}
+
+SymbolTable::Id SymbolTable::find(const char* str, int len) const
+{
+    if( len <= 0 )
+        return 0;
+    const quint32 h = hash(str,len);
+    const Shard& s = d_shards[h >> ( 32 - ShardBits )];
+    const Entry* e = lookup( s.d_table.loadAcquire(), h, str, len );
+    if( e == 0 )
+        return 0;
+    return e->d_id;
+}
+
+const QByteArray& SymbolTable::string(SymbolTable::Id id) const
+{
+    if( id == 0 )
+        return s_empty;
+    const quint32 i = id - 1;
+    const Shard& s = d_shards[ i & ( ShardCount - 1 ) ];
+    const quint32 index = i >> ShardBits;
+    if( ( index >> ChunkBits ) >= DirLen )
+        return s_empty;
+    const Entry* entries = s.d_dir[ index >> ChunkBits ].loadAcquire();
+    if( entries == 0 )
+        return s_empty;
+    return entries[ index & ( ChunkLen - 1 ) ].d_str;
+}
+
+quint32 SymbolTable::count() const
+{
+    quint32 res = 0;
+    for( int i = 0; i < ShardCount; i++ )
+    {
+        Shard& s = const_cast<Shard&>(d_shards[i]);
+        QMutexLocker lock(&s.d_lock);
+        res += s.d_count;
+    }
+    return res;
+}
+
+quint32 SymbolTable::hash(const char* str, int len)
+{
+    // FNV-1a
+    quint32 h = 2166136261u;
+    for( int i = 0; i < len; i++ )
+    {
+        h ^= quint8(str[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+const SymbolTable::Entry* SymbolTable::lookup(const SymbolTable::Table* t, quint32 h, const char* str, int len)
+{
+    if( t == 0 )
+        return 0;
+    const quint32 mask = t->d_cap - 1;
+    quint32 i = h & mask;
+    while( true )
+    {
+        const Entry* e = t->d_slots[i].loadAcquire();
+        if( e == 0 )
+            return 0;
+        if( e->d_hash == h && e->d_str.size() == len && ::memcmp( e->d_str.constData(), str, len ) == 0 )
+            return e;
+        i = ( i + 1 ) & mask;
+    }
+}
+
+SymbolTable::Table* SymbolTable::createTable(quint32 cap)
+{
+    Table* t = new Table();
+    t->d_cap = cap;
+    t->d_slots = new QAtomicPointer<Entry>[cap];
+    return t;
+}
+
+void SymbolTable::insert(SymbolTable::Table* t, SymbolTable::Entry* e)
+{
+    const quint32 mask = t->d_cap - 1;
+    quint32 i = e->d_hash & mask;
+    while( t->d_slots[i].load() != 0 )
+        i = ( i + 1 ) & mask;
+    t->d_slots[i].storeRelease(e);
+}
+
+char* SymbolTable::allocate(SymbolTable::Shard& s, quint32 len)
+{
+    if( len > ArenaLen / 4 )
+    {
+        char* block = new char[len];
+        s.d_arenas.append(block);
+        return block;
+    }
+    if( s.d_arenaLeft < len )
+    {
+        s.d_arena = new char[ArenaLen];
+        s.d_arenaLeft = ArenaLen;
+        s.d_arenas.append(s.d_arena);
+    }
+    char* res = s.d_arena;
+    s.d_arena += len;
+    s.d_arenaLeft -= len;
+    return res;
+}
@@ -0,0 +1,90 @@
+#ifndef OBSYMBOLTABLE_H
+#define OBSYMBOLTABLE_H
+
+/*
+* Copyright 2019, 2020 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QByteArray>
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QList>
+
+namespace Ob
+{
+    class SymbolTable
+    {
+        // this class is thread-safe; lookups of existing symbols are lock-free, only the
+        // insertion of a new symbol locks one of the shards.
+        // The characters of a symbol live in an arena which is never freed, so a symbol
+        // (i.e. the QByteArray returned by intern) has a stable constData() pointer.
+    public:
+        typedef quint32 Id; // 0 is the empty symbol
+
+        static SymbolTable* inst();
+
+        const QByteArray& intern( const char* str, int len );
+        const QByteArray& intern( const QByteArray& str ) { return intern( str.constData(), str.size() ); }
+        Id internId( const char* str, int len );
+        Id internId( const QByteArray& str ) { return internId( str.constData(), str.size() ); }
+        Id find( const char* str, int len ) const; // returns 0 if str was never interned
+        const QByteArray& string( Id ) const;
+        quint32 count() const;
+
+        static Id idOf( const QByteArray& sym ) { return inst()->find( sym.constData(), sym.size() ); }
+    private:
+        SymbolTable();
+        ~SymbolTable();
+
+        enum { ShardBits = 6, ShardCount = 1 << ShardBits,
+               ChunkBits = 10, ChunkLen = 1 << ChunkBits, DirLen = 1024, // max 1M symbols per shard
+               ArenaLen = 64 * 1024 };
+        struct Entry
+        {
+            QByteArray d_str;
+            quint32 d_hash;
+            Id d_id;
+        };
+        struct Table
+        {
+            quint32 d_cap; // power of two
+            QAtomicPointer<Entry>* d_slots;
+        };
+        struct Shard
+        {
+            QMutex d_lock; // only for writers
+            QAtomicPointer<Table> d_table;
+            QAtomicPointer<Entry> d_dir[DirLen]; // chunks of ChunkLen entries, index is (id-1) >> ShardBits
+            QList<Table*> d_retired; // old tables still possibly used by readers
+            QList<char*> d_arenas;
+            char* d_arena;
+            quint32 d_arenaLeft;
+            quint32 d_count;
+            Shard():d_arena(0),d_arenaLeft(0),d_count(0) {}
+        };
+        const Entry* internEntry( const char* str, int len ); // len > 0
+        static quint32 hash( const char* str, int len );
+        static const Entry* lookup( const Table*, quint32 hash, const char* str, int len );
+        static Table* createTable( quint32 cap );
+        static void insert( Table*, Entry* );
+        char* allocate( Shard&, quint32 len );
+        Shard d_shards[ShardCount];
+    };
+}
+
+#endif // OBSYMBOLTABLE_H
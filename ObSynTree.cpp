@@ -5,7 +5,7 @@ using namespace Ob;
 SynTree::SynTree(quint16 r, const Token& t ):d_tok(r){
 	d_tok.d_lineNr = t.d_lineNr;
 	d_tok.d_colNr = t.d_colNr;
-	d_tok.d_sourcePath = t.d_sourcePath;
+	d_tok.d_fileId = t.d_fileId;
 }
 
 const char* SynTree::rToStr( quint16 r ) {
@@ -18,8 +18,25 @@
 */
 
 #include "ObToken.h"
+#include <QReadWriteLock>
+#include <QHash>
+#include <QVector>
 using namespace Ob;
 
+struct SourcePaths
+{
+    QReadWriteLock d_lock;
+    QHash<QString,quint32> d_ids;
+    QVector<QString> d_paths;
+    SourcePaths() { d_paths.append(QString()); } // id 0 is no path
+};
+
+static SourcePaths* sourcePaths()
+{
+    static SourcePaths* s_inst = new SourcePaths(); // never deleted, like the SymbolTable
+    return s_inst;
+}
+
 bool Token::isValid() const
 {
     return d_type != Tok_Eof && d_type != Tok_Invalid;
@@ -40,3 +57,66 @@ const char*Token::getString() const
     return tokenTypeString(d_type);
 }
 
+void Token::setVal(const QByteArray& val)
+{
+    if( val.isEmpty() || isTransient(d_type) )
+    {
+        d_valId = 0;
+        d_val = QByteArray( val.constData(), val.size() ); // val might refer to the lexer buffer
+    }else
+    {
+        d_valId = SymbolTable::inst()->internId(val);
+        d_val.clear();
+    }
+}
+
+bool Token::isTransient(quint16 type)
+{
+    switch( type )
+    {
+    case Tok_Comment:
+    case Tok_Latt:
+    case Tok_Invalid:
+    case Tok_string:
+    case Tok_hexstring:
+    case Tok_hexchar:
+    case Tok_integer:
+    case Tok_real:
+    case Tok_Dlr:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+quint32 Token::toFileId(const QString& sourcePath)
+{
+    if( sourcePath.isEmpty() )
+        return 0;
+    SourcePaths* sp = sourcePaths();
+    {
+        QReadLocker lock(&sp->d_lock);
+        const quint32 id = sp->d_ids.value(sourcePath);
+        if( id )
+            return id;
+    }
+    QWriteLocker lock(&sp->d_lock);
+    quint32& id = sp->d_ids[sourcePath];
+    if( id == 0 )
+    {
+        id = sp->d_paths.size();
+        sp->d_paths.append(sourcePath);
+    }
+    return id;
+}
+
+QString Token::toSourcePath(quint32 fileId)
+{
+    SourcePaths* sp = sourcePaths();
+    QReadLocker lock(&sp->d_lock);
+    if( fileId < quint32(sp->d_paths.size()) )
+        return sp->d_paths[fileId];
+    else
+        return QString();
+}
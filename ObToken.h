@@ -23,11 +23,16 @@
 #include <QString>
 #include <Oberon/ObTokenType.h>
 #include <Oberon/ObRowCol.h>
+#include <Oberon/ObSymbolTable.h>
 
 namespace Ob
 {
     struct Token
     {
+        // 24 bytes in release mode; the value is interned in the SymbolTable and the
+        // source path is registered once per file, so copying a token allocates nothing.
+        // The values of comments, literals and errors are not interned but owned by the token
+        // and shared by its copies.
 #ifdef _DEBUG
         union
         {
@@ -43,16 +48,31 @@ namespace Ob
         uint d_colNr : RowCol::COL_BIT_LEN; // supports 4k chars per line
         uint d_double : 1;     // originally unused, now set if floating point mantissa or exponent require double precision
 
-        QByteArray d_val;
-        QString d_sourcePath;
-        Token(quint16 t = Tok_Invalid, quint32 line = 0, quint16 col = 0, quint16 len = 0, const QByteArray& val = QByteArray() ):
-            d_type(t),d_lineNr(line),d_colNr(col),d_len(len),d_val(val),d_double(0){}
+        SymbolTable::Id d_valId; // 0 if the value is not interned, see isTransient
+        quint32 d_fileId; // see toFileId
+        QByteArray d_val; // the value if not interned
+
+        Token(quint16 t = Tok_Invalid, quint32 line = 0, quint16 col = 0, quint16 len = 0, const QByteArray& val = QByteArray(),
+              quint32 fileId = 0 ):
+            d_type(t),d_lineNr(line),d_colNr(col),d_len(len),d_double(0),d_fileId(fileId)
+        {
+            setVal(val);
+        }
         bool isValid() const;
         bool isEof() const;
         const char* getName() const;
         const char* getString() const;
+        const QByteArray& getVal() const { return d_valId ? SymbolTable::inst()->string(d_valId) : d_val; }
+        void setVal( const QByteArray& val );
+        SymbolTable::Id getSymbolId() const { return d_valId; }
+        static bool isTransient( quint16 type );
+        QString getSourcePath() const { return toSourcePath(d_fileId); }
         RowCol toRowCol() const { return RowCol(d_lineNr,d_colNr); }
-        Loc toLoc() const { return Loc(d_lineNr,d_colNr,d_sourcePath); }
+        Loc toLoc() const { return Loc(d_lineNr,d_colNr,getSourcePath()); }
+
+        // side table of all source paths seen by a lexer; thread-safe, ids are never reused
+        static quint32 toFileId( const QString& sourcePath );
+        static QString toSourcePath( quint32 fileId );
     };
 }
 
@@ -25,6 +25,8 @@ SOURCES += \
     $$PWD/ObParser.cpp \
     $$PWD/ObToken.cpp \
     $$PWD/ObLexer.cpp \
+    $$PWD/ObSymbolTable.cpp \
+    $$PWD/ObScan.cpp \
     $$PWD/ObFileCache.cpp \
     $$PWD/ObErrors.cpp \
     $$PWD/ObCodeModel.cpp \
@@ -39,6 +41,8 @@ HEADERS  += \
     $$PWD/ObParser.h \
     $$PWD/ObToken.h \
     $$PWD/ObLexer.h \
+    $$PWD/ObSymbolTable.h \
+    $$PWD/ObScan.h \
     $$PWD/ObFileCache.h \
     $$PWD/ObErrors.h \
     $$PWD/ObCodeModel.h \
@@ -93,7 +93,7 @@ public:
         bool isExt = false;
         foreach( const CodeModel::Module* m, d_that->d_mdl->getGlobalScope().d_mods )
         {
-            if( m->d_def && m->d_def->d_tok.d_sourcePath == path )
+            if( m->d_def && m->d_def->d_tok.getSourcePath() == path )
             {
                 isExt = m->d_isExt;
                 break;
@@ -208,7 +208,7 @@ public:
     {
         const int line = id->d_tok.d_lineNr - 1;
         const int col = id->d_tok.d_colNr - 1;
-        loadFile( id->d_tok.d_sourcePath );
+        loadFile( id->d_tok.getSourcePath() );
         // Qt-Koordinaten
         if( line >= 0 && line < document()->blockCount() )
         {
@@ -262,7 +262,7 @@ public:
         {
             QTextCursor c( document()->findBlockByNumber( n->d_tok.d_lineNr - 1) );
             c.setPosition( c.position() + n->d_tok.d_colNr - 1 );
-            c.setPosition( c.position() + n->d_tok.d_val.size(), QTextCursor::KeepAnchor );
+            c.setPosition( c.position() + n->d_tok.getVal().size(), QTextCursor::KeepAnchor );
 
             QTextEdit::ExtraSelection sel;
             sel.format = format;
@@ -541,8 +541,8 @@ void OberonViewer::pushLocation(const SynTree* st)
 
 static bool UsedByLessThan( const SynTree* lhs, const SynTree* rhs )
 {
-    return lhs->d_tok.d_sourcePath < rhs->d_tok.d_sourcePath ||
-            (!(rhs->d_tok.d_sourcePath < lhs->d_tok.d_sourcePath) &&
+    return lhs->d_tok.getSourcePath() < rhs->d_tok.getSourcePath() ||
+            (!(rhs->d_tok.getSourcePath() < lhs->d_tok.getSourcePath()) &&
              lhs->d_tok.d_lineNr < rhs->d_tok.d_lineNr );
 }
 
@@ -550,7 +550,7 @@ void OberonViewer::fillUsedBy(const SynTree* id, const CodeModel::NamedThing* nt
 {
     d_usedBy->clear();
     if( id )
-        d_usedByTitle->setText(QString("%1 '%2'").arg(nt->typeName().data()).arg(id->d_tok.d_val.data()) );
+        d_usedByTitle->setText(QString("%1 '%2'").arg(nt->typeName().data()).arg(id->d_tok.getVal().data()) );
     else if( !nt->d_name.isEmpty() )
         d_usedByTitle->setText(QString("%1 '%2'").arg(nt->typeName().data()).arg(nt->d_name.data()) );
     else
@@ -565,8 +565,8 @@ void OberonViewer::fillUsedBy(const SynTree* id, const CodeModel::NamedThing* nt
     QList<const SynTree*> part;
     foreach( const SynTree* id, all )
     {
-        groups[qMakePair(id->d_tok.d_sourcePath,id->d_tok.d_lineNr)].append(id);
-        if( id->d_tok.d_sourcePath == d_view->d_path )
+        groups[qMakePair(id->d_tok.getSourcePath(),id->d_tok.d_lineNr)].append(id);
+        if( id->d_tok.getSourcePath() == d_view->d_path )
             part << id;
     }
 
@@ -576,11 +576,11 @@ void OberonViewer::fillUsedBy(const SynTree* id, const CodeModel::NamedThing* nt
     {
         const SynTree* st = i.value().first();
         QTreeWidgetItem* item = new QTreeWidgetItem(d_usedBy);
-        item->setText( 0, QString("%1 (%2 %3%4)").arg(QFileInfo(st->d_tok.d_sourcePath).fileName())
+        item->setText( 0, QString("%1 (%2 %3%4)").arg(QFileInfo(st->d_tok.getSourcePath()).fileName())
                     .arg(st->d_tok.d_lineNr).arg( i.value().size() )
                        .arg( st == nt->d_id ? " decl" : "" ) );
         if( id && st->d_tok.d_lineNr == id->d_tok.d_lineNr &&
-                st->d_tok.d_sourcePath == id->d_tok.d_sourcePath )
+                st->d_tok.getSourcePath() == id->d_tok.getSourcePath() )
         {
             QFont f = item->font(0);
             f.setBold(true);
@@ -589,7 +589,7 @@ void OberonViewer::fillUsedBy(const SynTree* id, const CodeModel::NamedThing* nt
         }
         item->setToolTip( 0, item->text(0) );
         item->setData( 0, Qt::UserRole, QVariant::fromValue(st) );
-        if( st->d_tok.d_sourcePath != d_view->d_path )
+        if( st->d_tok.getSourcePath() != d_view->d_path )
             item->setForeground( 0, Qt::gray );
         else if( curItem == 0 )
             curItem = item;
@@ -603,7 +603,7 @@ void OberonViewer::fillUsedBy(const SynTree* id, const CodeModel::NamedThing* nt
 		const int col = positionInBlock(tc) + 1;
         d_view->markNonTerms(part);
         d_loc->setText( QString("%1   %2:%3   %5 '%4'").arg(d_view->d_path).arg(line).arg(col)
-                        .arg(id->d_tok.d_val.data() ).arg(nt->typeName().data() ) );
+                        .arg(id->d_tok.getVal().data() ).arg(nt->typeName().data() ) );
         pushLocation(id);
     }
 }
@@ -624,7 +624,7 @@ void OberonViewer::onModuleDblClick(const QModelIndex& i)
 
     if( nt->d_id )
     {
-        d_loc->setText(nt->d_id->d_tok.d_sourcePath);
+        d_loc->setText(nt->d_id->d_tok.getSourcePath());
         d_view->setCursorPosition( nt->d_id, true );
     }else
         fillUsedBy( 0, nt );
@@ -128,7 +128,7 @@ int main(int argc, char *argv[])
         {
             if( o->d_def == 0 )
                 continue;
-            QFileInfo fi(o->d_def->d_tok.d_sourcePath );
+            QFileInfo fi(o->d_def->d_tok.getSourcePath() );
             QDir dir = fi.dir();
             if( !mod.isEmpty() )
             {
@@ -202,7 +202,7 @@ void Highlighter::highlightBlock(const QString& text)
             f = formatForCategory(C_Str);
         }else if( t.d_type == Tok_Dlr )
         {
-            if( !t.d_val.isEmpty() )
+            if( !t.getVal().isEmpty() )
             {
                 braceDepth++;
                 lexerState = 2;
@@ -230,7 +230,7 @@ void Highlighter::highlightBlock(const QString& text)
             f = formatForCategory(C_Kw);
         }else if( t.d_type == Tok_ident )
         {
-            if( d_builtins.contains(t.d_val) )
+            if( d_builtins.contains(t.getVal()) )
                 f = formatForCategory(C_Type);
             else
                 f = formatForCategory(C_Ident);
@@ -20,7 +20,11 @@
 #include "ObxAst.h"
 #include "ObLexer.h"
 #include <QtDebug>
+#include <QMutex>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <limits>
+#include <algorithm>
 using namespace Obx;
 using namespace Ob;
 
@@ -532,11 +536,16 @@ struct ObxAstPrinter : public AstVisitor
 
 Named*Scope::find(const QByteArray& name, bool recursive) const
 {
-    Names::const_iterator i = d_names.find( name.constData() );
+    return find( Lexer::getSymbolId(name), recursive );
+}
+
+Named*Scope::find(quint32 nameId, bool recursive) const
+{
+    Names::const_iterator i = d_names.find( nameId );
     if( i != d_names.end() )
         return i.value();
     if( recursive && d_scope )
-        return d_scope->find(name);
+        return d_scope->find(nameId);
     else
         return 0;
 }
@@ -544,10 +553,12 @@ Named*Scope::find(const QByteArray& name, bool recursive) const
 bool Scope::add(Named* n)
 {
     Q_ASSERT( n != 0 );
-    if( find(n->d_name,false) )
+    if( n->d_nameId == 0 )
+        n->d_nameId = SymbolTable::inst()->internId(n->d_name);
+    if( find(n->d_nameId,false) )
         return false;
     // else
-    d_names[n->d_name.constData()] = n;
+    d_names[n->d_nameId] = n;
     d_order.append(n);
     n->d_scope = this;
     switch( n->getTag() )
@@ -875,14 +886,24 @@ quint8 IdentLeaf::visibilityFor(Module*) const
 #ifdef _DEBUG
 
 QSet<Thing*> Thing::insts;
+static QMutex s_instsLock; // modules can be parsed in parallel threads
 
 Thing::Thing():d_slot(0),d_slotValid(false),d_slotAllocated(false),d_visited(false),d_unsafe(false),d_generic(false)
 {
+    QMutexLocker lock(&s_instsLock);
+    insts.insert(this);
+}
+
+Thing::Thing(const Thing& rhs):QSharedData(),d_loc(rhs.d_loc),d_slot(rhs.d_slot),d_slotValid(rhs.d_slotValid),
+    d_slotAllocated(rhs.d_slotAllocated),d_visited(rhs.d_visited),d_unsafe(rhs.d_unsafe),d_generic(rhs.d_generic)
+{
+    QMutexLocker lock(&s_instsLock);
     insts.insert(this);
 }
 
 Thing::~Thing()
 {
+    QMutexLocker lock(&s_instsLock);
     insts.remove(this);
 }
 
@@ -890,11 +911,16 @@ Thing::~Thing()
 
 Named*Record::find(const QByteArray& name, bool recursive) const
 {
-    Names::const_iterator i = d_names.find(name.constData());
+    return find( Lexer::getSymbolId(name), recursive );
+}
+
+Named*Record::find(quint32 nameId, bool recursive) const
+{
+    Names::const_iterator i = d_names.find(nameId);
     if( i != d_names.end() )
         return i.value();
     if( recursive && d_baseRec != 0 )
-        return d_baseRec->find(name,recursive);
+        return d_baseRec->find(nameId,recursive);
     return 0;
 }
 
@@ -958,28 +984,37 @@ Record*Record::findBySlot(int slot) const
     return 0;
 }
 
+static QMutex s_layoutLock(QMutex::Recursive); // the field types are measured while holding it
+
 quint32 Record::getByteSize() const
 {
-    if( d_alignment > 0 )
+    if( d_layoutDone.loadAcquire() )
         return d_byteSize;
 
+    // records of imported modules can be measured concurrently by Model::validateLevels; the layout
+    // is computed once under the lock and published by d_layoutDone together with the field slots
+    QMutexLocker lock(&s_layoutLock);
+    if( d_layoutDone.load() )
+        return d_byteSize;
     Record* r = const_cast<Record*>(this);
     // http://www.catb.org/esr/structure-packing/#_structure_alignment_and_padding
     if( d_union )
     {
-        r->d_byteSize = 0;
-        r->d_alignment = 1;
+        int maxSize = 0;
+        int maxAlig = 1;
         for( int i = 0; i < d_fields.size(); i++ )
         {
             const int size = d_fields[i]->d_type->getByteSize();
             const int alig = d_fields[i]->d_type->getAlignment();
-            if( size > r->d_byteSize )
-                r->d_byteSize = size;
-            if( alig > r->d_alignment )
-                r->d_alignment = alig;
+            if( size > maxSize )
+                maxSize = size;
+            if( alig > maxAlig )
+                maxAlig = alig;
             d_fields[i]->d_slot = 0;
             d_fields[i]->d_slotValid = true;
         }
+        r->d_byteSize = maxSize;
+        r->d_alignment = maxAlig;
     }else
     {
         int off = 0;
@@ -1002,10 +1037,11 @@ quint32 Record::getByteSize() const
             // qDebug() << i << "off" << off << "size" << size;
             off += size;
         }
-        r->d_alignment = maxAlig;
         r->d_byteSize = off + (maxAlig - (off % maxAlig)) % maxAlig;
+        r->d_alignment = maxAlig;
         // qDebug() << "struct size" << r->d_byteSize << "alig" << r->d_alignment;
     }
+    r->d_layoutDone.storeRelease(1);
     return d_byteSize;
 }
 
@@ -1695,6 +1731,724 @@ void Module::findAllInstances(QList<Module*>& result) const
     }
 }
 
+struct Cloner
+{
+    // Deep copy of a module as delivered by the parser; the raw pointers (declarations, bindings, scopes,
+    // owners) are redirected to the copies once all objects exist.
+    // With d_inPlace nothing is copied; the traversal only redirects the objects in d_map, see Module::rebindUsers
+    QHash<Thing*,Thing*> d_map;
+    QSet<Thing*> d_seen; // d_inPlace: visited objects
+    bool d_inPlace;
+
+    Cloner():d_inPlace(false) {}
+
+    template<class T>
+    T* map( T* in ) const
+    {
+        Thing* out = d_map.value(in);
+        return out ? cast<T*>(out) : in;
+    }
+    template<class T>
+    T* dup( T* in )
+    {
+        if( d_inPlace )
+        {
+            d_seen.insert(in);
+            return in;
+        }
+        T* out = new T(*in);
+        d_map[in] = out;
+        return out;
+    }
+    template<class T>
+    Ref<T> copy( const Ref<T>& in )
+    {
+        return cast<T*>( thing(in.data()) );
+    }
+    template<class T>
+    void copyList( QList< Ref<T> >& l )
+    {
+        for( int i = 0; i < l.size(); i++ )
+            l[i] = copy(l[i]);
+    }
+    void copyActuals( MetaActuals& l )
+    {
+        for( int i = 0; i < l.size(); i++ )
+        {
+            l[i].d_constExpr = copy(l[i].d_constExpr);
+            l[i].d_type = copy(l[i].d_type);
+        }
+    }
+    void scope( Scope* s )
+    {
+        copyList(s->d_order);
+        copyList(s->d_helper);
+        SysAttrs::iterator i;
+        for( i = s->d_sysAttrs.begin(); i != s->d_sysAttrs.end(); ++i )
+        {
+            // SysAttr is not a tagged Thing
+            Ref<SysAttr> a = d_inPlace ? i.value() : new SysAttr(*i.value().data());
+            copyList(a->d_valExpr);
+            i.value() = a;
+        }
+        copyList(s->d_body);
+    }
+    Thing* thing( Thing* in )
+    {
+        if( in == 0 )
+            return 0;
+        Thing* out = d_map.value(in);
+        if( out )
+            return out;
+        if( d_inPlace && d_seen.contains(in) )
+            return in;
+        switch( in->getTag() )
+        {
+        case Thing::T_Module:
+            {
+                Module* m = dup(cast<Module*>(in));
+                scope(m);
+                copyList(m->d_metaParams);
+                copyActuals(m->d_metaActuals);
+                copyList(m->d_helper2);
+                if( !d_inPlace )
+                {
+                    m->d_usedBy.clear();
+                    m->d_template = 0;
+                    m->d_evalMemo.clear();
+                }
+                out = m;
+            }
+            break;
+        case Thing::T_Procedure:
+            {
+                Procedure* p = dup(cast<Procedure*>(in));
+                scope(p);
+                p->d_receiver = copy(p->d_receiver);
+                out = p;
+            }
+            break;
+        case Thing::T_Import:
+            {
+                Import* i = dup(cast<Import*>(in));
+                copyActuals(i->d_metaActuals);
+                out = i;
+            }
+            break;
+        case Thing::T_Const:
+            {
+                Const* c = dup(cast<Const*>(in));
+                c->d_constExpr = copy(c->d_constExpr);
+                out = c;
+            }
+            break;
+        case Thing::T_Field:
+            out = dup(cast<Field*>(in));
+            break;
+        case Thing::T_Variable:
+            out = dup(cast<Variable*>(in));
+            break;
+        case Thing::T_LocalVar:
+            out = dup(cast<LocalVar*>(in));
+            break;
+        case Thing::T_Parameter:
+            out = dup(cast<Parameter*>(in));
+            break;
+        case Thing::T_NamedType:
+            out = dup(cast<NamedType*>(in));
+            break;
+        case Thing::T_Pointer:
+            {
+                Pointer* p = dup(cast<Pointer*>(in));
+                p->d_to = copy(p->d_to);
+                out = p;
+            }
+            break;
+        case Thing::T_Array:
+            {
+                Array* a = dup(cast<Array*>(in));
+                a->d_lenExpr = copy(a->d_lenExpr);
+                a->d_type = copy(a->d_type);
+                out = a;
+            }
+            break;
+        case Thing::T_Record:
+            {
+                Record* r = dup(cast<Record*>(in));
+                r->d_base = copy(r->d_base);
+                copyList(r->d_fields);
+                copyList(r->d_methods);
+                out = r;
+            }
+            break;
+        case Thing::T_ProcType:
+            {
+                ProcType* p = dup(cast<ProcType*>(in));
+                p->d_return = copy(p->d_return);
+                copyList(p->d_formals);
+                out = p;
+            }
+            break;
+        case Thing::T_QualiType:
+            {
+                QualiType* q = dup(cast<QualiType*>(in));
+                q->d_quali = copy(q->d_quali);
+                out = q;
+            }
+            break;
+        case Thing::T_Enumeration:
+            {
+                Enumeration* e = dup(cast<Enumeration*>(in));
+                copyList(e->d_items);
+                out = e;
+            }
+            break;
+        case Thing::T_Call:
+            {
+                Call* c = dup(cast<Call*>(in));
+                c->d_what = copy(c->d_what);
+                out = c;
+            }
+            break;
+        case Thing::T_Return:
+            {
+                Return* r = dup(cast<Return*>(in));
+                r->d_what = copy(r->d_what);
+                out = r;
+            }
+            break;
+        case Thing::T_Assign:
+            {
+                Assign* a = dup(cast<Assign*>(in));
+                a->d_lhs = copy(a->d_lhs);
+                a->d_rhs = copy(a->d_rhs);
+                out = a;
+            }
+            break;
+        case Thing::T_IfLoop:
+            {
+                IfLoop* l = dup(cast<IfLoop*>(in));
+                copyList(l->d_if);
+                for( int i = 0; i < l->d_then.size(); i++ )
+                    copyList(l->d_then[i]);
+                copyList(l->d_else);
+                out = l;
+            }
+            break;
+        case Thing::T_ForLoop:
+            {
+                ForLoop* l = dup(cast<ForLoop*>(in));
+                l->d_id = copy(l->d_id);
+                l->d_from = copy(l->d_from);
+                l->d_to = copy(l->d_to);
+                l->d_by = copy(l->d_by);
+                copyList(l->d_do);
+                out = l;
+            }
+            break;
+        case Thing::T_CaseStmt:
+            {
+                CaseStmt* c = dup(cast<CaseStmt*>(in));
+                c->d_exp = copy(c->d_exp);
+                for( int i = 0; i < c->d_cases.size(); i++ )
+                {
+                    copyList(c->d_cases[i].d_labels);
+                    copyList(c->d_cases[i].d_block);
+                }
+                copyList(c->d_else);
+                out = c;
+            }
+            break;
+        case Thing::T_Exit:
+            out = dup(cast<Exit*>(in));
+            break;
+        case Thing::T_Literal:
+            out = dup(cast<Literal*>(in));
+            break;
+        case Thing::T_SetExpr:
+            {
+                SetExpr* s = dup(cast<SetExpr*>(in));
+                copyList(s->d_parts);
+                out = s;
+            }
+            break;
+        case Thing::T_IdentLeaf:
+            out = dup(cast<IdentLeaf*>(in));
+            break;
+        case Thing::T_UnExpr:
+            {
+                UnExpr* e = dup(cast<UnExpr*>(in));
+                e->d_sub = copy(e->d_sub);
+                out = e;
+            }
+            break;
+        case Thing::T_IdentSel:
+            {
+                IdentSel* e = dup(cast<IdentSel*>(in));
+                e->d_sub = copy(e->d_sub);
+                out = e;
+            }
+            break;
+        case Thing::T_ArgExpr:
+            {
+                ArgExpr* e = dup(cast<ArgExpr*>(in));
+                e->d_sub = copy(e->d_sub);
+                copyList(e->d_args);
+                out = e;
+            }
+            break;
+        case Thing::T_BinExpr:
+            {
+                BinExpr* e = dup(cast<BinExpr*>(in));
+                e->d_lhs = copy(e->d_lhs);
+                e->d_rhs = copy(e->d_rhs);
+                out = e;
+            }
+            break;
+        default:
+            return in; // BaseType, BuiltIn and the global scopes are shared
+        }
+        if( out->isNamed() )
+        {
+            Named* n = cast<Named*>(out);
+            n->d_type = copy(n->d_type);
+        }
+        return out;
+    }
+    void fixup( Thing* t )
+    {
+        if( t->isNamed() )
+        {
+            Named* n = cast<Named*>(t);
+            n->d_scope = map(n->d_scope);
+        }
+        if( t->isScope() )
+        {
+            Scope* s = cast<Scope*>(t);
+            Scope::Names::iterator i;
+            for( i = s->d_names.begin(); i != s->d_names.end(); ++i )
+                i.value() = map(i.value());
+        }
+        switch( t->getTag() )
+        {
+        case Thing::T_Module:
+            {
+                Module* m = cast<Module*>(t);
+                for( int i = 0; i < m->d_imports.size(); i++ )
+                    m->d_imports[i] = map(m->d_imports[i]);
+            }
+            break;
+        case Thing::T_Import:
+            {
+                Import* i = cast<Import*>(t);
+                i->d_mod = map(i->d_mod.data());
+                i->d_tmpl = map(i->d_tmpl.data());
+            }
+            break;
+        case Thing::T_Procedure:
+            {
+                Procedure* p = cast<Procedure*>(t);
+                p->d_receiverRec = map(p->d_receiverRec);
+                p->d_super = map(p->d_super);
+                for( int i = 0; i < p->d_subs.size(); i++ )
+                    p->d_subs[i] = map(p->d_subs[i]);
+                QSet<Procedure*> calling;
+                foreach( Procedure* c, p->d_calling )
+                    calling << map(c);
+                p->d_calling = calling;
+            }
+            break;
+        case Thing::T_Field:
+            {
+                Field* f = cast<Field*>(t);
+                f->d_owner = map(f->d_owner);
+                f->d_super = map(f->d_super);
+            }
+            break;
+        case Thing::T_Record:
+            {
+                Record* r = cast<Record*>(t);
+                r->d_baseRec = map(r->d_baseRec);
+                for( int i = 0; i < r->d_subRecs.size(); i++ )
+                    r->d_subRecs[i] = map(r->d_subRecs[i]);
+                Record::Names::iterator i;
+                for( i = r->d_names.begin(); i != r->d_names.end(); ++i )
+                    i.value() = map(i.value());
+            }
+            break;
+        case Thing::T_ProcType:
+            {
+                ProcType* p = cast<ProcType*>(t);
+                for( int i = 0; i < p->d_nonLocals.size(); i++ )
+                    p->d_nonLocals[i] = map(p->d_nonLocals[i]);
+            }
+            break;
+        case Thing::T_IdentLeaf:
+            {
+                IdentLeaf* e = cast<IdentLeaf*>(t);
+                e->d_ident = map(e->d_ident.data());
+                e->d_mod = map(e->d_mod);
+            }
+            break;
+        case Thing::T_IdentSel:
+            {
+                IdentSel* e = cast<IdentSel*>(t);
+                e->d_ident = map(e->d_ident.data());
+            }
+            break;
+        }
+        switch( t->getTag() )
+        {
+        case Thing::T_Pointer:
+        case Thing::T_Array:
+        case Thing::T_Record:
+        case Thing::T_ProcType:
+        case Thing::T_QualiType:
+        case Thing::T_Enumeration:
+            {
+                Type* tt = cast<Type*>(t);
+                tt->d_decl = map(tt->d_decl);
+                tt->d_binding = map(tt->d_binding);
+            }
+            break;
+        case Thing::T_Literal:
+        case Thing::T_SetExpr:
+        case Thing::T_IdentLeaf:
+        case Thing::T_UnExpr:
+        case Thing::T_IdentSel:
+        case Thing::T_ArgExpr:
+        case Thing::T_BinExpr:
+            {
+                Expression* e = cast<Expression*>(t);
+                e->d_type = map(e->d_type.data());
+            }
+            break;
+        }
+    }
+};
+
+Ref<Module> Module::clone(QHash<Thing*, Thing*>* copies) const
+{
+    Cloner c;
+    Ref<Module> res = cast<Module*>( c.thing( const_cast<Module*>(this) ) );
+    foreach( Thing* t, c.d_map )
+        c.fixup(t);
+    if( copies )
+        *copies = c.d_map;
+    return res;
+}
+
+struct InterfaceHasher
+{
+    // Serializes the exported declarations and everything reachable from them which a user of the module
+    // depends on (incl. private fields and methods because of the record layout); declarations of other
+    // modules are only referenced by name.
+    Module* d_mod;
+    QByteArray d_out;
+    QHash<Thing*,int> d_seen;
+
+    InterfaceHasher(Module* m):d_mod(m) {}
+    void add( const QByteArray& str )
+    {
+        d_out += str;
+        d_out += '\n';
+    }
+    bool enter( Thing* t )
+    {
+        const int i = d_seen.value(t,-1);
+        if( i >= 0 )
+        {
+            add( "#" + QByteArray::number(i) );
+            return false;
+        }
+        d_seen.insert(t, d_seen.size());
+        return true;
+    }
+    void named( Named* n )
+    {
+        if( n == 0 )
+        {
+            add("-");
+            return;
+        }
+        if( !enter(n) )
+            return;
+        add( QByteArray(n->getTagName()) + " " + n->d_name + " " + QByteArray::number(n->d_visibility) );
+        switch( n->getTag() )
+        {
+        case Thing::T_Const:
+            {
+                Const* c = cast<Const*>(n);
+                QByteArray val;
+                QDataStream out(&val, QIODevice::WriteOnly);
+                out << c->d_val << quint8(c->d_vtype) << quint32(c->d_strLen) << bool(c->d_wide) << bool(c->d_minInt);
+                add( val.toHex() );
+            }
+            break;
+        case Thing::T_Parameter:
+            {
+                Parameter* p = cast<Parameter*>(n);
+                add( QByteArray::number(p->d_var) + QByteArray::number(p->d_const) );
+            }
+            break;
+        case Thing::T_Procedure:
+            {
+                Procedure* p = cast<Procedure*>(n);
+                add( QByteArray::number(p->d_noBody) );
+                QByteArrayList attrs = p->d_sysAttrs.keys();
+                std::sort(attrs.begin(), attrs.end());
+                add( attrs.join(',') );
+            }
+            break;
+        }
+        type( n->d_type.data() );
+    }
+    void type( Type* t )
+    {
+        if( t == 0 )
+        {
+            add("-");
+            return;
+        }
+        switch( t->getTag() )
+        {
+        case Thing::T_BaseType:
+            add( cast<BaseType*>(t)->getTypeName() );
+            return;
+        case Thing::T_QualiType:
+            {
+                QualiType* q = cast<QualiType*>(t);
+                Named* n = q->d_quali.isNull() ? 0 : q->d_quali->getIdent();
+                if( n && n->getModule() != d_mod )
+                    add( "ext " + n->getQualifiedName().join('.') );
+                else
+                    named(n);
+            }
+            return;
+        }
+        if( !enter(t) )
+            return;
+        add( QByteArray(t->getTagName()) + " " + QByteArray::number(t->d_unsafe) );
+        switch( t->getTag() )
+        {
+        case Thing::T_Pointer:
+            type( cast<Pointer*>(t)->d_to.data() );
+            break;
+        case Thing::T_Array:
+            {
+                Array* a = cast<Array*>(t);
+                add( QByteArray::number(a->d_len) + " " + QByteArray::number(a->d_vla) );
+                type( a->d_type.data() );
+            }
+            break;
+        case Thing::T_Record:
+            {
+                Record* r = cast<Record*>(t);
+                add( QByteArray::number(r->d_union) + " " + QByteArray::number(r->d_fields.size())
+                     + " " + QByteArray::number(r->d_methods.size()) );
+                type( r->d_base.data() );
+                foreach( const Ref<Field>& f, r->d_fields )
+                    named( f.data() );
+                foreach( const Ref<Procedure>& p, r->d_methods )
+                    named( p.data() );
+            }
+            break;
+        case Thing::T_ProcType:
+            {
+                ProcType* p = cast<ProcType*>(t);
+                add( QByteArray::number(p->d_typeBound) + " " + QByteArray::number(p->d_varargs)
+                     + " " + QByteArray::number(p->d_formals.size()) );
+                type( p->d_return.data() );
+                foreach( const Ref<Parameter>& f, p->d_formals )
+                    named( f.data() );
+            }
+            break;
+        case Thing::T_Enumeration:
+            {
+                Enumeration* e = cast<Enumeration*>(t);
+                add( QByteArray::number(e->d_items.size()) );
+                foreach( const Ref<Const>& c, e->d_items )
+                    named( c.data() );
+            }
+            break;
+        }
+    }
+};
+
+static QList<Named*> exportedDecls( Module* m )
+{
+    // bound procedures are reached through the records
+    QList<Named*> res;
+    foreach( const Ref<Named>& n, m->d_order )
+    {
+        if( n->getTag() == Thing::T_Import || !n->isPublic() )
+            continue;
+        if( n->getTag() == Thing::T_Procedure && !cast<Procedure*>(n.data())->d_receiver.isNull() )
+            continue;
+        res << n.data();
+    }
+    return res;
+}
+
+QByteArray Module::interfaceHash() const
+{
+    Module* me = const_cast<Module*>(this);
+    InterfaceHasher h(me);
+    h.add( d_name + " " + QByteArray::number(d_isDef) + QByteArray::number(d_externC)
+           + " " + QByteArray::number(d_metaParams.size()) );
+    foreach( Named* n, exportedDecls(me) )
+        h.named(n);
+    return QCryptographicHash::hash(h.d_out, QCryptographicHash::Sha1);
+}
+
+struct InterfaceMatcher
+{
+    // Pairs the objects of two modules with the same interfaceHash() in the order InterfaceHasher visits them
+    QHash<Thing*,Thing*>& d_map;
+    Module* d_from;
+    bool d_ok;
+
+    InterfaceMatcher(QHash<Thing*,Thing*>& map, Module* from ):d_map(map),d_from(from),d_ok(true) {}
+    template<class T>
+    void list( const QList< Ref<T> >& a, const QList< Ref<T> >& b )
+    {
+        if( a.size() != b.size() )
+        {
+            d_ok = false;
+            return;
+        }
+        for( int i = 0; i < a.size() && d_ok; i++ )
+            named( a[i].data(), b[i].data() );
+    }
+    void named( Named* a, Named* b )
+    {
+        if( a == 0 || b == 0 )
+        {
+            if( a != b )
+                d_ok = false;
+            return;
+        }
+        if( d_map.contains(a) )
+            return;
+        if( a->getTag() != b->getTag() || a->d_name != b->d_name )
+        {
+            d_ok = false;
+            return;
+        }
+        d_map[a] = b;
+        if( a->getTag() == Thing::T_Procedure )
+            named( cast<Procedure*>(a)->d_receiver.data(), cast<Procedure*>(b)->d_receiver.data() );
+        type( a->d_type.data(), b->d_type.data() );
+    }
+    void type( Type* a, Type* b )
+    {
+        if( a == b )
+            return; // base types and declarations of other modules
+        if( a == 0 || b == 0 || a->getTag() != b->getTag() )
+        {
+            d_ok = false;
+            return;
+        }
+        if( d_map.contains(a) )
+            return;
+        d_map[a] = b;
+        switch( a->getTag() )
+        {
+        case Thing::T_QualiType:
+            {
+                QualiType* qa = cast<QualiType*>(a);
+                QualiType* qb = cast<QualiType*>(b);
+                Named* na = qa->d_quali.isNull() ? 0 : qa->d_quali->getIdent();
+                Named* nb = qb->d_quali.isNull() ? 0 : qb->d_quali->getIdent();
+                if( na && na->getModule() != d_from )
+                {
+                    if( na != nb )
+                        d_ok = false;
+                }else
+                    named( na, nb );
+            }
+            break;
+        case Thing::T_Pointer:
+            type( cast<Pointer*>(a)->d_to.data(), cast<Pointer*>(b)->d_to.data() );
+            break;
+        case Thing::T_Array:
+            type( cast<Array*>(a)->d_type.data(), cast<Array*>(b)->d_type.data() );
+            break;
+        case Thing::T_Record:
+            {
+                Record* ra = cast<Record*>(a);
+                Record* rb = cast<Record*>(b);
+                type( ra->d_base.data(), rb->d_base.data() );
+                list( ra->d_fields, rb->d_fields );
+                list( ra->d_methods, rb->d_methods );
+            }
+            break;
+        case Thing::T_ProcType:
+            {
+                ProcType* pa = cast<ProcType*>(a);
+                ProcType* pb = cast<ProcType*>(b);
+                type( pa->d_return.data(), pb->d_return.data() );
+                list( pa->d_formals, pb->d_formals );
+            }
+            break;
+        case Thing::T_Enumeration:
+            list( cast<Enumeration*>(a)->d_items, cast<Enumeration*>(b)->d_items );
+            break;
+        }
+    }
+};
+
+bool Module::rebindUsers(Module* successor, const QList<Module*>& users)
+{
+    Cloner c;
+    c.d_inPlace = true;
+    c.d_map[this] = successor;
+    InterfaceMatcher m(c.d_map, this);
+    const QList<Named*> a = exportedDecls(this);
+    const QList<Named*> b = exportedDecls(successor);
+    if( a.size() != b.size() )
+        return false;
+    for( int i = 0; i < a.size() && m.d_ok; i++ )
+        m.named(a[i], b[i]);
+    if( !m.d_ok )
+        return false;
+
+    QHash<Thing*,Thing*>::const_iterator i;
+    for( i = c.d_map.begin(); i != c.d_map.end(); ++i )
+    {
+        // the validation of the users marked the old declarations
+        if( i.key()->getTag() == Thing::T_Record )
+        {
+            Record* from = cast<Record*>(i.key());
+            Record* to = cast<Record*>(i.value());
+            if( from->d_usedByRef )
+                to->d_usedByRef = true;
+            if( from->d_usedByVal )
+                to->d_usedByVal = true;
+        }else if( i.key()->getTag() == Thing::T_Procedure && cast<Procedure*>(i.key())->d_used )
+            cast<Procedure*>(i.value())->d_used = true;
+    }
+
+    foreach( Module* u, users )
+        c.thing(u);
+    foreach( Thing* t, c.d_seen )
+    {
+        c.fixup(t);
+        if( t->getTag() == Thing::T_Record )
+        {
+            Record* r = cast<Record*>(t);
+            if( r->d_baseRec && !r->d_baseRec->d_subRecs.contains(r) )
+                r->d_baseRec->d_subRecs.append(r);
+        }else if( t->getTag() == Thing::T_Procedure )
+        {
+            Procedure* p = cast<Procedure*>(t);
+            if( p->d_super && !p->d_super->d_subs.contains(p) )
+                p->d_super->d_subs.append(p);
+        }
+    }
+    return true;
+}
+
 static bool isInParam( Expression* e )
 {
     Named* n = e->getIdent();
@@ -28,6 +28,8 @@
 #include <QVariant>
 #include <QDateTime>
 #include <QSet>
+#include <QSharedPointer>
+#include <QAtomicInt>
 
 class QIODevice;
 
@@ -77,6 +79,7 @@ namespace Obx
     #ifdef _DEBUG
         static QSet<Thing*> insts;
         Thing();
+        Thing(const Thing&);
         virtual ~Thing();
     #else
         Thing():d_slot(0),d_slotValid(false),d_slotAllocated(false),d_visited(false),d_unsafe(false) {}
@@ -140,6 +143,7 @@ namespace Obx
     struct Enumeration;
     struct Exit;
     struct SysAttr;
+    class EvalMemo;
 
     typedef QList< Ref<Statement> > StatSeq;
 
@@ -279,25 +283,27 @@ namespace Obx
         Record* d_baseRec;
         QList<Record*> d_subRecs;
 
-        typedef QHash<const char*,Named*> Names;
+        typedef QHash<quint32,Named*> Names; // symbol id (see Ob::Lexer::getSymbolId) -> Named
         Names d_names;
         QList< Ref<Field> > d_fields;
         QList< Ref<Procedure> > d_methods;
         quint16 d_fieldCount, d_methCount;
         uint d_alignment : 4;
         uint d_byteSize : 28;
+        QAtomicInt d_layoutDone; // d_alignment, d_byteSize and the field slots are valid, see getByteSize
 
         Record():d_baseRec(0),d_fieldCount(0),d_methCount(0),d_byteSize(0),d_alignment(0) {}
         int getTag() const { return T_Record; }
         void accept(AstVisitor* v) { v->visit(this); }
         bool isStructured(bool withPtrAndProcType = false) const { return true; }
         Named* find(const QByteArray& name , bool recursive) const;
+        Named* find(quint32 nameId , bool recursive) const;
         QString pretty() const { return d_unsafe ? ( d_union ? "CUNION" : "CSTRUCT" ) : "RECORD"; }
         QList<Field*> getOrderedFields() const;
         QList<Procedure*> getOrderedMethods() const;
         Record* findBySlot(int) const;
         quint32 getByteSize() const;
-        quint32 getAlignment() const { return d_alignment; }
+        quint32 getAlignment() const { getByteSize(); return d_alignment; }
         Field* nextField(Field*) const;
         static QSet<Record*> calcDependencyOrder(QList<Record*>& inout);
     };
@@ -349,6 +355,7 @@ namespace Obx
     {
         enum Visibility { Invalid, Private, LocalAccess, ReadWrite, ReadOnly };
         QByteArray d_name;
+        quint32 d_nameId; // symbol id of d_name (see Ob::SymbolTable), set by the parser or Scope::add
         Ref<Type> d_type;
         Scope* d_scope; // owning scope up to module (whose scope is nil)
 
@@ -364,7 +371,7 @@ namespace Obx
         uint d_used : 1; // Procedure: called or assigned
         uint d_receiver : 1;
 
-        Named(const QByteArray& n = QByteArray(), Type* t = 0, Scope* s = 0):d_scope(s),d_type(t),d_name(n),
+        Named(const QByteArray& n = QByteArray(), Type* t = 0, Scope* s = 0):d_scope(s),d_type(t),d_name(n),d_nameId(0),
             d_visibility(Invalid),d_synthetic(false),d_liveFrom(0),d_liveTo(0),
             d_upvalSource(0),d_upvalIntermediate(0),d_upvalSink(0),
             d_hasErrors(0),d_noBody(0),d_used(0),d_receiver(0) {}
@@ -500,7 +507,7 @@ namespace Obx
 
     struct Scope : public Named
     {
-        typedef QHash<const char*, Named*> Names;
+        typedef QHash<quint32, Named*> Names; // symbol id (see Ob::Lexer::getSymbolId) -> Named
         Names d_names;
         QList< Ref<Named> > d_order;
         QList< Ref<IdentLeaf> > d_helper; // filled with helper decls when fillXref
@@ -516,6 +523,7 @@ namespace Obx
         int getTag() const { return T_Scope; }
 
         Named* find( const QByteArray&, bool recursive = true ) const;
+        Named* find( quint32 nameId, bool recursive = true ) const;
         bool add( Named* );
     };
 
@@ -527,7 +535,10 @@ namespace Obx
         QList<Procedure*> d_subs; // the procedures of the subclasses which override this procedure
         // Ref<Expression> d_imp; // the number or string after PROC+, no longer supported, see d_sysAttrs
         QSet<Procedure*> d_calling; // the non-builtin procedures directly called in the body
-        Procedure():d_receiverRec(0),d_super(0) {}
+        Ob::RowCol d_lazyBegin; // skeleton mode: the BEGIN of a body which is not parsed yet, see Parser::parseBody
+        quint32 d_lazyLine; // skeleton mode: buffer offset of the line of d_lazyBegin
+        Procedure():d_receiverRec(0),d_super(0),d_lazyLine(0) {}
+        bool hasLazyBody() const { return d_lazyBegin.isValid(); }
         void accept(AstVisitor* v) { v->visit(this); }
         int getTag() const { return T_Procedure; }
         ProcType* getProcType() const;
@@ -543,11 +554,16 @@ namespace Obx
         MetaActuals d_metaActuals; // set if this is an instance of a generic module
         Ob::RowCol d_begin;
         QDateTime d_when; // file modification date when parsed last time
+        QByteArray d_hash; // of the source text when parsed last time, see FileCache::hash
         bool d_isValidated;
         bool d_isDef; // DEFINITION module
         bool d_isExt;
         bool d_externC;
         QList< Ref<Type> > d_helper2; // filled with pointers because of ADDROF
+        Ref<Module> d_template; // generic modules: unvalidated copy of the AST used for instantiation
+        QSharedPointer<EvalMemo> d_evalMemo; // folded constants, see Evaluator
+        QByteArray d_source; // skeleton mode: the text the lazy procedure bodies refer to, until all are parsed
+        QByteArrayList d_options; // skeleton mode: the preprocessor options the module was parsed with
 
         Module():d_isDef(false),d_isValidated(false),d_isExt(false),d_externC(false) {}
         int getTag() const { return T_Module; }
@@ -559,6 +575,10 @@ namespace Obx
         bool isFullyInstantiated() const;
         Import* findImport(Module*) const;
         void findAllInstances(QList<Module*>&) const;
+        Ref<Module> clone( QHash<Thing*,Thing*>* copies = 0 ) const; // deep copy; only valid before validation
+        QByteArray interfaceHash() const; // exported declarations and what they depend on; only valid after validation
+        bool rebindUsers( Module* successor, const QList<Module*>& users ); // redirect the users to the declarations
+                                                // of successor which must have the same interfaceHash
         mutable QByteArray d_mac; // cache for formatMetaActuals
       };
 
@@ -682,8 +702,9 @@ namespace Obx
     {
         NoRef<Named> d_ident;
         QByteArray d_name; // name to be resolved with result written to d_ident
+        quint32 d_nameId; // symbol id of d_name
         IdentRole d_role;
-        IdentLeaf():d_mod(0),d_role(NoRole) {}
+        IdentLeaf():d_mod(0),d_role(NoRole),d_nameId(0) {}
         IdentLeaf( Named* id, const Ob::RowCol&, Module* mod, Type* t, IdentRole r );
         Module* d_mod; // we need this to find out when xref from which module the ident is coming
         Named* getIdent(bool first=false) const { return d_ident.data(); }
@@ -717,8 +738,9 @@ namespace Obx
     {
         NoRef<Named> d_ident;
         QByteArray d_name; // name to be resolved with result written to d_ident
+        quint32 d_nameId; // symbol id of d_name
         IdentRole d_role;
-        IdentSel():UnExpr(SEL),d_role(NoRole) {}
+        IdentSel():UnExpr(SEL),d_role(NoRole),d_nameId(0) {}
         Named* getIdent(bool first=false) const { return first && d_sub ? d_sub->getIdent(first) : d_ident.data(); }
         int getTag() const { return T_IdentSel; }
         void accept(AstVisitor* v) { v->visit(this); }
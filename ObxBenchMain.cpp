@@ -0,0 +1,1093 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QThread>
+#include <QTextStream>
+#include <QtDebug>
+#include "ObLexer.h"
+#include "ObErrors.h"
+#include "ObSymbolTable.h"
+#include "ObScan.h"
+#include "ObxModel.h"
+#include "ObxProject.h"
+#include "ObxCilGen.h"
+#include "ObxCGen2.h"
+#include "ObxTrace.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+// Measures the throughput of the compiler front end, e.g.
+//   OBXBENCH -lex -j8 -r10 testcases/ObxTests
+//   OBXBENCH -lex -cmp -r10 testcases/ObxTests
+//   OBXBENCH -parse -r20 testcases/ObxTests/Generic*.obx
+//   OBXBENCH -parse -skeleton testcases/ObxTests
+//   OBXBENCH -lookup testcases/ObxTests
+//   OBXBENCH -synth -sizes=100,200,400 -r3 -baseline=synth.json
+//   OBXBENCH -fuzzscan=100000
+
+static QStringList collectFiles( const QDir& dir )
+{
+    QStringList res;
+    QStringList files = dir.entryList( QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name );
+
+    foreach( const QString& f, files )
+        res += collectFiles( QDir( dir.absoluteFilePath(f) ) );
+
+    files = dir.entryList( QStringList() << QString("*.Mod")
+                                           << QString("*.mod")
+                           << QString("*.obx")
+                           << QString("*.Def")
+                           << QString("*.def")
+                                            << QString("*.obn"),
+                                           QDir::Files, QDir::Name );
+    foreach( const QString& f, files )
+    {
+        res.append( dir.absoluteFilePath(f) );
+    }
+    return res;
+}
+
+struct SourceFile
+{
+    QString d_path;
+    QByteArray d_code;
+};
+
+struct LexJob : public QRunnable
+{
+    const SourceFile& d_file;
+    QAtomicInt& d_tokens;
+    bool d_bufMode;
+    LexJob( const SourceFile& f, QAtomicInt& tokens, bool bufMode ):d_file(f),d_tokens(tokens),d_bufMode(bufMode) {}
+    void run()
+    {
+        Ob::Errors errs(0,true);
+        Ob::Lexer lex;
+        lex.setErrors(&errs);
+        lex.setIgnoreComments(true);
+        lex.setPackComments(true);
+        lex.setSensExt(true);
+        QBuffer buf;
+        if( d_bufMode )
+            lex.setBuffer( d_file.d_code, d_file.d_path );
+        else
+        {
+            buf.setData(d_file.d_code);
+            buf.open(QIODevice::ReadOnly);
+            lex.setStream( &buf, d_file.d_path );
+        }
+        int count = 0;
+        Ob::Token t = lex.nextToken();
+        while( !t.isEof() )
+        {
+            count++;
+            t = lex.nextToken();
+        }
+        d_tokens.fetchAndAddRelaxed(count);
+    }
+};
+
+static const char* s_levelNames[] = { "scalar", "sse2", "avx2" };
+
+static QList<Ob::Token> lexBuffer( Ob::Lexer& lex, const QByteArray& code, bool packComments )
+{
+    // the comment and literal values of the tokens are valid as long as lex
+    lex.setIgnoreComments(false);
+    lex.setPackComments(packComments);
+    lex.setBuffer( code, "fuzz" );
+    QList<Ob::Token> res;
+    Ob::Token t = lex.nextToken();
+    while( !t.isEof() )
+    {
+        res << t;
+        t = lex.nextToken();
+    }
+    return res;
+}
+
+static bool sameTokens( const QList<Ob::Token>& lhs, const QList<Ob::Token>& rhs )
+{
+    if( lhs.size() != rhs.size() )
+        return false;
+    for( int i = 0; i < lhs.size(); i++ )
+    {
+        if( lhs[i].d_type != rhs[i].d_type || lhs[i].d_lineNr != rhs[i].d_lineNr || lhs[i].d_colNr != rhs[i].d_colNr
+                || lhs[i].d_len != rhs[i].d_len || lhs[i].getVal() != rhs[i].getVal() )
+            return false;
+    }
+    return true;
+}
+
+static int fuzzScan( int iterations, QTextStream& out )
+{
+    // Compares the SIMD scanning kernels with the scalar ones on random input, both directly and by
+    // lexing the input with each level. The input is biased towards the bytes the kernels look for,
+    // and runs of them are long enough to cross the 16 and 32 byte blocks.
+    static const char alphabet[] = " \t\r\n\x0b\x0c\x1c" "aZz_09" "()*" "\"'" "\0" "\x80\xc3\xff" "@[`{/:=.$";
+    const int alphaLen = sizeof(alphabet) - 1;
+    const Ob::Scan::Level max = Ob::Scan::maxLevel();
+    out << "fuzzing the scanning kernels up to " << s_levelNames[max] << " with " << iterations << " inputs" << endl;
+    qsrand(4711);
+    int failed = 0;
+    for( int it = 0; it < iterations && failed < 10; it++ )
+    {
+        QByteArray buf( qrand() % 300, 0 );
+        const int runStart = qrand() % alphaLen, runLen = qrand() % 8 + 1;
+        for( int i = 0; i < buf.size(); i++ )
+        {
+            if( qrand() % 8 )
+                buf[i] = alphabet[ ( runStart + qrand() % runLen ) % alphaLen ]; // runs of similar bytes
+            else
+                buf[i] = alphabet[ qrand() % alphaLen ];
+        }
+        const int off = qrand() % ( buf.size() + 1 ); // also tests unaligned starts
+        const char* str = buf.constData() + off;
+        const int len = buf.size() - off;
+        const char a = alphabet[ qrand() % alphaLen ];
+        const char b = alphabet[ qrand() % alphaLen ];
+        const int space = Ob::Scan::skipSpaceScalar( str, len );
+        const int ident = Ob::Scan::identLenScalar( str, len );
+        const int either = Ob::Scan::findEitherScalar( str, len, a, b );
+
+        Ob::Scan::setLevel( Ob::Scan::Scalar );
+        const bool pack = it % 2;
+        Ob::Lexer refLex;
+        const QList<Ob::Token> ref = lexBuffer( refLex, buf, pack );
+        for( int l = Ob::Scan::SSE2; l <= max; l++ )
+        {
+            Ob::Scan::setLevel( Ob::Scan::Level(l) );
+            QByteArrayList what;
+            if( Ob::Scan::skipSpace( str, len ) != space )
+                what << "skipSpace";
+            if( Ob::Scan::identLen( str, len ) != ident )
+                what << "identLen";
+            if( Ob::Scan::findEither( str, len, a, b ) != either )
+                what << "findEither";
+            Ob::Lexer lex;
+            if( !sameTokens( ref, lexBuffer( lex, buf, pack ) ) )
+                what << "tokens";
+            if( !what.isEmpty() )
+            {
+                failed++;
+                out << "  " << s_levelNames[l] << " differs from scalar in " << what.join(", ")
+                    << " at input " << it << " offset " << off << ": " << buf.toHex() << endl;
+            }
+        }
+    }
+    Ob::Scan::setLevel( max );
+    out << ( failed ? "FAILED" : "passed" ) << endl;
+    return failed ? 1 : 0;
+}
+
+static qint64 lexAll( const QList<SourceFile>& files, int threads, int repeat, bool bufMode, QTextStream& out )
+{
+    quint64 bytes = 0;
+    foreach( const SourceFile& f, files )
+        bytes += f.d_code.size();
+
+    QAtomicInt tokens;
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    QElapsedTimer timer;
+    timer.start();
+    for( int r = 0; r < repeat; r++ )
+    {
+        foreach( const SourceFile& f, files )
+            pool.start( new LexJob(f,tokens,bufMode) );
+    }
+    pool.waitForDone();
+    const qint64 ms = qMax( timer.elapsed(), qint64(1) );
+
+    const quint64 count = quint32(tokens.load());
+    out << "lexed " << files.size() << " files (" << bytes / 1024 << " KB) " << repeat << " times with "
+        << threads << " threads in " << ( bufMode ? "buffer" : "stream" ) << " mode" << endl;
+    out << "  scanning kernels: " << s_levelNames[Ob::Scan::getLevel()] << endl;
+    out << "  " << count << " tokens in " << ms << " [ms], " << ( count * 1000 / ms ) << " tokens/s, "
+        << ( bytes * repeat * 1000 / ms / 1024 ) << " KB/s" << endl;
+    out << "  " << Ob::SymbolTable::inst()->count() << " symbols interned" << endl;
+    out << "  " << sizeof(Ob::Token) << " bytes per token" << endl;
+    return ms;
+}
+
+static void compareLexModes( const QList<SourceFile>& files, int threads, int repeat, QTextStream& out )
+{
+    // the same files with the same kernels in both modes, one after the other
+    const qint64 stream = lexAll( files, threads, repeat, false, out );
+    const qint64 buffer = lexAll( files, threads, repeat, true, out );
+    out << "stream mode " << stream << " [ms], buffer mode " << buffer << " [ms], speedup "
+        << QString::number( double(stream) / double(buffer), 'f', 2 ) << "x" << endl;
+}
+
+static qint64 peakRss()
+{
+    // in KiB, or -1 if unknown
+#ifdef Q_OS_LINUX
+    // VmHWM can be reset by resetPeakRss, ru_maxrss cannot
+    QFile status("/proc/self/status");
+    if( status.open(QIODevice::ReadOnly) )
+    {
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        foreach( const QByteArray& line, lines )
+        {
+            if( line.startsWith("VmHWM:") )
+                return line.mid(6).simplified().split(' ').first().toLongLong();
+        }
+    }
+#endif
+#ifdef Q_OS_UNIX
+    struct rusage u;
+    if( getrusage(RUSAGE_SELF, &u) != 0 )
+        return -1;
+#ifdef Q_OS_MAC
+    return u.ru_maxrss / 1024; // bytes on macOS
+#else
+    return u.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+static void parseAll( const QStringList& paths, int threads, int repeat, bool skeleton, QTextStream& out )
+{
+    // the whole front end including validation and instantiation of generic modules
+    Obx::Model mdl;
+    mdl.setThreadCount(threads);
+    mdl.setSkeleton(skeleton);
+    mdl.getErrs()->setReportToConsole(false);
+    Obx::PackageList pl;
+    Obx::Package p;
+    p.d_files = paths;
+    pl << p;
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = true;
+    for( int r = 0; r < repeat; r++ )
+        ok = mdl.parseFiles(pl) && ok;
+    const qint64 ms = qMax( timer.elapsed(), qint64(1) );
+
+    int insts = 0;
+    foreach( Obx::Module* m, mdl.getDepOrder() )
+        insts += mdl.instances(m).size();
+    out << "parsed and validated " << paths.size() << " files " << repeat << " times with "
+        << threads << " threads in " << ms << " [ms], " << ( ms / repeat ) << " [ms] per run" << endl;
+    out << "  " << mdl.getSloc() << " SLOC, " << mdl.getDepOrder().size() << " modules, "
+        << insts << " generic instances, " << mdl.getErrs()->getErrCount() << " errors" << endl;
+    if( skeleton )
+    {
+        // the remaining work, e.g. when all is generated; the sum is the time of a parse without -skeleton
+        timer.restart();
+        ok = mdl.materialize() && ok;
+        out << "  parsed and validated the procedure bodies in " << timer.elapsed() << " [ms], "
+            << mdl.getErrs()->getErrCount() << " errors" << endl;
+    }
+    timer.restart();
+    mdl.clear();
+    out << "  teardown in " << timer.elapsed() << " [ms], peak RSS " << peakRss() << " [KiB]" << endl;
+    if( !ok )
+        out << "  there were errors" << endl;
+}
+
+static void lookupAll( const QStringList& paths, int count, QTextStream& out )
+{
+    // findSymbolBySourcePos on the largest module, with and without the SourceIndex
+    Obx::Model mdl;
+    mdl.getErrs()->setReportToConsole(false);
+    Obx::PackageList pl;
+    Obx::Package p;
+    p.d_files = paths;
+    pl << p;
+    mdl.parseFiles(pl);
+
+    Obx::Module* largest = 0;
+    foreach( Obx::Module* m, mdl.getDepOrder() )
+    {
+        if( m->d_file.isEmpty() || !m->d_metaActuals.isEmpty() )
+            continue;
+        if( largest == 0 || m->d_end.d_row > largest->d_end.d_row )
+            largest = m;
+    }
+    if( largest == 0 )
+    {
+        out << "no module to look up" << endl;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Obx::SourceIndex index(largest);
+    const qint64 buildMs = timer.elapsed();
+
+    // the positions are random, but the same for each run
+    qsrand(4711);
+    QList<QPair<quint32,quint16> > pos;
+    const int rows = qMax( int(largest->d_end.d_row), 1 );
+    for( int i = 0; i < count; i++ )
+        pos << qMakePair( quint32( qrand() % rows + 1 ), quint16( qrand() % 60 + 1 ) );
+
+    int hits = 0;
+    timer.restart();
+    QList<QPair<Obx::Expression*,Obx::Scope*> > res;
+    for( int i = 0; i < pos.size(); i++ )
+    {
+        Obx::Scope* s = 0;
+        Obx::Expression* e = index.find( pos[i].first, pos[i].second, &s );
+        if( e )
+            hits++;
+        res << qMakePair(e,s);
+    }
+    const qint64 indexMs = timer.elapsed();
+
+    int diffs = 0;
+    timer.restart();
+    for( int i = 0; i < pos.size(); i++ )
+    {
+        Obx::Scope* s = 0;
+        Obx::Expression* e = Obx::SourceIndex::scan( largest, pos[i].first, pos[i].second, &s );
+        if( res[i].first != e || res[i].second != s )
+            diffs++;
+    }
+    const qint64 scanMs = timer.elapsed();
+
+    out << "looked up " << count << " positions in " << largest->d_file << " (" << largest->d_end.d_row
+        << " lines, " << index.getIdentCount() << " identifiers), " << hits << " hits" << endl;
+    out << "  index built in " << buildMs << " [ms], lookups in " << indexMs << " [ms]" << endl;
+    out << "  AST walk lookups in " << scanMs << " [ms]" << endl;
+    if( diffs )
+        out << "  " << diffs << " results differ from the AST walk" << endl;
+}
+
+struct SynthConfig
+{
+    int d_modules;  // ordinary modules
+    int d_fanout;   // imports per module
+    int d_generics; // generic module instantiations per module
+    int d_procs;    // procedures per module
+    int d_stmts;    // statements per procedure body
+    bool d_optimize; // the code generators run the Optimizer
+    SynthConfig():d_modules(100),d_fanout(4),d_generics(1),d_procs(10),d_stmts(20),d_optimize(false){}
+};
+
+class SynthGen
+{
+    // Writes a synthetic, error free Oberon+ project. The output only depends on the configuration, so
+    // two runs with the same configuration measure the same code.
+public:
+    SynthGen( const SynthConfig& cfg ):d_cfg(cfg),d_seed(4711),d_lines(0) {}
+    QStringList write( const QString& dir );
+    quint64 getLines() const { return d_lines; }
+    static int templateCount( const SynthConfig& cfg ) { return cfg.d_generics > 0 ? qMin( cfg.d_modules, 8 ) : 0; }
+private:
+    quint32 random( quint32 n )
+    {
+        d_seed = d_seed * 1103515245 + 12345;
+        return ( d_seed >> 16 ) % n;
+    }
+    void genericModule( QTextStream&, int g );
+    void module( QTextStream&, int m );
+    void statements( QTextStream&, int count );
+    bool writeFile( const QDir&, const QString& name, const QByteArray& code, QStringList& files );
+    SynthConfig d_cfg;
+    quint32 d_seed;
+    quint64 d_lines;
+};
+
+static const char* s_actuals[] = { "INTEGER", "LONGINT", "REAL", "BOOLEAN", "CHAR", "SET", "LONGREAL", "SHORTINT", "BYTE" };
+static const int s_actualCount = sizeof(s_actuals) / sizeof(s_actuals[0]);
+
+QStringList SynthGen::write(const QString& dir)
+{
+    QDir(dir).removeRecursively();
+    QDir().mkpath(dir);
+    QDir d(dir);
+    QStringList files;
+    for( int g = 0; g < templateCount(d_cfg); g++ )
+    {
+        QByteArray code;
+        QTextStream out(&code);
+        genericModule(out,g);
+        out.flush();
+        if( !writeFile( d, QString("Gen%1.obx").arg(g), code, files ) )
+            return QStringList();
+    }
+    for( int m = 0; m < d_cfg.d_modules; m++ )
+    {
+        QByteArray code;
+        QTextStream out(&code);
+        module(out,m);
+        out.flush();
+        if( !writeFile( d, QString("Syn%1.obx").arg(m), code, files ) )
+            return QStringList();
+    }
+    return files;
+}
+
+bool SynthGen::writeFile(const QDir& dir, const QString& name, const QByteArray& code, QStringList& files)
+{
+    QFile f( dir.absoluteFilePath(name) );
+    if( !f.open(QIODevice::WriteOnly) )
+    {
+        qCritical() << "cannot open for writing" << f.fileName();
+        return false;
+    }
+    f.write(code);
+    d_lines += code.count('\n');
+    files << f.fileName();
+    return true;
+}
+
+void SynthGen::statements(QTextStream& out, int count)
+{
+    // the body of a FOR loop with the control variable i, a local INTEGER s, a record r and an array a
+    for( int k = 0; k < count; k++ )
+    {
+        switch( random(8) )
+        {
+        case 0:
+            out << "    s := s + i * " << ( k + 2 ) << ";" << endl;
+            break;
+        case 1:
+            out << "    IF s > 1000 THEN s := s - 1000 ELSIF s < 0 THEN s := -s ELSE INC(s) END;" << endl;
+            break;
+        case 2:
+            out << "    WHILE s > 500 DO s := s DIV 2 END;" << endl;
+            break;
+        case 3:
+            out << "    r.a := s MOD 7; r.x := r.x + 1.5;" << endl;
+            break;
+        case 4:
+            out << "    CASE s MOD 4 OF" << endl;
+            out << "      0: s := s + 1" << endl;
+            out << "    | 1: s := s + 2" << endl;
+            out << "    | 2: s := s * 2" << endl;
+            out << "    ELSE s := 0" << endl;
+            out << "    END;" << endl;
+            break;
+        case 5:
+            out << "    a[i MOD 16] := s;" << endl;
+            break;
+        case 6:
+            out << "    IF (s > 10) & (r.a # 3) OR ODD(i) THEN s := s + a[(i + 1) MOD 16] END;" << endl;
+            break;
+        case 7:
+            out << "    REPEAT s := s - 3 UNTIL s < 100;" << endl;
+            break;
+        }
+    }
+}
+
+void SynthGen::genericModule(QTextStream& out, int g)
+{
+    out << "MODULE Gen" << g << "(T);" << endl << endl;
+    out << "TYPE Box* = POINTER TO RECORD value*: T; count*: INTEGER END;" << endl << endl;
+    out << "PROCEDURE Set*(b: Box; v: T);" << endl;
+    out << "BEGIN" << endl;
+    out << "  b.value := v; INC(b.count)" << endl;
+    out << "END Set;" << endl << endl;
+    out << "PROCEDURE Get*(b: Box): T;" << endl;
+    out << "BEGIN" << endl;
+    out << "  RETURN b.value" << endl;
+    out << "END Get;" << endl << endl;
+    out << "PROCEDURE Count*(b: Box; n: INTEGER): INTEGER;" << endl;
+    out << "  VAR i, s: INTEGER; r: RECORD a: INTEGER; x: LONGREAL END; a: ARRAY 16 OF INTEGER;" << endl;
+    out << "BEGIN" << endl;
+    out << "  s := b.count;" << endl;
+    out << "  FOR i := 0 TO n DO" << endl;
+    statements(out, d_cfg.d_stmts);
+    out << "  END;" << endl;
+    out << "  RETURN s" << endl;
+    out << "END Count;" << endl << endl;
+    out << "END Gen" << g << "." << endl;
+}
+
+void SynthGen::module(QTextStream& out, int m)
+{
+    // imports only go to modules with a lower number, so the import graph is acyclic
+    QList<int> imports;
+    const int fanout = qMin( d_cfg.d_fanout, m );
+    while( imports.size() < fanout )
+    {
+        const int i = random(m);
+        if( !imports.contains(i) )
+            imports << i;
+    }
+    const int templates = templateCount(d_cfg);
+
+    out << "MODULE Syn" << m << ";" << endl << endl;
+    if( !imports.isEmpty() || d_cfg.d_generics > 0 )
+    {
+        out << "IMPORT";
+        for( int k = 0; k < imports.size(); k++ )
+            out << ( k == 0 ? " " : ", " ) << "Syn" << imports[k];
+        for( int k = 0; k < d_cfg.d_generics; k++ )
+            out << ( k == 0 && imports.isEmpty() ? " " : ", " ) << endl << "  B" << k << " := Gen"
+                << random(templates) << "(" << s_actuals[random(s_actualCount)] << ")";
+        out << ";" << endl << endl;
+    }
+    out << "TYPE Rec* = RECORD a*, b*: INTEGER; x*: LONGREAL END;" << endl << endl;
+    if( d_cfg.d_generics > 0 )
+    {
+        out << "VAR" << endl;
+        for( int k = 0; k < d_cfg.d_generics; k++ )
+            out << "  box" << k << ": B" << k << ".Box;" << endl;
+        out << endl;
+    }
+    for( int p = 0; p < d_cfg.d_procs; p++ )
+    {
+        out << "PROCEDURE P" << p << "*(n: INTEGER): INTEGER;" << endl;
+        out << "  VAR i, s: INTEGER; r: Rec; a: ARRAY 16 OF INTEGER;" << endl;
+        out << "BEGIN" << endl;
+        out << "  s := n;" << endl;
+        out << "  FOR i := 0 TO n DO" << endl;
+        statements(out, d_cfg.d_stmts);
+        out << "  END;" << endl;
+        out << "  IF n > 0 THEN" << endl;
+        if( !imports.isEmpty() )
+            out << "    s := s + Syn" << imports[p % imports.size()] << ".P" << random(d_cfg.d_procs)
+                << "(n - 1);" << endl;
+        if( p > 0 )
+            out << "    s := s + P" << random(p) << "(n DIV 2);" << endl;
+        if( d_cfg.d_generics > 0 )
+        {
+            const int k = p % d_cfg.d_generics;
+            out << "    s := s + B" << k << ".Count(box" << k << ", n - 1);" << endl;
+        }
+        out << "  END;" << endl;
+        out << "  RETURN s" << endl;
+        out << "END P" << p << ";" << endl << endl;
+    }
+    if( d_cfg.d_generics > 0 )
+    {
+        out << "BEGIN" << endl;
+        for( int k = 0; k < d_cfg.d_generics; k++ )
+            out << "  NEW(box" << k << ");" << endl;
+    }
+    out << "END Syn" << m << "." << endl;
+}
+
+static bool resetPeakRss()
+{
+    // since Linux 4.0 writing 5 to clear_refs resets the VmHWM reported in /proc/self/status
+#ifdef Q_OS_LINUX
+    QFile f("/proc/self/clear_refs");
+    if( !f.open(QIODevice::WriteOnly) )
+        return false;
+    return f.write("5") == 1;
+#else
+    return false;
+#endif
+}
+
+struct PhaseResult
+{
+    QByteArray d_name;
+    double d_ms;
+    qint64 d_peak; // KiB or -1
+    PhaseResult( const QByteArray& name = QByteArray(), double ms = 0, qint64 peak = -1 ):
+        d_name(name),d_ms(ms),d_peak(peak){}
+};
+
+struct SynthResult
+{
+    int d_modules;
+    quint64 d_lines;
+    QList<PhaseResult> d_phases;
+    SynthResult():d_modules(0),d_lines(0){}
+    const PhaseResult* find( const QByteArray& name ) const
+    {
+        for( int i = 0; i < d_phases.size(); i++ )
+            if( d_phases[i].d_name == name )
+                return &d_phases[i];
+        return 0;
+    }
+};
+
+static double linesPerSec( quint64 lines, double ms )
+{
+    return ms > 0.0 ? lines * 1000.0 / ms : 0.0;
+}
+
+enum SynthPhase { FrontEnd, CilPelib, CilIlOnly, CGen };
+
+static bool runPhase( Obx::Project* pro, SynthPhase phase, const QString& outDir )
+{
+    switch( phase )
+    {
+    case FrontEnd:
+        return pro->parse();
+    case CilPelib:
+        return Obx::CilGen::translateAll( pro, Obx::CilGen::Pelib, false, outDir, true );
+    case CilIlOnly:
+        return Obx::CilGen::translateAll( pro, Obx::CilGen::IlOnly, false, outDir, true );
+    case CGen:
+        return Obx::CGen2::translateAll( pro, false, outDir );
+    }
+    return false;
+}
+
+static bool synthAll( const SynthConfig& cfg, const QString& dir, int threads, int repeat, SynthResult& res,
+                      QTextStream& out )
+{
+    SynthGen gen(cfg);
+    const QStringList files = gen.write( QDir(dir).absoluteFilePath("src") );
+    if( files.isEmpty() )
+        return false;
+    res.d_modules = cfg.d_modules;
+    res.d_lines = gen.getLines();
+    out << "synthetic project with " << cfg.d_modules << " modules, " << SynthGen::templateCount(cfg)
+        << " generic modules, " << res.d_lines << " lines in " << dir << endl;
+
+    Obx::Project pro;
+    pro.getMdl()->setThreadCount(threads);
+    pro.setOptimize(cfg.d_optimize);
+    Obx::PackageList pl;
+    Obx::Package p;
+    p.d_files = files;
+    pl << p;
+    pro.initializeFromPackageList(pl);
+
+    static const char* names[] = { "front end", "cil pelib", "cil ilonly", "c" };
+    static const char* subs[] = { "lex and parse", "validate", "instantiate" };
+    const bool peakPerPhase = resetPeakRss();
+    for( int ph = FrontEnd; ph <= CGen; ph++ )
+    {
+        const QString outDir = QDir(dir).absoluteFilePath( QString(names[ph]).replace(' ','-') );
+        if( ph != FrontEnd )
+            QDir().mkpath(outDir);
+        double best = -1.0;
+        qint64 peak = -1;
+        QList<qint64> subTotals;
+        for( int r = 0; r < repeat; r++ )
+        {
+            if( ph == FrontEnd )
+                Obx::Trace::setEnabled(true);
+            resetPeakRss();
+            QElapsedTimer timer;
+            timer.start();
+            const bool ok = runPhase( &pro, SynthPhase(ph), outDir );
+            const double ms = timer.nsecsElapsed() / 1000000.0;
+            if( !ok || pro.getErrs()->getErrCount() != 0 )
+            {
+                out << "  " << names[ph] << " failed with " << pro.getErrs()->getErrCount() << " errors" << endl;
+                Obx::Trace::setEnabled(false);
+                return false;
+            }
+            if( best < 0.0 || ms < best )
+            {
+                best = ms;
+                if( ph == FrontEnd )
+                {
+                    subTotals.clear();
+                    for( int s = 0; s < 3; s++ )
+                        subTotals << Obx::Trace::getTotal(subs[s]);
+                }
+            }
+            peak = qMax( peak, peakRss() );
+            Obx::Trace::setEnabled(false);
+        }
+        res.d_phases << PhaseResult( names[ph], best, peak );
+        out << QString("  %1 %2 [ms] %3 lines/s, peak RSS %4 [KiB]").arg(QString(names[ph]),-12)
+               .arg(best, 10, 'f', 1).arg(qint64(linesPerSec(res.d_lines,best)), 10).arg(peak) << endl;
+        for( int s = 0; s < subTotals.size(); s++ )
+        {
+            // summed over all threads, so only comparable to the wall time with -j1
+            const double ms = subTotals[s] / 1000000.0;
+            res.d_phases << PhaseResult( subs[s], ms );
+            out << QString("    %1 %2 [ms] %3 lines/s").arg(QString(subs[s]),-14)
+                   .arg(ms, 8, 'f', 1).arg(qint64(linesPerSec(res.d_lines,ms)), 10) << endl;
+        }
+    }
+    if( !peakPerPhase )
+        out << "  the peak RSS cannot be reset on this system and includes the preceding phases" << endl;
+    return true;
+}
+
+static QJsonObject toJson( const SynthConfig& cfg, int threads, const QList<SynthResult>& results )
+{
+    QJsonObject config;
+    config["fanout"] = cfg.d_fanout;
+    config["generics"] = cfg.d_generics;
+    config["procs"] = cfg.d_procs;
+    config["stmts"] = cfg.d_stmts;
+    config["threads"] = threads;
+    QJsonArray runs;
+    foreach( const SynthResult& r, results )
+    {
+        QJsonObject phases;
+        foreach( const PhaseResult& p, r.d_phases )
+        {
+            QJsonObject o;
+            o["ms"] = p.d_ms;
+            o["linesPerSec"] = linesPerSec(r.d_lines,p.d_ms);
+            if( p.d_peak >= 0 )
+                o["peakKiB"] = p.d_peak;
+            phases[ QString::fromUtf8(p.d_name) ] = o;
+        }
+        QJsonObject run;
+        run["modules"] = r.d_modules;
+        run["lines"] = double(r.d_lines);
+        run["phases"] = phases;
+        runs.append(run);
+    }
+    QJsonObject res;
+    res["config"] = config;
+    res["runs"] = runs;
+    return res;
+}
+
+static SynthResult fromJson( const QJsonObject& run )
+{
+    SynthResult res;
+    res.d_modules = run["modules"].toInt();
+    res.d_lines = run["lines"].toDouble();
+    const QJsonObject phases = run["phases"].toObject();
+    foreach( const QString& name, phases.keys() )
+    {
+        const QJsonObject o = phases[name].toObject();
+        res.d_phases << PhaseResult( name.toUtf8(), o["ms"].toDouble(), o["peakKiB"].toDouble(-1) );
+    }
+    return res;
+}
+
+static double costGrowth( const SynthResult& small, const SynthResult& large, const QByteArray& phase )
+{
+    // how much more time per line the largest project takes than the smallest one; 1.0 is linear
+    const PhaseResult* s = small.find(phase);
+    const PhaseResult* l = large.find(phase);
+    if( s == 0 || l == 0 || s->d_ms <= 0.0 || small.d_lines == 0 || large.d_lines == 0 )
+        return 0.0;
+    return ( l->d_ms / large.d_lines ) / ( s->d_ms / small.d_lines );
+}
+
+static int compareBaseline( const QString& path, const SynthConfig& cfg, int threads,
+                            const QList<SynthResult>& results, int tolerance, QTextStream& out )
+{
+    // returns the number of regressions, or -1 if the baseline cannot be used
+    QFile f(path);
+    if( !f.open(QIODevice::ReadOnly) )
+    {
+        out << "cannot open baseline " << path << endl;
+        return -1;
+    }
+    const QJsonObject base = QJsonDocument::fromJson(f.readAll()).object();
+    if( base["config"].toObject() != toJson(cfg,threads,QList<SynthResult>())["config"].toObject() )
+    {
+        out << "baseline " << path << " was measured with a different configuration" << endl;
+        return -1;
+    }
+    QMap<int,SynthResult> baseRuns;
+    foreach( const QJsonValue& v, base["runs"].toArray() )
+    {
+        const SynthResult r = fromJson(v.toObject());
+        baseRuns[r.d_modules] = r;
+    }
+
+    const double factor = 1.0 + tolerance / 100.0;
+    const double noise = 5.0; // [ms], smaller differences are not reported
+    int regressions = 0;
+    out << "comparing with baseline " << path << " (tolerance " << tolerance << "%)" << endl;
+    foreach( const SynthResult& r, results )
+    {
+        if( !baseRuns.contains(r.d_modules) )
+        {
+            out << "  no baseline for " << r.d_modules << " modules" << endl;
+            continue;
+        }
+        const SynthResult& b = baseRuns[r.d_modules];
+        foreach( const PhaseResult& p, r.d_phases )
+        {
+            const PhaseResult* bp = b.find(p.d_name);
+            if( bp == 0 )
+                continue;
+            if( p.d_ms > bp->d_ms * factor && p.d_ms - bp->d_ms > noise )
+            {
+                out << QString("  REGRESSION %1 modules, %2: %3 [ms] instead of %4 [ms]").arg(r.d_modules)
+                       .arg(QString(p.d_name)).arg(p.d_ms, 0, 'f', 1).arg(bp->d_ms, 0, 'f', 1) << endl;
+                regressions++;
+            }
+            if( p.d_peak > 0 && bp->d_peak > 0 && p.d_peak > bp->d_peak * factor )
+            {
+                out << QString("  REGRESSION %1 modules, %2: peak RSS %3 [KiB] instead of %4 [KiB]")
+                       .arg(r.d_modules).arg(QString(p.d_name)).arg(p.d_peak).arg(bp->d_peak) << endl;
+                regressions++;
+            }
+        }
+    }
+    if( results.size() > 1 && baseRuns.contains(results.first().d_modules)
+            && baseRuns.contains(results.last().d_modules) )
+    {
+        const SynthResult& bs = baseRuns[results.first().d_modules];
+        const SynthResult& bl = baseRuns[results.last().d_modules];
+        foreach( const PhaseResult& p, results.last().d_phases )
+        {
+            const double now = costGrowth( results.first(), results.last(), p.d_name );
+            const double was = costGrowth( bs, bl, p.d_name );
+            if( was > 0.0 && now > was * factor )
+            {
+                out << QString("  SCALING REGRESSION %1: the time per line grows by %2 instead of %3 from %4 to %5 modules")
+                       .arg(QString(p.d_name)).arg(now, 0, 'f', 2).arg(was, 0, 'f', 2)
+                       .arg(results.first().d_modules).arg(results.last().d_modules) << endl;
+                regressions++;
+            }
+        }
+    }
+    if( regressions == 0 )
+        out << "  no regressions" << endl;
+    return regressions;
+}
+
+static int synthBench( const SynthConfig& cfg, const QList<int>& sizes, const QString& dir, int threads, int repeat,
+                       const QString& savePath, const QString& basePath, int tolerance, QTextStream& out )
+{
+    QList<SynthResult> results;
+    foreach( int size, sizes )
+    {
+        SynthConfig c = cfg;
+        c.d_modules = size;
+        SynthResult r;
+        if( !synthAll( c, dir, threads, repeat, r, out ) )
+            return -1;
+        results << r;
+    }
+    if( results.size() > 1 )
+    {
+        out << "time per line from " << results.first().d_modules << " to " << results.last().d_modules
+            << " modules grows by (1.00 is linear):" << endl;
+        foreach( const PhaseResult& p, results.last().d_phases )
+            out << QString("  %1 %2").arg(QString(p.d_name),-14)
+                   .arg(costGrowth(results.first(),results.last(),p.d_name), 0, 'f', 2) << endl;
+    }
+    if( !savePath.isEmpty() )
+    {
+        QFile f(savePath);
+        if( !f.open(QIODevice::WriteOnly) )
+        {
+            out << "cannot write baseline " << savePath << endl;
+            return -1;
+        }
+        f.write( QJsonDocument( toJson(cfg,threads,results) ).toJson() );
+        out << "baseline written to " << savePath << endl;
+    }
+    if( !basePath.isEmpty() )
+    {
+        const int regressions = compareBaseline( basePath, cfg, threads, results, tolerance, out );
+        if( regressions != 0 )
+            return regressions < 0 ? -1 : 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setOrganizationName("Rochus Keller");
+    a.setOrganizationDomain("https://github.com/rochus-keller/Oberon");
+    a.setApplicationName("OBXBENCH");
+    a.setApplicationVersion("2021-10-16");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QStringList dirOrFilePaths;
+    int threads = 1;
+    int repeat = 1;
+    bool bufMode = false;
+    bool compareModes = false;
+    bool parse = false;
+    bool skeleton = false;
+    bool lookup = false;
+    bool synth = false;
+    SynthConfig cfg;
+    QList<int> sizes;
+    QString synthDir = QDir::temp().absoluteFilePath("obxbench");
+    QString savePath, basePath;
+    int tolerance = 25;
+    int fuzz = 0;
+    const QStringList args = QCoreApplication::arguments();
+    for( int i = 1; i < args.size(); i++ )
+    {
+        if( args[i] == "-h" )
+        {
+            out << "usage: OBXBENCH [options] files or directories" << endl;
+            out << "  measures the throughput of the Oberon+ compiler front end" << endl;
+            out << "options:" << endl;
+            out << "  -h            display this information" << endl;
+            out << "  -lex          lex all files and report tokens/s (default)" << endl;
+            out << "  -parse        parse and validate all files as one project, including generic instantiation" << endl;
+            out << "  -skeleton     -parse: only parse and validate the declarations, then the procedure bodies" << endl;
+            out << "  -lookup       look up 10000 random source positions in the largest module" << endl;
+            out << "  -synth        generate a synthetic project and measure the front end and the code generators" << endl;
+            out << "  -modules=N    number of modules of the synthetic project (default 100)" << endl;
+            out << "  -sizes=N,M,.. measure synthetic projects with N, M, .. modules and report the scaling" << endl;
+            out << "  -fanout=N     imports per synthetic module (default 4)" << endl;
+            out << "  -generics=N   generic module instantiations per synthetic module (default 1)" << endl;
+            out << "  -procs=N      procedures per synthetic module (default 10)" << endl;
+            out << "  -stmts=N      statements per synthetic procedure (default 20)" << endl;
+            out << "  -O            the synthetic code generators run the optimizer" << endl;
+            out << "  -out=path     where the synthetic project and the generated code go (default temp dir)" << endl;
+            out << "  -save=file    write the synthetic results as a JSON baseline" << endl;
+            out << "  -baseline=file compare the synthetic results with a JSON baseline, exit code 1 on regressions" << endl;
+            out << "  -tol=N        tolerated slowdown compared to the baseline in percent (default 25)" << endl;
+            out << "  -scan=level   scanning kernels used by the lexer: scalar, sse2 or avx2 (default: best supported)" << endl;
+            out << "  -fuzzscan[=N] compare the SIMD scanning kernels with the scalar ones on N random inputs" << endl;
+            out << "  -buf          lex from the whole buffer instead of line by line from a QIODevice" << endl;
+            out << "  -cmp          lex in stream and in buffer mode and report both times side by side" << endl;
+            out << "  -jN           use N parallel threads (-j: one per core)" << endl;
+            out << "  -rN           repeat the measurement N times (-synth: report the fastest run)" << endl;
+            return 0;
+        }else if( args[i] == "-lex" )
+            parse = false;
+        else if( args[i] == "-parse" )
+            parse = true;
+        else if( args[i] == "-skeleton" )
+            skeleton = parse = true;
+        else if( args[i] == "-lookup" )
+            lookup = true;
+        else if( args[i] == "-synth" )
+            synth = true;
+        else if( args[i].startsWith("-modules=") )
+            cfg.d_modules = qMax( args[i].mid(9).toInt(), 1 );
+        else if( args[i].startsWith("-sizes=") )
+        {
+            foreach( const QString& n, args[i].mid(7).split(',', QString::SkipEmptyParts) )
+                sizes << qMax( n.toInt(), 1 );
+        }else if( args[i].startsWith("-fanout=") )
+            cfg.d_fanout = qMax( args[i].mid(8).toInt(), 0 );
+        else if( args[i].startsWith("-generics=") )
+            cfg.d_generics = qMax( args[i].mid(10).toInt(), 0 );
+        else if( args[i].startsWith("-procs=") )
+            cfg.d_procs = qMax( args[i].mid(7).toInt(), 1 );
+        else if( args[i].startsWith("-stmts=") )
+            cfg.d_stmts = qMax( args[i].mid(7).toInt(), 0 );
+        else if( args[i] == "-O" )
+            cfg.d_optimize = true;
+        else if( args[i].startsWith("-out=") )
+            synthDir = QDir::current().absoluteFilePath(args[i].mid(5));
+        else if( args[i].startsWith("-save=") )
+            savePath = QDir::current().absoluteFilePath(args[i].mid(6));
+        else if( args[i].startsWith("-baseline=") )
+            basePath = QDir::current().absoluteFilePath(args[i].mid(10));
+        else if( args[i].startsWith("-tol=") )
+            tolerance = qMax( args[i].mid(5).toInt(), 0 );
+        else if( args[i].startsWith("-scan=") )
+        {
+            const QString level = args[i].mid(6);
+            int l = 0;
+            while( l <= Ob::Scan::AVX2 && level != s_levelNames[l] )
+                l++;
+            if( l > Ob::Scan::AVX2 )
+            {
+                err << "error: unknown scanning level " << level << endl;
+                return -1;
+            }
+            if( l > Ob::Scan::maxLevel() )
+                err << "warning: " << level << " is not supported, using " << s_levelNames[Ob::Scan::maxLevel()] << endl;
+            Ob::Scan::setLevel( Ob::Scan::Level(l) );
+        }else if( args[i] == "-fuzzscan" )
+            fuzz = 10000;
+        else if( args[i].startsWith("-fuzzscan=") )
+            fuzz = qMax( args[i].mid(10).toInt(), 1 );
+        else if( args[i] == "-buf" )
+            bufMode = true;
+        else if( args[i] == "-cmp" )
+            compareModes = true;
+        else if( args[i] == "-j" )
+            threads = QThread::idealThreadCount();
+        else if( args[i].startsWith("-j") )
+            threads = qMax( args[i].mid(2).toInt(), 1 );
+        else if( args[i].startsWith("-r") )
+            repeat = qMax( args[i].mid(2).toInt(), 1 );
+        else if( !args[i].startsWith('-') )
+            dirOrFilePaths += args[i];
+        else
+        {
+            err << "error: invalid command line option " << args[i] << endl;
+            return -1;
+        }
+    }
+    if( fuzz )
+        return fuzzScan( fuzz, out );
+    if( synth )
+    {
+        if( sizes.isEmpty() )
+            sizes << cfg.d_modules;
+        std::sort( sizes.begin(), sizes.end() );
+        return synthBench( cfg, sizes, synthDir, threads, repeat, savePath, basePath, tolerance, out );
+    }
+    if( dirOrFilePaths.isEmpty() )
+    {
+        out << "no file or directory to process; quitting (use -h option for help)" << endl;
+        return -1;
+    }
+
+    QStringList paths;
+    foreach( const QString& path, dirOrFilePaths )
+    {
+        QFileInfo info(path);
+        if( info.isDir() )
+            paths += collectFiles( info.absoluteFilePath() );
+        else
+            paths << info.absoluteFilePath();
+    }
+
+    if( lookup )
+    {
+        lookupAll( paths, 10000, out );
+        return 0;
+    }
+    if( parse )
+    {
+        parseAll( paths, threads, repeat, skeleton, out );
+        return 0;
+    }
+
+    // all files are read in advance so that file IO is not part of the measurement
+    QList<SourceFile> files;
+    foreach( const QString& path, paths )
+    {
+        QFile f(path);
+        if( !f.open(QIODevice::ReadOnly) )
+        {
+            err << "cannot open file " << path << endl;
+            continue;
+        }
+        SourceFile sf;
+        sf.d_path = path;
+        sf.d_code = f.readAll();
+        files << sf;
+    }
+
+    if( compareModes )
+        compareLexModes( files, threads, repeat, out );
+    else
+        lexAll( files, threads, repeat, bufMode, out );
+    return 0;
+}
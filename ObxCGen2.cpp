@@ -21,6 +21,8 @@
 #include "ObxAst.h"
 #include "ObErrors.h"
 #include "ObxProject.h"
+#include "ObxTrace.h"
+#include "ObxOptimizer.h"
 #include <QtDebug>
 #include <QFile>
 #include <QDir>
@@ -28,6 +30,7 @@
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QBuffer>
+#include <limits>
 using namespace Obx;
 using namespace Ob;
 
@@ -139,6 +142,8 @@ struct ObxCGenImp : public AstVisitor
     QList<QPair<QString,QIODevice*> > overlay;
     bool ownsErr;
     bool debug; // generate line pragmas
+    bool optimize;
+    bool devirtualize; // optimize, and all modules of the program are loaded
     quint32 anonymousDeclNr; // starts with one, zero is an invalid slot
     Procedure* curProc;
     Named* curVarDecl;
@@ -157,9 +162,15 @@ struct ObxCGenImp : public AstVisitor
     QList<QPair<QByteArray,bool> > temps;
 #endif
     QList<int> sellLater;
+    QList<quint32> loopExits; // per enclosing LOOP the label after it if an EXIT needs a goto, else 0
+    int breakNesting; // the switch and do while statements in the innermost LOOP
+    quint32 labelNr;
+    QSet<Module*> declared; // the modules whose headers are included, thisMod and the imports transitively
+    quint32 boundCalls, directCalls, guardedCalls;
+    enum { MaxGuardedTargets = 3 }; // the dispatch of a type-bound call is guarded if it has at most two overrides
 
-    ObxCGenImp():err(0),thisMod(0),ownsErr(false),level(0),debug(false),anonymousDeclNr(1),
-        curProc(0),curVarDecl(0){}
+    ObxCGenImp():err(0),thisMod(0),ownsErr(false),level(0),debug(false),optimize(false),devirtualize(false),anonymousDeclNr(1),
+        curProc(0),curVarDecl(0),breakNesting(0),labelNr(0),boundCalls(0),directCalls(0),guardedCalls(0){}
 
     inline QByteArray ws() { return QByteArray(level*4,' '); }
 
@@ -1159,6 +1170,14 @@ struct ObxCGenImp : public AstVisitor
             }
         }
 
+        Optimizer::Body body;
+        if( optimize )
+            body = Optimizer::optimize(me, devirtualize);
+        else
+            body.d_stats = me->d_body;
+        foreach( const Ref<LocalVar>& t, body.d_temps )
+            b << ws() << formatType( t->d_type.data(), escape(t->d_name) ) << ";" << endl;
+
         beginBody();
 
         // initializer
@@ -1205,12 +1224,12 @@ struct ObxCGenImp : public AstVisitor
             }
         }
 
-        foreach( const Ref<Statement>& s, me->d_body )
+        foreach( const Ref<Statement>& s, body.d_stats )
         {
             emitStatement(s.data());
         }
 
-        if( !pt->d_return.isNull() && ( me->d_body.isEmpty() || me->d_body.last()->getTag() != Thing::T_Return ) )
+        if( !pt->d_return.isNull() && ( body.d_stats.isEmpty() || body.d_stats.last()->getTag() != Thing::T_Return ) )
         {
             b << ws() << "return ";
             emitDefault(pt->d_return.data(),me->d_end);
@@ -2791,6 +2810,92 @@ struct ObxCGenImp : public AstVisitor
             b << ".$a";
     }
 
+    bool isDeclared( Procedure* p )
+    {
+        if( declared.isEmpty() )
+        {
+            QList<Module*> todo;
+            todo << thisMod;
+            while( !todo.isEmpty() )
+            {
+                Module* m = todo.takeLast();
+                if( declared.contains(m) )
+                    continue;
+                declared.insert(m);
+                foreach( Import* imp, m->d_imports )
+                {
+                    if( !imp->d_mod.isNull() )
+                        todo << imp->d_mod.data();
+                }
+            }
+        }
+        return declared.contains(p->getModule());
+    }
+
+    bool emitDevirtualized( ProcType* pt, ArgExpr* me )
+    {
+        // ( pointer ^ | record ) .method (args) as a direct call if there is no override of method in the
+        // program which the receiver could dispatch to; with one or two overrides each target is called
+        // directly if the class of the receiver refers to it; false if the dispatch has to stay
+        Q_ASSERT(me->d_sub->getTag() == Thing::T_IdentSel );
+        IdentSel* method = cast<IdentSel*>(me->d_sub.data());
+        Type* td = derefed(method->d_sub->d_type.data());
+        Q_ASSERT(td && td->getTag() == Thing::T_Record);
+        Procedure* p = cast<Procedure*>(method->getIdent());
+        boundCalls++;
+
+        const QList<Procedure*> targets = Optimizer::dispatchTargets(p, cast<Record*>(td));
+        if( targets.size() > MaxGuardedTargets )
+            return false;
+        foreach( Procedure* t, targets )
+        {
+            if( !isDeclared(t) )
+                return false;
+        }
+
+        if( targets.size() == 1 )
+        {
+            directCalls++;
+            b << dottedName(p) << "((void*)";
+            renderDesig2(method->d_sub->d_type.data(),method->d_sub.data(),true);
+            if( !pt->d_formals.isEmpty() )
+            {
+                b << ", ";
+                emitActuals(pt,me);
+            }
+            b << ")";
+            return true;
+        }
+
+        guardedCalls++;
+        const int self = buyTemp("void*");
+        const QByteArray vtable = "((" + formatType(p->d_receiverRec,"*") + ")$t" + QByteArray::number(self) +
+                ")->class$->" + escape( method->getIdent()->d_name);
+        b << "($t" << self << " = ";
+        renderDesig2(method->d_sub->d_type.data(),method->d_sub.data(),true);
+        b << ", ";
+        for( int i = 0; i <= targets.size(); i++ )
+        {
+            if( i < targets.size() )
+                b << "(void(*)())" << vtable << " == (void(*)())" << dottedName(targets[i]) << " ? "
+                  << dottedName(targets[i]);
+            else
+                b << vtable; // a class not known when the module was generated
+            b << "($t" << self;
+            if( !pt->d_formals.isEmpty() )
+            {
+                b << ", ";
+                emitActuals(pt,me);
+            }
+            b << ")";
+            if( i < targets.size() )
+                b << " : ";
+        }
+        b << ")";
+        sellTemp(self);
+        return true;
+    }
+
     void emitActuals( ProcType* pt, ArgExpr* me )
     {
         Q_ASSERT( pt->d_formals.size() <= me->d_args.size() );
@@ -2971,7 +3076,9 @@ struct ObxCGenImp : public AstVisitor
         if( unsafeArrayReturn )
             b << "(struct OBX$Array$1){0,1,";
 
-        if( pt->d_typeBound && !superCall )
+        if( pt->d_typeBound && !superCall && func && devirtualize && emitDevirtualized(pt, me) )
+            ; // NOP
+        else if( pt->d_typeBound && !superCall )
         {
             if( func )
             {
@@ -3557,7 +3664,15 @@ struct ObxCGenImp : public AstVisitor
 
     void visit( Exit*)
     {
-        b << ws() << "break;" << endl; // since we don't use switch this doesn't colide with switch/break.
+        if( breakNesting == 0 || loopExits.isEmpty() )
+            b << ws() << "break;" << endl;
+        else
+        {
+            // a break would only leave the enclosing switch or do while
+            if( loopExits.back() == 0 )
+                loopExits.back() = ++labelNr;
+            b << ws() << "goto $exit" << loopExits.back() << ";" << endl;
+        }
     }
 
     void visit( Return* me)
@@ -3569,145 +3684,137 @@ struct ObxCGenImp : public AstVisitor
         b << ";" << endl;
     }
 
-    void visit( CaseStmt* me)
+    void emitCaseValue( qint64 val, bool wide )
     {
-        // NOTE: identical with CilGen!
-
-        if( me->d_typeCase )
+        // the C literal of the minimum is the negation of a positive literal, which is out of range
+        if( wide && val == std::numeric_limits<qint64>::min() )
+            b << "(-9223372036854775807ll-1)";
+        else if( !wide && val == std::numeric_limits<qint32>::min() )
+            b << "(-2147483647-1)";
+        else
         {
-            // first rewrite the AST with 'if' instead of complex 'case'
-
-            if( me->d_cases.isEmpty() )
-                return;
-
-            Ref<IfLoop> ifl = new IfLoop();
-            ifl->d_op = IfLoop::IF;
-            ifl->d_loc = me->d_loc;
+            b << val;
+            if( wide )
+                b << "ll";
+        }
+    }
 
-            for( int i = 0; i < me->d_cases.size(); i++ )
+    void emitCaseSearch( const Optimizer::CaseTable& t, int from, int to, const QByteArray& sel, bool wide,
+                         quint32 nr )
+    {
+        // binary search in t.d_ranges[from,to) for the value of sel
+        if( to - from <= 3 )
+        {
+            for( int i = from; i < to; i++ )
             {
-                const CaseStmt::Case& c = me->d_cases[i];
-
-                Q_ASSERT( c.d_labels.size() == 1 );
-                Type* td = derefed(c.d_labels.first()->d_type.data());
-
-                Ref<BinExpr> eq = new BinExpr();
-                if( td && td->getBaseType() == Type::NIL )
-                    eq->d_op = BinExpr::EQ;
-                else
-                    eq->d_op = BinExpr::IS;
-                eq->d_lhs = me->d_exp;
-                eq->d_rhs = c.d_labels.first();
-                eq->d_loc = me->d_exp->d_loc;
-                eq->d_type = new BaseType(Type::BOOLEAN);
-
-                ifl->d_if.append(eq.data());
-                ifl->d_then.append( c.d_block );
+                const Optimizer::CaseTable::Range& r = t.d_ranges[i];
+                b << ws() << "if( ";
+                if( r.d_lo == r.d_hi )
+                {
+                    b << sel << " == ";
+                    emitCaseValue(r.d_lo, wide);
+                }else
+                {
+                    b << sel << " >= ";
+                    emitCaseValue(r.d_lo, wide);
+                    b << " && " << sel << " <= ";
+                    emitCaseValue(r.d_hi, wide);
+                }
+                b << " ) goto $case" << nr << "_" << r.d_case << ";" << endl;
             }
-
-            ifl->d_else = me->d_else;
-
-            // and now generate code for the if
-            ifl->accept(this);
+            b << ws() << "goto $case" << nr << "_else;" << endl;
+            return;
         }
-        else
-        {
-            // first rewrite the AST with 'if' instead of complex 'case'
-
-            Ref<IfLoop> ifl = new IfLoop();
-            ifl->d_op = IfLoop::IF;
-            ifl->d_loc = me->d_loc;
+        const int mid = ( from + to ) / 2;
+        b << ws() << "if( " << sel << " < ";
+        emitCaseValue(t.d_ranges[mid].d_lo, wide);
+        b << " ) {" << endl;
+        level++;
+        emitCaseSearch( t, from, mid, sel, wide, nr );
+        level--;
+        b << ws() << "}" << endl;
+        emitCaseSearch( t, mid, to, sel, wide, nr );
+    }
 
-            Ref<BaseType> boolean = new BaseType(Type::BOOLEAN);
+    void visit( CaseStmt* me)
+    {
+        Optimizer::CaseTable t;
+        if( !me->d_cases.isEmpty() && Optimizer::caseTable(me, thisMod, t) )
+        {
+            // the selector is evaluated once; dense labels use a switch, sparse ones a binary search
+            Type* td = derefed(me->d_exp->d_type.data());
+            const bool wide = td->getBaseType() == Type::INT64;
+            const int temp = buyTemp(formatType(td));
+            const QByteArray sel = "$t" + QByteArray::number(temp);
+            b << ws() << sel << " = ";
+            renderDesig(td, me->d_exp.data(), false);
+            b << ";" << endl;
 
-            // TODO: consider switch statement
-            for( int i = 0; i < me->d_cases.size(); i++ )
+            if( t.d_dense )
             {
-                const CaseStmt::Case& c = me->d_cases[i];
-
-                QList< Ref<Expression> > ors;
-                for( int j = 0; j < c.d_labels.size(); j++ )
+                b << ws() << "switch( " << sel << " ) {" << endl;
+                sellTemp(temp,false);
+                breakNesting++;
+                for( int i = 0; i < me->d_cases.size(); i++ )
                 {
-                    Expression* l = c.d_labels[j].data();
-                    // TODO: avoid redundant evaluations using temp vars
-                    bool done = false;
-                    if( l->getTag() == Thing::T_BinExpr )
+                    foreach( const Optimizer::CaseTable::Range& r, t.d_ranges )
                     {
-                        BinExpr* bi = cast<BinExpr*>( l );
-                        if( bi->d_op == BinExpr::Range )
+                        if( r.d_case != i )
+                            continue;
+                        for( qint64 v = r.d_lo; v <= r.d_hi; v++ )
                         {
-                            // TODO: consider lhs > rhs
-                            Ref<BinExpr> _and = new BinExpr();
-                            _and->d_op = BinExpr::AND;
-                            _and->d_loc = l->d_loc;
-                            _and->d_type = boolean.data();
-
-                            Ref<BinExpr> lhs = new BinExpr();
-                            lhs->d_op = BinExpr::GEQ;
-                            lhs->d_lhs = me->d_exp;
-                            lhs->d_rhs = bi->d_lhs;
-                            lhs->d_loc = l->d_loc;
-                            lhs->d_type = boolean.data();
-
-                            Ref<BinExpr> rhs = new BinExpr();
-                            rhs->d_op = BinExpr::LEQ;
-                            rhs->d_lhs = me->d_exp;
-                            rhs->d_rhs = bi->d_rhs;
-                            rhs->d_loc = l->d_loc;
-                            rhs->d_type = boolean.data();
-
-                            _and->d_lhs = lhs.data();
-                            _and->d_rhs = rhs.data();
-
-                            ors << _and.data();
-                            done = true;
+                            b << ws() << "case ";
+                            emitCaseValue(v, wide);
+                            b << ":" << endl;
                         }
                     }
-                    if( !done )
-                    {
-                        Ref<BinExpr> eq = new BinExpr();
-                        eq->d_op = BinExpr::EQ;
-                        eq->d_lhs = me->d_exp;
-                        eq->d_rhs = l;
-                        eq->d_loc = l->d_loc;
-                        eq->d_type = boolean.data();
-
-                        ors << eq.data();
-                    }
+                    level++;
+                    for( int j = 0; j < me->d_cases[i].d_block.size(); j++ )
+                        emitStatement(me->d_cases[i].d_block[j].data());
+                    b << ws() << "break;" << endl;
+                    level--;
                 }
-                Q_ASSERT( !ors.isEmpty() );
-                if( ors.size() == 1 )
-                    ifl->d_if.append( ors.first() );
-                else
+                if( !me->d_else.isEmpty() )
                 {
-                    Q_ASSERT( ors.size() > 1 );
-                    Ref<BinExpr> bi = new BinExpr();
-                    bi->d_op = BinExpr::OR;
-                    bi->d_lhs = ors[0];
-                    bi->d_rhs = ors[1];
-                    bi->d_loc = ors[1]->d_loc;
-                    bi->d_type = boolean.data();
-                    for( int i = 2; i < ors.size(); i++ )
-                    {
-                        Ref<BinExpr> tmp = new BinExpr();
-                        tmp->d_op = BinExpr::OR;
-                        tmp->d_lhs = bi.data();
-                        tmp->d_type = boolean.data();
-                        bi = tmp;
-                        bi->d_rhs = ors[i];
-                        bi->d_loc = ors[i]->d_loc;
-                    }
-                    ifl->d_if.append( bi.data() );
+                    b << ws() << "default:" << endl;
+                    level++;
+                    for( int i = 0; i < me->d_else.size(); i++ )
+                        emitStatement(me->d_else[i].data());
+                    b << ws() << "break;" << endl;
+                    level--;
                 }
-
-                ifl->d_then.append( c.d_block );
+                breakNesting--;
+                b << ws() << "}" << endl;
+            }else
+            {
+                const quint32 nr = ++labelNr;
+                emitCaseSearch( t, 0, t.d_ranges.size(), sel, wide, nr );
+                sellTemp(temp,false);
+                for( int i = 0; i < me->d_cases.size(); i++ )
+                {
+                    b << ws() << "$case" << nr << "_" << i << ": {" << endl;
+                    level++;
+                    for( int j = 0; j < me->d_cases[i].d_block.size(); j++ )
+                        emitStatement(me->d_cases[i].d_block[j].data());
+                    b << ws() << "goto $case" << nr << "_end;" << endl;
+                    level--;
+                    b << ws() << "}" << endl;
+                }
+                b << ws() << "$case" << nr << "_else: ;" << endl;
+                for( int i = 0; i < me->d_else.size(); i++ )
+                    emitStatement(me->d_else[i].data());
+                b << ws() << "$case" << nr << "_end: ;" << endl;
             }
-
-            ifl->d_else = me->d_else;
-
-            // and now generate code for the if
-            ifl->accept(this);
+            return;
         }
+        // rewrite the AST with 'if' instead of complex 'case'
+        Ref<IfLoop> ifl = Optimizer::lowerCase(me);
+        if( ifl.isNull() )
+        {
+            for( int i = 0; i < me->d_else.size(); i++ )
+                emitStatement(me->d_else[i].data());
+        }else
+            ifl->accept(this); // and now generate code for the if
     }
 
     void emitIf( IfLoop* me )
@@ -3752,26 +3859,8 @@ struct ObxCGenImp : public AstVisitor
             break;
         case IfLoop::WHILE:
             {
-                // NOTE: identical with CilGen!
                 // substitute by primitive statements
-                Ref<IfLoop> loop = new IfLoop();
-                loop->d_op = IfLoop::LOOP;
-                loop->d_loc = me->d_loc;
-
-                Ref<IfLoop> conds = new IfLoop();
-                conds->d_op = IfLoop::IF;
-                conds->d_loc = me->d_loc;
-
-                conds->d_if = me->d_if;
-                conds->d_then = me->d_then;
-
-                Q_ASSERT( me->d_else.isEmpty() );
-                Ref<Exit> ex = new Exit();
-                ex->d_loc = me->d_loc;
-                conds->d_else << ex.data();
-
-                loop->d_then << ( StatSeq() << conds.data() );
-
+                Ref<IfLoop> loop = Optimizer::lowerWhile(me);
                 loop->accept(this); // now render
             }
             break;
@@ -3779,8 +3868,10 @@ struct ObxCGenImp : public AstVisitor
             {
                 b << ws() << "do {" << endl;
                 level++;
+                breakNesting++;
                 for( int i = 0; i < me->d_then.first().size(); i++ )
                     emitStatement(me->d_then.first()[i].data());
+                breakNesting--;
                 level--;
                 b <<  ws() << "}while(!(";
                 me->d_if[0]->accept(this);
@@ -3798,10 +3889,17 @@ struct ObxCGenImp : public AstVisitor
             {
                 b << ws() << "while(1) {" << endl;
                 level++;
+                const int outerBreakNesting = breakNesting;
+                breakNesting = 0;
+                loopExits.push_back(0);
                 for( int i = 0; i < me->d_then.first().size(); i++ )
                     emitStatement(me->d_then.first()[i].data());
+                breakNesting = outerBreakNesting;
                 level--;
                 b << ws() << "}" << endl;
+                if( loopExits.back() != 0 )
+                    b << ws() << "$exit" << loopExits.back() << ": ;" << endl;
+                loopExits.pop_back();
             }
             break;
         }
@@ -3809,52 +3907,18 @@ struct ObxCGenImp : public AstVisitor
 
     void visit( ForLoop* me)
     {
-        // NOTE: identical with CilGen!
-
-        // i := from;
-        // WHILE i <= to DO statements; i := i + by END
-        // WHILE i >= to DO statements; i := i + by END
-
-        // TODO: caclulate TO only once!
-
-        Ref<Assign> a = new Assign();
-        a->d_loc = me->d_loc;
-        a->d_lhs = me->d_id;
-        a->d_rhs = me->d_from;
-
-        Ref<IfLoop> loop = new IfLoop();
-        loop->d_loc = me->d_loc;
-        loop->d_op = IfLoop::WHILE;
-
-        Ref<BinExpr> cond = new BinExpr();
-        cond->d_loc = me->d_loc;
-        if( me->d_byVal.toInt() > 0 )
-            cond->d_op = BinExpr::LEQ;
-        else
-            cond->d_op = BinExpr::GEQ;
-        cond->d_lhs = me->d_id;
-        cond->d_rhs = me->d_to;
-        cond->d_type = me->d_id->d_type.data();
-        loop->d_if.append( cond.data() );
-
-        loop->d_then.append( me->d_do );
-
-        Ref<BinExpr> add = new BinExpr();
-        add->d_loc = me->d_loc;
-        add->d_op = BinExpr::ADD;
-        add->d_lhs = me->d_id;
-        add->d_rhs = me->d_by;
-        add->d_type = me->d_id->d_type;
-
-        Ref<Assign> a2 = new Assign();
-        a2->d_loc = me->d_loc;
-        a2->d_lhs = me->d_id;
-        a2->d_rhs = add.data();
-
-        loop->d_then.back().append( a2.data() );
-
-        a->accept(this);
-        loop->accept(this);
+        QList< Ref<LocalVar> > loopTemps;
+        const StatSeq loop = Optimizer::lowerFor(me, curProc, loopTemps);
+        QList<int> slots;
+        foreach( const Ref<LocalVar>& t, loopTemps )
+        {
+            slots << buyTemp(formatType(t->d_type.data()));
+            t->d_name = "$t" + QByteArray::number(slots.back());
+        }
+        foreach( const Ref<Statement>& s, loop )
+            s->accept(this);
+        foreach( int i, slots )
+            sellTemp(i, false);
     }
 
     void visit( LocalVar* ) { Q_ASSERT(false); }
@@ -3910,6 +3974,8 @@ bool Obx::CGen2::translateAll(Obx::Project* pro, bool debug, const QString& wher
     QTextStream fout(&clearStr);
 
     QList<Module*> mods = pro->getModulesToGenerate();
+    // the overrides are only all known in an executable with a main module, see Optimizer::dispatchTargets
+    const bool devirtualize = pro->getOptimize() && !pro->getMain().first.isEmpty();
     const quint32 errCount = pro->getErrs()->getErrCount();
     QSet<Module*> generated;
     foreach( Module* m, mods )
@@ -3946,7 +4012,7 @@ bool Obx::CGen2::translateAll(Obx::Project* pro, bool debug, const QString& wher
                             if( h.open(QIODevice::WriteOnly) )
                             {
                                 //qDebug() << "generating C for" << m->getName() << "to" << f.fileName();
-                                if( !CGen2::translate(&h, &b, inst,debug,pro->getErrs()) )
+                                if( !CGen2::translate(&h, &b, inst,debug,pro->getErrs(),pro->getOptimize(), devirtualize) )
                                 {
                                     qCritical() << "error generating C for" << inst->getName();
                                     return false;
@@ -4046,7 +4112,8 @@ bool Obx::CGen2::translateAll(Obx::Project* pro, bool debug, const QString& wher
     return ok;
 }
 
-bool Obx::CGen2::translate(QIODevice* header, QIODevice* body, Obx::Module* m, bool debug, Ob::Errors* errs)
+bool Obx::CGen2::translate(QIODevice* header, QIODevice* body, Obx::Module* m, bool debug, Ob::Errors* errs, bool optimize,
+                           bool devirtualize)
 {
     Q_ASSERT( m != 0 && header != 0 && body != 0 );
 
@@ -4056,10 +4123,13 @@ bool Obx::CGen2::translate(QIODevice* header, QIODevice* body, Obx::Module* m, b
     if( m->d_isDef && !m->d_externC )
         return true;
 
+    Trace::Scope trace("c gen", m);
     ObxCGenImp imp;
     imp.thisMod = m;
     //imp.emitter = e;
     imp.debug = debug;
+    imp.optimize = optimize;
+    imp.devirtualize = optimize && devirtualize;
     imp.h.setDevice(header);
     imp.b.setDevice(body);
 
@@ -4086,6 +4156,12 @@ bool Obx::CGen2::translate(QIODevice* header, QIODevice* body, Obx::Module* m, b
         ok = false;
     }
 
+    if( ok && imp.boundCalls && Trace::isEnabled() ) // only with OBXMC -trace
+        qDebug() << "devirtualized" << imp.directCalls + imp.guardedCalls << "of" << imp.boundCalls
+                 << "type-bound calls in" << m->getName() << "(" <<
+                    100 * ( imp.directCalls + imp.guardedCalls ) / imp.boundCalls << "%," << imp.guardedCalls
+                 << "guarded )";
+
     if( imp.ownsErr )
         delete imp.err;
 
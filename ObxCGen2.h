@@ -39,7 +39,8 @@ namespace Obx
     {
     public:
         static bool translateAll(Project*, bool debug, const QString& where );
-        static bool translate(QIODevice* header, QIODevice* body, Module*, bool debug, Ob::Errors* = 0 );
+        static bool translate(QIODevice* header, QIODevice* body, Module*, bool debug, Ob::Errors* = 0, bool optimize = false,
+                              bool devirtualize = false ); // devirtualize: all modules of an executable are loaded
         static bool generateMain(QIODevice*, const QByteArray& callMod,
                                  const QByteArray& callFunc,
                                  const QByteArrayList& allMods );
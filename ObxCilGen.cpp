@@ -24,6 +24,8 @@
 #include "ObxIlEmitter.h"
 #include "ObxPelibGen.h"
 #include "ObxValidator.h"
+#include "ObxOptimizer.h"
+#include "ObxTrace.h"
 #include <MonoTools/MonoMdbGen.h>
 #include <QtDebug>
 #include <QFile>
@@ -224,6 +226,8 @@ struct ObxCilGenImp : public AstVisitor
     bool forceAssemblyPrefix;
     bool forceFormalIndex;
     bool debug;
+    bool optimize;
+    bool devirtualize; // optimize, and all modules of the program are loaded
     bool arrayAsElementType;
     bool structAsPointer;
     bool checkPtrSize;
@@ -238,11 +242,12 @@ struct ObxCilGenImp : public AstVisitor
     QList<int> exitJump;
     Procedure* scope;
     int suppressLine;
+    quint32 boundCalls, directCalls;
 
     ObxCilGenImp():ownsErr(false),err(0),thisMod(0),anonymousDeclNr(1),level(0),
         scope(0),forceAssemblyPrefix(false),forceFormalIndex(false),
-        suppressLine(0),debug(false),checkPtrSize(false),
-        arrayAsElementType(false),structAsPointer(false)
+        suppressLine(0),debug(false),optimize(false),devirtualize(false),checkPtrSize(false),
+        arrayAsElementType(false),structAsPointer(false),boundCalls(0),directCalls(0)
     {
     }
 
@@ -1458,7 +1463,19 @@ struct ObxCilGenImp : public AstVisitor
             }
         }
 
-        beginBody(me->d_varCount);
+        Optimizer::Body body;
+        if( optimize )
+            body = Optimizer::optimize(me, devirtualize);
+        else
+            body.d_stats = me->d_body;
+        for( int i = 0; i < body.d_temps.size(); i++ )
+        {
+            body.d_temps[i]->d_slot = me->d_varCount + i;
+            body.d_temps[i]->d_slotValid = true;
+            emitter->addLocal( formatType(body.d_temps[i]->d_type.data()), escape(body.d_temps[i]->d_name) );
+        }
+
+        beginBody(me->d_varCount + body.d_temps.size());
 
         foreach( const Ref<Named>& n, me->d_order )
         {
@@ -1472,12 +1489,12 @@ struct ObxCilGenImp : public AstVisitor
                 break;
             }
         }
-        foreach( const Ref<Statement>& s, me->d_body )
+        foreach( const Ref<Statement>& s, body.d_stats )
         {
             temps.sellAll(); // no temp var kept from one statement to next
             s->accept(this);
         }
-        if( me->d_body.isEmpty() || me->d_body.last()->getTag() != Thing::T_Return )
+        if( body.d_stats.isEmpty() || body.d_stats.last()->getTag() != Thing::T_Return )
         {
             temps.sellAll();
             emitReturn( pt, 0, me->d_end );
@@ -2939,6 +2956,24 @@ struct ObxCilGenImp : public AstVisitor
         pinnedTemps.clear();
     }
 
+    bool isDirectCall( ArgExpr* me )
+    {
+        // a type-bound call can use call instead of callvirt if there is no override in the program the receiver
+        // could dispatch to, and the receiver cannot be NIL, since call doesn't check it
+        if( !devirtualize )
+            return false;
+        Q_ASSERT(me->d_sub->getTag() == Thing::T_IdentSel );
+        IdentSel* method = cast<IdentSel*>(me->d_sub.data());
+        Type* td = derefed(method->d_sub->d_type.data());
+        Q_ASSERT(td && td->getTag() == Thing::T_Record);
+        boundCalls++;
+        if( method->d_sub->getUnOp() == UnExpr::DEREF ||
+                Optimizer::dispatchTargets(cast<Procedure*>(method->getIdent()), cast<Record*>(td)).size() != 1 )
+            return false;
+        directCalls++;
+        return true;
+    }
+
     void emitCall( ArgExpr* me )
     {
         Q_ASSERT( me->d_sub );
@@ -3087,7 +3122,7 @@ struct ObxCilGenImp : public AstVisitor
 
         if( func )
         {
-            if( pt->d_typeBound && !superCall )
+            if( pt->d_typeBound && !superCall && !isDirectCall(me) )
                 line(me->d_loc).callvirt_(memberRef(func),pt->d_formals.size(),!pt->d_return.isNull()); // we dont support virtual funcs with varargs
             else
                 line(me->d_loc).call_(memberRef(func,varargs),pt->d_formals.size(),!pt->d_return.isNull(), pt->d_typeBound);
@@ -3718,68 +3753,20 @@ struct ObxCilGenImp : public AstVisitor
         }
     }
 
-    quint8 inclusiveType1(Type* lhs, Type* rhs) const
-    {
-        if( lhs == 0 || rhs == 0 )
-            return 0;
-        const quint8 l = lhs->getBaseType();
-        const quint8 r = rhs->getBaseType();
-        if( ( l == Type::CHAR && r == Type::STRING ) ||
-            ( l == Type::WCHAR && r == Type::WSTRING ) ||
-            ( l == Type::WCHAR && r == Type::STRING ) )
-            return r;
-        return Validator::inclusiveType( l, r ).first;
-    }
-
-
     void visit( ForLoop* me)
     {
         //const int before = stackDepth;
-        // i := from;
-        // WHILE i <= to DO statements; i := i + by END
-        // WHILE i >= to DO statements; i := i + by END
-
-        // TODO: caclulate TO only once!
-
-        Ref<Assign> a = new Assign();
-        a->d_loc = me->d_loc;
-        a->d_lhs = me->d_id;
-        a->d_rhs = me->d_from;
-
-        Ref<IfLoop> loop = new IfLoop();
-        loop->d_loc = me->d_loc;
-        loop->d_op = IfLoop::WHILE;
-
-        Ref<BinExpr> cond = new BinExpr();
-        cond->d_loc = me->d_loc;
-        if( me->d_byVal.toInt() > 0 )
-            cond->d_op = BinExpr::LEQ;
-        else
-            cond->d_op = BinExpr::GEQ;
-        cond->d_lhs = me->d_id;
-        cond->d_rhs = me->d_to;
-        cond->d_inclType = inclusiveType1(derefed(me->d_id->d_type.data()), derefed(me->d_to->d_type.data()) );
-        cond->d_type = new BaseType(Type::BOOLEAN); // me->d_id->d_type.data();
-        loop->d_if.append( cond.data() );
-
-        loop->d_then.append( me->d_do );
-
-        Ref<BinExpr> add = new BinExpr();
-        add->d_loc = me->d_loc;
-        add->d_op = BinExpr::ADD;
-        add->d_lhs = me->d_id;
-        add->d_rhs = me->d_by;
-        add->d_type = me->d_id->d_type;
-
-        Ref<Assign> a2 = new Assign();
-        a2->d_loc = me->d_loc;
-        a2->d_lhs = me->d_id;
-        a2->d_rhs = add.data();
-
-        loop->d_then.back().append( a2.data() );
-
-        a->accept(this);
-        loop->accept(this);
+        QList< Ref<LocalVar> > loopTemps;
+        const StatSeq loop = Optimizer::lowerFor(me, scope, loopTemps);
+        foreach( const Ref<LocalVar>& t, loopTemps )
+        {
+            t->d_slot = temps.buy(formatType(t->d_type.data()));
+            t->d_slotValid = true;
+        }
+        foreach( const Ref<Statement>& s, loop )
+            s->accept(this);
+        foreach( const Ref<LocalVar>& t, loopTemps )
+            temps.sell(t->d_slot);
         // TODO Q_ASSERT( before == stackDepth );
     }
 
@@ -3830,24 +3817,7 @@ struct ObxCilGenImp : public AstVisitor
         case IfLoop::WHILE:
             {
                 // substitute by primitive statements
-                Ref<IfLoop> loop = new IfLoop();
-                loop->d_op = IfLoop::LOOP;
-                loop->d_loc = me->d_loc;
-
-                Ref<IfLoop> conds = new IfLoop();
-                conds->d_op = IfLoop::IF;
-                conds->d_loc = me->d_loc;
-
-                conds->d_if = me->d_if;
-                conds->d_then = me->d_then;
-
-                Q_ASSERT( me->d_else.isEmpty() );
-                Ref<Exit> ex = new Exit();
-                ex->d_loc = me->d_loc;
-                conds->d_else << ex.data();
-
-                loop->d_then << ( StatSeq() << conds.data() );
-
+                Ref<IfLoop> loop = Optimizer::lowerWhile(me);
                 loop->accept(this); // now render
             }
             break;
@@ -4070,146 +4040,112 @@ struct ObxCilGenImp : public AstVisitor
         }
     }
 
-    void visit( CaseStmt* me)
+    void emitCaseSearch( const Optimizer::CaseTable& t, int from, int to, int sel, bool wide,
+                         const QList<int>& cases, int elseLabel, const RowCol& loc )
     {
-        // TODO: if else missing then abort if no case hit
-        if( me->d_typeCase )
+        // binary search in t.d_ranges[from,to) for the value of local sel
+        if( to - from <= 3 )
         {
-            // first rewrite the AST with 'if' instead of complex 'case'
-
-            if( me->d_cases.isEmpty() )
-                return;
-
-            Ref<IfLoop> ifl = new IfLoop();
-            ifl->d_op = IfLoop::IF;
-            ifl->d_loc = me->d_loc;
-
-            for( int i = 0; i < me->d_cases.size(); i++ )
+            for( int i = from; i < to; i++ )
             {
-                const CaseStmt::Case& c = me->d_cases[i];
-
-                Q_ASSERT( c.d_labels.size() == 1 );
-                Type* td = derefed(c.d_labels.first()->d_type.data());
-
-                Ref<BinExpr> eq = new BinExpr();
-                if( td && td->getBaseType() == Type::NIL )
-                    eq->d_op = BinExpr::EQ;
+                const Optimizer::CaseTable::Range& r = t.d_ranges[i];
+                line(loc).ldloc_(sel);
+                emitCaseValue( r.d_lo, wide, loc );
+                if( r.d_lo == r.d_hi )
+                    line(loc).beq_(cases[r.d_case]);
                 else
-                    eq->d_op = BinExpr::IS;
-                eq->d_lhs = me->d_exp;
-                eq->d_rhs = c.d_labels.first();
-                eq->d_loc = me->d_exp->d_loc;
-                eq->d_type = new BaseType(Type::BOOLEAN);
-
-                ifl->d_if.append(eq.data());
-                ifl->d_then.append( c.d_block );
+                {
+                    const int next = emitter->newLabel();
+                    line(loc).blt_(next);
+                    line(loc).ldloc_(sel);
+                    emitCaseValue( r.d_hi, wide, loc );
+                    line(loc).ble_(cases[r.d_case]);
+                    line(loc).label_(next);
+                }
             }
-
-            ifl->d_else = me->d_else;
-
-            // and now generate code for the if
-            ifl->accept(this);
+            line(loc).br_(elseLabel);
+            return;
         }
-        else
-        {
-            // first rewrite the AST with 'if' instead of complex 'case'
+        const int mid = ( from + to ) / 2;
+        const int lower = emitter->newLabel();
+        line(loc).ldloc_(sel);
+        emitCaseValue( t.d_ranges[mid].d_lo, wide, loc );
+        line(loc).blt_(lower);
+        emitCaseSearch( t, mid, to, sel, wide, cases, elseLabel, loc );
+        line(loc).label_(lower);
+        emitCaseSearch( t, from, mid, sel, wide, cases, elseLabel, loc );
+    }
 
-            Ref<IfLoop> ifl = new IfLoop();
-            ifl->d_op = IfLoop::IF;
-            ifl->d_loc = me->d_loc;
+    void emitCaseValue( qint64 val, bool wide, const RowCol& loc )
+    {
+        if( wide )
+            line(loc).ldc_i8(val);
+        else
+            line(loc).ldc_i4(val);
+    }
 
-            Ref<BaseType> boolean = new BaseType(Type::BOOLEAN);
+    void visit( CaseStmt* me)
+    {
+        // TODO: if else missing then abort if no case hit
+        Optimizer::CaseTable t;
+        if( !me->d_cases.isEmpty() && Optimizer::caseTable(me, thisMod, t) )
+        {
+            // the selector is evaluated once; dense labels use a jump table, sparse ones a binary search
+            const bool wide = derefed(me->d_exp->d_type.data())->getBaseType() == Type::INT64;
+            const int sel = temps.buy( wide ? "int64" : "int32" );
+            me->d_exp->accept(this);
+            line(me->d_loc).stloc_(sel);
 
+            QList<int> cases;
             for( int i = 0; i < me->d_cases.size(); i++ )
-            {
-                const CaseStmt::Case& c = me->d_cases[i];
+                cases << emitter->newLabel();
+            const int elseLabel = emitter->newLabel();
+            const int afterEnd = emitter->newLabel();
 
-                QList< Ref<Expression> > ors;
-                for( int j = 0; j < c.d_labels.size(); j++ )
+            if( t.d_dense && !wide )
+            {
+                const qint64 lo = t.d_ranges.first().d_lo;
+                QList<quint32> table;
+                foreach( const Optimizer::CaseTable::Range& r, t.d_ranges )
                 {
-                    Expression* l = c.d_labels[j].data();
-                    // TODO: avoid redundant evaluations using temp vars
-                    bool done = false;
-                    if( l->getTag() == Thing::T_BinExpr )
-                    {
-                        BinExpr* bi = cast<BinExpr*>( l );
-                        if( bi->d_op == BinExpr::Range )
-                        {
-                            // TODO: consider lhs > rhs
-                            Ref<BinExpr> _and = new BinExpr();
-                            _and->d_op = BinExpr::AND;
-                            _and->d_loc = l->d_loc;
-                            _and->d_type = boolean.data();
-
-                            Ref<BinExpr> lhs = new BinExpr();
-                            lhs->d_op = BinExpr::GEQ;
-                            lhs->d_lhs = me->d_exp;
-                            lhs->d_rhs = bi->d_lhs;
-                            lhs->d_loc = l->d_loc;
-                            lhs->d_inclType = inclusiveType1(derefed(me->d_exp->d_type.data()), derefed(bi->d_lhs->d_type.data()) );
-                            lhs->d_type = boolean.data();
-
-                            Ref<BinExpr> rhs = new BinExpr();
-                            rhs->d_op = BinExpr::LEQ;
-                            rhs->d_lhs = me->d_exp;
-                            rhs->d_rhs = bi->d_rhs;
-                            rhs->d_loc = l->d_loc;
-                            rhs->d_inclType = inclusiveType1(derefed(me->d_exp->d_type.data()), derefed(bi->d_rhs->d_type.data()) );
-                            rhs->d_type = boolean.data();
-
-                            _and->d_lhs = lhs.data();
-                            _and->d_rhs = rhs.data();
-
-                            ors << _and.data();
-                            done = true;
-                        }
-                    }
-                    if( !done )
-                    {
-                        Ref<BinExpr> eq = new BinExpr();
-                        eq->d_op = BinExpr::EQ;
-                        eq->d_lhs = me->d_exp;
-                        eq->d_rhs = l;
-                        eq->d_inclType = inclusiveType1(derefed(me->d_exp->d_type.data()), derefed(l->d_type.data()) );
-                        eq->d_loc = l->d_loc;
-                        eq->d_type = boolean.data();
-
-                        ors << eq.data();
-                    }
+                    while( lo + table.size() < r.d_lo )
+                        table << elseLabel;
+                    while( lo + table.size() <= r.d_hi )
+                        table << cases[r.d_case];
                 }
-                Q_ASSERT( !ors.isEmpty() );
-                if( ors.size() == 1 )
-                    ifl->d_if.append( ors.first() );
-                else
+                line(me->d_loc).ldloc_(sel);
+                if( lo != 0 )
                 {
-                    Q_ASSERT( ors.size() > 1 );
-                    Ref<BinExpr> bi = new BinExpr();
-                    bi->d_op = BinExpr::OR;
-                    bi->d_lhs = ors[0];
-                    bi->d_rhs = ors[1];
-                    bi->d_loc = ors[1]->d_loc;
-                    bi->d_type = boolean.data();
-                    for( int i = 2; i < ors.size(); i++ )
-                    {
-                        Ref<BinExpr> tmp = new BinExpr();
-                        tmp->d_op = BinExpr::OR;
-                        tmp->d_lhs = bi.data();
-                        tmp->d_type = boolean.data();
-                        bi = tmp;
-                        bi->d_rhs = ors[i];
-                        bi->d_loc = ors[i]->d_loc;
-                    }
-                    ifl->d_if.append( bi.data() );
+                    line(me->d_loc).ldc_i4(lo);
+                    line(me->d_loc).sub_();
                 }
+                line(me->d_loc).switch_(table);
+                line(me->d_loc).br_(elseLabel);
+            }else
+                emitCaseSearch( t, 0, t.d_ranges.size(), sel, wide, cases, elseLabel, me->d_loc );
+            temps.sell(sel);
 
-                ifl->d_then.append( c.d_block );
+            for( int i = 0; i < me->d_cases.size(); i++ )
+            {
+                line(me->d_loc).label_(cases[i]);
+                for( int j = 0; j < me->d_cases[i].d_block.size(); j++ )
+                    me->d_cases[i].d_block[j]->accept(this);
+                line(me->d_loc).br_(afterEnd);
             }
-
-            ifl->d_else = me->d_else;
-
-            // and now generate code for the if
-            ifl->accept(this);
+            line(me->d_loc).label_(elseLabel);
+            for( int i = 0; i < me->d_else.size(); i++ )
+                me->d_else[i]->accept(this);
+            line(me->d_loc).label_(afterEnd);
+            return;
         }
+        // rewrite the AST with 'if' instead of complex 'case'
+        Ref<IfLoop> ifl = Optimizer::lowerCase(me);
+        if( ifl.isNull() )
+        {
+            for( int i = 0; i < me->d_else.size(); i++ )
+                me->d_else[i]->accept(this);
+        }else
+            ifl->accept(this); // and now generate code for the if
     }
 
     void visit( Exit* me)
@@ -4746,7 +4682,7 @@ struct ObxCilGenImp : public AstVisitor
     void visit( Import* ) { Q_ASSERT( false ); }
 };
 
-bool CilGen::translate(Module* m, IlEmitter* e, bool debug, Ob::Errors* errs)
+bool CilGen::translate(Module* m, IlEmitter* e, bool debug, Ob::Errors* errs, bool optimize, bool devirtualize)
 {
     Q_ASSERT( m != 0 && e != 0 );
 
@@ -4756,10 +4692,13 @@ bool CilGen::translate(Module* m, IlEmitter* e, bool debug, Ob::Errors* errs)
     if( m->d_isDef && !m->d_externC )
         return true;
 
+    Trace::Scope trace("cil gen", m);
     ObxCilGenImp imp;
     imp.thisMod = m;
     imp.emitter = e;
     imp.debug = debug;
+    imp.optimize = optimize;
+    imp.devirtualize = optimize && devirtualize;
 
     if( errs == 0 )
     {
@@ -4784,6 +4723,10 @@ bool CilGen::translate(Module* m, IlEmitter* e, bool debug, Ob::Errors* errs)
         ok = false;
     }
 
+    if( ok && imp.boundCalls && Trace::isEnabled() ) // only with OBXMC -trace
+        qDebug() << "devirtualized" << imp.directCalls << "of" << imp.boundCalls << "type-bound calls in"
+                 << m->getName() << "(" << 100 * imp.directCalls / imp.boundCalls << "% )";
+
     if( imp.ownsErr )
         delete imp.err;
     return ok;
@@ -4910,6 +4853,10 @@ bool CilGen::translateAll(Project* pro, How how, bool debug, const QString& wher
 #else
     QList<Module*> mods = pro->getModulesToGenerate(true);
 #endif
+    // the overrides are only all known in an executable with a main module, see Optimizer::dispatchTargets
+    const bool devirtualize = pro->getOptimize() && !pro->getMain().first.isEmpty();
+    if( devirtualize )
+        forceGen = true; // the code depends on the overrides in other modules
     const quint32 errCount = pro->getErrs()->getErrCount();
     QSet<Module*> generated;
     int numGenerated = 0;
@@ -4953,7 +4900,7 @@ bool CilGen::translateAll(Project* pro, How how, bool debug, const QString& wher
                                     //qDebug() << "generating IL for" << m->getName() << "to" << f.fileName();
                                     IlAsmRenderer r(&f);
                                     IlEmitter e(&r);
-                                    if( !CilGen::translate(inst,&e, debug, pro->getErrs()) )
+                                    if( !CilGen::translate(inst,&e, debug, pro->getErrs(), pro->getOptimize(), devirtualize) )
                                     {
                                         qCritical() << "error generating IL for" << inst->getName();
                                         return false;
@@ -4980,7 +4927,7 @@ bool CilGen::translateAll(Project* pro, How how, bool debug, const QString& wher
                                 numGenerated++;
                                 PelibGen r;
                                 IlEmitter e(&r);
-                                if( !CilGen::translate(inst,&e,debug,pro->getErrs()) )
+                                if( !CilGen::translate(inst,&e,debug,pro->getErrs(),pro->getOptimize(), devirtualize) )
                                 {
                                     qCritical() << "error generating assembly for" << inst->getName();
                                     return false;
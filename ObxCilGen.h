@@ -41,7 +41,8 @@ namespace Obx
         enum How { Ilasm, Fastasm, IlOnly, Pelib };
         // all true on success, false on error
         static bool translateAll(Project*, How how, bool debug, const QString& where, bool forceGen = false );
-        static bool translate(Module*, IlEmitter* out, bool debug, Ob::Errors* = 0 );
+        static bool translate(Module*, IlEmitter* out, bool debug, Ob::Errors* = 0, bool optimize = false,
+                              bool devirtualize = false ); // devirtualize: all modules of an executable are loaded
         static bool generateMain(IlEmitter* out, const QByteArray& thisMod,
                                  const QByteArray& callMod = QByteArray(), const QByteArray& callFunc = QByteArray());
         static bool generateMain(IlEmitter* out, const QByteArray& thisMod, const QByteArrayList& callMods );
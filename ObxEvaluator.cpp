@@ -26,14 +26,65 @@ using namespace Ob;
 Q_DECLARE_METATYPE( Obx::Literal::SET )
 #endif
 
+Evaluator::Value Evaluator::Value::fromVariant(const QVariant& v, quint8 vtype)
+{
+    Value res;
+    res.d_vtype = vtype;
+    switch( vtype )
+    {
+    case Literal::Integer:
+    case Literal::Enum:
+    case Literal::Char:
+        res.d_int = v.toLongLong();
+        break;
+    case Literal::Boolean:
+        res.d_int = v.toBool();
+        break;
+    case Literal::Real:
+        res.d_real = v.toDouble();
+        break;
+    case Literal::Set:
+        res.d_set = v.value<Literal::SET>().to_ulong();
+        break;
+    case Literal::String:
+    case Literal::Bytes:
+        res.d_str = v.toByteArray();
+        break;
+    }
+    return res;
+}
+
+QVariant Evaluator::Value::toVariant() const
+{
+    switch( d_vtype )
+    {
+    case Literal::Integer:
+    case Literal::Enum:
+    case Literal::Char:
+        return d_int;
+    case Literal::Boolean:
+        return d_int != 0;
+    case Literal::Real:
+        return d_real;
+    case Literal::Set:
+        return QVariant::fromValue( Literal::SET(d_set) );
+    case Literal::String:
+    case Literal::Bytes:
+        return d_str;
+    }
+    return QVariant();
+}
+
 struct EvalVisitor : public AstVisitor
 {
     Scope* mod;
     Ob::Errors* errs;
     bool supportVla;
-    Evaluator::Result val;
+    bool local; // the value depends on the meta actuals of an instance
+    bool transient; // the value depends on the progress of the validation, e.g. on array lengths
+    Evaluator::Value val;
 
-    EvalVisitor(Scope* m, bool b, Ob::Errors* e):mod(m),errs(e),supportVla(b){}
+    EvalVisitor(Scope* m, bool b, Ob::Errors* e):mod(m),errs(e),supportVla(b),local(false),transient(false){}
 
     bool error( Expression* e, const QString& msg )
     {
@@ -43,329 +94,300 @@ struct EvalVisitor : public AstVisitor
         return false;
     }
 
-    void push( const QVariant& value, quint8 vtype, bool wide = false, bool minInt = false, int strlen = 0 )
+    void push( quint8 vtype, bool wide = false, bool minInt = false, int strlen = 0 )
     {
-        val.d_value = value;
         val.d_vtype = vtype;
         val.d_wide = wide;
         val.d_minInt = minInt;
         val.d_strLen = strlen;
     }
 
-    void NEG(const Evaluator::Result& r, Expression* e )
+    void pushInt( qint64 v, bool wide = false, bool minInt = false )
+    {
+        val.d_int = v;
+        push( Literal::Integer, wide, minInt );
+    }
+
+    void pushReal( double v, bool wide )
+    {
+        val.d_real = v;
+        push( Literal::Real, wide );
+    }
+
+    void pushBool( bool v )
+    {
+        val.d_int = v;
+        push( Literal::Boolean );
+    }
+
+    void pushSet( quint32 v )
+    {
+        val.d_set = v;
+        push( Literal::Set );
+    }
+
+    void pushStr( const QByteArray& str, bool wide, int strlen )
+    {
+        val.d_str = str;
+        push( Literal::String, wide, false, strlen );
+    }
+
+    static bool isInt( const Evaluator::Value& lhs, const Evaluator::Value& rhs )
+    {
+        return lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer;
+    }
+
+    static bool isOrdinal( const Evaluator::Value& lhs, const Evaluator::Value& rhs )
+    {
+        return lhs.d_vtype == rhs.d_vtype && ( lhs.d_vtype == Literal::Integer || lhs.d_vtype == Literal::Char
+                                               || lhs.d_vtype == Literal::Enum );
+    }
+
+    static bool isType( const Evaluator::Value& lhs, const Evaluator::Value& rhs, quint8 vtype )
+    {
+        return lhs.d_vtype == vtype && rhs.d_vtype == vtype;
+    }
+
+    void NEG(const Evaluator::Value& r, Expression* e )
     {
         if( r.d_vtype == Literal::Real )
-            push( -r.d_value.toDouble(), r.d_vtype, r.d_wide );
+            pushReal( -r.d_real, r.d_wide );
         else if( r.d_vtype == Literal::Integer )
-            push( -r.d_value.toLongLong(), r.d_vtype, r.d_wide, r.d_minInt );
+            pushInt( -r.d_int, r.d_wide, r.d_minInt );
         else
             error( e, Evaluator::tr("cannot invert sign of non numerical expression"));
     }
 
-    void NOT(const Evaluator::Result& r, Expression* e )
+    void NOT(const Evaluator::Value& r, Expression* e )
     {
         if( r.d_vtype == Literal::Boolean )
-            push( !r.d_value.toBool(), r.d_vtype );
+            pushBool( !r.d_int );
         else
             error( e, Evaluator::tr("cannot negate non boolean expression"));
     }
 
-    static QByteArray toString(const Evaluator::Result& v )
+    static QByteArray toString(const Evaluator::Value& v )
     {
         if( v.d_wide )
-            return QString(1,QChar((ushort)v.d_value.toUInt())).toUtf8();
+            return QString(1,QChar((ushort)v.d_int)).toUtf8();
         else
-            return QByteArray(1,(quint8)v.d_value.toUInt());
+            return QByteArray(1,(quint8)v.d_int);
     }
 
-    void ADD(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void ADD(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() + rhs.d_value.toLongLong(),lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt );
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() + rhs.d_value.toDouble(),lhs.d_vtype, lhs.d_wide || rhs.d_wide );
-        else if( lhs.d_vtype == Literal::Set && rhs.d_vtype == Literal::Set )
-            push(QVariant::fromValue( lhs.d_value.value<Literal::SET>() | rhs.d_value.value<Literal::SET>() ),
-                 lhs.d_vtype);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push( lhs.d_value.toByteArray() + rhs.d_value.toByteArray(), Literal::String, lhs.d_wide || rhs.d_wide,
-                  false, lhs.d_strLen + rhs.d_strLen );
+        if( isInt(lhs,rhs) )
+            pushInt( lhs.d_int + rhs.d_int, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt );
+        else if( isType(lhs,rhs,Literal::Real) )
+            pushReal( lhs.d_real + rhs.d_real, lhs.d_wide || rhs.d_wide );
+        else if( isType(lhs,rhs,Literal::Set) )
+            pushSet( lhs.d_set | rhs.d_set );
+        else if( isType(lhs,rhs,Literal::String) )
+            pushStr( lhs.d_str + rhs.d_str, lhs.d_wide || rhs.d_wide, lhs.d_strLen + rhs.d_strLen );
         else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::Char )
-            push( lhs.d_value.toByteArray() + toString(rhs), Literal::String, lhs.d_wide || rhs.d_wide,
-                  false, lhs.d_strLen + 1 );
+            pushStr( lhs.d_str + toString(rhs), lhs.d_wide || rhs.d_wide, lhs.d_strLen + 1 );
         else if( lhs.d_vtype == Literal::Char && rhs.d_vtype == Literal::String )
-            push( toString(lhs) + rhs.d_value.toByteArray(), Literal::String, lhs.d_wide || rhs.d_wide,
-                  false, lhs.d_strLen + 1 );
-        else if( lhs.d_vtype == Literal::Char && rhs.d_vtype == Literal::Char )
-            push( toString(lhs) + toString(rhs), Literal::String, lhs.d_wide || rhs.d_wide,
-                  false, 1 + 1 );
+            pushStr( toString(lhs) + rhs.d_str, lhs.d_wide || rhs.d_wide, rhs.d_strLen + 1 );
+        else if( isType(lhs,rhs,Literal::Char) )
+            pushStr( toString(lhs) + toString(rhs), lhs.d_wide || rhs.d_wide, 1 + 1 );
         else
             error( e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void SUB(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void SUB(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() - rhs.d_value.toLongLong(),lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() - rhs.d_value.toDouble(),lhs.d_vtype, lhs.d_wide || rhs.d_wide );
-        else if( lhs.d_vtype == Literal::Set && rhs.d_vtype == Literal::Set )
-        {
-            const Literal::SET a = lhs.d_value.value<Literal::SET>();
-            const Literal::SET b = rhs.d_value.value<Literal::SET>();
-            Literal::SET res;
-            for( int j = 0; j < a.size(); j++ )
-                res.set( a.test(j) && !b.test(j) );
-            push(QVariant::fromValue( res ),lhs.d_vtype);
-        }else
+        if( isInt(lhs,rhs) )
+            pushInt( lhs.d_int - rhs.d_int, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt );
+        else if( isType(lhs,rhs,Literal::Real) )
+            pushReal( lhs.d_real - rhs.d_real, lhs.d_wide || rhs.d_wide );
+        else if( isType(lhs,rhs,Literal::Set) )
+            pushSet( lhs.d_set & ~rhs.d_set );
+        else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void FDIV(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void FDIV(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() / double(rhs.d_value.toLongLong()),Literal::Real, lhs.d_wide || rhs.d_wide);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() / rhs.d_value.toDouble(),lhs.d_vtype, lhs.d_wide || rhs.d_wide );
-        else if( lhs.d_vtype == Literal::Set && rhs.d_vtype == Literal::Set )
-        {
-            const Literal::SET a = lhs.d_value.value<Literal::SET>();
-            const Literal::SET b = rhs.d_value.value<Literal::SET>();
-            Literal::SET res;
-            for( int j = 0; j < a.size(); j++ )
-                res.set( ( a.test(j) || b.test(j) ) && !( a.test(j) && b.test(j) ) );
-            push(QVariant::fromValue( res ),lhs.d_vtype);
-        }else
+        if( isInt(lhs,rhs) )
+            pushReal( lhs.d_int / double(rhs.d_int), lhs.d_wide || rhs.d_wide );
+        else if( isType(lhs,rhs,Literal::Real) )
+            pushReal( lhs.d_real / rhs.d_real, lhs.d_wide || rhs.d_wide );
+        else if( isType(lhs,rhs,Literal::Set) )
+            pushSet( lhs.d_set ^ rhs.d_set );
+        else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void MUL(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void MUL(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() * rhs.d_value.toLongLong(),lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() * rhs.d_value.toDouble(),lhs.d_vtype, lhs.d_wide || rhs.d_wide );
-        else if( lhs.d_vtype == Literal::Set && rhs.d_vtype == Literal::Set )
-        {
-            const Literal::SET a = lhs.d_value.value<Literal::SET>();
-            const Literal::SET b = rhs.d_value.value<Literal::SET>();
-            push(QVariant::fromValue( a & b ),lhs.d_vtype);
-        }else
+        if( isInt(lhs,rhs) )
+            pushInt( lhs.d_int * rhs.d_int, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt );
+        else if( isType(lhs,rhs,Literal::Real) )
+            pushReal( lhs.d_real * rhs.d_real, lhs.d_wide || rhs.d_wide );
+        else if( isType(lhs,rhs,Literal::Set) )
+            pushSet( lhs.d_set & rhs.d_set );
+        else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void DIV(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void DIV(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
+        if( isInt(lhs,rhs) )
         {
-            const qint64 a = lhs.d_value.toLongLong();
-            const qint64 b = rhs.d_value.toLongLong();
+            const qint64 a = lhs.d_int;
+            const qint64 b = rhs.d_int;
+            if( b == 0 )
+                error(e,Evaluator::tr("division by zero") );
             // res = ( a - ( ( a % b + b ) % b ) ) / b;
             // source: http://lists.inf.ethz.ch/pipermail/oberon/2019/013353.html
             if (a < 0)
-                push(qint64( (a - b + 1) / b ),lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
+                pushInt( (a - b + 1) / b, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
             else
-                push(qint64( a / b ),lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
+                pushInt( a / b, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
         }else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void MOD(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void MOD(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
+        if( isInt(lhs,rhs) )
         {
-            const qint64 a = lhs.d_value.toLongLong();
-            const qint64 b = rhs.d_value.toLongLong();
+            const qint64 a = lhs.d_int;
+            const qint64 b = rhs.d_int;
+            if( b == 0 )
+                error(e,Evaluator::tr("division by zero") );
             // res = ( a % b + b ) % b;
             // source: http://lists.inf.ethz.ch/pipermail/oberon/2019/013353.html
             if (a < 0)
-                push(qint64( (b - 1) + ((a - b + 1)) % b ),lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
+                pushInt( (b - 1) + ((a - b + 1)) % b, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
             else
-                push(qint64( a % b ), lhs.d_vtype, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
+                pushInt( a % b, lhs.d_wide || rhs.d_wide, lhs.d_minInt || rhs.d_minInt);
         }else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void AND(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
-    {
-        if( lhs.d_vtype == Literal::Boolean && rhs.d_vtype == Literal::Boolean )
-            push(lhs.d_value.toBool() && rhs.d_value.toBool(), lhs.d_vtype);
-        else
-            error(e,Evaluator::tr("operand types incompatible with operator") );
-    }
-
-    void OR(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
-    {
-        if( lhs.d_vtype == Literal::Boolean && rhs.d_vtype == Literal::Boolean )
-            push(lhs.d_value.toBool() || rhs.d_value.toBool(), lhs.d_vtype);
-        else
-            error(e,Evaluator::tr("operand types incompatible with operator") );
-    }
-
-    void EQ(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
-    {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() == rhs.d_value.toLongLong(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() == rhs.d_value.toDouble(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Boolean && rhs.d_vtype == Literal::Boolean )
-            push(lhs.d_value.toBool() == rhs.d_value.toBool(), Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Set && rhs.d_vtype == Literal::Set )
-            push(QVariant::fromValue( lhs.d_value.value<Literal::SET>() == rhs.d_value.value<Literal::SET>() ),
-                 Literal::Boolean);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push(lhs.d_value.toByteArray() == rhs.d_value.toByteArray(), Literal::Boolean);
-        else
-            error(e,Evaluator::tr("operand types incompatible with operator") );
-    }
-
-    void NEQ(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
-    {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() != rhs.d_value.toLongLong(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() != rhs.d_value.toDouble(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Boolean && rhs.d_vtype == Literal::Boolean )
-            push(lhs.d_value.toBool() != rhs.d_value.toBool(), Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Set && rhs.d_vtype == Literal::Set )
-            push(QVariant::fromValue( lhs.d_value.value<Literal::SET>() != rhs.d_value.value<Literal::SET>() ),
-                 Literal::Boolean);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push(lhs.d_value.toByteArray() != rhs.d_value.toByteArray(), Literal::Boolean);
-        else
-            error(e,Evaluator::tr("operand types incompatible with operator") );
-    }
-
-    void LE(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void AND(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() < rhs.d_value.toLongLong(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() < rhs.d_value.toDouble(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push(QString::fromUtf8(lhs.d_value.toByteArray()) < QString::fromUtf8(rhs.d_value.toByteArray()),
-                 Literal::Boolean);
+        if( isType(lhs,rhs,Literal::Boolean) )
+            pushBool( lhs.d_int && rhs.d_int );
         else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void LEQ(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void OR(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() <= rhs.d_value.toLongLong(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() <= rhs.d_value.toDouble(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push(QString::fromUtf8(lhs.d_value.toByteArray()) <= QString::fromUtf8(rhs.d_value.toByteArray()),
-                 Literal::Boolean);
+        if( isType(lhs,rhs,Literal::Boolean) )
+            pushBool( lhs.d_int || rhs.d_int );
         else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void GT(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    bool equal(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() > rhs.d_value.toLongLong(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() > rhs.d_value.toDouble(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push(QString::fromUtf8(lhs.d_value.toByteArray()) > QString::fromUtf8(rhs.d_value.toByteArray()),
-                 Literal::Boolean);
+        if( isOrdinal(lhs,rhs) || isType(lhs,rhs,Literal::Boolean) )
+            return lhs.d_int == rhs.d_int;
+        else if( isType(lhs,rhs,Literal::Real) )
+            return lhs.d_real == rhs.d_real;
+        else if( isType(lhs,rhs,Literal::Set) )
+            return lhs.d_set == rhs.d_set;
+        else if( isType(lhs,rhs,Literal::String) )
+            return lhs.d_str == rhs.d_str;
         else
-            error(e,Evaluator::tr("operand types incompatible with operator") );
+            return error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void GEQ(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    int compare(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
-        if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Integer )
-            push(lhs.d_value.toLongLong() >= rhs.d_value.toLongLong(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::Real && rhs.d_vtype == Literal::Real )
-            push(lhs.d_value.toDouble() >= rhs.d_value.toDouble(),Literal::Boolean);
-        else if( lhs.d_vtype == Literal::String && rhs.d_vtype == Literal::String )
-            push(QString::fromUtf8(lhs.d_value.toByteArray()) >= QString::fromUtf8(rhs.d_value.toByteArray()),
-                 Literal::Boolean);
+        if( isOrdinal(lhs,rhs) )
+            return lhs.d_int < rhs.d_int ? -1 : lhs.d_int > rhs.d_int ? 1 : 0;
+        else if( isType(lhs,rhs,Literal::Real) )
+            return lhs.d_real < rhs.d_real ? -1 : lhs.d_real > rhs.d_real ? 1 : 0;
+        else if( isType(lhs,rhs,Literal::String) )
+            return QString::fromUtf8(lhs.d_str).compare(QString::fromUtf8(rhs.d_str));
         else
-            error(e,Evaluator::tr("operand types incompatible with operator") );
+            return error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
-    void IN(const Evaluator::Result& lhs, const Evaluator::Result& rhs, Expression* e )
+    void IN(const Evaluator::Value& lhs, const Evaluator::Value& rhs, Expression* e )
     {
         if( lhs.d_vtype == Literal::Integer && rhs.d_vtype == Literal::Set )
         {
-            const qint64 b = lhs.d_value.toLongLong();
+            const qint64 b = lhs.d_int;
             if( b < 0 || b >= Literal::SET_BIT_LEN )
                 error(e,Evaluator::tr("lhs is out of range MIN(SET)..MAX(SET)") );
-            push( rhs.d_value.value<Literal::SET>().test(b), Literal::Boolean );
+            pushBool( ( rhs.d_set >> b ) & 1 );
         }else
             error(e,Evaluator::tr("operand types incompatible with operator") );
     }
 
     void visit( Literal* me)
     {
-        val.d_value = me->d_val;
-        val.d_vtype = (Literal::ValueType)me->d_vtype;
+        val = Evaluator::Value::fromVariant(me->d_val, me->d_vtype);
         val.d_wide = me->d_wide;
         val.d_minInt = me->d_minInt;
         val.d_strLen = me->d_strLen;
     }
 
+    qint64 setElement( Expression* e, Expression* part, const QString& msg )
+    {
+        part->accept(this);
+        if( val.d_vtype != Literal::Integer )
+            error(e,Evaluator::tr("operand type incompatible with set literal") );
+        const qint64 l = val.d_int;
+        if( l < 0 || l >= Literal::SET_BIT_LEN  )
+            error(e,msg);
+        return l;
+    }
+
     void visit( SetExpr* me)
     {
-        Literal::SET s;
+        quint32 s = 0;
         for(int i = 0; i < me->d_parts.size(); i++ )
         {
             if( me->d_parts[i]->getTag() == Thing::T_BinExpr )
             {
                 BinExpr* be = cast<BinExpr*>(me->d_parts[i].data());
-                if( be->d_op != BinExpr::Range )
+                if( be->d_op != BinExpr::Range || be->d_lhs.isNull() || be->d_rhs.isNull() )
                     error(me,Evaluator::tr("invalid set part") );
 
-                Evaluator::Result lhs, rhs;
-                if( be->d_lhs )
-                {
-                    be->d_lhs->accept(this);
-                    lhs = val;
-                }
-                if( be->d_rhs )
-                {
-                    be->d_rhs->accept(this);
-                    rhs = val;
-                }
-                if( lhs.d_vtype != Literal::Integer || rhs.d_vtype != Literal::Integer )
-                    error(me,Evaluator::tr("operand types incompatible with range operator") );
-
-                const qint64 l = lhs.d_value.toLongLong();
-                const qint64 r = lhs.d_value.toLongLong();
-                if( l < 0 || l >= Literal::SET_BIT_LEN || r < 0 || r >= Literal::SET_BIT_LEN )
-                    error(me,Evaluator::tr("lhs or rhs is out of range MIN(SET)..MAX(SET)") );
-                if( l <= r )
-                    for( int b = l; b <= r; b++ )
-                        s.set(b);
-                else
-                    for( int b = r; b <= l; b++ )
-                        s.set(b);
+                const QString msg = Evaluator::tr("lhs or rhs is out of range MIN(SET)..MAX(SET)");
+                const qint64 l = setElement( me, be->d_lhs.data(), msg );
+                const qint64 r = setElement( me, be->d_rhs.data(), msg );
+                for( qint64 b = qMin(l,r); b <= qMax(l,r); b++ )
+                    s |= 1u << b;
             }else
-            {
-                me->d_parts[i]->accept(this);
-                if( val.d_vtype != Literal::Integer )
-                {
-                    me->d_parts[i]->accept(this);
-                    error(me,Evaluator::tr("operand type incompatible with set literal") );
-                }
+                s |= 1u << setElement( me, me->d_parts[i].data(),
+                                       Evaluator::tr("value is out of range MIN(SET)..MAX(SET)") );
+        }
+        pushSet(s);
+    }
 
-                const qint64 l = val.d_value.toLongLong();
-                if( l < 0 || l >= Literal::SET_BIT_LEN  )
-                    error(me,Evaluator::tr("value is out of range MIN(SET)..MAX(SET)") );
-                s.set(l);
-            }
+    static bool dependsOnActuals( Const* c )
+    {
+        Module* m = c->getModule();
+        if( m == 0 || m->d_metaActuals.isEmpty() )
+            return false; // only the constants of an instance can depend on meta actuals
+        foreach( const Ref<Named>& p, m->d_metaParams )
+        {
+            if( p.data() == c )
+                return true;
         }
-        push(QVariant::fromValue(s),Literal::Set);
+        if( c->d_constExpr.isNull() || m->d_evalMemo.isNull() )
+            return true;
+        QHash<Expression*,EvalMemo::Entry>::const_iterator i = m->d_evalMemo->d_entries.find(c->d_constExpr.data());
+        return i == m->d_evalMemo->d_entries.end() || !i.value().d_shared;
     }
 
     void evalConst( Const* me)
     {
-        val.d_vtype = (Literal::ValueType)me->d_vtype;
-        val.d_value = me->d_val;
+        if( !me->d_visited )
+            transient = true;
+        else if( dependsOnActuals(me) )
+            local = true;
+        val = Evaluator::Value::fromVariant(me->d_val, me->d_vtype);
+        val.d_wide = me->d_wide;
+        val.d_minInt = me->d_minInt;
+        val.d_strLen = me->d_strLen;
     }
 
     void visit( IdentLeaf* me)
@@ -389,7 +411,7 @@ struct EvalVisitor : public AstVisitor
         if( me->d_sub )
             me->d_sub->accept(this);
         else
-            val = Evaluator::Result();
+            val = Evaluator::Value();
         switch( me->d_op )
         {
         case UnExpr::NEG:
@@ -439,55 +461,43 @@ struct EvalVisitor : public AstVisitor
             if( val.d_vtype == Literal::Integer )
             {
                 const bool lwide = val.d_wide;
-                const qint64 lhs = val.d_value.toLongLong();
+                const qint64 lhs = val.d_int;
                 me->d_args.last()->accept(this);
                 if( val.d_vtype == Literal::Integer )
                 {
-                    const bool rwide = val.d_wide;
-                    val.d_wide = lwide || rwide;
-                    val.d_minInt = !val.d_wide;
-                    const qint64 rhs = val.d_value.toLongLong();
+                    const bool wide = lwide || val.d_wide;
+                    const qint64 rhs = val.d_int;
+                    qint64 res = 0;
                     switch( func )
                     {
                     case BuiltIn::BITAND:
-                        if( val.d_wide )
-                            val.d_value = qint64(lhs & rhs);
-                        else
-                            val.d_value = qint32(lhs & rhs);
+                        res = lhs & rhs;
                         break;
                     case BuiltIn::BITOR:
-                        if( val.d_wide )
-                            val.d_value = qint64(lhs | rhs);
-                        else
-                            val.d_value = qint32(lhs | rhs);
+                        res = lhs | rhs;
                         break;
                     case BuiltIn::BITXOR:
-                        if( val.d_wide )
-                            val.d_value = qint64(lhs ^ rhs);
-                        else
-                            val.d_value = qint32(lhs ^ rhs);
+                        res = lhs ^ rhs;
                         break;
                     case BuiltIn::BITSHL:
-                        if( val.d_wide )
-                            val.d_value = qint64(lhs << rhs);
-                        else
-                            val.d_value = qint32(lhs << rhs);
+                        res = lhs << rhs;
                         break;
                     case BuiltIn::BITSHR:
-                        if( val.d_wide )
-                            val.d_value = qint64(lhs >> rhs);
-                        else
-                            val.d_value = qint32(lhs >> rhs);
+                        res = lhs >> rhs;
                         break;
                     case BuiltIn::BITASR:
-                        if( val.d_wide )
-                            val.d_value = qint64(lhs >> rhs | ~(~((quint64)0) >> rhs));
+                        if( wide )
+                            res = lhs >> rhs | ~(~((quint64)0) >> rhs);
                         else
-                            val.d_value = qint64(lhs >> rhs | ~(~((quint32)0) >> rhs));
+                            res = lhs >> rhs | ~(~((quint32)0) >> rhs);
                         break;
                     default:
                         Q_ASSERT(false);
                     }
+                    if( wide || func == BuiltIn::BITASR )
+                        pushInt( res, wide, !wide );
+                    else
+                        pushInt( qint32(res), wide, !wide );
                 }else
                     return error( me->d_args.last().data(), Evaluator::tr("invalid argument type") );
             }else
@@ -516,19 +526,19 @@ struct EvalVisitor : public AstVisitor
                 if( n && n->getTag() == Thing::T_NamedType && t && t->getTag() == Thing::T_BaseType )
                 {
                     BaseType* bi = cast<BaseType*>(t);
-                    if( f->d_func == BuiltIn::MAX )
-                        val.d_value = bi->maxVal();
-                    else
-                        val.d_value = bi->minVal();
-                    val.d_vtype = Literal::NoValue;
+                    quint8 vtype = Literal::NoValue;
                     if( bi->d_baseType == BaseType::CHAR || bi->d_baseType == BaseType::WCHAR )
-                        val.d_vtype = Literal::Char;
+                        vtype = Literal::Char;
                     else if( bi->d_baseType >= BaseType::BYTE && bi->d_baseType <= BaseType::INT64 )
-                        val.d_vtype = Literal::Integer;
+                        vtype = Literal::Integer;
                     else if( bi->d_baseType >= BaseType::REAL && bi->d_baseType <= BaseType::LONGREAL )
-                        val.d_vtype = Literal::Real;
+                        vtype = Literal::Real;
                     else if( bi->d_baseType == BaseType::SET )
-                        val.d_vtype = Literal::Integer;
+                        vtype = Literal::Integer;
+                    local = true; // the type could be a meta param
+                    val = Evaluator::Value::fromVariant( f->d_func == BuiltIn::MAX ? bi->maxVal() : bi->minVal(), vtype );
+                    val.d_wide = bi->d_baseType == BaseType::WCHAR || bi->d_baseType == BaseType::INT64 ||
+                            bi->d_baseType == BaseType::LONGREAL;
                     return;
                 }else
                     error( me, Evaluator::tr("base type argument required") );
@@ -561,8 +571,8 @@ struct EvalVisitor : public AstVisitor
 
                     if( !a->d_lenExpr.isNull() )
                     {
-                        val.d_value = a->d_len;
-                        val.d_vtype = Literal::Integer;
+                        transient = true; // d_len might not yet be known
+                        pushInt( a->d_len );
                         return;
                     }else
                         error( me, Evaluator::tr("cannot determine length of an open array in a const expression") );
@@ -574,8 +584,7 @@ struct EvalVisitor : public AstVisitor
                         me->d_args.first()->accept(this);
                         if( val.d_vtype == Literal::String )
                         {
-                            val.d_value = QString::fromUtf8(val.d_value.toByteArray()).size() + 1; // including \0
-                            val.d_vtype = Literal::Integer;
+                            pushInt( QString::fromUtf8(val.d_str).size() + 1 ); // including \0
                             return;
                         }
                     }else if( bt->d_baseType == BaseType::BYTEARRAY )
@@ -583,8 +592,7 @@ struct EvalVisitor : public AstVisitor
                         me->d_args.first()->accept(this);
                         if( val.d_vtype == Literal::Bytes )
                         {
-                            val.d_value = val.d_value.toByteArray().size();
-                            val.d_vtype = Literal::Integer;
+                            pushInt( val.d_str.size() );
                             return;
                         }
                     }
@@ -597,17 +605,15 @@ struct EvalVisitor : public AstVisitor
         case BuiltIn::ASH:
             if( me->d_args.size() == 2 )
             {
-                Evaluator::Result x,n;
-                me->d_args.first()->accept(this);
-                x = val;
                 me->d_args.last()->accept(this);
-                n = val;
-                if( x.d_vtype == Literal::Integer && n.d_vtype == Literal::Integer )
+                const Evaluator::Value n = val;
+                me->d_args.first()->accept(this);
+                if( val.d_vtype == Literal::Integer && n.d_vtype == Literal::Integer )
                 {
-                    if( x.d_wide )
-                        val.d_value = x.d_value.toLongLong() * ::pow(2,n.d_value.toInt());
+                    if( val.d_wide )
+                        val.d_int = val.d_int * ::pow(2,qint32(n.d_int));
                     else
-                        val.d_value = x.d_value.toInt() * ::pow(2,n.d_value.toInt());
+                        val.d_int = qint32(val.d_int) * ::pow(2,qint32(n.d_int));
                     return;
                 }else
                     error( me, Evaluator::tr("invalid argument types") );
@@ -624,11 +630,10 @@ struct EvalVisitor : public AstVisitor
                     return;
                 }else if( val.d_vtype == Literal::String )
                 {
-                    const QString str = QString::fromUtf8(val.d_value.toByteArray());
+                    const QString str = QString::fromUtf8(val.d_str);
                     if( str.size() == 1 )
                     {
-                        val.d_value = str[0].unicode();
-                        val.d_vtype = Literal::Integer;
+                        pushInt( str[0].unicode() );
                         return;
                     }else
                         error( me, Evaluator::tr("argument is not a character") );
@@ -651,9 +656,9 @@ struct EvalVisitor : public AstVisitor
             {
                 me->d_args.first()->accept(this);
                 if( val.d_vtype == Literal::Real )
-                    val.d_value = qAbs(val.d_value.toDouble());
+                    val.d_real = qAbs(val.d_real);
                 else if( val.d_vtype == Literal::Integer )
-                    val.d_value = qAbs(val.d_value.toULongLong());
+                    val.d_int = qAbs(val.d_int);
                 else
                     error( me, Evaluator::tr("invalid argument type") );
                 return;
@@ -665,10 +670,8 @@ struct EvalVisitor : public AstVisitor
             {
                 me->d_args.first()->accept(this);
                 if( val.d_vtype == Literal::Integer )
-                {
-                    val.d_value = ( val.d_value.toULongLong() % 2 == 0 );
-                    val.d_vtype = Literal::Boolean;
-                }else
+                    pushBool( val.d_int % 2 != 0 );
+                else
                     error( me, Evaluator::tr("invalid argument type") );
                 return;
             }else
@@ -680,16 +683,16 @@ struct EvalVisitor : public AstVisitor
                 me->d_args.first()->accept(this);
                 if( val.d_vtype == Literal::Integer )
                 {
-                    qint64 x = val.d_value.toULongLong();
+                    qint64 x = val.d_int;
                     me->d_args.last()->accept(this);
                     if( val.d_vtype == Literal::Integer )
                     {
-                        const qint32 n = val.d_value.toInt();
+                        const qint32 n = val.d_int;
                         if( n < 0 )
-                            x = x >> n;
+                            x = x >> -n;
                         else
                             x = x << n;
-                        val.d_value = x;
+                        val.d_int = x;
                     }else
                         error( me, Evaluator::tr("invalid argument type") );
                 }else
@@ -702,33 +705,29 @@ struct EvalVisitor : public AstVisitor
             if( me->d_args.size() == 2 )
             {
                 me->d_args.first()->accept(this);
-                Evaluator::Result lhs = val;
+                const Evaluator::Value lhs = val;
                 if( lhs.d_vtype == Literal::Integer )
                 {
                     me->d_args.last()->accept(this);
-                    const qint32 n = val.d_value.toInt();
+                    const qint32 n = val.d_int;
                     if( val.d_vtype != Literal::Integer )
                         error( me, Evaluator::tr("invalid argument type") );
                     if( lhs.d_wide )
                     {
-                        qint64 x = lhs.d_value.toLongLong();
+                        qint64 x = lhs.d_int;
                         if( x < 0 && n > 0 )
                             x = x >> n | ~(~((quint64)0) >> n);
                         else
                             x = x >> n;
-                        val.d_wide = true;
-                        val.d_minInt = false;
-                        val.d_value = x;
+                        pushInt( x, true, false );
                     }else
                     {
-                        qint32 x = lhs.d_value.toInt();
+                        qint32 x = lhs.d_int;
                         if( x < 0 && n > 0 )
                             x = x >> n | ~(~((quint32)0) >> n);
                         else
                             x = x >> n;
-                        val.d_minInt = true;
-                        val.d_wide = false;
-                        val.d_value = x;
+                        pushInt( x, false, true );
                     }
                 }else
                     error( me, Evaluator::tr("invalid argument type") );
@@ -742,13 +741,11 @@ struct EvalVisitor : public AstVisitor
                 me->d_args.first()->accept(this);
                 if( val.d_vtype == Literal::Integer )
                 {
-                    qint64 x = val.d_value.toULongLong();
+                    const quint64 x = val.d_int;
                     me->d_args.last()->accept(this);
                     if( val.d_vtype == Literal::Integer )
-                    {
-                        x = x >> val.d_value.toULongLong();
-                        val.d_value = x;
-                    }else
+                        val.d_int = x >> quint64(val.d_int);
+                    else
                         error( me, Evaluator::tr("invalid argument type") );
                 }else
                     error( me, Evaluator::tr("invalid argument type") );
@@ -762,7 +759,7 @@ struct EvalVisitor : public AstVisitor
                 me->d_args.first()->accept(this);
                 if( val.d_vtype == Literal::Real )
                 {
-                    val.d_value = floor( val.d_value.toDouble() );
+                    val.d_int = ::floor( val.d_real );
                     val.d_vtype = Literal::Integer;
                 }else
                     error( me, Evaluator::tr("invalid argument type") );
@@ -775,8 +772,10 @@ struct EvalVisitor : public AstVisitor
             {
                 me->d_args.first()->accept(this);
                 if( val.d_vtype == Literal::Integer )
+                {
+                    val.d_real = val.d_int;
                     val.d_vtype = Literal::Real;
-                else
+                }else
                     error( me, Evaluator::tr("invalid argument type") );
                 return;
             }else
@@ -789,9 +788,9 @@ struct EvalVisitor : public AstVisitor
                 if( val.d_vtype == Literal::Integer )
                 {
                     if( val.d_wide )
-                        val.d_value = qint64(~val.d_value.toULongLong());
+                        val.d_int = qint64(~quint64(val.d_int));
                     else
-                        val.d_value = qint32(~val.d_value.toUInt());
+                        val.d_int = qint32(~quint32(val.d_int));
                 }else
                     error( me, Evaluator::tr("invalid argument type") );
                 return;
@@ -807,20 +806,6 @@ struct EvalVisitor : public AstVisitor
             if( evalBitOps(f->d_func,me) )
                 return;
             break;
-        case BuiltIn::BYTESIZE:
-            if( me->d_args.size() == 1 )
-            {
-                val.d_value = 0;
-                val.d_vtype = Literal::Integer;
-                Named* n = me->d_args[0]->getIdent();
-                if( n && n->getTag() == Thing::T_NamedType )
-                {
-                    Type* t = derefed(n->d_type.data());
-                    if( t )
-                        val.d_value = t->getByteSize();
-                }
-            }
-            break;
         case BuiltIn::INC:
         case BuiltIn::DEC:
         case BuiltIn::INCL:
@@ -862,12 +847,14 @@ struct EvalVisitor : public AstVisitor
             error( me, Evaluator::tr("built-in procedure not supported in const expressions") );
             break;
         }
-        val = Evaluator::Result();
+        // also BYTESIZE: the size depends on the backend
+        val = Evaluator::Value();
+        transient = true;
     }
 
     void visit( BinExpr* me)
     {
-        Evaluator::Result lhs, rhs;
+        Evaluator::Value lhs, rhs;
         if( me->d_lhs )
         {
             me->d_lhs->accept(this);
@@ -908,22 +895,22 @@ struct EvalVisitor : public AstVisitor
             OR(lhs,rhs,me);
             break;
         case BinExpr::EQ:
-            EQ(lhs,rhs,me);
+            pushBool( equal(lhs,rhs,me) );
             break;
         case BinExpr::NEQ:
-            NEQ(lhs,rhs,me);
+            pushBool( !equal(lhs,rhs,me) );
             break;
         case BinExpr::LT:
-            LE(lhs,rhs,me);
+            pushBool( compare(lhs,rhs,me) < 0 );
             break;
         case BinExpr::LEQ:
-            LEQ(lhs,rhs,me);
+            pushBool( compare(lhs,rhs,me) <= 0 );
             break;
         case BinExpr::GT:
-            GT(lhs,rhs,me);
+            pushBool( compare(lhs,rhs,me) > 0 );
             break;
         case BinExpr::GEQ:
-            GEQ(lhs,rhs,me);
+            pushBool( compare(lhs,rhs,me) >= 0 );
             break;
         default:
             error(me,Evaluator::tr("operator not supported for constants"));
@@ -934,11 +921,41 @@ struct EvalVisitor : public AstVisitor
 Evaluator::Result Evaluator::eval(Expression* e, Scope* m, bool supportVla, Errors* err)
 {
     Q_ASSERT( m != 0 && e != 0 );
+
+    // the memo is only accessed by the thread which validates the module, see Model::validateLevels
+    Module* mod = m->getModule();
+    EvalMemo* memo = 0;
+    Expression* origin = 0;
+    if( mod )
+    {
+        if( mod->d_evalMemo.isNull() )
+            mod->d_evalMemo = QSharedPointer<EvalMemo>( new EvalMemo() );
+        memo = mod->d_evalMemo.data();
+        QHash<Expression*,EvalMemo::Entry>::const_iterator i = memo->d_entries.find(e);
+        if( i != memo->d_entries.end() )
+            return i.value().d_res;
+        if( memo->d_template )
+        {
+            origin = memo->d_origin.value(e);
+            if( origin )
+            {
+                i = memo->d_template->d_entries.find(origin);
+                if( i != memo->d_template->d_entries.end() )
+                {
+                    EvalMemo::Entry& hit = memo->d_entries[e];
+                    hit.d_expr = e;
+                    hit.d_res = i.value().d_res;
+                    hit.d_shared = true;
+                    return hit.d_res;
+                }
+            }
+        }
+    }
+
     EvalVisitor ev(m, supportVla,err);
     try
     {
         e->accept( &ev );
-        return ev.val;
     }catch(int)
     {
         Result r;
@@ -946,7 +963,53 @@ Evaluator::Result Evaluator::eval(Expression* e, Scope* m, bool supportVla, Erro
         r.d_dyn = true;
         return r;
     }catch(const char*)
-    { 
+    {
         return Result();
     }
+
+    Result res;
+    res.d_value = ev.val.toVariant();
+    res.d_vtype = ev.val.d_vtype;
+    res.d_wide = ev.val.d_wide;
+    res.d_minInt = ev.val.d_minInt;
+    res.d_strLen = ev.val.d_strLen;
+    if( memo && !ev.transient && res.d_vtype != Literal::NoValue )
+    {
+        EvalMemo::Entry& entry = memo->d_entries[e];
+        entry.d_expr = e;
+        entry.d_res = res;
+        entry.d_shared = !ev.local;
+        if( origin && !ev.local )
+        {
+            EvalMemo::Entry& shared = memo->d_template->d_entries[origin];
+            shared.d_expr = origin;
+            shared.d_res = res;
+            shared.d_shared = true;
+        }
+    }
+    return res;
+}
+
+void Evaluator::initInstance(Module* inst, Module* tmpl, const QHash<Thing*, Thing*>& copies)
+{
+    if( tmpl->d_evalMemo.isNull() )
+        tmpl->d_evalMemo = QSharedPointer<EvalMemo>( new EvalMemo() );
+    inst->d_evalMemo = QSharedPointer<EvalMemo>( new EvalMemo() );
+    inst->d_evalMemo->d_template = tmpl->d_evalMemo;
+    QHash<Expression*,Expression*>& origin = inst->d_evalMemo->d_origin;
+    for( QHash<Thing*,Thing*>::const_iterator i = copies.begin(); i != copies.end(); ++i )
+    {
+        // only the declarations are worth it; the other constant expressions are evaluated once per instance
+        if( i.key()->getTag() == Thing::T_Const )
+        {
+            Const* from = cast<Const*>(i.key());
+            if( !from->d_constExpr.isNull() )
+                origin.insert( cast<Const*>(i.value())->d_constExpr.data(), from->d_constExpr.data() );
+        }else if( i.key()->getTag() == Thing::T_Array )
+        {
+            Array* from = cast<Array*>(i.key());
+            if( !from->d_lenExpr.isNull() )
+                origin.insert( cast<Array*>(i.value())->d_lenExpr.data(), from->d_lenExpr.data() );
+        }
+    }
 }
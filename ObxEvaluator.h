@@ -40,11 +40,52 @@ namespace Obx
             Result():d_vtype(Literal::NoValue),d_wide(false),d_strLen(0),d_dyn(0),d_minInt(0){}
         };
 
+        struct Value
+        {
+            // Folding is done on this representation; QVariant is only used to read the values of Literal
+            // and Const and for the Result.
+            union
+            {
+                qint64 d_int; // Integer, Enum, Char, Boolean
+                double d_real;
+                quint32 d_set; // bit i is element i
+            };
+            QByteArray d_str; // String (utf8) and Bytes; implicitly shared with the Literal it comes from
+            quint8 d_vtype; // Literal::ValueType
+            bool d_wide;
+            bool d_minInt;
+            quint32 d_strLen;
+            Value():d_int(0),d_vtype(Literal::NoValue),d_wide(false),d_minInt(false),d_strLen(0){}
+            static Value fromVariant( const QVariant&, quint8 vtype );
+            QVariant toVariant() const;
+        };
+
         static Result eval( Expression*, Scope*, bool supportVla = false, Ob::Errors* = 0 );
 
+        // inst was cloned from tmpl; the constant and array length expressions of inst share the results
+        // of tmpl which don't depend on the meta actuals
+        static void initInstance( Module* inst, Module* tmpl, const QHash<Thing*,Thing*>& copies );
+
     private:
         Evaluator();
     };
+
+    class EvalMemo
+    {
+        // The results of Evaluator::eval per expression, held by the module of the scope of the evaluation.
+        // Only values which don't depend on the state of the validation are kept.
+    public:
+        struct Entry
+        {
+            Ref<Expression> d_expr; // the key must not be reused while it is in the memo
+            Evaluator::Result d_res;
+            bool d_shared; // doesn't depend on the meta actuals of the module
+            Entry():d_shared(false){}
+        };
+        QHash<Expression*,Entry> d_entries;
+        QHash<Expression*,Expression*> d_origin; // instances: expression -> template expression
+        QSharedPointer<EvalMemo> d_template; // instances: shared memo of the template
+    };
 }
 
 #endif // OBXEVALUATOR_H
@@ -49,6 +49,10 @@
 #include <QTextBrowser>
 #include <QProcess>
 #include <QTreeWidget>
+#include <QThread>
+#include <QStatusBar>
+#include <QElapsedTimer>
+#include <QTextDocument>
 #include <GuiTools/AutoMenu.h>
 #include <GuiTools/CodeEditor.h>
 #include <GuiTools/AutoShortcut.h>
@@ -348,10 +352,63 @@ public:
     }
 };
 
+// NOTE fastasm seems still to make problems, maybe related to the mscorelib.dll version;
+// the same code which issues a runtime exception runs without problems when compiled with
+// ILASM or Pelib; so somehow fastasm seems to generate wrong code or meta for the same IL.
+// Anyway we can do well without fastasm because neither fastasm nor ILASM generate useful MDBs.
+static const CilGen::How s_how = CilGen::Pelib; // CilGen::Fastasm; CilGen::Ilasm
+// Pelib is factor 1.4 faster than Fastasm for generating the IL and factor ~3 incl. IL to assembly compilation;
+// compared to ilasm.exe for compilation (instead of fastasm.exe) Pelib is even a factor 29 faster.
+
+class Ide::Compiler : public QThread
+{
+public:
+    // parses, validates and optionally generates a snapshot of the project; Ide::onCompiled publishes the result
+    Ide* d_ide;
+    Project* d_pro; // the snapshot, owned
+    QString d_buildPath;
+    bool d_all, d_generate, d_debug;
+    bool d_ok, d_generated;
+    qint64 d_parseMs, d_genMs;
+    QAtomicInt d_cancel; // superseded; the result is discarded
+
+    Compiler(Ide* ide, Project* pro, bool all, bool generate, bool debug, const QString& buildPath ):
+        QThread(ide),d_ide(ide),d_pro(pro),d_buildPath(buildPath),d_all(all),d_generate(generate),d_debug(debug),
+        d_ok(false),d_generated(false),d_parseMs(0),d_genMs(0) {}
+    ~Compiler()
+    {
+        delete d_pro;
+    }
+    void phase( const QString& msg )
+    {
+        QMetaObject::invokeMethod(d_ide, "onCompilePhase", Qt::QueuedConnection, Q_ARG(QString, msg) );
+    }
+    void run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+        phase( Ide::tr("Parsing and validating %1 files...").arg(d_pro->getFiles().size()) );
+        d_ok = d_pro->parse(false);
+        d_parseMs = timer.elapsed();
+        if( d_cancel.load() || !d_ok || !d_generate )
+            return;
+        phase( Ide::tr("Generating assemblies...") );
+        timer.restart();
+        d_generated = CilGen::translateAll(d_pro, s_how, d_debug, d_buildPath, d_all );
+        d_genMs = timer.elapsed();
+    }
+};
+
 static Ide* s_this = 0;
 static void report(QtMsgType type, const QString& message )
 {
-    if( s_this )
+    if( s_this && QThread::currentThread() != s_this->thread() )
+    {
+        // e.g. errors reported by Ide::Compiler
+        if( type != QtDebugMsg )
+            QMetaObject::invokeMethod(s_this, "onLogMessage", Qt::QueuedConnection, Q_ARG(QString, message),
+                                      Q_ARG(int, type == QtWarningMsg ? Ide::LogWarning : Ide::LogError ) );
+    }else if( s_this )
     {
         switch(type)
         {
@@ -380,7 +437,8 @@ Ide::Ide(QWidget *parent)
     : QMainWindow(parent),d_lock(false),d_filesDirty(false),d_pushBackLock(false),
       d_lock2(false),d_lock3(false),d_lock4(false),d_debugging(false),d_ovflCheck(true),d_mode(LineMode),
       d_suspended(false),d_curRow(0),d_curCol(0),d_curThread(0),d_status(Idle),
-      d_breakOnExceptions(false),d_noWarnings(false),d_incremental(false)
+      d_breakOnExceptions(false),d_noWarnings(false),d_incremental(false),d_compiler(0),
+      d_recompile(false),d_recompileAll(false),d_recompileGen(false)
 {
     s_this = this;
 
@@ -454,6 +512,7 @@ Ide::Ide(QWidget *parent)
 }
 Ide::~Ide()
 {
+    cancelCompile();
     QSettings s;
     s.setValue( "DockState", saveState() );
 }
@@ -474,7 +533,11 @@ void Ide::loadFile(const QString& path)
 
     onCaption();
 
+    // only the initial compile skips the procedure bodies; the bodies of a module are parsed when navigated to,
+    // searched for usages, generated or when the module is recompiled, which then also reports their errors
+    d_pro->getMdl()->setSkeleton(true);
     compile(true);
+    d_pro->getMdl()->setSkeleton(false);
 }
 
 void Ide::logMessage(const QString& msg, LogLevel l, bool addNewLine)
@@ -1024,7 +1087,7 @@ void Ide::onExportIl()
     if (dirPath.isEmpty())
         return;
 
-    if( !compile(false,false) ) // otherwise allocated flag is already set after one generator run
+    if( !compile(false,false,false) ) // otherwise allocated flag is already set after one generator run
         return;
     if( !CilGen::translateAll(d_pro, CilGen::Ilasm, d_debugging && d_ovflCheck, dirPath, true ) )
         QMessageBox::critical(this,tr("Save IL"),tr("There was an error when generating IL; "
@@ -1040,7 +1103,7 @@ void Ide::onExportC()
     if (dirPath.isEmpty())
         return;
 
-    if( !compile(false,false) ) // otherwise allocated flag is already set after one generator run
+    if( !compile(false,false,false) ) // otherwise allocated flag is already set after one generator run
         return;
     if( !CGen2::translateAll(d_pro, d_debugging, dirPath ) )
         QMessageBox::critical(this,tr("Save C"),tr("There was an error when generating C; "
@@ -1755,10 +1818,19 @@ static bool preloadLib( Project* pro, const QByteArray& name )
     return true;
 }
 
-bool Ide::compile(bool all, bool doGenerate )
+bool Ide::compile(bool all, bool doGenerate, bool inBackground )
 {
     if( !d_incremental )
         all = true;
+    if( d_compiler )
+    {
+        if( inBackground )
+        {
+            supersedeCompile(all,doGenerate);
+            return true;
+        }
+        cancelCompile();
+    }
     for( int i = 0; i < d_tab->count(); i++ )
     {
         Editor* e = static_cast<Editor*>( d_tab->widget(i) );
@@ -1780,6 +1852,21 @@ bool Ide::compile(bool all, bool doGenerate )
         preloadLib(d_pro,"Coroutines");
         preloadLib(d_pro,"XYplane");
     }
+
+    // an incremental parse updates the model the IDE is showing, so only full parses go to the background
+    if( inBackground && all && ( !doGenerate || s_how != CilGen::Fastasm ) )
+    {
+        QString buildPath;
+        if( doGenerate && !checkBuildDir(buildPath) )
+            return false;
+        d_compiler = new Compiler(this, d_pro->createSnapshot(), all, doGenerate,
+                                  d_debugging && d_ovflCheck, buildPath );
+        connect( d_compiler, SIGNAL(finished()), this, SLOT(onCompiled()) );
+        d_status = Compiling;
+        d_compiler->start();
+        return true;
+    }
+
     const QTime start = QTime::currentTime();
     d_status = Compiling;
     const bool res = d_pro->parse(!all);
@@ -1801,20 +1888,108 @@ bool Ide::compile(bool all, bool doGenerate )
     return true;
 }
 
-bool Ide::generate(bool forceAll)
+void Ide::supersedeCompile(bool all, bool doGenerate)
 {
-    if( d_status != Idle )
-        return false;
+    // the compile in flight works on outdated buffers; it is restarted when it returns
+    Q_ASSERT( d_compiler );
+    d_compiler->d_cancel = 1;
+    d_recompile = true;
+    d_recompileAll = d_recompileAll || all || d_compiler->d_all;
+    d_recompileGen = d_recompileGen || doGenerate || d_compiler->d_generate;
+    statusBar()->showMessage(tr("Compiling, restarting with the latest changes..."));
+}
+
+void Ide::cancelCompile()
+{
+    if( d_compiler == 0 )
+        return;
+    d_compiler->d_cancel = 1;
+    d_compiler->wait();
+    delete d_compiler;
+    d_compiler = 0;
+    d_recompile = false;
+    d_recompileAll = false;
+    d_recompileGen = false;
+    d_status = Idle;
+    statusBar()->clearMessage();
+}
+
+void Ide::onCompiled()
+{
+    if( d_compiler == 0 || sender() != d_compiler )
+        return; // already cancelled
+    Compiler* c = d_compiler;
+    d_compiler = 0;
+    d_status = Idle;
+    if( c->d_cancel.load() )
+    {
+        delete c;
+        statusBar()->clearMessage();
+        if( d_recompile )
+        {
+            const bool all = d_recompileAll;
+            const bool gen = d_recompileGen;
+            d_recompile = false;
+            d_recompileAll = false;
+            d_recompileGen = false;
+            compile(all,gen);
+        }
+        return;
+    }
+
+    d_pro->adopt(c->d_pro); // the snapshot gets the previous model which is deleted with c
+    d_pro->getMdl()->setSkeleton(false); // see loadFile
+    qDebug() << "recompiled" << d_pro->getFiles().size() << "files with" << d_pro->getSloc() << "SLOC in"
+             << c->d_parseMs << "[ms]";
+    if( c->d_generate && c->d_ok )
+        qDebug() << "generated in" << c->d_genMs << "[ms]";
+    statusBar()->showMessage(tr("Compiled %1 files in %2 ms%3").arg(d_pro->getFiles().size())
+                             .arg(c->d_parseMs + c->d_genMs)
+                             .arg(d_pro->getErrs()->getErrCount() ? tr(" with errors") : QString()), 5000 );
+    onErrors();
+    fillMods();
+    fillModule(0);
+    fillHier(0);
+    fillXref();
+    onTabChanged();
+    if( c->d_generate && c->d_ok && !c->d_generated )
+        QMessageBox::critical(this,tr("Compiler"),tr("There was an error when generating an assembly; "
+                                                     "see Output window for more information"));
+    delete c;
+}
+
+void Ide::onCompilePhase(const QString& msg)
+{
+    if( d_compiler )
+        statusBar()->showMessage(msg);
+}
+
+void Ide::onLogMessage(const QString& msg, int level)
+{
+    logMessage(msg, (LogLevel)level);
+}
+
+void Ide::onContentsChanged()
+{
+    // the highlighter also signals changes when it only formats the text; the revision only counts edits
+    QTextDocument* doc = qobject_cast<QTextDocument*>(sender());
+    if( doc == 0 )
+        return;
+    const int rev = doc->revision();
+    const int prev = d_revisions.value(doc, rev);
+    d_revisions[doc] = rev;
+    if( d_compiler && rev != prev && !d_compiler->d_cancel.load() )
+        supersedeCompile(d_compiler->d_all, d_compiler->d_generate);
+}
 
-    // NOTE fastasm seems still to make problems, maybe related to the mscorelib.dll version;
-    // the same code which issues a runtime exception runs without problems when compiled with
-    // ILASM or Pelib; so somehow fastasm seems to generate wrong code or meta for the same IL.
-    // Anyway we can do well without fastasm because neither fastasm nor ILASM generate useful MDBs.
-    const CilGen::How how = CilGen::Pelib; // CilGen::Fastasm; CilGen::Ilasm
-    // Pelib is factor 1.4 faster than Fastasm for generating the IL and factor ~3 incl. IL to assembly compilation;
-    // compared to ilasm.exe for compilation (instead of fastasm.exe) Pelib is even a factor 29 faster.
+void Ide::onDocDestroyed(QObject* doc)
+{
+    d_revisions.remove(doc);
+}
 
-    const QString buildPath = d_pro->getBuildDir(true);
+bool Ide::checkBuildDir(QString& buildPath)
+{
+    buildPath = d_pro->getBuildDir(true);
     QDir buildDir(buildPath);
     if( !buildDir.mkpath(buildPath) )
     {
@@ -1828,6 +2003,20 @@ bool Ide::generate(bool forceAll)
         return false;
     }
     test.remove();
+    return true;
+}
+
+bool Ide::generate(bool forceAll)
+{
+    if( d_status != Idle )
+        return false;
+
+    const CilGen::How how = s_how;
+
+    QString buildPath;
+    if( !checkBuildDir(buildPath) )
+        return false;
+    QDir buildDir(buildPath);
 
     if( how == CilGen::Fastasm && !checkEngine(true) )
         return false;
@@ -2033,6 +2222,9 @@ Ide::Editor* Ide::showEditor(const QString& path, int row, int col, bool setMark
 #endif
         }else
             qWarning() << "cannot open file for reading" << filePath;
+        d_revisions[edit->document()] = edit->document()->revision();
+        connect(edit->document(), SIGNAL(contentsChanged()), this, SLOT(onContentsChanged()) );
+        connect(edit->document(), SIGNAL(destroyed(QObject*)), this, SLOT(onDocDestroyed(QObject*)) );
 
         if( f.first && f.first->d_mod )
         {
@@ -3432,9 +3624,9 @@ void Ide::onSetOptions()
     foreach( const Token& t, toks )
     {
         if( t.d_type == Tok_ident )
-            l << t.d_val;
+            l << t.getVal();
         else
-            errs << QString::fromUtf8(t.d_val);
+            errs << QString::fromUtf8(t.getVal());
     }
 
     if( !errs.isEmpty() )
@@ -88,7 +88,10 @@ namespace Obx
         void createMenuBar();
         void closeEvent(QCloseEvent* event);
         bool checkSaved( const QString& title );
-        bool compile(bool all = true, bool doGenerate = false);
+        bool compile(bool all = true, bool doGenerate = false, bool inBackground = true);
+        void supersedeCompile(bool all, bool doGenerate);
+        void cancelCompile();
+        bool checkBuildDir(QString& buildPath);
         bool generate(bool forceAll);
         bool run();
         void fillMods();
@@ -178,8 +181,15 @@ namespace Obx
         void onNoWarnings();
         void onConvertAllToUtf8();
         void onIncremental();
+        void onCompiled();
+        void onCompilePhase(const QString&);
+        void onLogMessage(const QString&, int level);
+        void onContentsChanged();
+        void onDocDestroyed(QObject*);
     private:
         class DocTab;
+        class Compiler;
+        Compiler* d_compiler; // the compile running in the background, if any
         DocTab* d_tab;
         Mono::Debugger* d_dbg;
         Mono::Engine* d_eng;
@@ -212,6 +222,8 @@ namespace Obx
         bool d_breakOnExceptions;
         bool d_noWarnings;
         bool d_incremental;
+        bool d_recompile, d_recompileAll, d_recompileGen; // restart when d_compiler returns
+        QHash<QObject*,int> d_revisions; // QTextDocument -> revision when last seen by onContentsChanged
         quint32 d_curThread;
         enum Status { Idle, Compiling, Generating, Running };
         Status d_status;
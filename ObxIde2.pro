@@ -40,7 +40,8 @@ SOURCES += ObxIde2.cpp \
     ../MonoTools/MonoDebugger.cpp \
     ../MonoTools/MonoIlView.cpp \
     ../MonoTools/MonoMdbGen.cpp \
-    ObxCGen2.cpp
+    ObxCGen2.cpp \
+    ObxOptimizer.cpp
 
 
 HEADERS  += ObxIde2.h \
@@ -56,7 +57,8 @@ HEADERS  += ObxIde2.h \
     ../MonoTools/MonoDebuggerPrivate.h \
     ../MonoTools/MonoIlView.h \
     ../MonoTools/MonoMdbGen.h \
-    ObxCGen2.h
+    ObxCGen2.h \
+    ObxOptimizer.h
 
 
 include( ObxParser.pri )
@@ -1026,6 +1026,20 @@ void IlEmitter::sub_(bool withOverflow, bool withUnsignedOverflow)
     delta(-2+1);
 }
 
+void IlEmitter::switch_(const QList<quint32>& labels)
+{
+    Q_ASSERT( !d_method.isEmpty() );
+    QByteArray arg;
+    for( int i = 0; i < labels.size(); i++ )
+    {
+        if( i != 0 )
+            arg += ",";
+        arg += QByteArray::number(labels[i]);
+    }
+    d_body.append(IlOperation(IL_switch,arg) );
+    delta(-1);
+}
+
 void IlEmitter::throw_()
 {
     Q_ASSERT( !d_method.isEmpty() );
@@ -1282,6 +1296,9 @@ void IlAsmRenderer::addMethod(const IlMethod& m)
         case IL_leave:
             out << ws() << s_opName[op.d_ilop] << " '#" << op.d_arg << "'" << endl;
             break;
+        case IL_switch:
+            out << ws() << s_opName[op.d_ilop] << " ( '#" << op.d_arg.split(',').join("', '#") << "' )" << endl;
+            break;
         case IL_call:
             out << ws() << s_opName[op.d_ilop];
             if( op.d_flags )
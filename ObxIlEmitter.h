@@ -205,6 +205,7 @@ namespace Obx
         void stobj_(const QByteArray& typeRef);
         void stsfld_(const QByteArray& fieldRef);
         void sub_( bool withOverflow = false, bool withUnsignedOverflow = false );
+        void switch_( const QList<quint32>& labels ); // branches to labels[i] for unsigned i, falls through otherwise
         void throw_();
         void unbox_(const QByteArray& typeRef);
         void xor_();
@@ -21,6 +21,7 @@
 #include "ObxAst.h"
 #include "ObxProject.h"
 #include "ObxLibFfi.h"
+#include "ObxTrace.h"
 #include <LjTools/Engine2.h>
 #include <QDir>
 #include <QStringList>
@@ -111,6 +112,7 @@ int main(int argc, char *argv[])
 
     QStringList dirOrFilePaths;
     QString outPath;
+    QString tracePath;
     bool doRun = false;
     bool fromBc = false;
     QStringList args = QCoreApplication::arguments();
@@ -142,8 +144,14 @@ int main(int argc, char *argv[])
             out << "  -obs          use built-in Oberon System backend definitions" << endl;
             out << "  -fsroot=path  Oberon file system root (supports %PRODIR% and %APPDIR%)" << endl;
             out << "  -frombc       run from bytecode (expecting the bytecode directory)" << endl;
+            out << "  -trace[=file] report the time per compiler phase and module, optionally as Chrome trace JSON" << endl;
             out << "  -h            display this information" << endl;
             return 0;
+        }else if( args[i] == "-trace" || args[i].startsWith("-trace=") )
+        {
+            Obx::Trace::setEnabled(true);
+            if( args[i].startsWith("-trace=") )
+                tracePath = QDir::current().absoluteFilePath(args[i].mid(7));
         }else if( args[i] == "-oak" )
             rt.getPro()->setUseBuiltInOakwood(true);
         else if( args[i] == "-obs" )
@@ -277,7 +285,14 @@ int main(int argc, char *argv[])
             qDebug() << Obx::Thing::s_tagName[i.key()] << i.value();
 #endif
 
-    if( !fromBc && !rt.compile(!outPath.isEmpty() || doRun) )
+    const bool compiled = fromBc || rt.compile(!outPath.isEmpty() || doRun);
+    if( Obx::Trace::isEnabled() )
+    {
+        Obx::Trace::printSummary(out);
+        if( !tracePath.isEmpty() && !Obx::Trace::write(tracePath) )
+            err << "cannot write trace to " << tracePath << endl;
+    }
+    if( !compiled )
         return -1;
 
     if( !outPath.isEmpty() )
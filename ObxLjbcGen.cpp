@@ -23,6 +23,7 @@
 #include "ObxModel.h"
 #include "ObxEvaluator.h"
 #include "ObxCGen.h"
+#include "ObxTrace.h"
 #include <LjTools/LuaJitComposer.h>
 #include <QDir>
 #include <QtDebug>
@@ -3808,6 +3809,7 @@ bool LjbcGen::allocateSlots(Module* me, QIODevice* out)
 bool LjbcGen::translate(Module* m, QIODevice* out, bool strip, Ob::Errors* errs)
 {
     Q_ASSERT( m != 0 && out != 0 );
+    Trace::Scope trace("lj gen", m);
 
     if( m->d_hasErrors || !m->d_isValidated ) //  not validated can happen if imports cannot be resolved
         return false;
@@ -0,0 +1,178 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <QTextStream>
+#include <QtDebug>
+#include "ObxProject.h"
+#include "ObxModel.h"
+#include "ObErrors.h"
+#include "ObFileCache.h"
+#include "ObxLspServer.h"
+
+// A language server for Oberon+ which talks JSON-RPC on stdin/stdout, e.g.
+//   OBXLSP path/to/project.obxpro
+// All logging goes to stderr, stdout is reserved for the protocol.
+
+static QStringList collectFiles( const QDir& dir )
+{
+    QStringList res;
+    QStringList files = dir.entryList( QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name );
+
+    foreach( const QString& f, files )
+        res += collectFiles( QDir( dir.absoluteFilePath(f) ) );
+
+    files = dir.entryList( QStringList() << QString("*.Mod")
+                                           << QString("*.mod")
+                           << QString("*.obx")
+                           << QString("*.Def")
+                           << QString("*.def")
+                                            << QString("*.obn"),
+                                           QDir::Files, QDir::Name );
+    foreach( const QString& f, files )
+    {
+        res.append( dir.absoluteFilePath(f) );
+    }
+    return res;
+}
+
+static bool preloadLib( Obx::Project* pro, const QByteArray& name )
+{
+    QFile f( QString(":/oakwood/%1.Def" ).arg(name.constData() ) );
+    if( !f.open(QIODevice::ReadOnly) )
+    {
+        qCritical() << "unknown preload" << name;
+        return false;
+    }
+    pro->getFc()->addFile( name, f.readAll(), true );
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setOrganizationName("Rochus Keller");
+    a.setOrganizationDomain("https://github.com/rochus-keller/Oberon");
+    a.setApplicationName("OBXLSP");
+    a.setApplicationVersion("2021-10-16");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Obx::Project pro;
+    pro.getErrs()->setReportToConsole(false);
+
+    QStringList dirOrFilePaths;
+    QByteArrayList options;
+    bool verbose = false;
+    const QStringList args = QCoreApplication::arguments();
+    for( int i = 1; i < args.size(); i++ )
+    {
+        if( args[i] == "-h" )
+        {
+            out << "usage: OBXLSP [options] [project file, files or directories]" << endl;
+            out << "  runs a Language Server Protocol server for Oberon+ on stdin/stdout" << endl;
+            out << "  without files the project is taken from the workspace root sent by the client" << endl;
+            out << "options:" << endl;
+            out << "  -h            display this information" << endl;
+            out << "  -v            log the time of each request to stderr" << endl;
+            out << "  -set:ident    set the variable named by ident to TRUE" << endl;
+            out << "  -jN           parse the source files with N parallel threads (-j: one per core)" << endl;
+            out << "  the following options are overridden if a project file is loaded" << endl;
+            out << "  -oak          use built-in oakwood definitions" << endl;
+            out << "  -obs          use built-in Oberon System backend definitions" << endl;
+            out << "  -int16        INTEGER is mapped to INT16 instead of INT32" << endl;
+            return 0;
+        }else if( args[i] == "-v" )
+            verbose = true;
+        else if( args[i] == "-oak" )
+            pro.setUseBuiltInOakwood(true);
+        else if( args[i] == "-obs" )
+            pro.setUseBuiltInObSysInner(true);
+        else if( args[i] == "-int16" )
+            pro.setInt16(true);
+        else if( args[i] == "-j" )
+            pro.getMdl()->setThreadCount(QThread::idealThreadCount());
+        else if( args[i].startsWith("-j") )
+            pro.getMdl()->setThreadCount( qMax( args[i].mid(2).toInt(), 1 ) );
+        else if( args[i].startsWith("-set:") )
+            options << args[i].mid(5).toUtf8();
+        else if( !args[i].startsWith('-') )
+            dirOrFilePaths += args[i];
+        else
+        {
+            err << "error: invalid command line option " << args[i] << endl;
+            return -1;
+        }
+    }
+
+    Obx::Package p;
+    QString pfile;
+    foreach( const QString& path, dirOrFilePaths )
+    {
+        QFileInfo info(path);
+        if( info.isDir() )
+            p.d_files += collectFiles( info.absoluteFilePath() );
+        else if( pfile.isEmpty() && ( path.endsWith(".obxpro") || path.endsWith(".obnpro") ) )
+            pfile = info.absoluteFilePath();
+        else
+            p.d_files << info.absoluteFilePath();
+    }
+    if( !pfile.isEmpty() )
+    {
+        if( !p.d_files.isEmpty() )
+        {
+            err << "expecting either a project file or source files/directories, but not both" << endl;
+            return -1;
+        }
+        if( !pro.loadFrom(pfile) )
+            return -1;
+    }else if( !p.d_files.isEmpty() )
+    {
+        pro.initializeFromPackageList( Obx::PackageList() << p );
+        pro.setOptions(options);
+    }
+
+    if( pro.useBuiltInOakwood() )
+    {
+        preloadLib(&pro,"In");
+        preloadLib(&pro,"Out");
+        preloadLib(&pro,"Files");
+        preloadLib(&pro,"Input");
+        preloadLib(&pro,"Math");
+        preloadLib(&pro,"MathL");
+        preloadLib(&pro,"Strings");
+        preloadLib(&pro,"Coroutines");
+        preloadLib(&pro,"XYplane");
+    }
+    if( !pro.getFiles().isEmpty() )
+        pro.parse();
+
+    QFile in;
+    in.open(fileno(stdin), QIODevice::ReadOnly); // by descriptor, so LspServer can poll it without stdio buffering
+    QFile res;
+    res.open(stdout, QIODevice::WriteOnly);
+    Obx::LspServer server(&pro, &in, &res);
+    server.setVerbose(verbose);
+    return server.run();
+}
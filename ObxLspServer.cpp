@@ -0,0 +1,519 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ObxLspServer.h"
+#include "ObxProject.h"
+#include "ObErrors.h"
+#include "ObFileCache.h"
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QUrl>
+#include <QtDebug>
+#ifdef Q_OS_UNIX
+#include <poll.h>
+#endif
+using namespace Obx;
+using namespace Ob;
+
+// see https://microsoft.github.io/language-server-protocol/specification
+enum { ParseError = -32700, InvalidRequest = -32600, MethodNotFound = -32601 };
+enum { SkModule = 2, SkClass = 5, SkMethod = 6, SkFunction = 12, SkVariable = 13, SkConstant = 14, SkStruct = 23 };
+static const int s_debounce = 300; // ms without input after an edit until the project is reparsed
+
+LspServer::LspServer(Project* pro, QIODevice* in, QIODevice* out):d_pro(pro),d_in(in),d_out(out),
+    d_shutdown(false),d_verbose(false),d_pending(false)
+{
+    Q_ASSERT( pro && in && out );
+}
+
+int LspServer::run()
+{
+    QJsonObject msg;
+    while( true )
+    {
+        // edits only mark the project for reparsing, so a burst of didChange costs one reparse
+        if( d_pending && !waitForInput(s_debounce) )
+            flush();
+        if( !readMessage(msg) )
+            break;
+        if( msg.value("method").toString() == "exit" )
+            return d_shutdown ? 0 : 1;
+        QElapsedTimer timer;
+        timer.start();
+        const QJsonValue id = msg.value("id");
+        if( !id.isUndefined() && !id.isNull() )
+            flush(); // requests see all edits received before them
+        dispatch(msg);
+        if( d_verbose )
+            qDebug() << msg.value("method").toString() << "in" << timer.elapsed() << "[ms]";
+    }
+    return d_shutdown ? 0 : 1;
+}
+
+bool LspServer::waitForInput(int msecs)
+{
+    if( d_in->bytesAvailable() > 0 )
+        return true;
+#ifdef Q_OS_UNIX
+    QFile* f = qobject_cast<QFile*>(d_in);
+    if( f && f->handle() >= 0 )
+    {
+        pollfd p;
+        p.fd = f->handle();
+        p.events = POLLIN;
+        p.revents = 0;
+        return ::poll(&p, 1, msecs) != 0;
+    }
+#endif
+    return d_in->waitForReadyRead(msecs) || d_in->bytesAvailable() > 0;
+}
+
+bool LspServer::readMessage(QJsonObject& msg)
+{
+    while( true )
+    {
+        int len = -1;
+        while( true )
+        {
+            QByteArray line = d_in->readLine();
+            if( line.isEmpty() )
+                return false; // end of input
+            line = line.trimmed();
+            if( line.isEmpty() )
+                break;
+            const int colon = line.indexOf(':');
+            if( colon != -1 && line.left(colon).trimmed().toLower() == "content-length" )
+                len = line.mid(colon+1).trimmed().toInt();
+        }
+        if( len < 0 )
+            continue;
+        QByteArray body;
+        while( body.size() < len )
+        {
+            const QByteArray part = d_in->read( len - body.size() );
+            if( part.isEmpty() && !d_in->waitForReadyRead(-1) && d_in->atEnd() )
+                return false;
+            body += part;
+        }
+        QJsonParseError err;
+        const QJsonDocument doc = QJsonDocument::fromJson(body, &err);
+        if( err.error != QJsonParseError::NoError || !doc.isObject() )
+        {
+            respondError( QJsonValue(), ParseError, err.errorString() );
+            continue;
+        }
+        msg = doc.object();
+        return true;
+    }
+}
+
+void LspServer::write(const QJsonObject& msg)
+{
+    QJsonObject o = msg;
+    o.insert("jsonrpc", "2.0");
+    const QByteArray body = QJsonDocument(o).toJson(QJsonDocument::Compact);
+    d_out->write( "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" );
+    d_out->write( body );
+    if( QFile* f = qobject_cast<QFile*>(d_out) )
+        f->flush();
+}
+
+void LspServer::respond(const QJsonValue& id, const QJsonValue& result)
+{
+    QJsonObject o;
+    o.insert("id", id);
+    o.insert("result", result);
+    write(o);
+}
+
+void LspServer::respondError(const QJsonValue& id, int code, const QString& msg)
+{
+    QJsonObject e;
+    e.insert("code", code);
+    e.insert("message", msg);
+    QJsonObject o;
+    o.insert("id", id.isUndefined() ? QJsonValue() : id);
+    o.insert("error", e);
+    write(o);
+}
+
+void LspServer::notify(const QString& method, const QJsonValue& params)
+{
+    QJsonObject o;
+    o.insert("method", method);
+    o.insert("params", params);
+    write(o);
+}
+
+void LspServer::dispatch(const QJsonObject& msg)
+{
+    const QString method = msg.value("method").toString();
+    const QJsonValue id = msg.value("id");
+    const bool isRequest = !id.isUndefined() && !id.isNull();
+    const QJsonObject params = msg.value("params").toObject();
+
+    if( method.isEmpty() )
+        return; // a response to a server request; we send none
+    if( d_shutdown && isRequest )
+        respondError( id, InvalidRequest, "server is shutting down" );
+    else if( method == "initialize" )
+        respond( id, initialize(params) );
+    else if( method == "initialized" )
+        publishDiagnostics();
+    else if( method == "shutdown" )
+    {
+        d_shutdown = true;
+        respond( id, QJsonValue() );
+    }else if( method == "textDocument/didOpen" )
+        didOpen(params);
+    else if( method == "textDocument/didChange" )
+        didChange(params);
+    else if( method == "textDocument/didSave" )
+        didSave(params);
+    else if( method == "textDocument/didClose" )
+        didClose(params);
+    else if( method == "textDocument/definition" )
+        respond( id, definition(params) );
+    else if( method == "textDocument/references" )
+        respond( id, references(params) );
+    else if( method == "textDocument/documentSymbol" )
+        respond( id, documentSymbol(params) );
+    else if( isRequest )
+        respondError( id, MethodNotFound, QString("method not supported: %1").arg(method) );
+    // else unknown notifications are ignored
+}
+
+QJsonObject LspServer::initialize(const QJsonObject& params)
+{
+    if( d_pro->getFiles().isEmpty() )
+    {
+        // no project given on the command line; use the project file or the sources of the workspace
+        const QString root = toPath( params.value("rootUri").toString() );
+        QDir dir( root.isEmpty() ? params.value("rootPath").toString() : root );
+        const QStringList pros = dir.entryList( QStringList() << "*.obxpro", QDir::Files, QDir::Name );
+        if( !pros.isEmpty() )
+            d_pro->loadFrom( dir.absoluteFilePath(pros.first()) );
+        else if( dir.exists() )
+            d_pro->initializeFromDir( dir, true );
+        d_pro->parse(); // diagnostics follow the initialized notification
+    }
+
+    QJsonObject sync;
+    sync.insert("openClose", true);
+    sync.insert("change", 1); // full text
+    QJsonObject save;
+    save.insert("includeText", false);
+    sync.insert("save", save);
+
+    QJsonObject caps;
+    caps.insert("textDocumentSync", sync);
+    caps.insert("definitionProvider", true);
+    caps.insert("referencesProvider", true);
+    caps.insert("documentSymbolProvider", true);
+
+    QJsonObject info;
+    info.insert("name", "OBXLSP");
+
+    QJsonObject res;
+    res.insert("capabilities", caps);
+    res.insert("serverInfo", info);
+    return res;
+}
+
+void LspServer::didOpen(const QJsonObject& params)
+{
+    const QJsonObject doc = params.value("textDocument").toObject();
+    const QString path = toPath(doc.value("uri").toString());
+    const QByteArray text = doc.value("text").toString().toUtf8();
+    QFile f(path);
+    if( !d_unsaved.contains(path) && f.open(QIODevice::ReadOnly) && f.readAll() == text )
+        return; // the model was parsed from the same text
+    d_pro->getFc()->addFile(path, text);
+    d_unsaved.insert(path);
+    d_pending = true;
+}
+
+void LspServer::didChange(const QJsonObject& params)
+{
+    const QString path = toPath(params.value("textDocument").toObject().value("uri").toString());
+    const QJsonArray changes = params.value("contentChanges").toArray();
+    if( changes.isEmpty() )
+        return;
+    d_pro->getFc()->addFile(path, changes.last().toObject().value("text").toString().toUtf8() );
+    d_unsaved.insert(path);
+    d_pending = true;
+}
+
+void LspServer::didSave(const QJsonObject& params)
+{
+    const QString path = toPath(params.value("textDocument").toObject().value("uri").toString());
+    // the file on disk is newer than the module now, so updateParse picks it up when it differs from the buffer
+    d_pro->getFc()->removeFile(path);
+    d_unsaved.remove(path);
+}
+
+void LspServer::didClose(const QJsonObject& params)
+{
+    const QString path = toPath(params.value("textDocument").toObject().value("uri").toString());
+    if( !d_unsaved.contains(path) )
+        return;
+    // the edits are dropped; the disk version is older than the module, so it has to go through the cache
+    d_unsaved.remove(path);
+    QFile f(path);
+    if( f.open(QIODevice::ReadOnly) )
+        d_pro->getFc()->addFile(path, f.readAll());
+    else
+        d_pro->getFc()->removeFile(path);
+    d_pending = true;
+}
+
+QJsonValue LspServer::definition(const QJsonObject& params)
+{
+    Expression* e = findSymbol(params);
+    if( e == 0 )
+        return QJsonValue();
+    Named* n = e->getIdent();
+    if( n == 0 )
+        return QJsonValue();
+    if( n->getTag() == Thing::T_Import )
+    {
+        Module* m = static_cast<Import*>(n)->d_mod.data();
+        if( m )
+            return location( m, m->d_loc, m->d_name.size() );
+    }
+    return location( n->getModule(), n->d_loc, n->d_name.size() );
+}
+
+QJsonValue LspServer::references(const QJsonObject& params)
+{
+    Expression* hit = findSymbol(params);
+    if( hit == 0 || hit->getIdent() == 0 )
+        return QJsonValue();
+    Named* n = hit->getIdent();
+    QJsonArray res;
+    QSet<QString> seen; // generic instances repeat the uses of their template
+    if( params.value("context").toObject().value("includeDeclaration").toBool() )
+    {
+        const QJsonValue decl = location( n->getModule(), n->d_loc, n->d_name.size() );
+        if( decl.isObject() )
+        {
+            res.append(decl);
+            seen.insert( QString("%1:%2:%3").arg(n->getModule()->d_file).arg(n->d_loc.d_row).arg(n->d_loc.d_col) );
+        }
+    }
+    const ExpList uses = d_pro->getUsage(n);
+    foreach( const Ref<Expression>& e, uses )
+    {
+        Module* m = e->getModule();
+        if( m == 0 )
+            continue;
+        const QString key = QString("%1:%2:%3").arg(m->d_file).arg(e->d_loc.d_row).arg(e->d_loc.d_col);
+        if( seen.contains(key) )
+            continue;
+        seen.insert(key);
+        const QJsonValue loc = location( m, e->d_loc, n->d_name.size() );
+        if( loc.isObject() )
+            res.append(loc);
+    }
+    return res;
+}
+
+QJsonValue LspServer::documentSymbol(const QJsonObject& params)
+{
+    const QString path = toPath(params.value("textDocument").toObject().value("uri").toString());
+    Project::FileMod f = d_pro->findFile(path);
+    if( f.second == 0 )
+        return QJsonValue();
+    QJsonArray res;
+    foreach( const Ref<Named>& n, f.second->d_order )
+    {
+        const QJsonObject s = symbol(n.data());
+        if( !s.isEmpty() )
+            res.append(s);
+    }
+    return res;
+}
+
+void LspServer::flush()
+{
+    if( !d_pending )
+        return;
+    d_pending = false;
+    reparse(true);
+}
+
+void LspServer::reparse(bool incremental)
+{
+    QElapsedTimer timer;
+    timer.start();
+    d_pro->parse(incremental);
+    if( d_verbose )
+        qDebug() << ( incremental ? "reparsed" : "parsed" ) << d_pro->getFiles().size() << "files in"
+                 << timer.elapsed() << "[ms]";
+    publishDiagnostics();
+}
+
+void LspServer::publishDiagnostics()
+{
+    QHash<QString,QJsonArray> diags;
+    foreach( const Errors::Entry& e, d_pro->getErrs()->getErrors() )
+    {
+        QJsonObject d;
+        const RowCol pos( qMax(e.d_line,quint32(1)), qMax(e.d_col,quint16(1)) );
+        d.insert("range", range(pos, pos) );
+        d.insert("severity", e.d_isErr ? 1 : 2 );
+        d.insert("source", "obx");
+        d.insert("message", e.d_msg );
+        diags[e.d_file].append(d);
+    }
+    QSet<QString> published;
+    QHash<QString,QJsonArray>::const_iterator i;
+    for( i = diags.begin(); i != diags.end(); ++i )
+    {
+        bool found = false;
+        const FileCache::Entry fe = d_pro->getFc()->getFile(i.key(), &found);
+        if( i.key().isEmpty() || ( found && fe.d_isModuleName ) )
+            continue; // built-in definitions have no file
+        QJsonObject p;
+        p.insert("uri", toUri(i.key()) );
+        p.insert("diagnostics", i.value() );
+        notify("textDocument/publishDiagnostics", p );
+        published.insert(i.key());
+    }
+    foreach( const QString& path, d_diagnosed )
+    {
+        if( published.contains(path) )
+            continue;
+        QJsonObject p;
+        p.insert("uri", toUri(path) );
+        p.insert("diagnostics", QJsonArray() );
+        notify("textDocument/publishDiagnostics", p );
+    }
+    d_diagnosed = published;
+}
+
+Expression* LspServer::findSymbol(const QJsonObject& params) const
+{
+    const QString path = toPath(params.value("textDocument").toObject().value("uri").toString());
+    const QJsonObject pos = params.value("position").toObject();
+    return d_pro->findSymbolBySourcePos( path, pos.value("line").toInt() + 1, pos.value("character").toInt() + 1 );
+}
+
+QJsonValue LspServer::location(Module* m, const RowCol& loc, int len) const
+{
+    if( m == 0 || m->d_file.isEmpty() || !loc.isValid() )
+        return QJsonValue();
+    bool found = false;
+    const FileCache::Entry fe = d_pro->getFc()->getFile(m->d_file, &found);
+    if( found && fe.d_isModuleName )
+        return QJsonValue();
+    RowCol to = loc;
+    to.d_col += len;
+    QJsonObject res;
+    res.insert("uri", toUri(m->d_file) );
+    res.insert("range", range(loc, to) );
+    return res;
+}
+
+QJsonObject LspServer::symbol(Named* n) const
+{
+    if( n == 0 || n->d_synthetic || !n->d_loc.isValid() )
+        return QJsonObject();
+    int kind = 0;
+    QJsonArray children;
+    RowCol end = n->d_loc;
+    end.d_col += n->d_name.size();
+    switch( n->getTag() )
+    {
+    case Thing::T_Procedure:
+        {
+            Procedure* p = static_cast<Procedure*>(n);
+            kind = p->d_receiver.isNull() ? SkFunction : SkMethod;
+            if( p->d_end.isValid() )
+                end = p->d_end;
+            foreach( const Ref<Named>& sub, p->d_order )
+            {
+                if( sub->getTag() == Thing::T_Procedure || sub->getTag() == Thing::T_NamedType ||
+                        sub->getTag() == Thing::T_Const )
+                {
+                    const QJsonObject s = symbol(sub.data());
+                    if( !s.isEmpty() )
+                        children.append(s);
+                }
+            }
+        }
+        break;
+    case Thing::T_NamedType:
+        kind = !n->d_type.isNull() && n->d_type->getTag() == Thing::T_Record ? SkStruct : SkClass;
+        break;
+    case Thing::T_Const:
+        kind = SkConstant;
+        break;
+    case Thing::T_Variable:
+        kind = SkVariable;
+        break;
+    case Thing::T_Module:
+        kind = SkModule;
+        break;
+    default:
+        return QJsonObject(); // imports, locals and parameters
+    }
+    RowCol selEnd = n->d_loc;
+    selEnd.d_col += n->d_name.size();
+    QJsonObject res;
+    res.insert("name", QString::fromUtf8(n->d_name) );
+    res.insert("kind", kind );
+    res.insert("range", range(n->d_loc, end) );
+    res.insert("selectionRange", range(n->d_loc, selEnd) );
+    if( !children.isEmpty() )
+        res.insert("children", children );
+    return res;
+}
+
+QString LspServer::toPath(const QString& uri)
+{
+    const QUrl url(uri);
+    if( url.isLocalFile() )
+        return QFileInfo(url.toLocalFile()).absoluteFilePath();
+    return uri;
+}
+
+QString LspServer::toUri(const QString& path)
+{
+    return QUrl::fromLocalFile(path).toString();
+}
+
+QJsonObject LspServer::range(const RowCol& from, const RowCol& to)
+{
+    // LSP positions are zero based
+    QJsonObject start;
+    start.insert("line", int(from.d_row) - 1 );
+    start.insert("character", int(from.d_col) - 1 );
+    QJsonObject end;
+    end.insert("line", int(to.d_row) - 1 );
+    end.insert("character", int(to.d_col) - 1 );
+    QJsonObject res;
+    res.insert("start", start);
+    res.insert("end", end);
+    return res;
+}
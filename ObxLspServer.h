@@ -0,0 +1,85 @@
+#ifndef OBXLSPSERVER_H
+#define OBXLSPSERVER_H
+
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSet>
+#include <Oberon/ObxAst.h>
+
+class QIODevice;
+
+namespace Obx
+{
+    class Project;
+
+    class LspServer
+    {
+        // Speaks the Language Server Protocol (JSON-RPC with Content-Length framing) over a pair of devices,
+        // usually stdin/stdout. The project stays parsed between requests; edits go to the FileCache and
+        // are picked up by Project::parse(true), i.e. Model::updateParse. The reparse after an edit is deferred
+        // until a request arrives or no input arrives for a moment.
+    public:
+        LspServer( Project*, QIODevice* in, QIODevice* out );
+        int run(); // returns when the client sends exit or closes the input
+        void setVerbose( bool on ) { d_verbose = on; }
+
+    protected:
+        bool waitForInput( int msecs ); // false if no input arrived within msecs
+        bool readMessage( QJsonObject& );
+        void write( const QJsonObject& );
+        void respond( const QJsonValue& id, const QJsonValue& result );
+        void respondError( const QJsonValue& id, int code, const QString& msg );
+        void notify( const QString& method, const QJsonValue& params );
+        void dispatch( const QJsonObject& );
+
+        QJsonObject initialize( const QJsonObject& params );
+        void didOpen( const QJsonObject& params );
+        void didChange( const QJsonObject& params );
+        void didSave( const QJsonObject& params );
+        void didClose( const QJsonObject& params );
+        QJsonValue definition( const QJsonObject& params );
+        QJsonValue references( const QJsonObject& params );
+        QJsonValue documentSymbol( const QJsonObject& params );
+
+        void reparse( bool incremental );
+        void flush(); // the deferred reparse, if any
+        void publishDiagnostics();
+        Expression* findSymbol( const QJsonObject& params ) const;
+        QJsonValue location( Module*, const Ob::RowCol&, int len ) const;
+        QJsonObject symbol( Named* ) const;
+
+        static QString toPath( const QString& uri );
+        static QString toUri( const QString& path );
+        static QJsonObject range( const Ob::RowCol& from, const Ob::RowCol& to );
+    private:
+        Project* d_pro;
+        QIODevice* d_in;
+        QIODevice* d_out;
+        QSet<QString> d_unsaved; // files open with edits not written to disk
+        QSet<QString> d_diagnosed; // files for which diagnostics were last published
+        bool d_shutdown;
+        bool d_verbose;
+        bool d_pending; // edits not yet reparsed
+    };
+}
+
+#endif // OBXLSPSERVER_H
@@ -23,6 +23,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QThread>
 #ifndef QT_NO_PROCESS
 #include <QProcess>
 #endif
@@ -32,6 +33,12 @@
 #include "ObxCilGen.h"
 #include "ObFileCache.h"
 #include "ObxCGen2.h"
+#include "ObxTrace.h"
+#ifndef OBX_NO_MC_SERVER
+#include "ObxMcServer.h"
+#else
+namespace Obx { class McServer; }
+#endif
 
 
 static QStringList collectFiles( const QDir& dir )
@@ -56,6 +63,30 @@ static QStringList collectFiles( const QDir& dir )
     return res;
 }
 
+static void reportTrace( const QString& path, QTextStream& out )
+{
+    if( !Obx::Trace::isEnabled() )
+        return;
+    Obx::Trace::printSummary(out);
+    if( path.isEmpty() )
+        return;
+    if( Obx::Trace::write(path) )
+        out << "trace written to " << path << endl;
+    else
+        qCritical() << "cannot write trace to" << path;
+}
+
+static void listGenerated( const QString& outPath, const QDateTime& since, QTextStream& out )
+{
+    // the files written by the code generator, for the -remote client
+    const QFileInfoList files = QDir(outPath).entryInfoList( QDir::Files, QDir::Name );
+    foreach( const QFileInfo& f, files )
+    {
+        if( f.lastModified().toMSecsSinceEpoch() / 1000 >= since.toMSecsSinceEpoch() / 1000 ) // whole seconds on some file systems
+            out << "generated " << f.absoluteFilePath() << endl;
+    }
+}
+
 static bool preloadLib( Obx::Project* pro, const QByteArray& name )
 {
     QFile f( QString(":/oakwood/%1.Def" ).arg(name.constData() ) );
@@ -68,44 +99,26 @@ static bool preloadLib( Obx::Project* pro, const QByteArray& name )
     return true;
 }
 
-int main(int argc, char *argv[])
+static int compile( const QStringList& args, QTextStream& out, QTextStream& err, Obx::McServer* server )
 {
-    QCoreApplication a(argc, argv);
-
-    a.setOrganizationName("Rochus Keller");
-    a.setOrganizationDomain("https://github.com/rochus-keller/Oberon");
-    a.setApplicationName("OBXMC");
-    a.setApplicationVersion("2024-03-13");
-
-    QTextStream out(stdout);
-    QTextStream err(stderr);
-    out << "OBXMC version: " << a.applicationVersion() <<
-                 " author: me@rochus-keller.ch  license: GPL" << endl;
-
-
-    Obx::Project pro;
-
+    // server is null if OBXMC compiles in-process, otherwise the project is kept for the next request
     QStringList dirOrFilePaths;
     QByteArrayList options;
     QString outPath;
-    QStringList args = QCoreApplication::arguments();
+    QString tracePath;
+    QStringList keyArgs; // the options which determine the project and its front end
+    Obx::Project::ModProc modProc;
+    int threads = 1;
+    bool oak = false;
+    bool obs = false;
+    bool int16 = false;
     bool genAsm = false;
     bool run = false;
     bool build = false;
     bool debug = false;
     bool genC = false;
-    if( args.size() <= 1 )
-    {
-        // if there are no args look in the application directory for a file called obxljconfig which includes
-        // the command line ("" sections not supported); this is useful e.g. on macOS to include the bytecode in the bundle
-        QStringList newArgs;
-        newArgs.append( args.isEmpty() ? QString(): args.first() );
-        QFile config(QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("obxljconfig"));
-        if( config.open(QIODevice::ReadOnly) )
-            newArgs += QString::fromUtf8(
-                        config.readAll().simplified()).split(' '); // RISK: this also affects whitespace included in " "
-        args = newArgs;
-    }
+    bool optimize = false;
+    bool trace = false;
     for( int i = 1; i < args.size(); i++ ) // arg 0 enthaelt Anwendungspfad
     {
         if(  args[i] == "-h" || args.size() == 1 )
@@ -121,6 +134,13 @@ int main(int argc, char *argv[])
             out << "  -build        run the generated build.sh script (Linux only)" << endl;
             out << "  -run          run the generated run.sh script (Linux only)" << endl;
             out << "  -c            generate C code (CIL otherwise)" << endl;
+            out << "  -O            inline small procedures, propagate constants, remove dead code and common subexpressions," << endl;
+            out << "                call type-bound procedures directly if the program has no override" << endl;
+            out << "  -jN           parse the source files with N parallel threads (-j: one per core)" << endl;
+            out << "  -trace[=file] report the time per compiler phase and module, optionally as Chrome trace JSON," << endl;
+            out << "                and with -O the share of devirtualized type-bound calls per module" << endl;
+            out << "  -server[=name] stay resident and compile the command lines sent by -remote on a local socket" << endl;
+            out << "  -remote[=name] let the resident OBXMC compile the command line (compiles in-process if none)" << endl;
             out << "  the following options are overridden if a project file is loaded" << endl;
             out << "  -main=A[.B]   run module A or procedure B in module A and quit" << endl;
             out << "  -oak          use built-in oakwood definitions" << endl;
@@ -128,21 +148,48 @@ int main(int argc, char *argv[])
             out << "  -int16        INTEGER is mapped to INT16 instead of INT32" << endl;
             return 0;
         }else if( args[i] == "-oak" )
-            pro.setUseBuiltInOakwood(true);
-        else if( args[i] == "-obs" )
-            pro.setUseBuiltInObSysInner(true);
-        else if( args[i] == "-asm" )
+        {
+            oak = true;
+            keyArgs << args[i];
+        }else if( args[i] == "-obs" )
+        {
+            obs = true;
+            keyArgs << args[i];
+        }else if( args[i] == "-asm" )
             genAsm = true;
         else if( args[i] == "-run" )
             run = true;
         else if( args[i] == "-int16" )
-            pro.setInt16(true);
-        else if( args[i] == "-debug" )
+        {
+            int16 = true;
+            keyArgs << args[i];
+        }else if( args[i] == "-debug" )
             debug = true;
         else if( args[i] == "-build" )
             build = true;
         else if( args[i] == "-c" )
             genC = true;
+        else if( args[i] == "-O" )
+            optimize = true;
+        else if( args[i] == "-j" )
+            threads = QThread::idealThreadCount();
+        else if( args[i].startsWith("-j") )
+        {
+            bool ok;
+            const int n = args[i].mid(2).toInt(&ok);
+            if( !ok || n < 1 )
+            {
+                err << "invalid -j option" << endl;
+                return -1;
+            }
+            threads = n;
+        }
+        else if( args[i] == "-trace" || args[i].startsWith("-trace=") )
+        {
+            trace = true;
+            if( args[i].startsWith("-trace=") )
+                tracePath = QDir::current().absoluteFilePath(args[i].mid(7));
+        }
         else if( args[i].startsWith("-out=") )
         {
             outPath = args[i].mid(5);
@@ -152,6 +199,7 @@ int main(int argc, char *argv[])
         }else if( args[i].startsWith("-set:") )
         {
             options << args[i].mid(5).toUtf8();
+            keyArgs << args[i];
         }else if( args[i].startsWith("-run=") )
         {
             QStringList run = args[i].mid(5).split('.');
@@ -160,17 +208,17 @@ int main(int argc, char *argv[])
                 err << "invalid -run option" << endl;
                 return -1;
             }
-            Obx::Project::ModProc modProc;
             if( run.size() == 2 )
             {
                 modProc.first = run[0].toUtf8();
                 modProc.second = run[1].toUtf8();
             }else
                 modProc.first = run[0].toUtf8();
-            pro.setMain(modProc);
+            keyArgs << args[i];
         }else if( !args[ i ].startsWith( '-' ) )
         {
             dirOrFilePaths += args[ i ];
+            keyArgs << args[i];
         }else
         {
             err << "error: invalid command line option " << args[i] << endl;
@@ -182,6 +230,7 @@ int main(int argc, char *argv[])
         out << "no file or directory to process; quitting (use -h option for help)" << endl;
         return -1;
     }
+    Obx::Trace::setEnabled(trace);
 
 #if 0 // #ifndef _DEBUG
     if( !genAsm )
@@ -207,44 +256,98 @@ int main(int argc, char *argv[])
         }
     }
     pl << p;
-    if( !pfile.isEmpty() )
+    if( !pfile.isEmpty() && !p.d_files.isEmpty() )
+    {
+        err << "expecting either a project file or source files/directories, but not both" << endl;
+        return -1;
+    }
+
+    QScopedPointer<Obx::Project> local;
+    Obx::Project* pro;
+    bool incremental = false;
+#ifndef OBX_NO_MC_SERVER
+    Obx::McServer::Target* target = 0;
+    if( server )
     {
-        if( !p.d_files.isEmpty() )
+        // the same command line in the same directory reuses the project unless files were added or removed
+        target = &server->getTarget( QDir::currentPath() + '\n' + keyArgs.join('\n') );
+        const QDateTime proFileTime = pfile.isEmpty() ? QDateTime() : QFileInfo(pfile).lastModified();
+        if( target->d_pro && target->d_parsed && target->d_files == p.d_files &&
+                target->d_proFileTime == proFileTime )
+            incremental = true;
+        else
         {
-            err << "expecting either a project file or source files/directories, but not both" << endl;
-            return -1;
+            delete target->d_pro;
+            target->d_pro = new Obx::Project();
+            target->d_files = p.d_files;
+            target->d_proFileTime = proFileTime;
+            target->d_parsed = false;
         }
-        qDebug() << "loading project" << pfile;
-        if( !pro.loadFrom(pfile) ) // This overrides most command line settings!
-            return -1;
+        pro = target->d_pro;
     }else
+#endif
     {
-        qDebug() << "processing" << p.d_files.size() << "files...";
-        pro.initializeFromPackageList(pl);
+        local.reset( new Obx::Project() );
+        pro = local.data();
     }
+    pro->getMdl()->setThreadCount(threads);
+    pro->setOptimize(optimize);
 
-    if( pro.useBuiltInOakwood() )
+    if( !incremental )
     {
-        preloadLib(&pro,"In");
-        preloadLib(&pro,"Out");
-        preloadLib(&pro,"Files");
-        preloadLib(&pro,"Input");
-        preloadLib(&pro,"Math");
-        preloadLib(&pro,"MathL");
-        preloadLib(&pro,"Strings");
-        preloadLib(&pro,"Coroutines");
-        preloadLib(&pro,"XYPlane");
-    }
+        pro->setUseBuiltInOakwood(oak);
+        pro->setUseBuiltInObSysInner(obs);
+        pro->setInt16(int16);
+        if( !modProc.first.isEmpty() )
+            pro->setMain(modProc);
+        if( !pfile.isEmpty() )
+        {
+            qDebug() << "loading project" << pfile;
+            if( !pro->loadFrom(pfile) ) // This overrides most command line settings!
+                return -1;
+        }else
+        {
+            qDebug() << "processing" << p.d_files.size() << "files...";
+            pro->initializeFromPackageList(pl);
+        }
+
+        if( pro->useBuiltInOakwood() )
+        {
+            preloadLib(pro,"In");
+            preloadLib(pro,"Out");
+            preloadLib(pro,"Files");
+            preloadLib(pro,"Input");
+            preloadLib(pro,"Math");
+            preloadLib(pro,"MathL");
+            preloadLib(pro,"Strings");
+            preloadLib(pro,"Coroutines");
+            preloadLib(pro,"XYPlane");
+        }
+    }else
+        qDebug() << "updating" << pro->getFiles().size() << "files...";
 
     QTime start = QTime::currentTime();
-    pro.setOptions(options);
-    if( !pro.parse() )
+    if( !incremental )
+        pro->setOptions(options);
+    const bool parsed = pro->parse(incremental);
+#ifndef OBX_NO_MC_SERVER
+    if( target )
+        target->d_parsed = parsed;
+#endif
+    if( !parsed )
+    {
+        reportTrace(tracePath, out);
         return -1;
+    }
     qDebug() << "recompiled in" << start.msecsTo(QTime::currentTime()) << "[ms]";
     start = QTime::currentTime();
+    const QDateTime genStart = QDateTime::currentDateTime();
     if( genC )
     {
-        Obx::CGen2::translateAll(&pro, debug, outPath);
+        Obx::CGen2::translateAll(pro, debug, outPath);
+        reportTrace(tracePath, out);
+        if( server )
+            listGenerated(outPath, genStart, out);
     }else
     {
         Obx::CilGen::How how;
@@ -252,29 +355,102 @@ int main(int argc, char *argv[])
             how = Obx::CilGen::Ilasm;
         else
             how = Obx::CilGen::Pelib;
-        Obx::CilGen::translateAll(&pro, how, debug, outPath );
+        Obx::CilGen::translateAll(pro, how, debug, outPath );
         qDebug() << "translated in" << start.msecsTo(QTime::currentTime()) << "[ms]";
+        reportTrace(tracePath, out);
+        if( server )
+            listGenerated(outPath, genStart, out);
         QDir::setCurrent(outPath);
         QDir dir(outPath);
         if( build && genAsm )
         {
-#ifndef QT_NO_PROCESS
-            start = QTime::currentTime();
             const QString path = dir.absoluteFilePath("build.sh");
-            if( QProcess::execute(path) < 0 )
-                return -1;
-            qDebug() << "built with ilasm in" << start.msecsTo(QTime::currentTime()) << "[ms]";
+#ifndef OBX_NO_MC_SERVER
+            if( server )
+                server->execute(path); // by the client, so that the output goes to its console
+            else
 #endif
+            {
+#ifndef QT_NO_PROCESS
+                start = QTime::currentTime();
+                if( QProcess::execute(path) < 0 )
+                    return -1;
+                qDebug() << "built with ilasm in" << start.msecsTo(QTime::currentTime()) << "[ms]";
+#endif
+            }
         }
         if( run )
         {
-#ifndef QT_NO_PROCESS
             const QString path = dir.absoluteFilePath("run.sh");
-            if( QProcess::execute(path) < 0 )
-                return -1;
+#ifndef OBX_NO_MC_SERVER
+            if( server )
+                server->execute(path);
+            else
+#endif
+            {
+#ifndef QT_NO_PROCESS
+                if( QProcess::execute(path) < 0 )
+                    return -1;
 #endif
+            }
         }
     }
 
     return 0;
 }
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName("Rochus Keller");
+    a.setOrganizationDomain("https://github.com/rochus-keller/Oberon");
+    a.setApplicationName("OBXMC");
+    a.setApplicationVersion("2024-03-13");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    out << "OBXMC version: " << a.applicationVersion() <<
+                 " author: me@rochus-keller.ch  license: GPL" << endl;
+
+    QStringList args = QCoreApplication::arguments();
+    if( args.size() <= 1 )
+    {
+        // if there are no args look in the application directory for a file called obxljconfig which includes
+        // the command line ("" sections not supported); this is useful e.g. on macOS to include the bytecode in the bundle
+        QStringList newArgs;
+        newArgs.append( args.isEmpty() ? QString(): args.first() );
+        QFile config(QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("obxljconfig"));
+        if( config.open(QIODevice::ReadOnly) )
+            newArgs += QString::fromUtf8(
+                        config.readAll().simplified()).split(' '); // RISK: this also affects whitespace included in " "
+        args = newArgs;
+    }
+
+#ifndef OBX_NO_MC_SERVER
+    for( int i = 1; i < args.size(); i++ )
+    {
+        if( args[i] == "-server" || args[i].startsWith("-server=") )
+        {
+            const QString name = args[i].startsWith("-server=") ? args[i].mid(8) : Obx::McServer::defaultName();
+            Obx::McServer server(compile);
+            if( !server.listen(name) )
+                return -1;
+            out << "listening on " << name << endl;
+            return a.exec();
+        }else if( args[i] == "-remote" || args[i].startsWith("-remote=") )
+        {
+            const QString name = args[i].startsWith("-remote=") ? args[i].mid(8) : Obx::McServer::defaultName();
+            args.removeAt(i);
+            bool connected;
+            const int res = Obx::McServer::forward(name, args, out, err, &connected);
+            if( connected )
+                return res;
+            qDebug() << "no OBXMC server on" << name << "; compiling in-process";
+            break;
+        }
+    }
+#endif
+
+    return compile(args, out, err, 0);
+}
@@ -0,0 +1,435 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon to Mono CLI compiler.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ObxMcServer.h"
+#include "ObxProject.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutex>
+#include <QThread>
+#include <QtEndian>
+#include <QStandardPaths>
+#include <QtDebug>
+#ifndef QT_NO_PROCESS
+#include <QProcess>
+#endif
+#include <stdio.h>
+#ifdef Q_OS_UNIX
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace Obx;
+
+static const quint32 s_maxFrame = 64 * 1024 * 1024; // larger length fields are taken as garbage
+
+// while a request is served all messages (qDebug, errors reported to console, etc.) go to the client;
+// messages from worker threads are collected and sent by the main thread
+static QMutex s_msgLock;
+static QByteArray s_pending;
+static McServer* s_serving = 0;
+static QtMessageHandler s_prevHandler = 0;
+
+static void forwardMessage( QtMsgType type, const QMessageLogContext& ctx, const QString& msg )
+{
+    McServer* server;
+    {
+        QMutexLocker lock(&s_msgLock);
+        server = s_serving;
+        if( server )
+            s_pending += msg.toUtf8() + '\n';
+    }
+    if( server == 0 )
+    {
+        if( s_prevHandler )
+            s_prevHandler(type, ctx, msg);
+        else
+            fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+    }else if( QThread::currentThread() == server->thread() )
+        server->flushMessages();
+}
+
+class McChannel : public QIODevice
+{
+public:
+    McChannel( McServer* server, quint8 kind ):d_server(server),d_kind(kind)
+    {
+        open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+protected:
+    qint64 readData(char*, qint64) { return -1; }
+    qint64 writeData(const char* data, qint64 len)
+    {
+        d_server->send( d_kind, QByteArray(data,len) );
+        return len;
+    }
+private:
+    McServer* d_server;
+    quint8 d_kind;
+};
+
+#ifdef Q_OS_UNIX
+static QString privateDir()
+{
+    // the socket lives in a directory only the user can enter, so nobody else can bind the name first or
+    // replace the socket; RuntimeLocation (XDG_RUNTIME_DIR) is such a directory already, /tmp is not
+    QString base = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if( base.isEmpty() )
+        base = QDir::tempPath();
+    const QByteArray dir = QFile::encodeName( QString("%1/obxmc-%2").arg(base).arg(::getuid()) );
+    ::mkdir( dir.constData(), 0700 );
+    struct stat st;
+    if( ::lstat( dir.constData(), &st ) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != ::getuid()
+            || ( st.st_mode & 077 ) != 0 )
+    {
+        qCritical() << "cannot use" << dir << "for the OBXMC socket; it must be a directory private to the user";
+        return QString();
+    }
+    return QFile::decodeName(dir);
+}
+
+static bool isSameUser( QLocalSocket* s )
+{
+    const int fd = int(s->socketDescriptor());
+    if( fd < 0 )
+        return false;
+#ifdef SO_PEERCRED
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if( ::getsockopt( fd, SOL_SOCKET, SO_PEERCRED, &cred, &len ) != 0 )
+        return false;
+    return cred.uid == ::getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    if( ::getpeereid( fd, &uid, &gid ) != 0 )
+        return false;
+    return uid == ::getuid();
+#endif
+}
+#endif
+
+static QString socketPath( const QString& name )
+{
+#ifdef Q_OS_UNIX
+    if( QFileInfo(name).isAbsolute() )
+        return name;
+    const QString dir = privateDir();
+    if( dir.isEmpty() )
+        return QString();
+    return dir + "/" + name;
+#else
+    return name;
+#endif
+}
+
+McServer::McServer(Handler h, QObject* parent):QObject(parent),d_handler(h),d_client(0)
+{
+    d_server = new QLocalServer(this);
+    d_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect( d_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()) );
+    s_prevHandler = qInstallMessageHandler(forwardMessage);
+}
+
+McServer::~McServer()
+{
+    qInstallMessageHandler(s_prevHandler);
+    foreach( const Target& t, d_targets )
+        delete t.d_pro;
+}
+
+bool McServer::listen(const QString& name)
+{
+    const QString path = socketPath(name);
+    if( path.isEmpty() )
+        return false;
+#ifdef Q_OS_UNIX
+    QLocalSocket probe;
+    probe.connectToServer(path);
+    if( probe.waitForConnected(1000) )
+    {
+        qCritical() << "another OBXMC server already listens on" << path;
+        return false;
+    }
+    if( QFileInfo(name).isRelative() )
+        QLocalServer::removeServer(path); // a stale socket of a server which was killed; only in our own directory
+#endif
+    if( !d_server->listen(path) )
+    {
+        qCritical() << "cannot listen on" << path << d_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+McServer::Target&McServer::getTarget(const QString& key)
+{
+    return d_targets[key];
+}
+
+void McServer::execute(const QString& script)
+{
+    send( Execute, script.toUtf8() );
+}
+
+QString McServer::defaultName()
+{
+    QByteArray user = qgetenv("USER");
+    if( user.isEmpty() )
+        user = qgetenv("USERNAME");
+    return QString("OBXMC-%1").arg( QString::fromLocal8Bit(user) ); // put into privateDir() on Unix
+}
+
+int McServer::forward(const QString& name, const QStringList& args, QTextStream& out, QTextStream& err,
+                      bool* connected)
+{
+    *connected = false;
+    const QString path = socketPath(name);
+    if( path.isEmpty() )
+        return -1;
+    QLocalSocket s;
+    s.connectToServer(path);
+    if( !s.waitForConnected(1000) )
+        return -1;
+#ifdef Q_OS_UNIX
+    if( !isSameUser(&s) )
+    {
+        err << "the OBXMC server on " << path << " belongs to another user; ignored" << endl;
+        return -1;
+    }
+#endif
+    *connected = true;
+
+    // the server may only ask for the scripts the command line requests, and each only once
+    QStringList scripts;
+    if( args.contains("-build") )
+        scripts << "build.sh";
+    if( args.contains("-run") )
+        scripts << "run.sh";
+
+    QByteArray req;
+    QDataStream ds(&req, QIODevice::WriteOnly);
+    ds << QDir::currentPath() << args;
+    writeFrame( &s, Request, req );
+
+    QByteArray buf;
+    bool failed = false;
+    while( true )
+    {
+        quint8 kind;
+        QByteArray data;
+        int res;
+        while( ( res = readFrame( buf, kind, data ) ) > 0 )
+        {
+            switch( kind )
+            {
+            case Out:
+                out << QString::fromUtf8(data);
+                out.flush();
+                break;
+            case Err:
+                err << QString::fromUtf8(data);
+                err.flush();
+                break;
+            case Execute:
+#ifndef QT_NO_PROCESS
+                if( !failed )
+                {
+                    const QFileInfo info( QString::fromUtf8(data) );
+                    if( !info.isAbsolute() || !info.isFile() || info.isSymLink()
+                            || !scripts.removeOne(info.fileName()) )
+                    {
+                        err << "refused to run " << info.filePath() << endl;
+                        failed = true;
+                        break;
+                    }
+                    QDir::setCurrent( info.absolutePath() );
+                    if( QProcess::execute(info.absoluteFilePath()) < 0 )
+                        failed = true;
+                }
+#endif
+                break;
+            case Exit:
+                return failed ? -1 : data.toInt();
+            }
+        }
+        if( res < 0 )
+        {
+            err << "invalid message from the OBXMC server" << endl;
+            return -1;
+        }
+        if( s.bytesAvailable() == 0 && !s.waitForReadyRead(-1) && s.bytesAvailable() == 0 )
+        {
+            err << "lost the connection to the OBXMC server" << endl;
+            return -1;
+        }
+        buf += s.readAll();
+    }
+}
+
+void McServer::writeFrame(QLocalSocket* s, quint8 kind, const QByteArray& data)
+{
+    // 4 bytes big endian length of data, 1 byte kind, data
+    uchar head[5];
+    qToBigEndian<quint32>( data.size(), head );
+    head[4] = kind;
+    s->write( (const char*)head, 5 );
+    s->write( data );
+    while( s->bytesToWrite() > 0 && s->waitForBytesWritten(-1) )
+        ;
+}
+
+int McServer::readFrame(QByteArray& buf, quint8& kind, QByteArray& data)
+{
+    if( buf.size() < 5 )
+        return 0;
+    const quint32 len = qFromBigEndian<quint32>( (const uchar*)buf.constData() );
+    if( len > s_maxFrame )
+        return -1;
+    if( quint32(buf.size()) - 5 < len )
+        return 0;
+    kind = buf[4];
+    data = buf.mid(5,len);
+    buf.remove(0,5+len);
+    return 1;
+}
+
+void McServer::send(quint8 kind, const QByteArray& data)
+{
+    flushMessages();
+    if( d_client )
+        writeFrame( d_client, kind, data );
+}
+
+void McServer::flushMessages()
+{
+    QByteArray msgs;
+    {
+        QMutexLocker lock(&s_msgLock);
+        msgs.swap(s_pending);
+    }
+    if( !msgs.isEmpty() && d_client )
+        writeFrame( d_client, Err, msgs );
+}
+
+void McServer::onNewConnection()
+{
+    while( d_server->hasPendingConnections() )
+    {
+        QLocalSocket* s = d_server->nextPendingConnection();
+#ifdef Q_OS_UNIX
+        if( !isSameUser(s) )
+        {
+            qWarning() << "rejected a connection from another user";
+            s->abort();
+            s->deleteLater();
+            continue;
+        }
+#endif
+        d_bufs[s] = QByteArray();
+        connect( s, SIGNAL(readyRead()), this, SLOT(onReadyRead()) );
+        connect( s, SIGNAL(disconnected()), this, SLOT(onDisconnected()) );
+        if( s->bytesAvailable() )
+            QMetaObject::invokeMethod( this, "onReadyRead", Qt::QueuedConnection );
+    }
+}
+
+void McServer::onReadyRead()
+{
+    QLocalSocket* s = qobject_cast<QLocalSocket*>(sender());
+    if( s == 0 || !d_bufs.contains(s) )
+    {
+        // queued from onNewConnection
+        foreach( QLocalSocket* c, d_bufs.keys() )
+        {
+            if( c->bytesAvailable() )
+            {
+                s = c;
+                break;
+            }
+        }
+        if( s == 0 )
+            return;
+    }
+    QByteArray& buf = d_bufs[s];
+    buf += s->readAll();
+    quint8 kind;
+    QByteArray data;
+    const int res = readFrame( buf, kind, data );
+    if( res > 0 && kind == Request )
+        handle( s, data );
+    else if( res != 0 )
+        s->disconnectFromServer();
+}
+
+void McServer::onDisconnected()
+{
+    QLocalSocket* s = qobject_cast<QLocalSocket*>(sender());
+    if( s == 0 )
+        return;
+    d_bufs.remove(s);
+    s->deleteLater();
+}
+
+void McServer::handle(QLocalSocket* s, const QByteArray& req)
+{
+    QDataStream in(req);
+    QString cwd;
+    QStringList args;
+    in >> cwd >> args;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QString home = QDir::currentPath();
+    QDir::setCurrent(cwd);
+    d_client = s;
+    {
+        QMutexLocker lock(&s_msgLock);
+        s_serving = this;
+    }
+
+    int res;
+    {
+        McChannel o(this,Out);
+        McChannel e(this,Err);
+        QTextStream out(&o);
+        QTextStream err(&e);
+        res = d_handler( args, out, err, this );
+        out.flush();
+        err.flush();
+    }
+
+    {
+        QMutexLocker lock(&s_msgLock);
+        s_serving = 0;
+    }
+    flushMessages();
+    writeFrame( s, Exit, QByteArray::number(res) );
+    d_client = 0;
+    QDir::setCurrent(home);
+    s->disconnectFromServer();
+    qDebug() << "served" << args.join(' ') << "in" << cwd << "in" << timer.elapsed() << "[ms]";
+}
@@ -0,0 +1,90 @@
+#ifndef OBXMCSERVER_H
+#define OBXMCSERVER_H
+
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon to Mono CLI compiler.
+*
+* The following is the license that applies to this copy of the
+* application. For a license to use the application under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
+
+class QLocalServer;
+class QLocalSocket;
+class QTextStream;
+
+namespace Obx
+{
+    class Project;
+
+    class McServer : public QObject
+    {
+        // Resident OBXMC: listens on a local socket (a Unix domain socket on Unix) and runs the command lines
+        // sent by McServer::forward one after the other. On Unix the socket is created in a directory only the
+        // user can access, and both ends check that the peer runs as the same user. The projects stay in memory between requests, so
+        // a rebuild only reparses the modules whose files changed (Model::updateParse).
+        Q_OBJECT
+    public:
+        struct Target
+        {
+            Project* d_pro;
+            QStringList d_files; // as expanded from the command line or the project file
+            QDateTime d_proFileTime;
+            bool d_parsed;
+            Target():d_pro(0),d_parsed(false){}
+        };
+
+        // runs a command line; out and err go to the client
+        typedef int (*Handler)( const QStringList& args, QTextStream& out, QTextStream& err, McServer* );
+
+        McServer( Handler, QObject* parent = 0 );
+        ~McServer();
+        bool listen( const QString& name );
+        Target& getTarget( const QString& key ); // the project of key is created by the handler
+        void execute( const QString& script ); // asks the client to run script, e.g. build.sh
+
+        static QString defaultName();
+        // sends args to the server and prints its output; returns the exit code of the command line,
+        // or -1 with connected == false if no server listens on name
+        static int forward( const QString& name, const QStringList& args, QTextStream& out, QTextStream& err,
+                            bool* connected );
+
+        enum Frame { Request, Out, Err, Execute, Exit };
+        static void writeFrame( QLocalSocket*, quint8 kind, const QByteArray& );
+        // 1 if a frame was taken from buf, 0 if buf is still incomplete, -1 if buf holds no valid frame
+        static int readFrame( QByteArray& buf, quint8& kind, QByteArray& data );
+        void send( quint8 kind, const QByteArray& );
+        void flushMessages();
+    protected slots:
+        void onNewConnection();
+        void onReadyRead();
+        void onDisconnected();
+    protected:
+        void handle( QLocalSocket*, const QByteArray& );
+    private:
+        QLocalServer* d_server;
+        Handler d_handler;
+        QHash<QString,Target> d_targets;
+        QHash<QLocalSocket*,QByteArray> d_bufs;
+        QLocalSocket* d_client; // the one being served
+        bool d_busy;
+    };
+}
+
+#endif // OBXMCSERVER_H
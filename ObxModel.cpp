@@ -20,14 +20,19 @@
 #include "ObxModel.h"
 #include "ObErrors.h"
 #include "ObFileCache.h"
+#include "ObxTrace.h"
+#include "ObSymbolTable.h"
 #include "ObxValidator.h"
 #include "ObxEvaluator.h"
 #include <QBuffer>
 #include <QFile>
 #include <QDir>
 #include <QFileInfo>
+#include <QThreadPool>
+#include <QVector>
 #include <QtDebug>
 #include <qhash.h>
+#include <algorithm>
 #include <math.h>
 using namespace Obx;
 using namespace Ob;
@@ -44,6 +49,7 @@ struct Model::CrossReferencer : public AstVisitor
 {
     Module* d_mod;
     Model* d_mdl;
+    XRef* d_part;
     QList<Scope*> stack;
     QSet<Type*> visited;
 
@@ -51,16 +57,37 @@ struct Model::CrossReferencer : public AstVisitor
     {
         d_mod = mod;
         d_mdl = mdl;
+        d_part = &mdl->d_xrefParts[mod];
         if(mod)
             d_mod->accept(this);
     }
 
+    CrossReferencer(Model* mdl, Module* mod, Procedure* body)
+    {
+        // only the statements of a body parsed after mod was cross-referenced, see Model::materialize
+        d_mod = mod;
+        d_mdl = mdl;
+        d_part = &mdl->d_xrefParts[mod];
+        stack.push_back(body);
+        foreach( const Ref<Statement>& s, body->d_body )
+        {
+            if( !s.isNull() )
+                s->accept(this);
+        }
+    }
+
+    void add( Named* n, Expression* e )
+    {
+        d_mdl->d_xref[n].append(e);
+        (*d_part)[n].append(e);
+    }
+
     void visit( Module* me )
     {
         stack.push_back(me);
 
         me->d_helper << new IdentLeaf( me, me->d_loc,me, 0, DeclRole );
-        d_mdl->d_xref[me].append( me->d_helper.back().data() );
+        add( me, me->d_helper.back().data() );
 
         foreach( const Ref<Named>& n, me->d_order )
         {
@@ -76,7 +103,7 @@ struct Model::CrossReferencer : public AstVisitor
 
         // causes begin to highlight when module name is hit; not useful
         //me->d_helper << new IdentLeaf( me, me->d_begin ,d_mod, 0, DeclRole);
-        //d_mdl->d_xref[me].append( me->d_helper.back().data() );
+        //add( me, me->d_helper.back().data() );
 
         stack.pop_back();
     }
@@ -87,7 +114,7 @@ struct Model::CrossReferencer : public AstVisitor
 
         IdentLeaf* e1 = new IdentLeaf( me, me->d_aliasPos.isValid() ? me->d_aliasPos : me->d_loc, d_mod, 0, ImportRole );
         d_mod->d_helper.append( e1 );
-        d_mdl->d_xref[me].append( e1 );
+        add( me, e1 );
 
         Module* m = me->d_tmpl.data();
         if( m == 0 )
@@ -96,7 +123,7 @@ struct Model::CrossReferencer : public AstVisitor
         {
             IdentLeaf* e2 = new IdentLeaf( m, me->d_loc, d_mod, 0, ImportRole );
             d_mod->d_helper.append( e2 );
-            d_mdl->d_xref[m].append( e2 );
+            add( m, e2 );
         }
 
         foreach( const MetaActual& a, me->d_metaActuals )
@@ -108,7 +135,7 @@ struct Model::CrossReferencer : public AstVisitor
         stack.push_back(me);
 
         me->d_helper << new IdentLeaf( me, me->d_loc,d_mod, 0, DeclRole);
-        d_mdl->d_xref[me].append( me->d_helper.back().data() );
+        add( me, me->d_helper.back().data() );
 
         //if( me->d_receiver ) // receiver Param is part of d_order
         //    me->d_receiver->accept(this);
@@ -137,7 +164,7 @@ struct Model::CrossReferencer : public AstVisitor
     {
         Scope* s = stack.back();
         s->d_helper << new IdentLeaf(me, me->d_loc, d_mod, 0, DeclRole );
-        d_mdl->d_xref[me].append( s->d_helper.back().data() );
+        add( me, s->d_helper.back().data() );
 
         if( me->d_type )
             me->d_type->accept(this);
@@ -195,7 +222,7 @@ struct Model::CrossReferencer : public AstVisitor
     {
         Scope* s = stack.back();
         s->d_helper << new IdentLeaf( me, me->d_loc, d_mod, 0, receiver ? ThisRole : DeclRole );
-        d_mdl->d_xref[me].append( s->d_helper.back().data() );
+        add( me, s->d_helper.back().data() );
         // we need the visited set here because the same type can be assigned to more than one Named
         if( me->d_type && !visited.contains(me->d_type.data()) )
         {
@@ -228,7 +255,7 @@ struct Model::CrossReferencer : public AstVisitor
     {
         Scope* s = stack.back();
         s->d_helper << new IdentLeaf( me, me->d_loc, d_mod, 0, DeclRole );
-        d_mdl->d_xref[me].append( s->d_helper.back().data() );
+        add( me, s->d_helper.back().data() );
         if( me->d_constExpr )
             me->d_constExpr->accept(this);
     }
@@ -334,7 +361,7 @@ struct Model::CrossReferencer : public AstVisitor
     void visit( IdentLeaf* me )
     {
         if( !me->d_ident.isNull() )
-            d_mdl->d_xref[me->d_ident.data()].append( me );
+            add( me->d_ident.data(), me );
     }
 
     void visit( UnExpr* me )
@@ -348,7 +375,7 @@ struct Model::CrossReferencer : public AstVisitor
         if( me->d_sub )
             me->d_sub->accept(this);
         if( !me->d_ident.isNull() )
-            d_mdl->d_xref[me->d_ident.data()].append( me );
+            add( me->d_ident.data(), me );
     }
 
     void visit( ArgExpr* me )
@@ -391,7 +418,7 @@ struct Model::CrossReferencer : public AstVisitor
                 rc.d_col += 1;
                 IdentLeaf* e1 = new IdentLeaf( m, rc, d_mod, 0, StringRole );
                 d_mod->d_helper.append( e1 );
-                d_mdl->d_xref[m].append( e1 );
+                add( m, e1 );
 
                 // qDebug() << "CallByString" << d_mod->d_file << l->d_loc.d_row << l->d_loc.d_col << str;
                 Named* n = quali.size() > 1 ? m->find( Lexer::getSymbol(quali.last()) ) : 0;
@@ -400,7 +427,7 @@ struct Model::CrossReferencer : public AstVisitor
                     rc.d_col += quali.first().size() + 1;
                     IdentLeaf* e2 = new IdentLeaf( n, rc, d_mod, 0, StringRole );
                     d_mod->d_helper.append( e2 );
-                    d_mdl->d_xref[n].append( e2 );
+                    add( n, e2 );
                 }
             }
         }
@@ -415,7 +442,65 @@ struct Model::CrossReferencer : public AstVisitor
 
 };
 
-Model::Model(QObject *parent) : QObject(parent),d_fillXref(false),d_int16(false)
+struct Model::ParseJob : public QRunnable
+{
+    Model* d_mdl;
+    QString d_path;
+    Ref<Module> d_mod;
+    Errors d_errs; // private to the job, merged into Model::d_errs in file order when all jobs are done
+    quint32 d_sloc;
+
+    ParseJob(Model* mdl, const QString& path):d_mdl(mdl),d_path(path),d_errs(0,true),d_sloc(0)
+    {
+        d_errs.setLog(true);
+        d_errs.setShowWarnings(mdl->d_errs->showWarnings());
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        d_mod = d_mdl->parseFile(d_path, &d_errs, &d_sloc);
+    }
+};
+
+struct Model::ValidateJob : public QRunnable
+{
+    Model* d_mdl;
+    Module* d_mod;
+    const Validator::BaseTypes& d_bt;
+    Errors d_errs; // private to the job, merged into Model::d_errs in dependency order
+
+    ValidateJob(Model* mdl, Module* m, const Validator::BaseTypes& bt):d_mdl(mdl),d_mod(m),d_bt(bt),d_errs(0,true)
+    {
+        d_errs.setLog(true);
+        d_errs.setShowWarnings(mdl->d_errs->showWarnings());
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        qDebug() << "analyzing" << d_mod->getName();
+        Validator::check(d_mod, d_bt, &d_errs, d_mdl, d_mdl->d_skeleton );
+    }
+};
+
+// The log of a job holds every report in the order of occurrence, including repetitions, so the target
+// deduplicates and counts exactly as if the job had reported to it directly; parse jobs are replayed in file
+// order and validate jobs per dependency level in module order, so -jN and -j1 report the same messages and
+// counts, but validation messages of modules on the same level may be listed in a different order than -j1.
+static void replayErrors( const Errors& from, Errors* to )
+{
+    foreach( const Errors::Entry& e, from.getLog() )
+    {
+        if( e.d_isErr )
+            to->error( Errors::Source(e.d_source), e.d_file, e.d_line, e.d_col, e.d_msg );
+        else
+            to->warning( Errors::Source(e.d_source), e.d_file, e.d_line, e.d_col, e.d_msg );
+    }
+}
+
+Model::Model(QObject *parent) : QObject(parent),d_fillXref(false),d_int16(false),d_threadCount(1),d_sloc(0),
+    d_skeleton(false)
 {
     d_errs = new Errors(this);
     d_fc = new FileCache(this);
@@ -454,13 +539,141 @@ void Model::clear()
     d_depOrder.clear();
     unbindFromGlobal();
     d_insts.clear();
+    d_instIndex.clear();
     d_modules.clear();
     d_packages.clear();
     d_others.clear();
     d_xref.clear();
+    d_xrefParts.clear();
     d_sloc = 0;
 }
 
+static void collectExtensions( Module* m, Thing* t, QSet<Thing*>& seen, QList<Record*>& recs,
+                               QList<Procedure*>& procs )
+{
+    // the records with a base record and the procedures overriding a super procedure declared in m
+    if( t == 0 || seen.contains(t) )
+        return;
+    seen.insert(t);
+    switch( t->getTag() )
+    {
+    case Thing::T_Record:
+        {
+            Record* r = cast<Record*>(t);
+            if( r->d_decl && r->d_decl->getModule() != m )
+                break; // e.g. an actual of a generic instance
+            if( r->d_baseRec )
+                recs.append(r);
+            foreach( const Ref<Field>& f, r->d_fields )
+                collectExtensions( m, f->d_type.data(), seen, recs, procs );
+            foreach( const Ref<Procedure>& p, r->d_methods )
+                collectExtensions( m, p.data(), seen, recs, procs );
+        }
+        break;
+    case Thing::T_Pointer:
+        collectExtensions( m, cast<Pointer*>(t)->d_to.data(), seen, recs, procs );
+        break;
+    case Thing::T_Array:
+        collectExtensions( m, cast<Array*>(t)->d_type.data(), seen, recs, procs );
+        break;
+    case Thing::T_ProcType:
+        {
+            ProcType* pt = cast<ProcType*>(t);
+            collectExtensions( m, pt->d_return.data(), seen, recs, procs );
+            foreach( const Ref<Parameter>& p, pt->d_formals )
+                collectExtensions( m, p->d_type.data(), seen, recs, procs );
+        }
+        break;
+    case Thing::T_Procedure:
+    case Thing::T_Module:
+        {
+            Scope* s = cast<Scope*>(t);
+            if( s->getModule() != m )
+                break;
+            if( t->getTag() == Thing::T_Procedure )
+            {
+                Procedure* p = cast<Procedure*>(t);
+                if( p->d_super )
+                    procs.append(p);
+                collectExtensions( m, p->d_type.data(), seen, recs, procs );
+            }
+            foreach( const Ref<Named>& n, s->d_order )
+            {
+                if( n->getTag() == Thing::T_Procedure )
+                    collectExtensions( m, n.data(), seen, recs, procs );
+                else if( n->getTag() != Thing::T_Import )
+                    collectExtensions( m, n->d_type.data(), seen, recs, procs );
+            }
+        }
+        break;
+    }
+}
+
+static void unlinkExtensions( Module* m )
+{
+    // called before m is replaced; remove the records and procedures declared in m from the d_subRecs and
+    // d_subs of their base records and super procedures, which might outlive m
+    QSet<Thing*> seen;
+    QList<Record*> recs;
+    QList<Procedure*> procs;
+    collectExtensions( m, m, seen, recs, procs );
+    foreach( Record* r, recs )
+        r->d_baseRec->d_subRecs.removeAll(r);
+    foreach( Procedure* p, procs )
+        p->d_super->d_subs.removeAll(p);
+}
+
+static bool lessThanDecl( Named* lhs, const RowCol& lpos, Named* rhs, const RowCol& rpos )
+{
+    Module* lm = lhs ? lhs->getModule() : 0;
+    Module* rm = rhs ? rhs->getModule() : 0;
+    if( lm != rm )
+    {
+        const QString lf = lm ? lm->d_file : QString();
+        const QString rf = rm ? rm->d_file : QString();
+        if( lf != rf )
+            return lf < rf;
+        const QByteArray ln = lm ? lm->getName() : QByteArray();
+        const QByteArray rn = rm ? rm->getName() : QByteArray(); // instances of the same generic module
+        if( ln != rn )
+            return ln < rn;
+    }
+    return lpos.packed() < rpos.packed();
+}
+
+static bool lessThanRecord( Record* lhs, Record* rhs )
+{
+    return lessThanDecl( lhs->findDecl(true), lhs->d_loc, rhs->findDecl(true), rhs->d_loc );
+}
+
+static bool lessThanProc( Procedure* lhs, Procedure* rhs )
+{
+    return lessThanDecl( lhs, lhs->d_loc, rhs, rhs->d_loc );
+}
+
+static void sortExtensions( const QList<Module*>& mods )
+{
+    // the validator appends to d_subRecs and d_subs in the order the modules are validated, which varies
+    // with concurrent validation; sort them by declaration position so the order is always the same
+    QSet<Record*> bases;
+    QSet<Procedure*> supers;
+    foreach( Module* m, mods )
+    {
+        QSet<Thing*> seen;
+        QList<Record*> recs;
+        QList<Procedure*> procs;
+        collectExtensions( m, m, seen, recs, procs );
+        foreach( Record* r, recs )
+            bases.insert(r->d_baseRec);
+        foreach( Procedure* p, procs )
+            supers.insert(p->d_super);
+    }
+    foreach( Record* r, bases )
+        std::sort( r->d_subRecs.begin(), r->d_subRecs.end(), lessThanRecord );
+    foreach( Procedure* p, supers )
+        std::sort( p->d_subs.begin(), p->d_subs.end(), lessThanProc );
+}
+
 bool Model::parseFiles(const PackageList& files)
 {
     if( files.isEmpty() )
@@ -472,12 +685,42 @@ bool Model::parseFiles(const PackageList& files)
     clear();
 
     const quint32 before = d_errs->getErrCount();
+
+    QList<ParseJob*> jobs;
+    if( d_threadCount > 1 )
+    {
+        // each file has its own lexer and parser, so they can all run concurrently; the results are
+        // merged below in the same order as in the sequential case, so d_modules and errors are stable
+        QThreadPool pool;
+        pool.setMaxThreadCount(d_threadCount);
+        foreach( const Package& package, files )
+        {
+            foreach( const QString& filePath, package.d_files )
+            {
+                ParseJob* job = new ParseJob(this,filePath);
+                jobs.append(job);
+                pool.start(job);
+            }
+        }
+        pool.waitForDone();
+    }
+
+    int curJob = 0;
     foreach( const Package& package, files )
     {
         foreach( const QString& filePath, package.d_files )
         {
             qDebug() << "parsing" << filePath;
-            Ref<Module> m = parseFile(filePath);
+            Ref<Module> m;
+            if( jobs.isEmpty() )
+                m = parseFile(filePath);
+            else
+            {
+                ParseJob* job = jobs[curJob++];
+                replayErrors( job->d_errs, d_errs );
+                d_sloc += job->d_sloc;
+                m = job->d_mod;
+            }
             if( m.isNull() )
                 error( filePath, tr("cannot open file") );
             else
@@ -501,6 +744,8 @@ bool Model::parseFiles(const PackageList& files)
         }
     }
 
+    qDeleteAll(jobs);
+
     resolveImports();
     if( !findProcessingOrder() )
         return false;
@@ -511,29 +756,38 @@ bool Model::parseFiles(const PackageList& files)
     Validator::BaseTypes bt;
     fillBt(bt);
 
-    foreach( Module* m, d_depOrder )
+    QSet<Module*> failed; // modules with validation errors
+    if( d_threadCount > 1 )
+        validateLevels(bt, failed);
+    else
     {
-        if( m == d_systemModule.data())
-            continue;
+        foreach( Module* m, d_depOrder )
+        {
+            if( m == d_systemModule.data())
+                continue;
 
-        Q_ASSERT( m->d_metaActuals.isEmpty() );
-                      // generic module instances are not validated here,
-                      // but are validated in Validator::visit(Import*) for locality
+            Q_ASSERT( m->d_metaActuals.isEmpty() );
+                          // generic module instances are not validated here,
+                          // but are validated in Validator::visit(Import*) for locality
+
+            qDebug() << "analyzing" << m->getName();
 
-        qDebug() << "analyzing" << m->getName();
+            const quint32 errCount = d_errs->getErrCount();
+            Validator::check(m, bt, d_errs, this, d_skeleton );
+            if( errCount != d_errs->getErrCount() )
+                failed.insert(m);
+        }
+        sortExtensions(d_depOrder); // same order as validateLevels
+    }
 
-        Validator::check(m, bt, d_errs, this );
+    foreach( Module* m, d_depOrder )
+    {
+        if( m == d_systemModule.data())
+            continue;
 
         //m->dump(); // TEST
         if( d_fillXref )
-        {
-            CrossReferencer(this,m);
-            for( int i = 0; i < m->d_imports.size(); i++ )
-            {
-                if( !m->d_imports[i]->d_metaActuals.isEmpty() )
-                    CrossReferencer(this,m->d_imports[i]->d_mod.data());
-            }
-        }
+            addXref(m);
     }
 
 #if 0 // TEST
@@ -550,6 +804,200 @@ bool Model::parseFiles(const PackageList& files)
     return true;
 }
 
+static bool instantiatesGenerics( Module* m )
+{
+    foreach( Import* i, m->d_imports )
+    {
+        if( !i->d_metaActuals.isEmpty() )
+            return true;
+    }
+    return false;
+}
+
+void Model::validateLevels(const Validator::BaseTypes& bt, QSet<Module*>& failed)
+{
+    // A module only depends on modules of lower levels, so the modules of a level can be validated
+    // concurrently. Modules importing generic instances are validated on the calling thread after the
+    // level, because instantiate() modifies d_insts and validates the new instance in place.
+    QHash<Module*,int> levelOf;
+    QList< QList<Module*> > levels;
+    foreach( Module* m, d_depOrder )
+    {
+        if( m == d_systemModule.data())
+            continue;
+        Q_ASSERT( m->d_metaActuals.isEmpty() );
+        int level = 0;
+        foreach( Import* i, m->d_imports )
+        {
+            if( !i->d_mod.isNull() )
+                level = qMax( level, levelOf.value(i->d_mod.data(), -1) + 1 );
+        }
+        levelOf[m] = level;
+        while( levels.size() <= level )
+            levels.append( QList<Module*>() );
+        levels[level].append(m);
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(d_threadCount);
+    for( int l = 0; l < levels.size(); l++ )
+    {
+        QList<ValidateJob*> jobs;
+        QList<Module*> serial;
+        foreach( Module* m, levels[l] )
+        {
+            if( instantiatesGenerics(m) )
+                serial.append(m);
+            else
+            {
+                ValidateJob* job = new ValidateJob(this,m,bt);
+                jobs.append(job);
+                pool.start(job);
+            }
+        }
+        pool.waitForDone();
+        foreach( ValidateJob* job, jobs )
+        {
+            replayErrors( job->d_errs, d_errs );
+            if( job->d_errs.getErrCount() != 0 )
+                failed.insert(job->d_mod);
+        }
+        qDeleteAll(jobs);
+
+        foreach( Module* m, serial )
+        {
+            qDebug() << "analyzing" << m->getName();
+            const quint32 errCount = d_errs->getErrCount();
+            Validator::check(m, bt, d_errs, this, d_skeleton );
+            if( errCount != d_errs->getErrCount() )
+                failed.insert(m);
+        }
+        sortExtensions(levels[l]);
+    }
+}
+
+void Model::addXref(Module* m)
+{
+    {
+        Trace::Scope trace("xref", m);
+        CrossReferencer(this,m);
+    }
+    foreach( Import* i, m->d_imports )
+    {
+        // an instance imported by more than one module is only referenced once
+        if( !i->d_metaActuals.isEmpty() && !i->d_mod.isNull() && !d_xrefParts.contains(i->d_mod.data()) )
+        {
+            Trace::Scope trace("xref", i->d_mod.data());
+            CrossReferencer(this,i->d_mod.data());
+        }
+    }
+}
+
+void Model::removeXref(Module* m)
+{
+    const XRef part = d_xrefParts.take(m);
+    for( XRef::const_iterator i = part.begin(); i != part.end(); ++i )
+    {
+        XRef::iterator j = d_xref.find(i.key());
+        if( j == d_xref.end() )
+            continue;
+        QSet<Expression*> exps;
+        foreach( const Ref<Expression>& e, i.value() )
+            exps << e.data();
+        ExpList& l = j.value();
+        for( int k = l.size() - 1; k >= 0; k-- )
+        {
+            if( exps.contains(l[k].data()) )
+                l.removeAt(k);
+        }
+        if( l.isEmpty() )
+            d_xref.erase(j);
+    }
+}
+
+void Model::rekeyXref(const QList<Named*>& replaced, const QList<Module*>& users)
+{
+    // the use-sites in users were redirected from the replaced declarations by Module::rebindUsers
+    foreach( Named* n, replaced )
+        d_xref.remove(n);
+    foreach( Module* u, users )
+    {
+        XRefParts::iterator p = d_xrefParts.find(u);
+        if( p == d_xrefParts.end() )
+            continue;
+        foreach( Named* n, replaced )
+        {
+            const ExpList l = p.value().take(n);
+            foreach( const Ref<Expression>& e, l )
+            {
+                Named* to = e->getIdent();
+                p.value()[to].append(e);
+                d_xref[to].append(e);
+            }
+        }
+    }
+}
+
+static bool actualsRefer( Module* inst, Module* mod )
+{
+    foreach( const MetaActual& a, inst->d_metaActuals )
+    {
+        Named* n = a.d_constExpr.isNull() ? 0 : a.d_constExpr->getIdent();
+        if( n && n->getModule() == mod )
+            return true;
+    }
+    return false;
+}
+
+static void collectUsers( Module* m, QList<Module*>& res, QSet<Module*>& seen )
+{
+    foreach( Module* u, m->d_usedBy )
+    {
+        if( seen.contains(u) )
+            continue;
+        seen.insert(u);
+        res.append(u);
+        collectUsers(u, res, seen);
+    }
+}
+
+bool Model::dropInstances(Module* mod, bool importedOnly)
+{
+    // forget the instances of mod if it is generic, and the instances whose actuals refer to mod;
+    // with importedOnly only the latter which are also imported by mod itself
+    QSet<Module*> stale;
+    ModInsts::iterator i = d_insts.begin();
+    while( i != d_insts.end() )
+    {
+        ModList& l = i.value();
+        for( int j = l.size() - 1; j >= 0; j-- )
+        {
+            Module* inst = l[j].data();
+            if( i.key() == mod || ( actualsRefer(inst, mod) && ( !importedOnly || mod->findImport(inst) ) ) )
+            {
+                if( d_fillXref )
+                    removeXref(inst);
+                unlinkExtensions(inst);
+                stale << inst;
+                l.removeAt(j);
+            }
+        }
+        if( l.isEmpty() )
+            i = d_insts.erase(i);
+        else
+            ++i;
+    }
+    InstIndex::iterator k = d_instIndex.begin();
+    while( k != d_instIndex.end() )
+    {
+        if( stale.contains(k.value()) )
+            k = d_instIndex.erase(k);
+        else
+            ++k;
+    }
+    return !stale.isEmpty();
+}
+
 bool Model::updateParse()
 {
     d_errs->clear();
@@ -557,9 +1005,9 @@ bool Model::updateParse()
     Validator::BaseTypes bt;
     fillBt(bt);
 
-    d_insts.clear(); // otherwise references to oldMod might remain left in d_metaActuals
-    // TODO: maybe this can be done incrementally as well to avoid redundant parse and redundant copies of insts
-    // NOTE that there might be a circular dependency of module and inst in case inst has actual from module
+    // Generic instances are kept as long as their template and the declarations referenced by their actuals
+    // are unchanged. NOTE that there might be a circular dependency of module and inst in case inst has
+    // actual from module.
 
     foreach( Module* oldMod, d_depOrder )
     {
@@ -568,20 +1016,23 @@ bool Model::updateParse()
 
         const QString filePath = oldMod->d_file;
         const QDateTime oldTs = oldMod->d_when;
-        const QDateTime newTs = getModified(filePath);
-
-        if( !oldMod->d_hasErrors && oldTs.isValid() && newTs <= oldTs )
-            continue;
 
-        foreach( Module* mm, oldMod->d_usedBy )
-            mm->d_when = QDateTime(); // invalidate dependent modules
-            // TODO: only invalidate if public interface changed
+        if( !oldMod->d_hasErrors && oldTs.isValid() )
+        {
+            // the content decides, so a file which was only touched is not reparsed
+            bool found;
+            const FileCache::Entry content = d_fc->readFile(filePath, &found);
+            if( found && !oldMod->d_hash.isEmpty() && content.d_hash == oldMod->d_hash )
+                continue;
+        }
 
         qDebug() << "reparsing" << oldMod->getName();
 
         Ref<Module> newMod = parseFile(filePath);
         if( newMod.isNull() )
         {
+            foreach( Module* mm, oldMod->d_usedBy )
+                mm->d_when = QDateTime(); // invalidate dependent modules
             error( filePath, tr("cannot open file") );
             continue;
         }
@@ -592,6 +1043,7 @@ bool Model::updateParse()
         newMod->d_scope = oldMod->d_scope;
 
         Ref<Module> tmp(oldMod); // keep a refcount
+        unlinkExtensions(oldMod);
         d_modules[newMod->d_fullName] = newMod; // replace existing
         const int pos = d_depOrder.indexOf(oldMod);
         Q_ASSERT( pos != -1 );
@@ -617,88 +1069,149 @@ bool Model::updateParse()
         }
         resolveImport(newMod.data());
 
-        Validator::check(newMod.data(), bt, d_errs, this );
-
-#if 0
+        QList<Named*> replaced; // declarations of oldMod referenced in d_xref
         if( d_fillXref )
         {
-            // we still get crashes in Ide::fillXref()
-            XRef::iterator i = d_xref.begin();
-            while( i != d_xref.end() )
+            const XRef& part = d_xrefParts.value(oldMod);
+            for( XRef::const_iterator i = part.begin(); i != part.end(); ++i )
             {
-                // TODO: d_insts
-                Module* m = i.key()->getModule();
-                if( m == oldMod )
-                    i = d_xref.erase(i);
-                else
-                    i++;
-            }
-            CrossReferencer(this,newMod.data());
-            for( int i = 0; i < newMod->d_imports.size(); i++ )
-            {
-                if( !newMod->d_imports[i]->d_metaActuals.isEmpty() )
-                    CrossReferencer(this,newMod->d_imports[i]->d_mod.data());
+                if( i.key()->getModule() == oldMod )
+                    replaced << i.key();
             }
+            removeXref(oldMod);
         }
-#endif
-    }
-    if( d_fillXref )
-    {
-        // this is a fix cost of about four times parsing/validation costs of one file,
-        // practically negligible; the benefit is no crash in Ide::fillXref() anymore
-        d_xref.clear();
-        foreach( Module* m, d_depOrder )
+
+        // instances depending on the old version of the module itself cannot be reused by the new version
+        const bool dropped = dropInstances(oldMod, true);
+
+        const quint32 errCount = d_errs->getErrCount();
+        Validator::check(newMod.data(), bt, d_errs, this, d_skeleton );
+
+        // users only have to be revalidated if the interface changed; a module reparsed because one of its
+        // imports changed always passes this on, since its users might depend on the import indirectly
+        bool keepUsers = !dropped && oldTs.isValid() && !oldMod->d_hasErrors && errCount == d_errs->getErrCount()
+                && oldMod->d_metaParams.isEmpty() && newMod->d_metaParams.isEmpty()
+                && oldMod->interfaceHash() == newMod->interfaceHash();
+        QList<Module*> users;
+        if( keepUsers )
         {
-            if( m == d_systemModule.data())
-                continue;
-            CrossReferencer(this,m);
-            for( int i = 0; i < m->d_imports.size(); i++ )
+            QSet<Module*> seen;
+            collectUsers(oldMod, users, seen);
+            for( ModInsts::const_iterator i = d_insts.constBegin(); i != d_insts.constEnd(); ++i )
             {
-                if( !m->d_imports[i]->d_metaActuals.isEmpty() )
-                    CrossReferencer(this,m->d_imports[i]->d_mod.data());
+                foreach( const Ref<Module>& inst, i.value() )
+                    users.append(inst.data());
             }
+            keepUsers = oldMod->rebindUsers(newMod.data(), users);
+        }
+        if( keepUsers )
+        {
+            newMod->d_usedBy = oldMod->d_usedBy;
+            if( d_fillXref )
+                rekeyXref(replaced, users);
+        }else
+        {
+            foreach( Module* mm, oldMod->d_usedBy )
+                mm->d_when = QDateTime(); // invalidate dependent modules
         }
+        dropInstances(oldMod, false);
+
+        if( d_fillXref )
+            addXref(newMod.data());
     }
     return true;
 }
 
 Ref<Module> Model::parseFile(const QString& filePath)
 {
-    bool found;
-    FileCache::Entry content = d_fc->getFile(filePath, &found );
-    Ref<Module> res;
-    if( found )
-    {
-        QBuffer buf;
-        buf.setData( content.d_code );
-        buf.open(QIODevice::ReadOnly);
-        res = parseFile( &buf, filePath, content.d_modified );
-    }else
-    {
-        QFile file(filePath);
-        if( !file.open(QIODevice::ReadOnly) )
-            return 0;
-        res = parseFile( &file, filePath, QFileInfo(filePath).lastModified() );
-    }
-    return res;
+    return parseFile( filePath, d_errs, &d_sloc );
 }
 
-Ref<Module> Model::parseFile(QIODevice* in, const QString& filePath, const QDateTime& ts)
+Ref<Module> Model::parseFile(const QString& filePath, Errors* errs, quint32* sloc)
 {
+    // NOTE: this method is called from ParseJob threads; don't touch Model state here
     Ob::Lexer lex;
-    lex.setErrors(d_errs);
+    lex.setErrors(errs);
     lex.setCache(d_fc);
     lex.setIgnoreComments(true);
     lex.setPackComments(true);
     lex.setSensExt(true);
-    lex.setStream( in, filePath, ts );
-    Obx::Parser p(&lex,d_errs);
-    Ref<Module> res = p.parse(d_options);
-    d_sloc += lex.getSloc();
-    // qDebug() << filePath << "with" << lex.getSloc() << "SLOC";
+    // the lexer works on the whole text; token values refer into it until they are interned; content keeps
+    // the text read by the FileCache alive
+    bool found;
+    const FileCache::Entry content = d_fc->readFile(filePath, &found );
+    if( !found )
+        return 0;
+
+    Ref<Module> res;
+    {
+        Trace::Scope trace("lex and parse", filePath); // the parser pulls the tokens from the lexer
+        lex.setBuffer( content.d_code, filePath, content.d_modified );
+        Obx::Parser p(&lex,errs);
+        p.setSkeleton(d_skeleton);
+        res = p.parse(d_options);
+        *sloc += lex.getSloc();
+        if( res && !res->d_metaParams.isEmpty() && !res->d_hasErrors )
+            res->d_template = res->clone(); // the validator modifies the AST of the generic module itself
+        // qDebug() << filePath << "with" << lex.getSloc() << "SLOC";
+    }
+    if( res )
+        res->d_hash = content.d_hash;
+    return res;
+}
+
+static void collectLazyBodies( Scope* s, QList<Procedure*>& res )
+{
+    foreach( const Ref<Named>& n, s->d_order )
+    {
+        if( n->getTag() == Thing::T_Procedure )
+            collectLazyBodies( cast<Procedure*>(n.data()), res );
+    }
+    if( s->getTag() == Thing::T_Procedure && cast<Procedure*>(s)->hasLazyBody() )
+        res.append( cast<Procedure*>(s) );
+}
+
+bool Model::materialize(Scope* s)
+{
+    if( s == 0 )
+    {
+        bool res = true;
+        foreach( Module* m, d_depOrder )
+        {
+            if( m->d_isValidated && !m->d_source.isEmpty() && !materialize(m) )
+                res = false;
+        }
+        return res;
+    }
+
+    QList<Procedure*> bodies;
+    collectLazyBodies(s, bodies);
+    if( bodies.isEmpty() && s->getTag() != Thing::T_Module )
+        return true;
+
+    Validator::BaseTypes bt;
+    fillBt(bt);
+    const bool res = Validator::checkDeferred(s, bt, d_errs, this);
+    if( d_fillXref )
+    {
+        Module* m = s->getModule();
+        Trace::Scope trace("xref", m);
+        foreach( Procedure* p, bodies )
+            CrossReferencer(this, m, p);
+    }
     return res;
 }
 
+bool Model::hasLazyBodies() const
+{
+    foreach( Module* m, d_depOrder )
+    {
+        if( m->d_isValidated && !m->d_source.isEmpty() )
+            return true;
+    }
+    return false;
+}
+
 QDateTime Model::getModified(const QString& path) const
 {
     bool ok;
@@ -915,7 +1428,7 @@ Ref<Module> Model::treeShaken(Module* m) const
     {
         if( used.contains(n.data()) )
         {
-            nm->d_names[n->d_name.constData()] = n.data();
+            nm->d_names[n->d_nameId] = n.data();
             nm->d_order.append(n);
         }
     }
@@ -948,20 +1461,36 @@ Module* Model::instantiate(Module* generic, const MetaActuals& actuals)
     Q_ASSERT( generic && generic->d_metaActuals.isEmpty() && !generic->d_metaParams.isEmpty() &&
               generic->d_metaParams.size() == actuals.size() );
 
-    ModList& insts = d_insts[generic];
-    const QByteArray ref = Module::format(generic->d_metaParams, actuals);
-    Ref<Module> inst;
-    for( int i = 0; i < insts.size(); i++ )
+    QPair<Module*,QByteArray> key( generic, Module::format(generic->d_metaParams, actuals) );
+    QVector<Evaluator::Result> vals( actuals.size() );
+    for( int i = 0; i < actuals.size(); i++ )
     {
-        if( insts[i]->formatMetaActuals() == ref )
+        // the formals of the generic module have no values, so format() only sees the type of constant actuals
+        Named* formal = generic->d_metaParams[i].data();
+        Expression* e = actuals[i].d_constExpr.data();
+        if( formal->getTag() != Thing::T_Const || e == 0 )
+            continue;
+        Type* tf = formal->d_type.isNull() ? 0 : formal->d_type->derefed();
+        Named* n = e->getIdent();
+        if( tf && tf->getTag() == Thing::T_ProcType && n )
+            key.second += "|" + n->getQualifiedName().join('.');
+        else
         {
-            inst = insts[i];
-            break;
+            vals[i] = Evaluator::eval(e, generic, false);
+            key.second += "|" + QByteArray::number(vals[i].d_vtype) + ":" + vals[i].d_value.toByteArray();
         }
     }
+    Ref<Module> inst( d_instIndex.value(key) );
     if( inst.isNull() )
     {
-        inst = parseFile( generic->d_file );
+        Trace::Scope trace("instantiate", generic);
+        if( generic->d_template )
+        {
+            QHash<Thing*,Thing*> copies;
+            inst = generic->d_template->clone(&copies);
+            Evaluator::initInstance(inst.data(), generic->d_template.data(), copies);
+        }else
+            inst = parseFile( generic->d_file );
         if( inst.isNull() || inst->d_hasErrors )
             return 0; // already reported
         if( !actuals.isEmpty() )
@@ -986,7 +1515,9 @@ Module* Model::instantiate(Module* generic, const MetaActuals& actuals)
                         c->d_vtype = LiteralValue::ProcLit;
                     }else
                     {
-                        Evaluator::Result res = Evaluator::eval(a.d_constExpr.data(), inst.data(), false, d_errs);
+                        Evaluator::Result res = vals[i];
+                        if( res.d_vtype == Literal::NoValue ) // evaluate again to report the errors
+                            res = Evaluator::eval(a.d_constExpr.data(), inst.data(), false, d_errs);
                         c->d_val = res.d_value;
                         c->d_vtype = res.d_vtype;
                         c->d_wide = res.d_wide;
@@ -1000,9 +1531,11 @@ Module* Model::instantiate(Module* generic, const MetaActuals& actuals)
         inst->d_metaActuals = actuals;
         inst->d_fullName = generic->d_fullName;
         inst->d_scope = generic->d_scope;
+        inst->formatMetaActuals(); // fill the lazy d_mac here; instances are read concurrently by validateLevels
         if( resolveImport(inst.data()) )
             inst->d_hasErrors = true;
-        insts.append(inst);
+        d_insts[generic].append(inst);
+        d_instIndex.insert(key, inst.data());
     }
     return inst.data();
 }
@@ -1208,13 +1741,13 @@ void Model::fillGlobals()
     d_globals->add( new BuiltIn(BuiltIn::ASH, new ProcType( Type::List() << d_intType.data() << d_intType.data(), d_intType.data() ) ) );
     bi = new BuiltIn(BuiltIn::BYTESIZE, new ProcType( Type::List() << d_anyType.data(), d_intType.data() ) );
     d_globals->add( bi.data() );
-    d_globals->d_names[Lexer::getSymbol("SIZE").constData()] = bi.data(); // backward compatibility for BB and OBN2
+    d_globals->d_names[Lexer::getSymbolId(Lexer::getSymbol("SIZE"))] = bi.data(); // backward compatibility for BB and OBN2
     d_globals->add( new BuiltIn(BuiltIn::ENTIER, new ProcType( Type::List() << d_longrealType.data(), d_longType.data() ) ) );
 
     // Oberon+
     bi = new BuiltIn(BuiltIn::CAST, new ProcType( Type::List() << d_anyType.data() << d_anyType.data(), d_anyType.data() ) );
     d_globals->add( bi.data() );
-    d_globals->d_names[Lexer::getSymbol("VAL").constData()] = bi.data(); // backward compatibility for OBS
+    d_globals->d_names[Lexer::getSymbolId(Lexer::getSymbol("VAL"))] = bi.data(); // backward compatibility for OBS
     d_globals->add( new BuiltIn(BuiltIn::STRLEN, new ProcType( Type::List() << d_anyType.data(), d_intType.data() ) ) );
     d_globals->add( new BuiltIn(BuiltIn::WCHR, new ProcType( Type::List() << d_intType.data(), d_wcharType.data() ) ) );
     d_globals->add( new BuiltIn(BuiltIn::PRINTLN, new ProcType( Type::List() << d_anyType.data() ) ) );
@@ -1275,7 +1808,8 @@ void Model::fillGlobals()
     d_globalsLower->d_names = d_globals->d_names;
     Scope::Names::const_iterator i;
     for( i = d_globals->d_names.begin(); i != d_globals->d_names.end(); ++i )
-        d_globalsLower->d_names.insert( Lexer::getSymbol( QByteArray(i.key()).toLower() ), i.value() );
+        d_globalsLower->d_names.insert( Lexer::getSymbolId( Lexer::getSymbol(
+                                            SymbolTable::inst()->string(i.key()).toLower() ) ), i.value() );
 }
 
 bool Model::resolveImports()
@@ -1368,6 +1902,7 @@ bool Model::findProcessingOrder()
 {
     d_depOrder.clear();
     d_insts.clear();
+    d_instIndex.clear();
 
     QSet<Module*> mods, all;
     Modules::const_iterator i;
@@ -41,6 +41,13 @@ namespace Obx
         const QList<Module*>& getDepOrder() const { return d_depOrder; }
         quint32 getSloc() const { return d_sloc; }
         void setOptions(const QByteArrayList& o) { d_options = o; }
+        void setThreadCount( int n ) { d_threadCount = n; } // > 1: parseFiles parses files and validates independent modules concurrently
+        int getThreadCount() const { return d_threadCount; }
+        // skeleton mode: procedure bodies are only parsed and validated by materialize, see Parser::setSkeleton
+        void setSkeleton( bool b ) { d_skeleton = b; }
+        bool isSkeleton() const { return d_skeleton; }
+        bool materialize( Scope* = 0 ); // the lazy bodies of a Module, a Procedure or of all modules
+        bool hasLazyBodies() const; // in validated modules
 
         void setFillXref( bool b ) { d_fillXref = b; }
         typedef QHash<Named*,ExpList> XRef; // name used by ident expression
@@ -70,12 +77,19 @@ namespace Obx
         bool error( const Ob::Loc& loc, const QString& msg );
         bool warning( const Ob::Loc& loc, const QString& msg );
         Ref<Module> parseFile( const QString& filePath );
-        Ref<Module> parseFile(QIODevice* , const QString& filePath, const QDateTime& ts);
+        Ref<Module> parseFile( const QString& filePath, Ob::Errors*, quint32* sloc );
         QDateTime getModified(const QString& path) const;
         void fillBt( Validator::BaseTypes& bt);
+        void validateLevels( const Validator::BaseTypes& bt, QSet<Module*>& failed );
+        bool dropInstances( Module*, bool importedOnly );
+        void addXref( Module* );
+        void removeXref( Module* );
+        void rekeyXref( const QList<Named*>& replaced, const QList<Module*>& users );
 
     private:
         struct CrossReferencer;
+        struct ParseJob;
+        struct ValidateJob;
         Ref<Scope> d_globals;
         Ref<Scope> d_globalsLower;
         QHash<QByteArray,QByteArray> d_preload;
@@ -107,19 +121,25 @@ namespace Obx
         typedef QList<Ref<Module> > ModList;
         typedef QHash<Module*,ModList> ModInsts;
         ModInsts d_insts; // generic module -> instances
+        typedef QHash<QPair<Module*,QByteArray>,Module*> InstIndex; // generic module, formatted actuals -> instance
+        InstIndex d_instIndex;
 
         typedef QHash<VirtualPath,Ref<Module> > Modules;
         typedef QHash<VirtualPath,QList<Module*> > Packages;
         Modules d_modules, d_others;
         Packages d_packages;
         XRef d_xref;
+        typedef QHash<Module*,XRef> XRefParts;
+        XRefParts d_xrefParts; // module -> the entries of d_xref contributed by the module
         quint32 d_sloc;
         QByteArrayList d_options;
+        int d_threadCount;
 
         Ob::Errors* d_errs;
         Ob::FileCache* d_fc;
         bool d_fillXref;
         bool d_int16;
+        bool d_skeleton;
     };
 }
 
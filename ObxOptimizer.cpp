@@ -0,0 +1,2472 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/compiler library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ObxOptimizer.h"
+#include "ObxValidator.h"
+#include "ObxEvaluator.h"
+#include <limits>
+#include <algorithm>
+using namespace Obx;
+using namespace Ob;
+
+static inline Type* derefed( Type* t )
+{
+    if( t )
+        return t->derefed();
+    else
+        return 0;
+}
+
+struct BaseTypes
+{
+    // the lowerings need types which outlive the statements they create
+    Ref<BaseType> d_bool, d_int64;
+    BaseTypes()
+    {
+        d_bool = new BaseType(Type::BOOLEAN);
+        d_int64 = new BaseType(Type::INT64);
+    }
+    static const BaseTypes& inst() { static BaseTypes bt; return bt; }
+};
+
+static BaseType* boolType()
+{
+    return BaseTypes::inst().d_bool.data();
+}
+
+static BaseType* int64Type()
+{
+    return BaseTypes::inst().d_int64.data();
+}
+
+static quint8 inclusiveType1(Type* lhs, Type* rhs)
+{
+    if( lhs == 0 || rhs == 0 )
+        return 0;
+    const quint8 l = lhs->getBaseType();
+    const quint8 r = rhs->getBaseType();
+    if( ( l == Type::CHAR && r == Type::STRING ) ||
+        ( l == Type::WCHAR && r == Type::WSTRING ) ||
+        ( l == Type::WCHAR && r == Type::STRING ) )
+        return r;
+    return Validator::inclusiveType( l, r ).first;
+}
+
+static bool isScalar( Type* t )
+{
+    t = derefed(t);
+    if( t == 0 )
+        return false;
+    if( t->getTag() == Thing::T_Enumeration )
+        return true;
+    if( t->getTag() != Thing::T_BaseType )
+        return false;
+    switch( t->getBaseType() )
+    {
+    case Type::BOOLEAN:
+    case Type::CHAR:
+    case Type::WCHAR:
+    case Type::BYTE:
+    case Type::INT8:
+    case Type::INT16:
+    case Type::INT32:
+    case Type::INT64:
+    case Type::REAL:
+    case Type::LONGREAL:
+    case Type::SET:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isPureBuiltIn( quint8 f )
+{
+    // all arguments are values and the result only depends on them
+    switch( f )
+    {
+    case BuiltIn::ABS:
+    case BuiltIn::ODD:
+    case BuiltIn::LSL:
+    case BuiltIn::ASR:
+    case BuiltIn::ROR:
+    case BuiltIn::FLOOR:
+    case BuiltIn::FLT:
+    case BuiltIn::ORD:
+    case BuiltIn::CHR:
+    case BuiltIn::CAP:
+    case BuiltIn::LONG:
+    case BuiltIn::SHORT:
+    case BuiltIn::ASH:
+    case BuiltIn::ENTIER:
+    case BuiltIn::WCHR:
+    case BuiltIn::BITAND:
+    case BuiltIn::BITNOT:
+    case BuiltIn::BITOR:
+    case BuiltIn::BITXOR:
+    case BuiltIn::BITSHL:
+    case BuiltIn::BITSHR:
+    case BuiltIn::BITASR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isByValue( ArgExpr* call, int i )
+{
+    // true if the scalar value of argument i is passed, so it can be replaced by an equal expression
+    Q_ASSERT( call->d_op == UnExpr::CALL && !call->d_sub.isNull() );
+    Named* id = call->d_sub->getIdent();
+    if( id && id->getTag() == Thing::T_BuiltIn )
+        return isPureBuiltIn( cast<BuiltIn*>(id)->d_func ) && isScalar( call->d_args[i]->d_type.data() );
+    Type* t = derefed( call->d_sub->d_type.data() );
+    if( t == 0 || t->getTag() != Thing::T_ProcType )
+        return false;
+    ProcType* pt = cast<ProcType*>(t);
+    if( i >= pt->d_formals.size() )
+        return isScalar( call->d_args[i]->d_type.data() ); // varargs
+    return !pt->d_formals[i]->isVarParam() && isScalar( pt->d_formals[i]->d_type.data() );
+}
+
+static bool constValue( Expression* e, qint64& val, quint8& vtype )
+{
+    // integer, character, boolean and enumeration values
+    const LiteralValue* v = 0;
+    switch( e->getTag() )
+    {
+    case Thing::T_Literal:
+        v = cast<Literal*>(e);
+        break;
+    case Thing::T_IdentLeaf:
+    case Thing::T_IdentSel:
+        {
+            Named* n = e->getIdent();
+            if( n && n->getTag() == Thing::T_Const )
+                v = cast<Const*>(n);
+        }
+        break;
+    }
+    if( v == 0 )
+        return false;
+    switch( v->d_vtype )
+    {
+    case Literal::Integer:
+    case Literal::Char:
+    case Literal::Enum:
+        val = v->d_val.toLongLong();
+        break;
+    case Literal::Boolean:
+        val = v->d_val.toBool();
+        break;
+    default:
+        return false;
+    }
+    vtype = v->d_vtype;
+    return true;
+}
+
+static bool fitsType( Type* t, quint8 vtype )
+{
+    // a value of vtype can be represented as a literal of type t
+    t = derefed(t);
+    if( t == 0 )
+        return false;
+    if( t->getTag() == Thing::T_Enumeration )
+        return vtype == Literal::Enum;
+    if( t->isInteger() )
+        return vtype == Literal::Integer;
+    if( t->isChar() )
+        return vtype == Literal::Char;
+    if( t->getBaseType() == Type::BOOLEAN )
+        return vtype == Literal::Boolean;
+    return false;
+}
+
+static qint64 truncated( Type* t, qint64 val )
+{
+    // the value a variable of type t holds after val was stored to it
+    switch( derefed(t)->getBaseType() )
+    {
+    case Type::BYTE:
+        return quint8(val);
+    case Type::INT8:
+        return qint8(val);
+    case Type::INT16:
+        return qint16(val);
+    case Type::INT32:
+        return qint32(val);
+    default:
+        return val;
+    }
+}
+
+static Literal* makeLiteral( quint8 vtype, qint64 val, Type* t, const RowCol& loc )
+{
+    QVariant v;
+    if( vtype == Literal::Boolean )
+        v = val != 0;
+    else
+        v = val;
+    return new Literal( Literal::ValueType(vtype), loc, v, t );
+}
+
+static bool sameValue( Expression* lhs, Expression* rhs )
+{
+    if( lhs->getTag() != rhs->getTag() )
+        return false;
+    if( lhs->getTag() == Thing::T_IdentLeaf )
+        return lhs->getIdent() == rhs->getIdent();
+    Q_ASSERT( lhs->getTag() == Thing::T_Literal );
+    Literal* l = cast<Literal*>(lhs);
+    Literal* r = cast<Literal*>(rhs);
+    return l->d_vtype == r->d_vtype && l->d_val == r->d_val;
+}
+
+struct OptUses : public AstVisitor
+{
+    // the variables a statement or expression assigns, reads, or passes by reference or address
+    QSet<Named*> d_defs;
+    QSet<Named*> d_reads;
+    QSet<Named*> d_escaped;
+
+    void visitStats( const StatSeq& ss )
+    {
+        foreach( const Ref<Statement>& s, ss )
+            s->accept(this);
+    }
+
+    void visit( Call* me )
+    {
+        me->d_what->accept(this);
+    }
+
+    void visit( Return* me )
+    {
+        if( !me->d_what.isNull() )
+            me->d_what->accept(this);
+    }
+
+    void visit( Assign* me )
+    {
+        if( me->d_lhs->getTag() == Thing::T_IdentLeaf )
+            d_defs << me->d_lhs->getIdent();
+        else
+            me->d_lhs->accept(this);
+        me->d_rhs->accept(this);
+    }
+
+    void visit( IfLoop* me )
+    {
+        foreach( const Ref<Expression>& e, me->d_if )
+            e->accept(this);
+        foreach( const StatSeq& ss, me->d_then )
+            visitStats(ss);
+        visitStats(me->d_else);
+    }
+
+    void visit( ForLoop* me )
+    {
+        Named* id = me->d_id->getIdent();
+        d_defs << id;
+        d_reads << id;
+        me->d_from->accept(this);
+        me->d_to->accept(this);
+        if( !me->d_by.isNull() )
+            me->d_by->accept(this);
+        visitStats(me->d_do);
+    }
+
+    void visit( CaseStmt* me )
+    {
+        me->d_exp->accept(this);
+        foreach( const CaseStmt::Case& c, me->d_cases )
+            visitStats(c.d_block);
+        visitStats(me->d_else);
+    }
+
+    void visit( SetExpr* me )
+    {
+        foreach( const Ref<Expression>& e, me->d_parts )
+            e->accept(this);
+    }
+
+    void visit( IdentLeaf* me )
+    {
+        d_reads << me->getIdent();
+    }
+
+    void visit( UnExpr* me )
+    {
+        if( me->d_op == UnExpr::ADDROF && me->d_sub->getTag() == Thing::T_IdentLeaf )
+            d_escaped << me->d_sub->getIdent();
+        me->d_sub->accept(this);
+    }
+
+    void visit( IdentSel* me )
+    {
+        me->d_sub->accept(this);
+    }
+
+    void visit( ArgExpr* me )
+    {
+        me->d_sub->accept(this);
+        Named* id = me->d_sub->getIdent();
+        const bool adr = id && id->getTag() == Thing::T_BuiltIn &&
+                ( cast<BuiltIn*>(id)->d_func == BuiltIn::ADR || cast<BuiltIn*>(id)->d_func == BuiltIn::SYS_ADR );
+        for( int i = 0; i < me->d_args.size(); i++ )
+        {
+            Expression* a = me->d_args[i].data();
+            if( me->d_op == UnExpr::CALL && a->getTag() == Thing::T_IdentLeaf && !isByValue(me,i) )
+            {
+                d_defs << a->getIdent();
+                if( adr )
+                    d_escaped << a->getIdent();
+            }
+            a->accept(this);
+        }
+    }
+
+    void visit( BinExpr* me )
+    {
+        me->d_lhs->accept(this);
+        me->d_rhs->accept(this);
+    }
+};
+
+struct OptScan : public AstVisitor
+{
+    // the size of a procedure body and what it refers to, for the inlining decision
+    int d_count;
+    int d_returns;
+    QSet<Named*> d_names;
+    QSet<Type*> d_types;
+    OptScan():d_count(0),d_returns(0){}
+
+    void visitStats( const StatSeq& ss )
+    {
+        foreach( const Ref<Statement>& s, ss )
+        {
+            d_count++;
+            s->accept(this);
+        }
+    }
+
+    void expr( Expression* e )
+    {
+        d_count++;
+        if( e->d_type.data() )
+            d_types << e->d_type.data();
+        Named* n = e->getIdent();
+        if( n )
+            d_names << n;
+        e->accept(this);
+    }
+
+    void visit( Call* me )
+    {
+        expr(me->d_what.data());
+    }
+
+    void visit( Return* me )
+    {
+        d_returns++;
+        if( !me->d_what.isNull() )
+            expr(me->d_what.data());
+    }
+
+    void visit( Assign* me )
+    {
+        expr(me->d_lhs.data());
+        expr(me->d_rhs.data());
+    }
+
+    void visit( IfLoop* me )
+    {
+        foreach( const Ref<Expression>& e, me->d_if )
+            expr(e.data());
+        foreach( const StatSeq& ss, me->d_then )
+            visitStats(ss);
+        visitStats(me->d_else);
+    }
+
+    void visit( ForLoop* me )
+    {
+        expr(me->d_id.data());
+        expr(me->d_from.data());
+        expr(me->d_to.data());
+        if( !me->d_by.isNull() )
+            expr(me->d_by.data());
+        visitStats(me->d_do);
+    }
+
+    void visit( CaseStmt* me )
+    {
+        expr(me->d_exp.data());
+        foreach( const CaseStmt::Case& c, me->d_cases )
+        {
+            foreach( const Ref<Expression>& l, c.d_labels )
+                expr(l.data());
+            visitStats(c.d_block);
+        }
+        visitStats(me->d_else);
+    }
+
+    void visit( SetExpr* me )
+    {
+        foreach( const Ref<Expression>& e, me->d_parts )
+            expr(e.data());
+    }
+
+    void visit( UnExpr* me )
+    {
+        expr(me->d_sub.data());
+    }
+
+    void visit( IdentSel* me )
+    {
+        expr(me->d_sub.data());
+    }
+
+    void visit( ArgExpr* me )
+    {
+        expr(me->d_sub.data());
+        foreach( const Ref<Expression>& e, me->d_args )
+            expr(e.data());
+    }
+
+    void visit( BinExpr* me )
+    {
+        expr(me->d_lhs.data());
+        expr(me->d_rhs.data());
+    }
+};
+
+struct OptEnv
+{
+    // the values of the tracked variables at a point of the procedure; either a Literal or an IdentLeaf of
+    // another tracked variable
+    QHash<Named*, Ref<Expression> > d_vals;
+    bool d_dead; // the point is unreachable
+    OptEnv():d_dead(false){}
+
+    void kill( Named* n )
+    {
+        d_vals.remove(n);
+        QHash<Named*, Ref<Expression> >::iterator i = d_vals.begin();
+        while( i != d_vals.end() )
+        {
+            if( i.value()->getTag() == Thing::T_IdentLeaf && i.value()->getIdent() == n )
+                i = d_vals.erase(i);
+            else
+                ++i;
+        }
+    }
+
+    void kill( const QSet<Named*>& ns )
+    {
+        foreach( Named* n, ns )
+            kill(n);
+    }
+
+    void join( const OptEnv& rhs )
+    {
+        if( rhs.d_dead )
+            return;
+        if( d_dead )
+        {
+            *this = rhs;
+            return;
+        }
+        QHash<Named*, Ref<Expression> >::iterator i = d_vals.begin();
+        while( i != d_vals.end() )
+        {
+            Expression* r = rhs.d_vals.value(i.key()).data();
+            if( r == 0 || !sameValue( i.value().data(), r ) )
+                i = d_vals.erase(i);
+            else
+                ++i;
+        }
+    }
+};
+
+struct OptimizerImp
+{
+    Procedure* proc;
+    Module* mod;
+    QSet<Named*> tracked;
+    Optimizer::Body res;
+    int inlineDepth;
+    bool closedWorld; // all modules of the program are loaded, so Procedure::d_subs is complete
+
+    OptimizerImp( Procedure* p, bool all ):proc(p),mod(p->getModule()),inlineDepth(0),closedWorld(all) {}
+
+    void run()
+    {
+        OptUses uses;
+        uses.visitStats(proc->d_body);
+        foreach( const Ref<Named>& n, proc->d_order )
+        {
+            const int tag = n->getTag();
+            if( tag != Thing::T_LocalVar && tag != Thing::T_Parameter )
+                continue;
+            if( n->isVarParam() || n->d_receiver || n->d_upvalSource || n->d_scope != proc ||
+                    uses.d_escaped.contains(n.data()) || !isScalar(n->d_type.data()) )
+                continue;
+            tracked << n.data();
+        }
+
+        OptEnv env;
+        stats( proc->d_body, res.d_stats, env );
+        cse( res.d_stats );
+        while( removeDeadStores() )
+            ;
+    }
+
+    static QSet<Named*> defsOf( Thing* t )
+    {
+        OptUses uses;
+        t->accept(&uses);
+        return uses.d_defs;
+    }
+
+    ///////// inlining
+
+    // a procedure is inlined if its body has at most InlineBaseCost + InlineArgCost * args nodes; calls in
+    // inlined bodies are inlined up to MaxInlineDepth
+    enum { InlineBaseCost = 8, InlineArgCost = 3, MaxInlineDepth = 2 };
+
+    LocalVar* newTemp( Type* t, const RowCol& loc )
+    {
+        Ref<LocalVar> v = new LocalVar();
+        v->d_name = "$o" + QByteArray::number(res.d_temps.size());
+        v->d_type = t;
+        v->d_scope = proc;
+        v->d_loc = loc;
+        v->d_synthetic = true;
+        res.d_temps.append(v);
+        return v.data();
+    }
+
+    static Literal* zeroLiteral( Type* t, const RowCol& loc )
+    {
+        // the value the generators initialize a local of type t with
+        Type* td = derefed(t);
+        if( td == 0 )
+            return 0;
+        if( td->getTag() == Thing::T_Enumeration )
+            return new Literal( Literal::Enum, loc, qint64(0), t );
+        if( td->getTag() != Thing::T_BaseType )
+            return 0;
+        if( td->isInteger() )
+            return new Literal( Literal::Integer, loc, qint64(0), t );
+        if( td->isReal() )
+            return new Literal( Literal::Real, loc, 0.0, t );
+        if( td->getBaseType() == Type::BOOLEAN )
+            return new Literal( Literal::Boolean, loc, false, t );
+        if( td->isChar() )
+            return new Literal( Literal::Char, loc, qint64(0), t );
+        return 0;
+    }
+
+    static bool sameType( Type* lhs, Type* rhs )
+    {
+        lhs = derefed(lhs);
+        rhs = derefed(rhs);
+        if( lhs == 0 || rhs == 0 )
+            return false;
+        if( lhs == rhs )
+            return true;
+        return lhs->getTag() == Thing::T_BaseType && rhs->getTag() == Thing::T_BaseType &&
+                lhs->getBaseType() == rhs->getBaseType();
+    }
+
+    static bool isSimpleVar( Expression* e )
+    {
+        if( e->getTag() != Thing::T_IdentLeaf )
+            return false;
+        const int tag = e->getIdent()->getTag();
+        return tag == Thing::T_LocalVar || tag == Thing::T_Parameter || tag == Thing::T_Variable;
+    }
+
+    bool isVisible( Module* m ) const
+    {
+        return m == mod || ( m != 0 && mod->findImport(m) != 0 );
+    }
+
+    bool isVisible( Type* t ) const
+    {
+        // a record or enumeration type of another module can be referred to from mod
+        for( int i = 0; t != 0 && i < 16; i++ )
+        {
+            t = t->derefed();
+            if( t == 0 )
+                return true;
+            switch( t->getTag() )
+            {
+            case Thing::T_Pointer:
+                t = cast<Pointer*>(t)->d_to.data();
+                break;
+            case Thing::T_Array:
+                t = cast<Array*>(t)->d_type.data();
+                break;
+            case Thing::T_Record:
+            case Thing::T_Enumeration:
+                {
+                    Named* decl = t->findDecl(true);
+                    return decl && decl->isPublic() && isVisible(decl->getModule());
+                }
+            default:
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Procedure* inlineCandidate( ArgExpr* call, Expression*& receiver )
+    {
+        // the procedure called by call if it is small, its body is available and cannot be overridden
+        receiver = 0;
+        if( call->d_op != UnExpr::CALL )
+            return 0;
+        Named* id = call->d_sub->getIdent();
+        if( id == 0 || id->getTag() != Thing::T_Procedure )
+            return 0;
+        Procedure* p = cast<Procedure*>(id);
+        if( !p->d_receiver.isNull() )
+        {
+            if( !closedWorld || call->d_sub->getTag() != Thing::T_IdentSel || !p->d_subs.isEmpty() )
+                return 0;
+            receiver = cast<IdentSel*>(call->d_sub.data())->d_sub.data();
+        }
+        if( p == proc || p->d_calling.contains(p) || p->d_noBody || p->hasLazyBody() || p->d_hasErrors ||
+                !p->d_sysAttrs.isEmpty() )
+            return 0;
+        Module* m = p->getModule();
+        if( m == 0 || m->d_isDef || m->d_externC || !m->d_isValidated || m->d_hasErrors )
+            return 0;
+        if( m != mod && !closedWorld )
+            return 0; // the code of mod would be outdated when m changes, but only closedWorld regenerates all modules
+        ProcType* pt = p->getProcType();
+        if( pt->d_varargs || call->d_args.size() != pt->d_formals.size() )
+            return 0;
+        foreach( const Ref<Named>& n, p->d_order )
+        {
+            if( n->getTag() == Thing::T_Procedure || n->d_upvalSource )
+                return 0;
+            if( n->getTag() == Thing::T_LocalVar && zeroLiteral( n->d_type.data(), RowCol() ) == 0 )
+                return 0;
+        }
+        if( p->d_scope && p->d_scope->getTag() == Thing::T_Procedure )
+        {
+            // a nested procedure; the outer locals it uses must be accessible to proc
+            if( p->d_scope != proc )
+                return 0;
+            ProcType* outer = proc->getProcType();
+            foreach( Named* n, pt->d_nonLocals )
+            {
+                if( n->d_scope != proc && !outer->d_nonLocals.contains(n) )
+                    return 0;
+            }
+        }
+        foreach( Procedure* q, p->d_calling )
+        {
+            if( q->d_scope && q->d_scope->getTag() == Thing::T_Procedure )
+                return 0; // the nested procedures called need non-locals proc might not provide
+        }
+
+        // the only RETURN is the last statement
+        OptScan scan;
+        scan.visitStats(p->d_body);
+        Statement* last = p->d_body.isEmpty() ? 0 : p->d_body.last().data();
+        if( scan.d_returns > 1 || ( scan.d_returns == 1 && last->getTag() != Thing::T_Return ) )
+            return 0;
+        if( !pt->d_return.isNull() && scan.d_returns == 0 )
+            return 0;
+        if( scan.d_count > InlineBaseCost + InlineArgCost * call->d_args.size() )
+            return 0;
+
+        if( m != mod )
+        {
+            // the body must only refer to what mod can see
+            foreach( Named* n, scan.d_names )
+            {
+                switch( n->getTag() )
+                {
+                case Thing::T_LocalVar:
+                case Thing::T_Parameter:
+                case Thing::T_Const:
+                case Thing::T_BuiltIn:
+                case Thing::T_Import:
+                    break;
+                case Thing::T_Field:
+                    if( !n->isPublic() )
+                        return 0;
+                    break;
+                default:
+                    if( !n->isPublic() || !isVisible(n->getModule()) )
+                        return 0;
+                    break;
+                }
+            }
+            foreach( Type* t, scan.d_types )
+            {
+                if( !isVisible(t) )
+                    return 0;
+            }
+        }
+        return p;
+    }
+
+    bool expand( Statement* s, StatSeq& out )
+    {
+        // replaces a call statement, v := call or RETURN call by the body of the procedure called
+        ArgExpr* call = 0;
+        switch( s->getTag() )
+        {
+        case Thing::T_Call:
+            call = cast<Call*>(s)->getCallExpr();
+            break;
+        case Thing::T_Assign:
+            if( isSimpleVar( cast<Assign*>(s)->d_lhs.data() ) &&
+                    cast<Assign*>(s)->d_rhs->getTag() == Thing::T_ArgExpr )
+                call = cast<ArgExpr*>( cast<Assign*>(s)->d_rhs.data() );
+            break;
+        case Thing::T_Return:
+            if( !cast<Return*>(s)->d_what.isNull() && cast<Return*>(s)->d_what->getTag() == Thing::T_ArgExpr )
+                call = cast<ArgExpr*>( cast<Return*>(s)->d_what.data() );
+            break;
+        }
+        if( call == 0 )
+            return false;
+        Expression* receiver;
+        Procedure* p = inlineCandidate( call, receiver );
+        if( p == 0 )
+            return false;
+        ProcType* pt = p->getProcType();
+        const bool isFunc = !pt->d_return.isNull();
+        if( isFunc == ( s->getTag() == Thing::T_Call ) )
+            return false; // the result of a function cannot be dropped if it has effects
+
+        Return* ret = 0;
+        if( !p->d_body.isEmpty() && p->d_body.last()->getTag() == Thing::T_Return )
+            ret = cast<Return*>(p->d_body.last().data());
+        if( isFunc && !sameType( ret->d_what->d_type.data(), pt->d_return.data() ) )
+            return false; // the conversion of the RETURN would get lost
+
+        // VAR parameters and a VAR or IN receiver are replaced by the variables passed, if they have the same type;
+        // a receiver passed by value is copied like the other value parameters
+        OptUses uses;
+        uses.visitStats(p->d_body);
+        QHash<Named*,Named*> map;
+        QList<int> byValue;
+        Parameter* r = receiver ? p->d_receiver.data() : 0;
+        if( r )
+        {
+            if( !sameType( receiver->d_type.data(), r->d_type.data() ) || uses.d_escaped.contains(r) )
+                return false;
+            if( r->d_var )
+            {
+                if( !isSimpleVar(receiver) )
+                    return false;
+                map[r] = receiver->getIdent();
+            }else if( derefed(r->d_type.data())->isStructured() )
+                return false;
+        }
+        for( int i = 0; i < pt->d_formals.size(); i++ )
+        {
+            Parameter* f = pt->d_formals[i].data();
+            Expression* a = call->d_args[i].data();
+            if( isScalar(f->d_type.data()) && ( !f->d_var || f->d_const ) )
+                byValue << i;
+            else if( f->isVarParam() && isSimpleVar(a) && sameType( a->d_type.data(), f->d_type.data() ) &&
+                     !uses.d_escaped.contains(f) )
+                map[f] = a->getIdent();
+            else
+                return false;
+        }
+
+        const RowCol loc = s->d_loc;
+        const bool keepLoc = p->getModule() == mod; // otherwise the lines would refer to another file
+        QSet<Named*> temps;
+        if( r && !r->d_var )
+        {
+            LocalVar* t = newTemp( r->d_type.data(), loc );
+            map[r] = t;
+            temps << t;
+            Ref<Assign> a = new Assign();
+            a->d_loc = loc;
+            a->d_lhs = new IdentLeaf( t, loc, mod, r->d_type.data(), LhsRole );
+            a->d_rhs = receiver;
+            out << a.data();
+        }
+        foreach( int i, byValue )
+        {
+            Parameter* f = pt->d_formals[i].data();
+            LocalVar* t = newTemp( f->d_type.data(), loc );
+            map[f] = t;
+            temps << t;
+            Ref<Assign> a = new Assign();
+            a->d_loc = loc;
+            a->d_lhs = new IdentLeaf( t, loc, mod, f->d_type.data(), LhsRole );
+            a->d_rhs = call->d_args[i];
+            out << a.data();
+        }
+        foreach( const Ref<Named>& n, p->d_order )
+        {
+            if( n->getTag() != Thing::T_LocalVar )
+                continue;
+            LocalVar* t = newTemp( n->d_type.data(), loc );
+            map[n.data()] = t;
+            temps << t;
+            Ref<Assign> a = new Assign();
+            a->d_loc = loc;
+            a->d_lhs = new IdentLeaf( t, loc, mod, n->d_type.data(), LhsRole );
+            a->d_rhs = zeroLiteral( n->d_type.data(), loc );
+            out << a.data();
+        }
+
+        const int first = out.size();
+        for( int i = 0; i < p->d_body.size(); i++ )
+        {
+            Statement* st = p->d_body[i].data();
+            if( st == ret )
+                break;
+            out << cloneStat( st, map, keepLoc ? RowCol() : loc );
+        }
+        if( isFunc )
+        {
+            Ref<Expression> e = cloneExpr( ret->d_what.data(), map, keepLoc ? RowCol() : loc );
+            if( s->getTag() == Thing::T_Assign )
+            {
+                Ref<Assign> a = new Assign( *cast<Assign*>(s) );
+                a->d_rhs = e;
+                out << a.data();
+            }else
+            {
+                Ref<Return> r = new Return( *cast<Return*>(s) );
+                r->d_what = e;
+                out << r.data();
+            }
+        }
+
+        // the temporaries are tracked unless the inlined statements take their address
+        OptUses body;
+        for( int i = first; i < out.size(); i++ )
+            out[i]->accept(&body);
+        foreach( Named* t, temps )
+        {
+            if( isScalar(t->d_type.data()) && !body.d_escaped.contains(t) )
+                tracked << t;
+        }
+        return true;
+    }
+
+    Ref<Expression> cloneExpr( Expression* e, const QHash<Named*,Named*>& map, const RowCol& loc )
+    {
+        // a copy of e with the names replaced by map; loc replaces all positions if valid
+        Ref<Expression> res;
+        switch( e->getTag() )
+        {
+        case Thing::T_Literal:
+            res = new Literal( *cast<Literal*>(e) );
+            break;
+        case Thing::T_IdentLeaf:
+            {
+                IdentLeaf* l = cast<IdentLeaf*>(e);
+                Ref<IdentLeaf> n = new IdentLeaf( *l );
+                Named* to = map.value( l->getIdent() );
+                if( to )
+                {
+                    n->d_ident = to;
+                    n->d_name = to->d_name;
+                    n->d_nameId = to->d_nameId;
+                    n->d_mod = mod;
+                }
+                res = n.data();
+            }
+            break;
+        case Thing::T_UnExpr:
+            {
+                Ref<UnExpr> n = new UnExpr( *cast<UnExpr*>(e) );
+                n->d_sub = cloneExpr( n->d_sub.data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_IdentSel:
+            {
+                Ref<IdentSel> n = new IdentSel( *cast<IdentSel*>(e) );
+                n->d_sub = cloneExpr( n->d_sub.data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_ArgExpr:
+            {
+                Ref<ArgExpr> n = new ArgExpr( *cast<ArgExpr*>(e) );
+                n->d_sub = cloneExpr( n->d_sub.data(), map, loc );
+                for( int i = 0; i < n->d_args.size(); i++ )
+                    n->d_args[i] = cloneExpr( n->d_args[i].data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_BinExpr:
+            {
+                Ref<BinExpr> n = new BinExpr( *cast<BinExpr*>(e) );
+                n->d_lhs = cloneExpr( n->d_lhs.data(), map, loc );
+                n->d_rhs = cloneExpr( n->d_rhs.data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_SetExpr:
+            {
+                Ref<SetExpr> n = new SetExpr( *cast<SetExpr*>(e) );
+                for( int i = 0; i < n->d_parts.size(); i++ )
+                    n->d_parts[i] = cloneExpr( n->d_parts[i].data(), map, loc );
+                res = n.data();
+            }
+            break;
+        default:
+            Q_ASSERT( false );
+            return e;
+        }
+        if( loc.isValid() )
+            res->d_loc = loc;
+        return res;
+    }
+
+    StatSeq cloneStats( const StatSeq& ss, const QHash<Named*,Named*>& map, const RowCol& loc )
+    {
+        StatSeq res;
+        foreach( const Ref<Statement>& s, ss )
+            res << cloneStat( s.data(), map, loc );
+        return res;
+    }
+
+    Ref<Statement> cloneStat( Statement* s, const QHash<Named*,Named*>& map, const RowCol& loc )
+    {
+        Ref<Statement> res;
+        switch( s->getTag() )
+        {
+        case Thing::T_Call:
+            {
+                Ref<Call> n = new Call( *cast<Call*>(s) );
+                n->d_what = cloneExpr( n->d_what.data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_Return:
+            {
+                Ref<Return> n = new Return( *cast<Return*>(s) );
+                if( !n->d_what.isNull() )
+                    n->d_what = cloneExpr( n->d_what.data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_Exit:
+            res = new Exit( *cast<Exit*>(s) );
+            break;
+        case Thing::T_Assign:
+            {
+                Ref<Assign> n = new Assign( *cast<Assign*>(s) );
+                n->d_lhs = cloneExpr( n->d_lhs.data(), map, loc );
+                n->d_rhs = cloneExpr( n->d_rhs.data(), map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_IfLoop:
+            {
+                Ref<IfLoop> n = new IfLoop( *cast<IfLoop*>(s) );
+                for( int i = 0; i < n->d_if.size(); i++ )
+                    n->d_if[i] = cloneExpr( n->d_if[i].data(), map, loc );
+                for( int i = 0; i < n->d_then.size(); i++ )
+                    n->d_then[i] = cloneStats( n->d_then[i], map, loc );
+                n->d_else = cloneStats( n->d_else, map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_ForLoop:
+            {
+                Ref<ForLoop> n = new ForLoop( *cast<ForLoop*>(s) );
+                n->d_id = cloneExpr( n->d_id.data(), map, loc );
+                n->d_from = cloneExpr( n->d_from.data(), map, loc );
+                n->d_to = cloneExpr( n->d_to.data(), map, loc );
+                if( !n->d_by.isNull() )
+                    n->d_by = cloneExpr( n->d_by.data(), map, loc );
+                n->d_do = cloneStats( n->d_do, map, loc );
+                res = n.data();
+            }
+            break;
+        case Thing::T_CaseStmt:
+            {
+                Ref<CaseStmt> n = new CaseStmt( *cast<CaseStmt*>(s) );
+                n->d_exp = cloneExpr( n->d_exp.data(), map, loc );
+                for( int i = 0; i < n->d_cases.size(); i++ )
+                {
+                    for( int j = 0; j < n->d_cases[i].d_labels.size(); j++ )
+                        n->d_cases[i].d_labels[j] = cloneExpr( n->d_cases[i].d_labels[j].data(), map, loc );
+                    n->d_cases[i].d_block = cloneStats( n->d_cases[i].d_block, map, loc );
+                }
+                n->d_else = cloneStats( n->d_else, map, loc );
+                res = n.data();
+            }
+            break;
+        default:
+            Q_ASSERT( false );
+            return s;
+        }
+        if( loc.isValid() )
+            res->d_loc = loc;
+        return res;
+    }
+
+    ///////// constant and copy propagation, folding and unreachable code
+
+    void stats( const StatSeq& in, StatSeq& out, OptEnv& env )
+    {
+        foreach( const Ref<Statement>& s, in )
+        {
+            if( env.d_dead )
+                break; // after RETURN or EXIT
+            stat( s.data(), out, env );
+        }
+    }
+
+    void stat( Statement* s, StatSeq& out, OptEnv& env )
+    {
+        StatSeq inlined;
+        if( inlineDepth < MaxInlineDepth && expand( s, inlined ) )
+        {
+            inlineDepth++;
+            stats( inlined, out, env );
+            inlineDepth--;
+            return;
+        }
+        switch( s->getTag() )
+        {
+        case Thing::T_Assign:
+            assign( cast<Assign*>(s), out, env );
+            break;
+        case Thing::T_Call:
+            {
+                Call* c = cast<Call*>(s);
+                Ref<Expression> what = expression( c->d_what.data(), env, true );
+                if( what.data() == c->d_what.data() )
+                    out << s;
+                else
+                {
+                    Ref<Call> n = new Call(*c);
+                    n->d_what = what;
+                    out << n.data();
+                }
+            }
+            break;
+        case Thing::T_Return:
+            {
+                Return* r = cast<Return*>(s);
+                Ref<Expression> what;
+                if( !r->d_what.isNull() )
+                {
+                    ProcType* pt = proc->getProcType();
+                    what = expression( r->d_what.data(), env, isScalar(pt->d_return.data()) );
+                }
+                if( what.data() == r->d_what.data() )
+                    out << s;
+                else
+                {
+                    Ref<Return> n = new Return(*r);
+                    n->d_what = what;
+                    out << n.data();
+                }
+                env.d_dead = true;
+            }
+            break;
+        case Thing::T_Exit:
+            out << s;
+            env.d_dead = true;
+            break;
+        case Thing::T_IfLoop:
+            {
+                IfLoop* l = cast<IfLoop*>(s);
+                switch( l->d_op )
+                {
+                case IfLoop::IF:
+                case IfLoop::WITH:
+                    ifStat( l, out, env );
+                    break;
+                case IfLoop::WHILE:
+                    whileStat( l, out, env );
+                    break;
+                case IfLoop::REPEAT:
+                case IfLoop::LOOP:
+                    loopStat( l, out, env );
+                    break;
+                }
+            }
+            break;
+        case Thing::T_ForLoop:
+            forStat( cast<ForLoop*>(s), out, env );
+            break;
+        case Thing::T_CaseStmt:
+            caseStat( cast<CaseStmt*>(s), out, env );
+            break;
+        default:
+            out << s;
+            break;
+        }
+    }
+
+    void assign( Assign* me, StatSeq& out, OptEnv& env )
+    {
+        QSet<Named*> kills = defsOf(me->d_rhs.data());
+        Named* lhs = me->d_lhs->getTag() == Thing::T_IdentLeaf ? me->d_lhs->getIdent() : 0;
+        if( lhs == 0 )
+            kills += defsOf(me->d_lhs.data());
+        OptEnv use = env;
+        use.kill(kills);
+        Ref<Expression> l = me->d_lhs;
+        if( lhs == 0 )
+            l = rewrite( me->d_lhs.data(), use, false );
+        Ref<Expression> r = rewrite( me->d_rhs.data(), use, isScalar(me->d_lhs->d_type.data()) );
+        env.kill(kills);
+
+        if( lhs && tracked.contains(lhs) )
+        {
+            env.kill(lhs);
+            qint64 val;
+            quint8 vtype;
+            if( constValue( r.data(), val, vtype ) && fitsType( lhs->d_type.data(), vtype ) )
+                env.d_vals[lhs] = makeLiteral( vtype, vtype == Literal::Integer ?
+                                                   truncated(lhs->d_type.data(), val) : val,
+                                               lhs->d_type.data(), me->d_loc );
+            else if( r->getTag() == Thing::T_IdentLeaf && r->getIdent() != lhs && tracked.contains(r->getIdent()) &&
+                     derefed(r->getIdent()->d_type.data()) == derefed(lhs->d_type.data()) )
+                env.d_vals[lhs] = r;
+        }
+
+        if( l.data() == me->d_lhs.data() && r.data() == me->d_rhs.data() )
+            out << me;
+        else
+        {
+            Ref<Assign> n = new Assign(*me);
+            n->d_lhs = l;
+            n->d_rhs = r;
+            out << n.data();
+        }
+    }
+
+    void ifStat( IfLoop* me, StatSeq& out, OptEnv& env )
+    {
+        Ref<IfLoop> n = new IfLoop();
+        n->d_op = me->d_op;
+        n->d_loc = me->d_loc;
+        OptEnv res;
+        res.d_dead = true;
+        bool taken = false;
+        for( int i = 0; i < me->d_if.size(); i++ )
+        {
+            Ref<Expression> cond = expression( me->d_if[i].data(), env, me->d_op == IfLoop::IF );
+            qint64 val;
+            quint8 vtype;
+            if( me->d_op == IfLoop::IF && constValue( cond.data(), val, vtype ) )
+            {
+                if( val == 0 )
+                    continue; // never taken
+                // always taken when reached, so it is the ELSE
+                OptEnv branch = env;
+                if( n->d_if.isEmpty() )
+                    stats( me->d_then[i], out, branch );
+                else
+                    stats( me->d_then[i], n->d_else, branch );
+                res.join(branch);
+                taken = true;
+                break;
+            }
+            n->d_if << cond;
+            n->d_then << StatSeq();
+            OptEnv branch = env;
+            stats( me->d_then[i], n->d_then.back(), branch );
+            res.join(branch);
+        }
+        if( !taken )
+        {
+            OptEnv branch = env;
+            if( n->d_if.isEmpty() )
+                stats( me->d_else, out, branch );
+            else
+                stats( me->d_else, n->d_else, branch );
+            res.join(branch);
+        }
+        if( !n->d_if.isEmpty() )
+            out << n.data();
+        env = res;
+    }
+
+    void whileStat( IfLoop* me, StatSeq& out, OptEnv& env )
+    {
+        // only the values of the variables the loop doesn't assign hold at the begin of each iteration
+        env.kill( defsOf(me) );
+        Ref<IfLoop> n = new IfLoop();
+        n->d_op = me->d_op;
+        n->d_loc = me->d_loc;
+        bool never = true;
+        for( int i = 0; i < me->d_if.size(); i++ )
+        {
+            n->d_if << expression( me->d_if[i].data(), env, true );
+            qint64 val;
+            quint8 vtype;
+            if( !constValue( n->d_if.back().data(), val, vtype ) || val != 0 )
+                never = false;
+            n->d_then << StatSeq();
+            OptEnv branch = env;
+            stats( me->d_then[i], n->d_then.back(), branch );
+        }
+        if( !never )
+            out << n.data();
+    }
+
+    void loopStat( IfLoop* me, StatSeq& out, OptEnv& env )
+    {
+        env.kill( defsOf(me) );
+        Ref<IfLoop> n = new IfLoop();
+        n->d_op = me->d_op;
+        n->d_loc = me->d_loc;
+        n->d_then << StatSeq();
+        OptEnv body = env;
+        stats( me->d_then.first(), n->d_then.first(), body );
+        if( me->d_op == IfLoop::REPEAT )
+        {
+            n->d_if << expression( me->d_if.first().data(), body, true );
+            env = body; // the loop is left right after the condition
+        }
+        out << n.data();
+    }
+
+    void forStat( ForLoop* me, StatSeq& out, OptEnv& env )
+    {
+        Ref<ForLoop> n = new ForLoop(*me);
+        n->d_from = expression( me->d_from.data(), env, true );
+        OptEnv head = env; // to is evaluated once after id := from, see lowerFor
+        head.kill( me->d_id->getIdent() );
+        n->d_to = expression( me->d_to.data(), head, true );
+        if( Optimizer::countedLoop(n.data()).d_trips == 0 )
+        {
+            // only id := from remains; to is constant
+            Ref<Assign> a = new Assign();
+            a->d_loc = me->d_loc;
+            a->d_lhs = me->d_id;
+            a->d_rhs = n->d_from;
+            assign( a.data(), out, env );
+            return;
+        }
+        env.kill( defsOf(me) );
+        n->d_do.clear();
+        OptEnv body = env;
+        stats( me->d_do, n->d_do, body );
+        out << n.data();
+    }
+
+    void caseStat( CaseStmt* me, StatSeq& out, OptEnv& env )
+    {
+        Ref<CaseStmt> n = new CaseStmt(*me);
+        if( !me->d_typeCase )
+            n->d_exp = expression( me->d_exp.data(), env, true );
+
+        qint64 sel;
+        quint8 vtype;
+        if( !me->d_typeCase && constValue( n->d_exp.data(), sel, vtype ) )
+        {
+            const int hit = findCase( me, sel );
+            if( hit >= 0 )
+            {
+                stats( me->d_cases[hit].d_block, out, env );
+                return;
+            }else if( hit == -1 && !me->d_else.isEmpty() )
+            {
+                stats( me->d_else, out, env );
+                return;
+            }
+        }
+
+        OptEnv res = env; // the path where no case matches and there is no ELSE
+        if( !me->d_else.isEmpty() )
+            res.d_dead = true;
+        for( int i = 0; i < n->d_cases.size(); i++ )
+        {
+            n->d_cases[i].d_block.clear();
+            OptEnv branch = env;
+            stats( me->d_cases[i].d_block, n->d_cases[i].d_block, branch );
+            res.join(branch);
+        }
+        n->d_else.clear();
+        OptEnv branch = env;
+        stats( me->d_else, n->d_else, branch );
+        res.join(branch);
+        out << n.data();
+        env = res;
+    }
+
+    int findCase( CaseStmt* me, qint64 sel )
+    {
+        // index of the case with a label matching sel, -1 if none, -2 if not all labels are known
+        Optimizer::CaseTable t;
+        if( !Optimizer::caseTable( me, proc, t ) )
+            return -2;
+        return t.find(sel);
+    }
+
+    ///////// expressions
+
+    Ref<Expression> expression( Expression* e, OptEnv& env, bool scalarContext )
+    {
+        // a variable changed by a call in e is not replaced anywhere in e; the changes are applied afterwards
+        const QSet<Named*> kills = defsOf(e);
+        Ref<Expression> res;
+        if( kills.isEmpty() )
+            res = rewrite( e, env, scalarContext );
+        else
+        {
+            OptEnv use = env;
+            use.kill(kills);
+            res = rewrite( e, use, scalarContext );
+            env.kill(kills);
+        }
+        return res;
+    }
+
+    Ref<Expression> rewrite( Expression* e, const OptEnv& env, bool replace )
+    {
+        // replace: e itself may be replaced by its value, otherwise only its parts
+        switch( e->getTag() )
+        {
+        case Thing::T_IdentLeaf:
+            if( replace && tracked.contains(e->getIdent()) )
+            {
+                Expression* v = env.d_vals.value(e->getIdent()).data();
+                if( v && v->getTag() == Thing::T_Literal )
+                {
+                    Ref<Literal> l = new Literal( *cast<Literal*>(v) );
+                    l->d_loc = e->d_loc;
+                    l->d_type = e->d_type;
+                    return l.data();
+                }else if( v )
+                    return new IdentLeaf( v->getIdent(), e->d_loc, cast<IdentLeaf*>(e)->d_mod, e->d_type.data(),
+                                          RhsRole );
+            }
+            return e;
+        case Thing::T_UnExpr:
+            {
+                UnExpr* u = cast<UnExpr*>(e);
+                if( u->d_op == UnExpr::ADDROF )
+                    return e;
+                Ref<Expression> sub = rewrite( u->d_sub.data(), env,
+                                               u->d_op != UnExpr::DEREF && isScalar(u->d_sub->d_type.data()) );
+                Ref<Expression> f = foldUnary( u, sub.data() );
+                if( f )
+                    return f;
+                if( sub.data() == u->d_sub.data() )
+                    return e;
+                Ref<UnExpr> n = new UnExpr(*u);
+                n->d_sub = sub;
+                return n.data();
+            }
+        case Thing::T_IdentSel:
+            {
+                IdentSel* s = cast<IdentSel*>(e);
+                Ref<Expression> sub = rewrite( s->d_sub.data(), env, false );
+                if( sub.data() == s->d_sub.data() )
+                    return e;
+                Ref<IdentSel> n = new IdentSel(*s);
+                n->d_sub = sub;
+                return n.data();
+            }
+        case Thing::T_ArgExpr:
+            {
+                ArgExpr* a = cast<ArgExpr*>(e);
+                Ref<Expression> sub = rewrite( a->d_sub.data(), env, false );
+                ExpList args = a->d_args;
+                bool changed = sub.data() != a->d_sub.data();
+                if( a->d_op != UnExpr::CAST )
+                {
+                    for( int i = 0; i < args.size(); i++ )
+                    {
+                        const bool byVal = a->d_op == UnExpr::IDX || isByValue(a,i);
+                        Ref<Expression> arg = rewrite( args[i].data(), env, byVal );
+                        if( arg.data() != args[i].data() )
+                        {
+                            args[i] = arg;
+                            changed = true;
+                        }
+                    }
+                }
+                if( !changed )
+                    return e;
+                Ref<ArgExpr> n = new ArgExpr(*a);
+                n->d_sub = sub;
+                n->d_args = args;
+                return n.data();
+            }
+        case Thing::T_BinExpr:
+            {
+                BinExpr* b = cast<BinExpr*>(e);
+                const bool scalar = b->d_op != BinExpr::IS && isScalar(b->d_lhs->d_type.data()) &&
+                        isScalar(b->d_rhs->d_type.data());
+                Ref<Expression> lhs = rewrite( b->d_lhs.data(), env, scalar );
+                Ref<Expression> rhs = rewrite( b->d_rhs.data(), env, scalar );
+                Ref<Expression> f = foldBinary( b, lhs.data(), rhs.data() );
+                if( f )
+                    return f;
+                if( lhs.data() == b->d_lhs.data() && rhs.data() == b->d_rhs.data() )
+                    return e;
+                Ref<BinExpr> n = new BinExpr(*b);
+                n->d_lhs = lhs;
+                n->d_rhs = rhs;
+                return n.data();
+            }
+        case Thing::T_SetExpr:
+            {
+                SetExpr* s = cast<SetExpr*>(e);
+                ExpList parts = s->d_parts;
+                bool changed = false;
+                for( int i = 0; i < parts.size(); i++ )
+                {
+                    Ref<Expression> p = rewrite( parts[i].data(), env, true );
+                    if( p.data() != parts[i].data() )
+                    {
+                        parts[i] = p;
+                        changed = true;
+                    }
+                }
+                if( !changed )
+                    return e;
+                Ref<SetExpr> n = new SetExpr(*s);
+                n->d_parts = parts;
+                return n.data();
+            }
+        default:
+            return e;
+        }
+    }
+
+    static bool arith( quint8 op, qint64 a, qint64 b, bool wide, qint64& res )
+    {
+        // the result if it is the same on all backends, i.e. no overflow in the 32 or 64 bit arithmetic they use
+        const qint64 maxv = wide ? std::numeric_limits<qint64>::max() : std::numeric_limits<qint32>::max();
+        const qint64 minv = wide ? std::numeric_limits<qint64>::min() : std::numeric_limits<qint32>::min();
+        switch( op )
+        {
+        case BinExpr::ADD:
+            if( ( b > 0 && a > maxv - b ) || ( b < 0 && a < minv - b ) )
+                return false;
+            res = a + b;
+            return true;
+        case BinExpr::SUB:
+            if( ( b < 0 && a > maxv + b ) || ( b > 0 && a < minv + b ) )
+                return false;
+            res = a - b;
+            return true;
+        case BinExpr::MUL:
+            {
+                const qint64 lim = qint64(1) << ( wide ? 31 : 15 );
+                if( a <= -lim || a >= lim || b <= -lim || b >= lim )
+                    return false;
+                res = a * b;
+                return true;
+            }
+        case BinExpr::DIV:
+            if( a < 0 || b <= 0 )
+                return false; // only where floor and truncating division agree
+            res = a / b;
+            return true;
+        case BinExpr::MOD:
+            if( a < 0 || b <= 0 )
+                return false;
+            res = a % b;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static Ref<Expression> foldBinary( BinExpr* e, Expression* lhs, Expression* rhs )
+    {
+        qint64 a, b;
+        quint8 ta, tb;
+        const bool lc = constValue( lhs, a, ta );
+        if( lc && ta == Literal::Boolean && ( e->d_op == BinExpr::AND || e->d_op == BinExpr::OR ) )
+        {
+            // rhs is only evaluated if the result is still open
+            if( e->d_op == BinExpr::AND )
+                return a ? rhs : makeLiteral( Literal::Boolean, 0, e->d_type.data(), e->d_loc );
+            else
+                return a ? makeLiteral( Literal::Boolean, 1, e->d_type.data(), e->d_loc ) : rhs;
+        }
+        if( !lc || !constValue( rhs, b, tb ) || ta != tb )
+            return Ref<Expression>();
+        Type* t = derefed(e->d_type.data());
+        if( t == 0 )
+            return Ref<Expression>();
+        switch( e->d_op )
+        {
+        case BinExpr::EQ:
+            return makeLiteral( Literal::Boolean, a == b, t, e->d_loc );
+        case BinExpr::NEQ:
+            return makeLiteral( Literal::Boolean, a != b, t, e->d_loc );
+        case BinExpr::LT:
+            return makeLiteral( Literal::Boolean, a < b, t, e->d_loc );
+        case BinExpr::LEQ:
+            return makeLiteral( Literal::Boolean, a <= b, t, e->d_loc );
+        case BinExpr::GT:
+            return makeLiteral( Literal::Boolean, a > b, t, e->d_loc );
+        case BinExpr::GEQ:
+            return makeLiteral( Literal::Boolean, a >= b, t, e->d_loc );
+        case BinExpr::ADD:
+        case BinExpr::SUB:
+        case BinExpr::MUL:
+        case BinExpr::DIV:
+        case BinExpr::MOD:
+            {
+                qint64 res;
+                if( ta != Literal::Integer || !t->isInteger() ||
+                        !arith( e->d_op, a, b, t->getBaseType() == Type::INT64, res ) )
+                    return Ref<Expression>();
+                return makeLiteral( Literal::Integer, res, e->d_type.data(), e->d_loc );
+            }
+        default:
+            return Ref<Expression>();
+        }
+    }
+
+    static Ref<Expression> foldUnary( UnExpr* e, Expression* sub )
+    {
+        qint64 a;
+        quint8 ta;
+        if( !constValue( sub, a, ta ) )
+            return Ref<Expression>();
+        Type* t = derefed(e->d_type.data());
+        if( e->d_op == UnExpr::NOT && ta == Literal::Boolean )
+            return makeLiteral( Literal::Boolean, !a, e->d_type.data(), e->d_loc );
+        qint64 res;
+        if( e->d_op == UnExpr::NEG && ta == Literal::Integer && t && t->isInteger() &&
+                arith( BinExpr::SUB, 0, a, t->getBaseType() == Type::INT64, res ) )
+            return makeLiteral( Literal::Integer, res, e->d_type.data(), e->d_loc );
+        return Ref<Expression>();
+    }
+
+    ///////// common subexpressions
+
+    struct Occurrence
+    {
+        int d_stat;
+        Expression* d_expr;
+        int d_size;
+    };
+
+    bool isCandidate( Expression* e, const QSet<Named*>& kills, int& size ) const
+    {
+        // integer +, - and * of tracked variables and literals; other operations could trap
+        switch( e->getTag() )
+        {
+        case Thing::T_Literal:
+            size = 1;
+            return true;
+        case Thing::T_IdentLeaf:
+            size = 1;
+            return tracked.contains(e->getIdent()) && !kills.contains(e->getIdent());
+        case Thing::T_BinExpr:
+            {
+                BinExpr* b = cast<BinExpr*>(e);
+                Type* t = derefed(b->d_type.data());
+                if( t == 0 || !t->isInteger() ||
+                        ( b->d_op != BinExpr::ADD && b->d_op != BinExpr::SUB && b->d_op != BinExpr::MUL ) )
+                    return false;
+                int l, r;
+                if( !isCandidate( b->d_lhs.data(), kills, l ) || !isCandidate( b->d_rhs.data(), kills, r ) )
+                    return false;
+                size = l + r + 1;
+                return true;
+            }
+        default:
+            return false;
+        }
+    }
+
+    static QByteArray keyOf( Expression* e, const QHash<Named*,int>& versions )
+    {
+        switch( e->getTag() )
+        {
+        case Thing::T_Literal:
+            return "l" + QByteArray::number( cast<Literal*>(e)->d_vtype ) + ":" +
+                    cast<Literal*>(e)->d_val.toByteArray();
+        case Thing::T_IdentLeaf:
+            return "v" + QByteArray::number( quintptr(e->getIdent()) ) + "." +
+                    QByteArray::number( versions.value(e->getIdent()) );
+        case Thing::T_BinExpr:
+            {
+                BinExpr* b = cast<BinExpr*>(e);
+                return BinExpr::s_opName[b->d_op] + QByteArray::number( derefed(b->d_type.data())->getBaseType() ) +
+                        "(" + keyOf( b->d_lhs.data(), versions ) + "," + keyOf( b->d_rhs.data(), versions ) + ")";
+            }
+        default:
+            Q_ASSERT( false );
+            return QByteArray();
+        }
+    }
+
+    void collect( Expression* e, int stat, const QSet<Named*>& kills, const QHash<Named*,int>& versions,
+                  QHash<QByteArray, QList<Occurrence> >& occs ) const
+    {
+        int size;
+        if( e->getTag() == Thing::T_BinExpr && isCandidate( e, kills, size ) && size > 1 )
+        {
+            Occurrence o;
+            o.d_stat = stat;
+            o.d_expr = e;
+            o.d_size = size;
+            occs[keyOf(e,versions)].append(o);
+        }
+        switch( e->getTag() )
+        {
+        case Thing::T_UnExpr:
+        case Thing::T_IdentSel:
+            collect( cast<UnExpr*>(e)->d_sub.data(), stat, kills, versions, occs );
+            break;
+        case Thing::T_ArgExpr:
+            collect( cast<UnExpr*>(e)->d_sub.data(), stat, kills, versions, occs );
+            if( cast<ArgExpr*>(e)->d_op != UnExpr::CAST )
+                foreach( const Ref<Expression>& a, cast<ArgExpr*>(e)->d_args )
+                    collect( a.data(), stat, kills, versions, occs );
+            break;
+        case Thing::T_BinExpr:
+            collect( cast<BinExpr*>(e)->d_lhs.data(), stat, kills, versions, occs );
+            collect( cast<BinExpr*>(e)->d_rhs.data(), stat, kills, versions, occs );
+            break;
+        case Thing::T_SetExpr:
+            foreach( const Ref<Expression>& p, cast<SetExpr*>(e)->d_parts )
+                collect( p.data(), stat, kills, versions, occs );
+            break;
+        }
+    }
+
+    static Ref<Expression> replaced( Expression* e, const QSet<Expression*>& what, Expression* by )
+    {
+        // e with the subexpressions in what replaced by by; only the path to them is copied
+        if( what.contains(e) )
+        {
+            Ref<IdentLeaf> l = new IdentLeaf( *cast<IdentLeaf*>(by) );
+            l->d_loc = e->d_loc;
+            return l.data();
+        }
+        switch( e->getTag() )
+        {
+        case Thing::T_UnExpr:
+        case Thing::T_IdentSel:
+        case Thing::T_ArgExpr:
+            {
+                UnExpr* u = cast<UnExpr*>(e);
+                Ref<Expression> sub = replaced( u->d_sub.data(), what, by );
+                ExpList args;
+                bool changed = sub.data() != u->d_sub.data();
+                if( e->getTag() == Thing::T_ArgExpr )
+                {
+                    args = cast<ArgExpr*>(e)->d_args;
+                    for( int i = 0; i < args.size(); i++ )
+                    {
+                        Ref<Expression> a = replaced( args[i].data(), what, by );
+                        if( a.data() != args[i].data() )
+                        {
+                            args[i] = a;
+                            changed = true;
+                        }
+                    }
+                }
+                if( !changed )
+                    return e;
+                Ref<UnExpr> n;
+                if( e->getTag() == Thing::T_ArgExpr )
+                {
+                    Ref<ArgExpr> a = new ArgExpr(*cast<ArgExpr*>(e));
+                    a->d_args = args;
+                    n = a.data();
+                }else if( e->getTag() == Thing::T_IdentSel )
+                    n = new IdentSel(*cast<IdentSel*>(e));
+                else
+                    n = new UnExpr(*u);
+                n->d_sub = sub;
+                return n.data();
+            }
+        case Thing::T_BinExpr:
+            {
+                BinExpr* b = cast<BinExpr*>(e);
+                Ref<Expression> lhs = replaced( b->d_lhs.data(), what, by );
+                Ref<Expression> rhs = replaced( b->d_rhs.data(), what, by );
+                if( lhs.data() == b->d_lhs.data() && rhs.data() == b->d_rhs.data() )
+                    return e;
+                Ref<BinExpr> n = new BinExpr(*b);
+                n->d_lhs = lhs;
+                n->d_rhs = rhs;
+                return n.data();
+            }
+        case Thing::T_SetExpr:
+            {
+                SetExpr* s = cast<SetExpr*>(e);
+                ExpList parts = s->d_parts;
+                bool changed = false;
+                for( int i = 0; i < parts.size(); i++ )
+                {
+                    Ref<Expression> p = replaced( parts[i].data(), what, by );
+                    if( p.data() != parts[i].data() )
+                    {
+                        parts[i] = p;
+                        changed = true;
+                    }
+                }
+                if( !changed )
+                    return e;
+                Ref<SetExpr> n = new SetExpr(*s);
+                n->d_parts = parts;
+                return n.data();
+            }
+        default:
+            return e;
+        }
+    }
+
+    static Ref<Statement> replaced( Statement* s, const QSet<Expression*>& what, Expression* by )
+    {
+        switch( s->getTag() )
+        {
+        case Thing::T_Assign:
+            {
+                Assign* a = cast<Assign*>(s);
+                Ref<Expression> lhs = replaced( a->d_lhs.data(), what, by );
+                Ref<Expression> rhs = replaced( a->d_rhs.data(), what, by );
+                if( lhs.data() == a->d_lhs.data() && rhs.data() == a->d_rhs.data() )
+                    return s;
+                Ref<Assign> n = new Assign(*a);
+                n->d_lhs = lhs;
+                n->d_rhs = rhs;
+                return n.data();
+            }
+        case Thing::T_Call:
+            {
+                Call* c = cast<Call*>(s);
+                Ref<Expression> e = replaced( c->d_what.data(), what, by );
+                if( e.data() == c->d_what.data() )
+                    return s;
+                Ref<Call> n = new Call(*c);
+                n->d_what = e;
+                return n.data();
+            }
+        case Thing::T_Return:
+            {
+                Return* r = cast<Return*>(s);
+                if( r->d_what.isNull() )
+                    return s;
+                Ref<Expression> e = replaced( r->d_what.data(), what, by );
+                if( e.data() == r->d_what.data() )
+                    return s;
+                Ref<Return> n = new Return(*r);
+                n->d_what = e;
+                return n.data();
+            }
+        default:
+            return s;
+        }
+    }
+
+    static bool isSimple( Statement* s )
+    {
+        const int tag = s->getTag();
+        return tag == Thing::T_Assign || tag == Thing::T_Call || tag == Thing::T_Return;
+    }
+
+    void cse( StatSeq& seq )
+    {
+        int i = 0;
+        while( i < seq.size() )
+        {
+            if( isSimple(seq[i].data()) )
+            {
+                int end = i;
+                while( end < seq.size() && isSimple(seq[end].data()) )
+                    end++;
+                while( cseRun( seq, i, end ) )
+                    end++;
+                i = end;
+                continue;
+            }
+            // the compound statements were created by stats() and can be modified
+            Statement* s = seq[i].data();
+            switch( s->getTag() )
+            {
+            case Thing::T_IfLoop:
+                {
+                    IfLoop* l = cast<IfLoop*>(s);
+                    for( int j = 0; j < l->d_then.size(); j++ )
+                        cse( l->d_then[j] );
+                    cse( l->d_else );
+                }
+                break;
+            case Thing::T_ForLoop:
+                cse( cast<ForLoop*>(s)->d_do );
+                break;
+            case Thing::T_CaseStmt:
+                {
+                    CaseStmt* c = cast<CaseStmt*>(s);
+                    for( int j = 0; j < c->d_cases.size(); j++ )
+                        cse( c->d_cases[j].d_block );
+                    cse( c->d_else );
+                }
+                break;
+            }
+            i++;
+        }
+    }
+
+    bool cseRun( StatSeq& seq, int from, int to )
+    {
+        // replaces the largest expression computed more than once in seq[from..to) by a temporary
+        QHash<Named*,int> versions;
+        QHash<QByteArray, QList<Occurrence> > occs;
+        for( int i = from; i < to; i++ )
+        {
+            Statement* s = seq[i].data();
+            const QSet<Named*> kills = defsOf(s);
+            switch( s->getTag() )
+            {
+            case Thing::T_Assign:
+                collect( cast<Assign*>(s)->d_rhs.data(), i, kills, versions, occs );
+                if( cast<Assign*>(s)->d_lhs->getTag() != Thing::T_IdentLeaf )
+                    collect( cast<Assign*>(s)->d_lhs.data(), i, kills, versions, occs );
+                break;
+            case Thing::T_Call:
+                collect( cast<Call*>(s)->d_what.data(), i, kills, versions, occs );
+                break;
+            case Thing::T_Return:
+                if( !cast<Return*>(s)->d_what.isNull() )
+                    collect( cast<Return*>(s)->d_what.data(), i, kills, versions, occs );
+                break;
+            }
+            foreach( Named* n, kills )
+                versions[n]++;
+        }
+
+        const QList<Occurrence>* best = 0;
+        QHash<QByteArray, QList<Occurrence> >::const_iterator j;
+        for( j = occs.constBegin(); j != occs.constEnd(); ++j )
+        {
+            if( j.value().size() > 1 && ( best == 0 || j.value().first().d_size > best->first().d_size ) )
+                best = &j.value();
+        }
+        if( best == 0 )
+            return false;
+
+        Expression* e = best->first().d_expr;
+        LocalVar* t = newTemp( e->d_type.data(), e->d_loc );
+        tracked << t;
+
+        Ref<IdentLeaf> use = new IdentLeaf( t, e->d_loc, mod, e->d_type.data(), RhsRole );
+        QSet<Expression*> what;
+        foreach( const Occurrence& o, *best )
+            what << o.d_expr;
+        for( int i = from; i < to; i++ )
+            seq[i] = replaced( seq[i].data(), what, use.data() );
+
+        Ref<Assign> a = new Assign();
+        a->d_loc = e->d_loc;
+        a->d_lhs = new IdentLeaf( t, e->d_loc, mod, e->d_type.data(), LhsRole );
+        a->d_rhs = e;
+        seq.insert( best->first().d_stat, a.data() );
+        return true;
+    }
+
+    ///////// dead stores
+
+    static bool isPure( Expression* e )
+    {
+        // evaluation cannot trap nor change anything
+        switch( e->getTag() )
+        {
+        case Thing::T_Literal:
+            return true;
+        case Thing::T_IdentLeaf:
+            {
+                Named* n = e->getIdent();
+                return n && ( n->getTag() == Thing::T_LocalVar || n->getTag() == Thing::T_Parameter ||
+                              n->getTag() == Thing::T_Variable || n->getTag() == Thing::T_Const );
+            }
+        case Thing::T_UnExpr:
+            return cast<UnExpr*>(e)->d_op == UnExpr::NOT && isPure( cast<UnExpr*>(e)->d_sub.data() );
+        case Thing::T_BinExpr:
+            {
+                BinExpr* b = cast<BinExpr*>(e);
+                switch( b->d_op )
+                {
+                case BinExpr::EQ:
+                case BinExpr::NEQ:
+                case BinExpr::LT:
+                case BinExpr::LEQ:
+                case BinExpr::GT:
+                case BinExpr::GEQ:
+                case BinExpr::AND:
+                case BinExpr::OR:
+                    return isScalar(b->d_lhs->d_type.data()) && isScalar(b->d_rhs->d_type.data()) &&
+                            isPure(b->d_lhs.data()) && isPure(b->d_rhs.data());
+                default:
+                    return false;
+                }
+            }
+        default:
+            return false;
+        }
+    }
+
+    static bool removeStores( StatSeq& seq, const QSet<Named*>& dead )
+    {
+        bool changed = false;
+        for( int i = seq.size() - 1; i >= 0; i-- )
+        {
+            Statement* s = seq[i].data();
+            switch( s->getTag() )
+            {
+            case Thing::T_Assign:
+                {
+                    Assign* a = cast<Assign*>(s);
+                    if( a->d_lhs->getTag() == Thing::T_IdentLeaf && dead.contains(a->d_lhs->getIdent()) &&
+                            isPure(a->d_rhs.data()) )
+                    {
+                        seq.removeAt(i);
+                        changed = true;
+                    }
+                }
+                break;
+            case Thing::T_IfLoop:
+                {
+                    IfLoop* l = cast<IfLoop*>(s);
+                    for( int j = 0; j < l->d_then.size(); j++ )
+                        changed |= removeStores( l->d_then[j], dead );
+                    changed |= removeStores( l->d_else, dead );
+                }
+                break;
+            case Thing::T_ForLoop:
+                changed |= removeStores( cast<ForLoop*>(s)->d_do, dead );
+                break;
+            case Thing::T_CaseStmt:
+                {
+                    CaseStmt* c = cast<CaseStmt*>(s);
+                    for( int j = 0; j < c->d_cases.size(); j++ )
+                        changed |= removeStores( c->d_cases[j].d_block, dead );
+                    changed |= removeStores( c->d_else, dead );
+                }
+                break;
+            }
+        }
+        return changed;
+    }
+
+    bool removeDeadStores()
+    {
+        // assignments to tracked variables which are never read
+        OptUses uses;
+        uses.visitStats(res.d_stats);
+        QSet<Named*> dead;
+        foreach( Named* n, tracked )
+        {
+            if( !uses.d_reads.contains(n) )
+                dead << n;
+        }
+        if( dead.isEmpty() )
+            return false;
+        return removeStores( res.d_stats, dead );
+    }
+};
+
+Optimizer::Body Optimizer::optimize(Procedure* p, bool closedWorld)
+{
+    Q_ASSERT( p != 0 );
+    OptimizerImp imp(p, closedWorld);
+    imp.run();
+    return imp.res;
+}
+
+Ref<IfLoop> Optimizer::lowerCase(CaseStmt* me)
+{
+    if( me->d_cases.isEmpty() )
+        return Ref<IfLoop>();
+
+    Ref<IfLoop> ifl = new IfLoop();
+    ifl->d_op = IfLoop::IF;
+    ifl->d_loc = me->d_loc;
+
+    if( me->d_typeCase )
+    {
+        for( int i = 0; i < me->d_cases.size(); i++ )
+        {
+            const CaseStmt::Case& c = me->d_cases[i];
+
+            Q_ASSERT( c.d_labels.size() == 1 );
+            Type* td = derefed(c.d_labels.first()->d_type.data());
+
+            Ref<BinExpr> eq = new BinExpr();
+            if( td && td->getBaseType() == Type::NIL )
+                eq->d_op = BinExpr::EQ;
+            else
+                eq->d_op = BinExpr::IS;
+            eq->d_lhs = me->d_exp;
+            eq->d_rhs = c.d_labels.first();
+            eq->d_loc = me->d_exp->d_loc;
+            eq->d_type = boolType();
+
+            ifl->d_if.append(eq.data());
+            ifl->d_then.append( c.d_block );
+        }
+    }else
+    {
+        Type* selType = derefed(me->d_exp->d_type.data());
+        for( int i = 0; i < me->d_cases.size(); i++ )
+        {
+            const CaseStmt::Case& c = me->d_cases[i];
+
+            QList< Ref<Expression> > ors;
+            for( int j = 0; j < c.d_labels.size(); j++ )
+            {
+                Expression* l = c.d_labels[j].data();
+                bool done = false;
+                if( l->getTag() == Thing::T_BinExpr )
+                {
+                    BinExpr* bi = cast<BinExpr*>( l );
+                    if( bi->d_op == BinExpr::Range )
+                    {
+                        Ref<BinExpr> _and = new BinExpr();
+                        _and->d_op = BinExpr::AND;
+                        _and->d_loc = l->d_loc;
+                        _and->d_type = boolType();
+
+                        Ref<BinExpr> lhs = new BinExpr();
+                        lhs->d_op = BinExpr::GEQ;
+                        lhs->d_lhs = me->d_exp;
+                        lhs->d_rhs = bi->d_lhs;
+                        lhs->d_loc = l->d_loc;
+                        lhs->d_inclType = inclusiveType1(selType, derefed(bi->d_lhs->d_type.data()) );
+                        lhs->d_type = boolType();
+
+                        Ref<BinExpr> rhs = new BinExpr();
+                        rhs->d_op = BinExpr::LEQ;
+                        rhs->d_lhs = me->d_exp;
+                        rhs->d_rhs = bi->d_rhs;
+                        rhs->d_loc = l->d_loc;
+                        rhs->d_inclType = inclusiveType1(selType, derefed(bi->d_rhs->d_type.data()) );
+                        rhs->d_type = boolType();
+
+                        _and->d_lhs = lhs.data();
+                        _and->d_rhs = rhs.data();
+
+                        ors << _and.data();
+                        done = true;
+                    }
+                }
+                if( !done )
+                {
+                    Ref<BinExpr> eq = new BinExpr();
+                    eq->d_op = BinExpr::EQ;
+                    eq->d_lhs = me->d_exp;
+                    eq->d_rhs = l;
+                    eq->d_inclType = inclusiveType1(selType, derefed(l->d_type.data()) );
+                    eq->d_loc = l->d_loc;
+                    eq->d_type = boolType();
+
+                    ors << eq.data();
+                }
+            }
+            Q_ASSERT( !ors.isEmpty() );
+            Ref<Expression> cond = ors.first();
+            for( int j = 1; j < ors.size(); j++ )
+            {
+                Ref<BinExpr> bi = new BinExpr();
+                bi->d_op = BinExpr::OR;
+                bi->d_lhs = cond;
+                bi->d_rhs = ors[j];
+                bi->d_loc = ors[j]->d_loc;
+                bi->d_type = boolType();
+                cond = bi.data();
+            }
+            ifl->d_if.append( cond );
+            ifl->d_then.append( c.d_block );
+        }
+    }
+
+    ifl->d_else = me->d_else;
+    return ifl;
+}
+
+static bool labelValue( Expression* e, Scope* scope, qint64& val )
+{
+    const Evaluator::Result res = Evaluator::eval( e, scope );
+    if( res.d_dyn )
+        return false;
+    switch( res.d_vtype )
+    {
+    case Literal::Integer:
+    case Literal::Char:
+    case Literal::Enum:
+        val = res.d_value.toLongLong();
+        return true;
+    case Literal::String:
+        {
+            // a string of length one used as a character
+            const QString str = QString::fromUtf8(res.d_value.toByteArray());
+            if( str.size() != 1 )
+                return false;
+            val = str[0].unicode();
+            return true;
+        }
+    default:
+        return false;
+    }
+}
+
+static bool lessRange( const Optimizer::CaseTable::Range& lhs, const Optimizer::CaseTable::Range& rhs )
+{
+    return lhs.d_lo < rhs.d_lo;
+}
+
+bool Optimizer::caseTable(CaseStmt* me, Scope* scope, CaseTable& res)
+{
+    enum { MinTableRanges = 4, MaxTableSize = 1024, MaxTableWaste = 3 };
+
+    res = CaseTable();
+    if( me->d_typeCase )
+        return false;
+    for( int i = 0; i < me->d_cases.size(); i++ )
+    {
+        foreach( const Ref<Expression>& l, me->d_cases[i].d_labels )
+        {
+            CaseTable::Range r;
+            r.d_case = i;
+            if( l->getTag() == Thing::T_BinExpr && cast<BinExpr*>(l.data())->d_op == BinExpr::Range )
+            {
+                BinExpr* bi = cast<BinExpr*>(l.data());
+                if( !labelValue( bi->d_lhs.data(), scope, r.d_lo ) || !labelValue( bi->d_rhs.data(), scope, r.d_hi ) )
+                    return false;
+                if( r.d_lo > r.d_hi )
+                    qSwap( r.d_lo, r.d_hi ); // as the Validator does
+            }else if( labelValue( l.data(), scope, r.d_lo ) )
+                r.d_hi = r.d_lo;
+            else
+                return false;
+            res.d_ranges.append(r);
+        }
+    }
+    std::sort( res.d_ranges.begin(), res.d_ranges.end(), lessRange );
+
+    // merge the adjacent ranges of the same case
+    int n = 0;
+    for( int i = 0; i < res.d_ranges.size(); i++ )
+    {
+        const CaseTable::Range& r = res.d_ranges[i];
+        if( n > 0 && res.d_ranges[n-1].d_hi >= r.d_lo )
+            return false; // duplicate labels, already reported by the Validator
+        if( n > 0 && res.d_ranges[n-1].d_case == r.d_case && res.d_ranges[n-1].d_hi + 1 == r.d_lo )
+            res.d_ranges[n-1].d_hi = r.d_hi;
+        else
+            res.d_ranges[n++] = r;
+    }
+    while( res.d_ranges.size() > n )
+        res.d_ranges.removeLast();
+
+    if( res.d_ranges.size() >= MinTableRanges )
+    {
+        const quint64 span = quint64(res.d_ranges.last().d_hi) - quint64(res.d_ranges.first().d_lo) + 1;
+        if( span <= MaxTableSize )
+        {
+            quint64 values = 0;
+            foreach( const CaseTable::Range& r, res.d_ranges )
+                values += r.d_hi - r.d_lo + 1;
+            res.d_dense = span <= values * MaxTableWaste;
+        }
+    }
+    return true;
+}
+
+int Optimizer::CaseTable::find(qint64 val) const
+{
+    int lo = 0, hi = d_ranges.size();
+    while( lo < hi )
+    {
+        const int mid = ( lo + hi ) / 2;
+        if( val < d_ranges[mid].d_lo )
+            hi = mid;
+        else if( val > d_ranges[mid].d_hi )
+            lo = mid + 1;
+        else
+            return d_ranges[mid].d_case;
+    }
+    return -1;
+}
+
+Ref<IfLoop> Optimizer::lowerWhile(IfLoop* me)
+{
+    Q_ASSERT( me->d_op == IfLoop::WHILE && me->d_else.isEmpty() );
+
+    Ref<IfLoop> loop = new IfLoop();
+    loop->d_op = IfLoop::LOOP;
+    loop->d_loc = me->d_loc;
+
+    Ref<IfLoop> conds = new IfLoop();
+    conds->d_op = IfLoop::IF;
+    conds->d_loc = me->d_loc;
+
+    conds->d_if = me->d_if;
+    conds->d_then = me->d_then;
+
+    Ref<Exit> ex = new Exit();
+    ex->d_loc = me->d_loc;
+    conds->d_else << ex.data();
+
+    loop->d_then << ( StatSeq() << conds.data() );
+    return loop;
+}
+
+Optimizer::CountedLoop Optimizer::countedLoop(ForLoop* me)
+{
+    CountedLoop res;
+    res.d_by = me->d_byVal.toLongLong();
+    quint8 vtype;
+    if( res.d_by == 0 || !constValue( me->d_from.data(), res.d_from, vtype ) ||
+            !constValue( me->d_to.data(), res.d_to, vtype ) )
+        return res;
+    res.d_const = true;
+    quint64 dist; // the distance in direction of by; never overflows
+    if( res.d_by > 0 )
+    {
+        if( res.d_from > res.d_to )
+        {
+            res.d_trips = 0;
+            return res;
+        }
+        dist = quint64(res.d_to) - quint64(res.d_from);
+    }else
+    {
+        if( res.d_from < res.d_to )
+        {
+            res.d_trips = 0;
+            return res;
+        }
+        dist = quint64(res.d_from) - quint64(res.d_to);
+    }
+    const quint64 steps = dist / ( res.d_by > 0 ? quint64(res.d_by) : quint64(0) - quint64(res.d_by) );
+    if( steps < quint64(std::numeric_limits<qint64>::max()) )
+        res.d_trips = steps + 1;
+    return res;
+}
+
+static Ref<IdentLeaf> tempLeaf( LocalVar* t, Expression* id, IdentRole role )
+{
+    // refers to t at the position and in the module of id
+    return new IdentLeaf( t, id->d_loc, id->getModule(), t->d_type.data(), role );
+}
+
+static Ref<Expression> forId( ForLoop* me, IdentRole role )
+{
+    // a new leaf for the control variable per use, so that no node of the lowered statements has two parents
+    Q_ASSERT( me->d_id->getTag() == Thing::T_IdentLeaf );
+    Ref<IdentLeaf> id = new IdentLeaf( *cast<IdentLeaf*>(me->d_id.data()) );
+    id->d_role = role;
+    return id.data();
+}
+
+static Ref<Assign> assignment( Expression* lhs, Expression* rhs, const RowCol& loc )
+{
+    Ref<Assign> a = new Assign();
+    a->d_loc = loc;
+    a->d_lhs = lhs;
+    a->d_rhs = rhs;
+    return a;
+}
+
+static Ref<BinExpr> binary( quint8 op, Expression* lhs, Expression* rhs, Type* t, const RowCol& loc )
+{
+    Ref<BinExpr> bi = new BinExpr();
+    bi->d_loc = loc;
+    bi->d_op = op;
+    bi->d_lhs = lhs;
+    bi->d_rhs = rhs;
+    bi->d_type = t;
+    if( bi->isRelation() )
+        bi->d_inclType = inclusiveType1( derefed(lhs->d_type.data()), derefed(rhs->d_type.data()) );
+    return bi;
+}
+
+StatSeq Optimizer::lowerFor(ForLoop* me, Scope* scope, QList< Ref<LocalVar> >& temps)
+{
+    // i := from;
+    // if the number of iterations is unknown:
+    //     t := to;
+    //     IF i <= t THEN n := ( t - i ) DIV by; LOOP statements; i := i + by; IF n = 0 THEN EXIT END; n := n - 1 END END
+    //     or, if i is an INT64 or an enumeration, t := to; WHILE i <= t DO statements; i := i + by END
+    // otherwise:
+    //     n := trips - 1; LOOP statements; i := i + by; IF n = 0 THEN EXIT END; n := n - 1 END
+    // n is an INT64 and i := i + by never executes more often than in the WHILE form, so the loop terminates
+    // also if to is at the limit of the type of i.
+
+    const RowCol loc = me->d_loc;
+    const CountedLoop cl = countedLoop(me);
+    Type* varType = me->d_id->d_type.data();
+    StatSeq res;
+    res << assignment( forId( me, LhsRole ).data(), me->d_from.data(), loc ).data();
+    if( cl.d_trips == 0 )
+        return res;
+
+    struct Temp
+    {
+        static LocalVar* create( Type* t, Scope* scope, QList< Ref<LocalVar> >& temps, const RowCol& loc )
+        {
+            Ref<LocalVar> v = new LocalVar();
+            v->d_name = "$f" + QByteArray::number(temps.size());
+            v->d_type = t;
+            v->d_scope = scope;
+            v->d_loc = loc;
+            v->d_synthetic = true;
+            temps.append(v);
+            return v.data();
+        }
+    };
+
+    Ref<IfLoop> loop = new IfLoop();
+    loop->d_loc = loc;
+    loop->d_op = IfLoop::LOOP;
+    loop->d_then.append( me->d_do );
+    StatSeq& body = loop->d_then.back();
+    body << assignment( forId( me, LhsRole ).data(),
+                        binary( BinExpr::ADD, forId( me, RhsRole ).data(), me->d_by.data(), varType, loc ).data(),
+                        loc ).data();
+
+    Type* td = derefed(varType);
+    if( cl.d_trips < 0 && ( td->getTag() == Thing::T_Enumeration || td->getBaseType() == Type::INT64 ) )
+    {
+        // the values of an enumeration are far from the limits, and the distance of two INT64 may not fit
+        // into the INT64 counter; t := to; WHILE i <= t DO ... END
+        LocalVar* to = Temp::create( varType, scope, temps, loc );
+        res << assignment( tempLeaf( to, me->d_id.data(), LhsRole ).data(), me->d_to.data(), loc ).data();
+        Ref<IfLoop> cond = new IfLoop();
+        cond->d_loc = loc;
+        cond->d_op = IfLoop::IF;
+        cond->d_if << binary( cl.d_by > 0 ? BinExpr::LEQ : BinExpr::GEQ, forId( me, RhsRole ).data(),
+                              tempLeaf( to, me->d_id.data(), RhsRole ).data(), boolType(), loc ).data();
+        cond->d_then << body;
+        Ref<Exit> ex = new Exit();
+        ex->d_loc = loc;
+        cond->d_else << ex.data();
+        body = StatSeq() << cond.data();
+        res << loop.data();
+        return res;
+    }
+
+    Type* countType = int64Type();
+    LocalVar* n = Temp::create( countType, scope, temps, loc );
+    Ref<Expression> zero = new Literal( Literal::Integer, loc, qint64(0), countType );
+    Ref<Expression> one = new Literal( Literal::Integer, loc, qint64(1), countType );
+
+    Ref<IfLoop> last = new IfLoop();
+    last->d_loc = loc;
+    last->d_op = IfLoop::IF;
+    last->d_if << binary( BinExpr::EQ, tempLeaf( n, me->d_id.data(), RhsRole ).data(), zero.data(),
+                          boolType(), loc ).data();
+    Ref<Exit> ex = new Exit();
+    ex->d_loc = loc;
+    last->d_then << ( StatSeq() << ex.data() );
+    body << last.data();
+    body << assignment( tempLeaf( n, me->d_id.data(), LhsRole ).data(),
+                        binary( BinExpr::SUB, tempLeaf( n, me->d_id.data(), RhsRole ).data(), one.data(),
+                                countType, loc ).data(), loc ).data();
+
+    if( cl.d_trips > 0 )
+    {
+        res << assignment( tempLeaf( n, me->d_id.data(), LhsRole ).data(),
+                           new Literal( Literal::Integer, loc, cl.d_trips - 1, countType ), loc ).data();
+        res << loop.data();
+        return res;
+    }
+
+    // to is used by the count and by the guard; each gets its own node
+    Ref<Expression> toVal, toGuard;
+    if( cl.d_const )
+    {
+        toVal = new Literal( Literal::Integer, loc, cl.d_to, varType );
+        toGuard = new Literal( Literal::Integer, loc, cl.d_to, varType );
+    }else
+    {
+        LocalVar* to = Temp::create( varType, scope, temps, loc );
+        res << assignment( tempLeaf( to, me->d_id.data(), LhsRole ).data(), me->d_to.data(), loc ).data();
+        toVal = tempLeaf( to, me->d_id.data(), RhsRole ).data();
+        toGuard = tempLeaf( to, me->d_id.data(), RhsRole ).data();
+    }
+
+    // i is not an INT64 here, so the distance of i and t always fits in the INT64 counter
+    StatSeq count;
+    Ref<Expression> lhs = forId( me, RhsRole ), rhs = toVal;
+    if( cl.d_by < 0 )
+        qSwap( lhs, rhs );
+    count << assignment( tempLeaf( n, me->d_id.data(), LhsRole ).data(), rhs.data(), loc ).data();
+    count << assignment( tempLeaf( n, me->d_id.data(), LhsRole ).data(),
+                         binary( BinExpr::SUB, tempLeaf( n, me->d_id.data(), RhsRole ).data(), lhs.data(),
+                                 countType, loc ).data(), loc ).data();
+    if( cl.d_by != 1 && cl.d_by != -1 )
+    {
+        Ref<Expression> step = new Literal( Literal::Integer, loc, cl.d_by > 0 ? cl.d_by : -cl.d_by, countType );
+        count << assignment( tempLeaf( n, me->d_id.data(), LhsRole ).data(),
+                             binary( BinExpr::DIV, tempLeaf( n, me->d_id.data(), RhsRole ).data(), step.data(),
+                                     countType, loc ).data(), loc ).data();
+    }
+    count << loop.data();
+
+    Ref<IfLoop> guard = new IfLoop();
+    guard->d_loc = loc;
+    guard->d_op = IfLoop::IF;
+    guard->d_if << binary( cl.d_by > 0 ? BinExpr::LEQ : BinExpr::GEQ, forId( me, RhsRole ).data(), toGuard.data(),
+                           boolType(), loc ).data();
+    guard->d_then << count;
+    res << guard.data();
+    return res;
+}
+
+static bool isSameOrExtension( Record* sub, Record* super )
+{
+    while( sub && sub != super )
+        sub = sub->d_baseRec;
+    return sub != 0;
+}
+
+static void collectOverrides( Procedure* p, Record* rec, QList<Procedure*>& res )
+{
+    foreach( Procedure* o, p->d_subs )
+    {
+        if( isSameOrExtension( o->d_receiverRec, rec ) )
+            res << o;
+        collectOverrides( o, rec, res );
+    }
+}
+
+QList<Procedure*> Optimizer::dispatchTargets(Procedure* p, Record* rec)
+{
+    QList<Procedure*> res;
+    res << p;
+    collectOverrides( p, rec, res );
+    return res;
+}
@@ -0,0 +1,88 @@
+#ifndef OBXOPTIMIZER_H
+#define OBXOPTIMIZER_H
+
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/compiler library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Oberon/ObxAst.h>
+
+namespace Obx
+{
+    class Optimizer
+    {
+        // The part of the code generation which CilGen and CGen2 share. The AST of the module is never modified;
+        // the statements returned share the unchanged expressions with it.
+    public:
+        struct Body
+        {
+            StatSeq d_stats;
+            QList< Ref<LocalVar> > d_temps; // to be declared by the generator in addition to the procedure locals
+        };
+
+        // Inlining of small procedures which cannot be overridden, constant and copy propagation with folding,
+        // common subexpressions in straight-line code, unreachable branches and dead stores. Values are only
+        // tracked for the scalar locals and value parameters of the procedure which are neither used by nested
+        // procedures nor passed by reference or address. Type-bound procedures and procedures of other modules are
+        // only inlined with closedWorld, i.e. if all modules of the program are loaded and generated.
+        static Body optimize( Procedure*, bool closedWorld = false );
+
+        // The labels of a CASE which is not a type case, as ranges of selector values
+        struct CaseTable
+        {
+            struct Range
+            {
+                qint64 d_lo, d_hi;
+                int d_case; // index in CaseStmt::d_cases
+            };
+            QList<Range> d_ranges; // ordered by value and not overlapping
+            bool d_dense; // a jump table from the first d_lo to the last d_hi pays off; binary search otherwise
+            CaseTable():d_dense(false){}
+            int find( qint64 ) const; // index in d_cases, -1 if no label matches
+        };
+        static bool caseTable( CaseStmt*, Scope*, CaseTable& ); // false if a label is not a known constant
+
+        // The lowerings of the structured statements both generators use; the results are only valid as long
+        // as the lowered statement is
+        static Ref<IfLoop> lowerCase( CaseStmt* ); // null if there are no cases, i.e. only the ELSE applies; for
+                                                   // type cases and those without a CaseTable
+        static Ref<IfLoop> lowerWhile( IfLoop* ); // LOOP IF cond THEN body ELSE EXIT END END
+        // id := from, then the loop counting the remaining iterations in an INT64; to and by are evaluated once.
+        // The temps are owned by scope; the generator allocates them before and releases them after the statements.
+        static StatSeq lowerFor( ForLoop*, Scope* scope, QList< Ref<LocalVar> >& temps );
+
+        // The canonical form of a FOR loop: id takes the values from + k * by for k in [0, trips)
+        struct CountedLoop
+        {
+            qint64 d_by;
+            qint64 d_from, d_to; // if d_const
+            qint64 d_trips; // -1 if not constant or larger than MAX(INT64)
+            bool d_const; // from and to are constant
+            CountedLoop():d_by(0),d_from(0),d_to(0),d_trips(-1),d_const(false){}
+        };
+        static CountedLoop countedLoop( ForLoop* );
+
+        // The procedures a call of the type-bound p with a receiver of static type rec can dispatch to, p first.
+        // Based on Procedure::d_subs, thus only complete if all modules of the program are loaded.
+        static QList<Procedure*> dispatchTargets( Procedure* p, Record* rec );
+    private:
+        Optimizer();
+    };
+}
+
+#endif // OBXOPTIMIZER_H
@@ -41,7 +41,7 @@ struct MaximumErrorCountExceeded {};
 struct PrematureEndFound {};
 
 Parser::Parser(Ob::Lexer* l, Ob::Errors* e, QObject *parent) : QObject(parent),d_lex(l),d_errs(e),
-    d_errCount(0), d_sync(false)
+    d_errCount(0), d_sync(false), d_skeleton(false)
 {
 
 }
@@ -49,9 +49,7 @@ Parser::Parser(Ob::Lexer* l, Ob::Errors* e, QObject *parent) : QObject(parent),d
 Ref<Module> Parser::parse(const QByteArrayList& options)
 {
     d_errCount = 0;
-    d_options.clear();
-    foreach( const QByteArray& o, options )
-        d_options[ Lexer::getSymbol(o).constData() ] = true;
+    setOptions(options);
     next();
     try
     {
@@ -85,10 +83,60 @@ Ref<Module> Parser::parse(const QByteArrayList& options)
         d_errs->error( Errors::Syntax, d_next.toLoc(), tr("unexpected end of file found") );
     }
     if( d_mod )
+    {
         d_mod->d_when = d_lex->getTimeStamp();
+        if( d_skeleton )
+        {
+            d_mod->d_source = d_lex->getBuffer();
+            d_mod->d_source.detach(); // the buffer might refer to a mapped file
+            d_mod->d_options = options;
+        }
+    }
     return d_mod;
 }
 
+bool Parser::parseBody(Procedure* p, Errors* errs)
+{
+    if( !p->hasLazyBody() )
+        return true;
+    Module* m = p->getModule();
+    Q_ASSERT( m != 0 && !m->d_source.isEmpty() );
+
+    Lexer lex;
+    lex.setErrors(errs);
+    lex.setIgnoreComments(true);
+    lex.setPackComments(true);
+    lex.setEnableExt(m->d_isExt);
+    lex.setBuffer( m->d_source, m->d_file, m->d_when );
+    lex.seek( p->d_lazyLine, p->d_lazyBegin.d_row, p->d_lazyBegin.d_col );
+
+    Parser parser(&lex,errs);
+    parser.setOptions(m->d_options);
+    parser.d_mod = m;
+    const quint32 errCount = errs->getErrCount();
+    try
+    {
+        parser.next();
+        parser.next(); // BEGIN or DO
+        p->d_body = parser.statementSequence(p);
+        if( parser.d_la != Tok_END )
+            parser.syntaxError( tr("expecting a statement or closing END") );
+    }catch( const MaximumErrorCountExceeded& )
+    {
+        m->d_hasErrors = true;
+        errs->error( Errors::Syntax, parser.d_cur.toLoc(), tr("maximum number of errors exceeded, stop parsing") );
+    }catch( const PrematureEndFound& )
+    {
+        m->d_hasErrors = true;
+        errs->error( Errors::Syntax, parser.d_next.toLoc(), tr("unexpected end of file found") );
+    }
+    p->d_lazyBegin = RowCol();
+    if( errs->getErrCount() == errCount )
+        return true;
+    p->d_body.clear(); // like a module with syntax errors a partial body is not validated
+    return false;
+}
+
 bool Parser::module(bool definition )
 {
     Ref<Module> m = new Module();
@@ -96,9 +144,10 @@ bool Parser::module(bool definition )
     m->d_isDef = definition;
     MATCH( Tok_ident, tr("expecting module name") );
     m->d_hasErrors = !d_cur.isValid();
-    m->d_name = d_cur.d_val;
+    m->d_name = d_cur.getVal();
+    m->d_nameId = d_cur.getSymbolId();
     m->d_loc = d_cur.toRowCol();
-    m->d_file = d_cur.d_sourcePath;
+    m->d_file = d_cur.getSourcePath();
 
     if( definition )
     {
@@ -135,9 +184,9 @@ bool Parser::module(bool definition )
     }
     MATCH( Tok_END, tr("expecting END keyword at the end of the module") );
     MATCH( Tok_ident, tr("expecting module name after END keyword") );
-    if( d_cur.isValid() && d_cur.d_val.constData() != m->d_name.constData() )
+    if( d_cur.isValid() && d_cur.getVal().constData() != m->d_name.constData() )
         semanticError( d_next.toLoc(), tr("the ident '%1' after the END keyword must be equal "
-                          "to the module name").arg(d_next.d_val.constData()));
+                          "to the module name").arg(d_next.getVal().constData()));
     else
         m->d_end = d_cur.toRowCol();
     if( d_la == Tok_Dot )
@@ -157,21 +206,22 @@ Ref<Literal> Parser::number()
     case Tok_integer:
         {
             next();
+            QByteArray num = d_cur.getVal();
             bool isInt = false;
             bool isLong = false;
-            if( d_cur.d_val.endsWith('I') || d_cur.d_val.endsWith('i') )
+            if( num.endsWith('I') || num.endsWith('i') )
             {
                 isInt = true;
-                d_cur.d_val.chop(1);
-            }else if(d_cur.d_val.endsWith('L') || d_cur.d_val.endsWith('l') )
+                num.chop(1);
+            }else if(num.endsWith('L') || num.endsWith('l') )
             {
                 isLong = true;
-                d_cur.d_val.chop(1);
+                num.chop(1);
             }
-            if( d_cur.d_val.endsWith('H') || d_cur.d_val.endsWith('h') )
+            if( num.endsWith('H') || num.endsWith('h') )
             {
                 bool ok;
-                const quint64 v = d_cur.d_val.left(d_cur.d_val.size()-1).toULongLong(&ok,16);
+                const quint64 v = num.left(num.size()-1).toULongLong(&ok,16);
                 if( isInt )
                 {
                     if( !ok || v > std::numeric_limits<quint32>::max() )
@@ -186,7 +236,7 @@ Ref<Literal> Parser::number()
             }else
             {
                 bool ok;
-                const qint64 v = d_cur.d_val.toLongLong(&ok);
+                const qint64 v = num.toLongLong(&ok);
                 if( isInt )
                 {
                     if( !ok || v > std::numeric_limits<qint32>::max() || v < std::numeric_limits<qint32>::min() )
@@ -202,7 +252,7 @@ Ref<Literal> Parser::number()
     case Tok_real:
         {
             next();
-            QByteArray str = d_cur.d_val;
+            QByteArray str = d_cur.getVal();
             // NOTE strtof is not useful to find out whether float is good enough precision;
             // a number like pi is just cut to float without error or HUGE_VALF
             if( str.contains('d') || str.contains('D') )
@@ -234,7 +284,8 @@ Ref<Expression> Parser::qualident()
     {
         next(); // ident
         Ref<IdentLeaf> id = new IdentLeaf();
-        id->d_name = d_cur.d_val;
+        id->d_name = d_cur.getVal();
+        id->d_nameId = d_cur.getSymbolId();
         id->d_loc = d_cur.toRowCol();
         id->d_mod = d_mod.data();
         cur = id.data();
@@ -244,7 +295,8 @@ Ref<Expression> Parser::qualident()
     if( cur.isNull() )
     {
         Ref<IdentLeaf> id = new IdentLeaf();
-        id->d_name = d_cur.d_val;
+        id->d_name = d_cur.getVal();
+        id->d_nameId = d_cur.getSymbolId();
         id->d_loc = d_cur.toRowCol();
         id->d_mod = d_mod.data();
         cur = id.data();
@@ -252,7 +304,8 @@ Ref<Expression> Parser::qualident()
     {
         Ref<IdentSel> id = new IdentSel();
         id->d_sub = cur.data();
-        id->d_name = d_cur.d_val;
+        id->d_name = d_cur.getVal();
+        id->d_nameId = d_cur.getSymbolId();
         id->d_loc = d_cur.toRowCol();
         cur = id.data();
     }
@@ -263,7 +316,8 @@ void Parser::identdef(Named* n, Scope* scope)
 {
     MATCH( Tok_ident, tr("expecting an identifier") );
     n->d_loc = d_cur.toRowCol();
-    n->d_name = d_cur.d_val;
+    n->d_name = d_cur.getVal();
+    n->d_nameId = d_cur.getSymbolId();
     if( d_la == Tok_Star )
     {
         next();
@@ -428,7 +482,8 @@ MetaParams Parser::metaSection()
             n = new Const();
         else
             n = new NamedType();
-        n->d_name = name.d_val;
+        n->d_name = name.getVal();
+        n->d_nameId = name.getSymbolId();
         n->d_loc = name.toRowCol();
         n->d_generic = true;
         n->d_type = t;
@@ -507,13 +562,14 @@ void Parser::addEnum( Scope* scope, Enumeration* e, const Token& t )
 {
     if( !t.isValid() )
         return;
-    if( scope->find( t.d_val ) )
+    if( scope->find( t.getSymbolId() ) )
     {
         semanticError( t.toRowCol(), tr("name of enumeration symbol must be unique in scope") );
     }else
     {
         Ref<Const> c = new Const();
-        c->d_name = t.d_val;
+        c->d_name = t.getVal();
+        c->d_nameId = t.getSymbolId();
         c->d_loc = t.toRowCol();
         c->d_constExpr = new Literal(Literal::Enum,c->d_loc,e->d_items.count(),e);
         // type and val are evaluated in Validator
@@ -757,7 +813,7 @@ Ref<Expression> Parser::literal()
     case Tok_string:
         {
             next();
-            const QByteArray utf8 = d_cur.d_val.mid(1,d_cur.d_val.size()-2); // remove "" and '' around string
+            const QByteArray utf8 = d_cur.getVal().mid(1,d_cur.getVal().size()-2); // remove "" and '' around string
             const QString tmp = QString::fromUtf8( utf8 );
             Ref<Literal> lit =  new Literal(Literal::String, d_cur.toRowCol(), utf8);
             lit->d_strLen = tmp.size();
@@ -768,7 +824,7 @@ Ref<Expression> Parser::literal()
     case Tok_hexstring:
         {
             next();
-            const QByteArray bytes = QByteArray::fromHex( d_cur.d_val );
+            const QByteArray bytes = QByteArray::fromHex( d_cur.getVal() );
             Ref<Literal> lit =  new Literal(Literal::Bytes, d_cur.toRowCol(), bytes );
             lit->d_strLen = bytes.size();
             return lit.data();
@@ -777,7 +833,7 @@ Ref<Expression> Parser::literal()
     case Tok_hexchar:
         {
             next();
-            const quint16 ch = d_cur.d_val.left( d_cur.d_val.size() - 1 ).toUInt(0,16);
+            const quint16 ch = d_cur.getVal().left( d_cur.getVal().size() - 1 ).toUInt(0,16);
             Ref<Literal> lit = new Literal( Literal::Char, d_cur.toRowCol(), ch);
             if( ch > 255 )
                 lit->d_wide = true;
@@ -886,12 +942,12 @@ void Parser::fieldList(Scope* scope, Record* r)
     for( int i = 0; i < fields.size(); i++ )
     {
         fields[i]->d_type = t;
-        if( r->find( fields[i]->d_name, false ) )
+        if( r->find( fields[i]->d_nameId, false ) )
             semanticError( fields[i]->d_loc, tr("field name is not unique in record"));
         else
         {
             r->d_fields << fields[i];
-            r->d_names[ fields[i]->d_name.constData() ] = fields[i].data();
+            r->d_names[ fields[i]->d_nameId ] = fields[i].data();
         }
     }
 }
@@ -976,7 +1032,8 @@ Ref<UnExpr> Parser::selector()
         if( d_cur.isValid() )
         {
             Ref<IdentSel> id = new IdentSel();
-            id->d_name = d_cur.d_val;
+            id->d_name = d_cur.getVal();
+            id->d_nameId = d_cur.getSymbolId();
             id->d_loc = d_cur.toRowCol();
             return id.data();
         }
@@ -1395,7 +1452,8 @@ Ref<Statement> Parser::forStatement(Scope* scope)
     MATCH( Tok_ident, tr("expecting an identifier after the FOR keyword") );
     Ref<IdentLeaf> id = new IdentLeaf();
     id->d_loc = d_cur.toRowCol();
-    id->d_name = d_cur.d_val;
+    id->d_name = d_cur.getVal();
+    id->d_nameId = d_cur.getSymbolId();
     id->d_mod = d_mod.data();
     f->d_id = id.data();
     MATCH( Tok_ColonEq, tr("expecting ':=' to assign the start value of the FOR statement") );
@@ -1684,13 +1742,13 @@ Ref<Expression> Parser::label()
 
     case Tok_string:
         next();
-        return new Literal( stringType(),d_cur.toRowCol(),d_cur.d_val.mid(1,d_cur.d_val.size()-2));
+        return new Literal( stringType(),d_cur.toRowCol(),d_cur.getVal().mid(1,d_cur.getVal().size()-2));
     case Tok_hexchar:
         next();
-        return new Literal(charType(),d_cur.toRowCol(), QByteArray::fromHex( d_cur.d_val.left( d_cur.d_val.size() - 1 ) ));
+        return new Literal(charType(),d_cur.toRowCol(), QByteArray::fromHex( d_cur.getVal().left( d_cur.getVal().size() - 1 ) ));
     case Tok_hexstring:
         next();
-        return new Literal( stringType(),d_cur.toRowCol(),QByteArray::fromHex( d_cur.d_val.mid(1, d_cur.d_val.size() - 2)));
+        return new Literal( stringType(),d_cur.toRowCol(),QByteArray::fromHex( d_cur.getVal().mid(1, d_cur.getVal().size() - 2)));
 
     case Tok_ident:
         return qualident();
@@ -1736,9 +1794,9 @@ Procedure* Parser::procedureDeclaration(bool headingOnly,Scope* scope)
                 next();
                 hasEndIdent = true;
             }
-            if( hasEndIdent && d_cur.isValid() && d_cur.d_val != res->d_name )
+            if( hasEndIdent && d_cur.isValid() && d_cur.getVal() != res->d_name )
                 semanticError( d_next.toLoc(), tr("the ident '%1' after the END keyword must be equal "
-                                  "to the procedure name").arg(d_next.d_val.constData()));
+                                  "to the procedure name").arg(d_next.getVal().constData()));
         }else if( kind == ProcCImp )
         {
             res->d_end = d_cur.toRowCol();
@@ -1844,8 +1902,14 @@ bool Parser::procedureBody(Procedure* p)
         else
         {
             hasBody = true;
-            next();
-            p->d_body = statementSequence(p);
+            if( d_skeleton && d_conditionStack.isEmpty()
+                    && int(d_next.d_lineNr) <= d_lex->getLineStarts().size() )
+                skipBody(p);
+            else
+            {
+                next();
+                p->d_body = statementSequence(p);
+            }
         }
 #else
         hasBody = true;
@@ -1869,6 +1933,36 @@ bool Parser::procedureBody(Procedure* p)
     return hasBody;
 }
 
+void Parser::skipBody(Procedure* p)
+{
+    // only the nesting of END is relevant; the statements are parsed by parseBody with the same lexer settings
+    // and options, starting with an empty condition stack like here
+    p->d_lazyBegin = d_next.toRowCol();
+    p->d_lazyLine = d_lex->getLineStarts()[d_next.d_lineNr - 1];
+    next();
+    int level = 0;
+    while( d_la != Tok_END || level > 0 )
+    {
+        switch( d_la )
+        {
+        case Tok_IF:
+        case Tok_CASE:
+        case Tok_WHILE:
+        case Tok_FOR:
+        case Tok_WITH:
+        case Tok_LOOP:
+            level++;
+            break;
+        case Tok_END:
+            level--;
+            break;
+        case Tok_Eof:
+            throw PrematureEndFound();
+        }
+        next();
+    }
+}
+
 Ref<Parameter> Parser::receiver()
 {
     MATCH( Tok_Lpar, tr("expecting '(' to start a receiver") );
@@ -1884,7 +1978,8 @@ Ref<Parameter> Parser::receiver()
             v->d_const = true;
     }
     MATCH( Tok_ident, tr("expecting the receiver variable name") );
-    v->d_name = d_cur.d_val;
+    v->d_name = d_cur.getVal();
+    v->d_nameId = d_cur.getSymbolId();
     v->d_loc = d_cur.toRowCol();
 
     MATCH( Tok_Colon, tr("expecting ':'") );
@@ -1892,7 +1987,8 @@ Ref<Parameter> Parser::receiver()
     // like namedType, but only one ident, not qualident
     MATCH( Tok_ident, tr("expecting the type name") );
     Ref<IdentLeaf> id = new IdentLeaf();
-    id->d_name = d_cur.d_val;
+    id->d_name = d_cur.getVal();
+    id->d_nameId = d_cur.getSymbolId();
     id->d_role = MethRole;
     id->d_loc = d_cur.toRowCol();
     id->d_mod = d_mod.data();
@@ -2024,7 +2120,8 @@ bool Parser::fPSection(Scope* scope, ProcType* pt)
     {
         Ref<Parameter> p = new Parameter();
         p->d_type = t;
-        p->d_name = name.d_val;
+        p->d_name = name.getVal();
+        p->d_nameId = name.getSymbolId();
         p->d_loc = name.toRowCol();
         p->d_var = var;
         p->d_const = in;
@@ -2118,7 +2215,7 @@ void Parser::import()
     if( d_cur.isValid() )
     {
         suff = d_cur;
-        imp->d_path << suff.d_val;
+        imp->d_path << suff.getVal();
     }else
         hasErr = true;
     while( d_la == Tok_Slash || d_la == Tok_Dot )
@@ -2128,7 +2225,7 @@ void Parser::import()
         if( d_cur.isValid() )
         {
             suff = d_cur;
-            imp->d_path << suff.d_val;
+            imp->d_path << suff.getVal();
         }else
             hasErr = true;
     }
@@ -2137,9 +2234,9 @@ void Parser::import()
         imp->d_metaActuals = metaActuals();
     }
     if( !hasAlias ) // no alias present
-        imp->d_name = suff.d_val;
+        imp->d_name = suff.getVal();
     else
-        imp->d_name = name.d_val;
+        imp->d_name = name.getVal();
     imp->d_loc = suff.toRowCol();
 
     if( !d_mod->add( imp.data() ) )
@@ -2178,7 +2275,7 @@ SysAttrs Parser::systemAttrs()
         MATCH( Tok_ident, tr("expecting an identifier") );
         Ref<SysAttr> attr = new SysAttr();
         attr->d_loc = d_cur.toRowCol();
-        attr->d_name = d_cur.d_val;
+        attr->d_name = d_cur.getVal();
         while( d_la != Tok_Comma && d_la != Tok_Rbrack )
             attr->d_valExpr.append( constExpression() );
         if( res.contains(attr->d_name ) )
@@ -2210,11 +2307,11 @@ void Parser::ppcmd()
             switch( t.d_type )
             {
             case Tok_Plus:
-                d_options[name.d_val.constData()] = true;
+                d_options[name.getVal().constData()] = true;
                 t = d_lex->nextToken();
                 break;
             case Tok_Minus:
-                d_options[name.d_val.constData()] = false;
+                d_options[name.getVal().constData()] = false;
                 t = d_lex->nextToken();
                 break;
             default:
@@ -2318,7 +2415,7 @@ bool Parser::ppfactor()
     switch( t.d_type )
     {
     case Tok_ident:
-        return d_options.value(t.d_val.constData());
+        return d_options.value(t.getVal().constData());
     case Tok_Lpar:
         {
             const bool res = ppexpr();
@@ -2403,6 +2500,13 @@ quint8 Parser::peek(quint16 la)
         return d_lex->peekToken(la-1).d_type;
 }
 
+void Parser::setOptions(const QByteArrayList& options)
+{
+    d_options.clear();
+    foreach( const QByteArray& o, options )
+        d_options[ Lexer::getSymbol(o).constData() ] = true;
+}
+
 void Parser::syntaxError(const QString& err)
 {
     if( !d_mod.isNull() )
@@ -36,6 +36,11 @@ namespace Obx
         explicit Parser(Ob::Lexer*, Ob::Errors*, QObject *parent = 0);
 
         Ref<Module> parse(const QByteArrayList& options = QByteArrayList());
+
+        // In skeleton mode the statements of procedure bodies are skipped and only their position is recorded;
+        // parseBody parses them when needed. Requires the whole-buffer mode of the lexer.
+        void setSkeleton( bool b ) { d_skeleton = b; }
+        static bool parseBody( Procedure*, Ob::Errors* );
     protected:
         bool module(bool definition);
         Ref<Literal> number();
@@ -95,6 +100,7 @@ namespace Obx
         enum { ProcNormal, ProcForward, ProcCImp };
         int procedureHeading(Procedure* proc, Scope* scope);
         bool procedureBody(Procedure* p);
+        void skipBody(Procedure* p);
         Ref<Parameter> receiver();
         void declarationSequence(bool definition, Scope* scope);
         Ref<Statement> returnStatement(Scope* scope);
@@ -167,6 +173,7 @@ namespace Obx
         void semanticError(const Ob::RowCol&, const QString& err );
 
         void addEnum( Scope* scope, Enumeration* e, const Ob::Token& t );
+        void setOptions( const QByteArrayList& );
     private:
         Ob::Lexer* d_lex;
         Ob::Errors* d_errs;
@@ -183,6 +190,7 @@ namespace Obx
         quint8 d_la; // Ob::TokenType
 #endif
         bool d_sync;
+        bool d_skeleton;
     };
 }
 
@@ -24,6 +24,8 @@ DEFINES += _HAS_GENERICS OBX_BBOX
 SOURCES += \
     $$PWD/ObToken.cpp \
     $$PWD/ObLexer.cpp \
+    $$PWD/ObSymbolTable.cpp \
+    $$PWD/ObScan.cpp \
     $$PWD/ObFileCache.cpp \
     $$PWD/ObErrors.cpp \
     $$PWD/ObRowCol.cpp \
@@ -32,6 +34,7 @@ SOURCES += \
     $$PWD/ObxParser.cpp \
     $$PWD/ObxPackage.cpp \
     $$PWD/ObxModel.cpp \
+    $$PWD/ObxTrace.cpp \
     $$PWD/ObxEvaluator.cpp \
     $$PWD/ObxAst.cpp \
     $$PWD/ObTokenType.cpp
@@ -39,6 +42,8 @@ SOURCES += \
 HEADERS  += \
     $$PWD/ObToken.h \
     $$PWD/ObLexer.h \
+    $$PWD/ObSymbolTable.h \
+    $$PWD/ObScan.h \
     $$PWD/ObFileCache.h \
     $$PWD/ObErrors.h \
     $$PWD/ObRowCol.h \
@@ -47,6 +52,7 @@ HEADERS  += \
     $$PWD/ObxParser.h \
     $$PWD/ObxPackage.h \
     $$PWD/ObxModel.h \
+    $$PWD/ObxTrace.h \
     $$PWD/ObxEvaluator.h \
     $$PWD/ObxAst.h \
     $$PWD/ObTokenType.h
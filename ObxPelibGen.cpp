@@ -18,6 +18,7 @@
 */
 
 #include "ObxPelibGen.h"
+#include "ObxTrace.h"
 #include <PeLib/PublicApi.h>
 #include <PeLib/PEMetaTables.h>
 #include <QSet>
@@ -1146,6 +1147,7 @@ bool PelibGen::hasError() const
 void PelibGen::writeByteCode(const QByteArray& filePath)
 {
     Q_ASSERT( d_imp && d_imp->level.isEmpty() );
+    Obx::Trace::Scope trace("pelib write", QString::fromUtf8(filePath));
     d_imp->DumpOutputFile(filePath.constData(), d_imp->moduleKind == IlEmitter::Library ? PELib::pedll : PELib::peexe,
                           d_imp->moduleKind == IlEmitter::GuiApp );
 }
@@ -1359,6 +1361,14 @@ void PelibGen::addMethod(const IlMethod& m)
         case IL_leave:
             d_imp->addLabelOp(mm,op.d_ilop,op.d_arg);
             break;
+        case IL_switch:
+            {
+                Instruction* sw = new Instruction(Instruction::i_switch);
+                foreach( const QByteArray& label, op.d_arg.split(',') )
+                    sw->AddCaseLabel(label.constData());
+                mm->AddInstruction(sw);
+            }
+            break;
         case IL_call:
             d_imp->addMethodOp(mm,op.d_ilop,op.d_flags ?
                                    SignatureParser::Instance : SignatureParser::Static,op.d_arg);
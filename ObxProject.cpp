@@ -21,46 +21,80 @@
 #include "ObxAst.h"
 #include "ObxModel.h"
 #include "ObErrors.h"
+#include "ObFileCache.h"
 #include <QBuffer>
 #include <QDir>
 #include <QtDebug>
 #include <QSettings>
 #include <QCoreApplication>
 #include <qdatetime.h>
+#include <algorithm>
 using namespace Obx;
 using namespace Ob;
 
+static inline bool scopeCovers( Scope* s, quint32 line, quint16 col )
+{
+    return ( s->d_loc.d_row == line && s->d_loc.d_col <= col ) ||
+            ( s->d_loc.d_row < line && s->d_end.d_row > line ) ||
+            ( s->d_end.d_row == line && s->d_end.d_col >= col );
+}
+
+static inline bool scopeNarrower( Scope* s, Scope* than )
+{
+    // a later scope with the same row span wins
+    return than == 0 || than->d_end.d_row - than->d_loc.d_row >= s->d_end.d_row - s->d_loc.d_row;
+}
+
 struct ObxHitTest : public AstVisitor
 {
     quint32 line; quint16 col;
     QList<Scope*> scopes;
     Scope* scopeHit;
+    // if set, all positions are collected instead of testing line/col
+    QVector<SourceIndex::Ident>* identsOut;
+    QVector<SourceIndex::ScopePos>* scopesOut;
+    QList<int> scopeIdx;
+    quint32 order;
 
-    ObxHitTest():scopeHit(0){}
+    ObxHitTest(QVector<SourceIndex::Ident>* i = 0, QVector<SourceIndex::ScopePos>* s = 0):
+        line(0),col(0),scopeHit(0),identsOut(i),scopesOut(s),order(0){}
 
     void test( Scope* s )
     {
-        if( ( s->d_loc.d_row == line && s->d_loc.d_col <= col ) ||
-                ( s->d_loc.d_row < line && s->d_end.d_row > line ) ||
-                ( s->d_end.d_row == line && s->d_end.d_col >= col ) )
+        if( scopesOut )
         {
-            if( scopeHit == 0 )
-                scopeHit = s;
-            else if( scopeHit->d_end.d_row - scopeHit->d_loc.d_row >= s->d_end.d_row - s->d_loc.d_row )
-                scopeHit = s;
+            SourceIndex::ScopePos p;
+            p.d_scope = s;
+            p.d_parent = scopeIdx.size() > 1 ? scopeIdx[scopeIdx.size()-2] : -1;
+            p.d_order = order++;
+            scopeIdx.back() = scopesOut->size();
+            scopesOut->append(p);
+            return;
         }
+        if( scopeCovers(s,line,col) && scopeNarrower(s,scopeHit) )
+            scopeHit = s;
     }
 
     void test(Expression* e)
     {
         if( e == 0 )
             return;
-        if( e->d_loc.d_row > line )
+        if( identsOut == 0 && e->d_loc.d_row > line )
             return;
         Named* n = e->getIdent();
         if( n == 0 )
             return;
-        if( line == e->d_loc.d_row && col >= e->d_loc.d_col && col <= e->d_loc.d_col + n->d_name.size() )
+        if( identsOut )
+        {
+            SourceIndex::Ident id;
+            id.d_row = e->d_loc.d_row;
+            id.d_col = e->d_loc.d_col;
+            id.d_end = e->d_loc.d_col + n->d_name.size();
+            id.d_order = order++;
+            id.d_ex = e;
+            id.d_scope = scopes.back();
+            identsOut->append(id);
+        }else if( line == e->d_loc.d_row && col >= e->d_loc.d_col && col <= e->d_loc.d_col + n->d_name.size() )
             throw e;
     }
 
@@ -164,6 +198,7 @@ struct ObxHitTest : public AstVisitor
     void visit( Procedure* m)
     {
         scopes.push_back(m);
+        scopeIdx.push_back(-1);
         test(m);
         //if( m->d_type->d_ident == 0 )
         if( m->d_type )
@@ -179,11 +214,13 @@ struct ObxHitTest : public AstVisitor
         for( int i = 0; i < m->d_helper.size(); i++ )
             m->d_helper[i]->accept(this);
         scopes.pop_back();
+        scopeIdx.pop_back();
     }
 
     void visit( Module* m )
     {
         scopes.push_back(m);
+        scopeIdx.push_back(-1);
         test(m);
         for( int i = 0; i < m->d_order.size(); i++ )
             m->d_order[i]->accept(this);
@@ -192,6 +229,7 @@ struct ObxHitTest : public AstVisitor
         for( int i = 0; i < m->d_helper.size(); i++ )
             m->d_helper[i]->accept(this);
         scopes.pop_back();
+        scopeIdx.pop_back();
     }
 
     void visit( Call* c )
@@ -804,7 +842,7 @@ struct ObxModuleDump : public AstVisitor
 };
 
 Project::Project(QObject *parent) : QObject(parent),d_dirty(false),d_useBuiltInOakwood(false),
-    d_useBuiltInObSysInner(false)
+    d_useBuiltInObSysInner(false),d_optimize(false)
 {
     d_mdl = new Model(this);
     //d_mdl->setSenseExt(true);
@@ -817,6 +855,7 @@ Project::Project(QObject *parent) : QObject(parent),d_dirty(false),d_useBuiltInO
 
 void Project::clear()
 {
+    d_index.clear();
     d_mdl->clear();
     d_modules.clear();
     d_groups.clear();
@@ -967,7 +1006,7 @@ Project::FileGroup Project::findFileGroup(const VirtualPath& package) const
     return FileGroup();
 }
 
-Expression* Project::findSymbolBySourcePos(const QString& file, quint32 line, quint16 col, Scope** scopePtr) const
+Expression* Project::findSymbolBySourcePos(const QString& file, quint32 line, quint16 col, Scope** scopePtr)
 {
     FileMod f = findFile(file);
     if( f.first == 0 )
@@ -976,7 +1015,181 @@ Expression* Project::findSymbolBySourcePos(const QString& file, quint32 line, qu
     return findSymbolBySourcePos(f.second,line,col, scopePtr);
 }
 
-Expression*Project::findSymbolBySourcePos(Module* m, quint32 line, quint16 col, Scope** scopePtr) const
+static int compare( const RowCol& pos, quint32 line, quint16 col ) // < 0: pos is before line/col
+{
+    if( pos.d_row != line )
+        return pos.d_row < line ? -1 : 1;
+    return int(pos.d_col) - int(col);
+}
+
+static Procedure* findLazyBody( Scope* s, quint32 line, quint16 col )
+{
+    foreach( const Ref<Named>& n, s->d_order )
+    {
+        if( n->getTag() != Thing::T_Procedure )
+            continue;
+        Procedure* p = cast<Procedure*>(n.data());
+        if( compare(p->d_loc, line, col) > 0 || compare(p->d_end, line, col) < 0 )
+            continue;
+        Procedure* nested = findLazyBody(p, line, col);
+        if( nested )
+            return nested;
+        if( p->hasLazyBody() && compare(p->d_lazyBegin, line, col) <= 0 )
+            return p;
+    }
+    return 0;
+}
+
+static bool hasLazyBodies( Scope* s )
+{
+    if( s->getTag() == Thing::T_Procedure && cast<Procedure*>(s)->hasLazyBody() )
+        return true;
+    foreach( const Ref<Named>& n, s->d_order )
+    {
+        if( n->getTag() == Thing::T_Procedure && hasLazyBodies( cast<Procedure*>(n.data()) ) )
+            return true;
+    }
+    return false;
+}
+
+Expression*Project::findSymbolBySourcePos(Module* m, quint32 line, quint16 col, Scope** scopePtr)
+{
+    Q_ASSERT(m);
+
+    Procedure* lazy = m->d_isValidated && !m->d_source.isEmpty() ? findLazyBody(m, line, col) : 0;
+    if( lazy )
+    {
+        d_mdl->materialize(lazy);
+        d_index.remove(m);
+    }
+
+    QHash<Module*,SourceIndex>::const_iterator i = d_index.constFind(m);
+    if( i == d_index.constEnd() )
+        i = d_index.insert(m, SourceIndex(m));
+    return i.value().find(line,col,scopePtr);
+}
+
+struct ScopeStartLess
+{
+    const QVector<SourceIndex::ScopePos>* d_scopes;
+    ScopeStartLess( const QVector<SourceIndex::ScopePos>* s ):d_scopes(s){}
+    bool operator()( int lhs, int rhs ) const
+    {
+        const RowCol& l = (*d_scopes)[lhs].d_scope->d_loc;
+        const RowCol& r = (*d_scopes)[rhs].d_scope->d_loc;
+        if( l.d_row != r.d_row )
+            return l.d_row < r.d_row;
+        if( l.d_col != r.d_col )
+            return l.d_col < r.d_col;
+        return lhs < rhs;
+    }
+};
+
+struct ScopeEndLess
+{
+    const QVector<SourceIndex::ScopePos>* d_scopes;
+    ScopeEndLess( const QVector<SourceIndex::ScopePos>* s ):d_scopes(s){}
+    bool operator()( int lhs, int rhs ) const
+    {
+        const quint32 l = (*d_scopes)[lhs].d_scope->d_end.d_row;
+        const quint32 r = (*d_scopes)[rhs].d_scope->d_end.d_row;
+        return l < r || ( l == r && lhs < rhs );
+    }
+};
+
+SourceIndex::SourceIndex(Module* m):d_mod(m)
+{
+    Q_ASSERT(m);
+    ObxHitTest collect(&d_idents,&d_scopes);
+    m->accept(&collect);
+    std::sort( d_idents.begin(), d_idents.end() );
+    d_byStart.resize(d_scopes.size());
+    for( int i = 0; i < d_scopes.size(); i++ )
+        d_byStart[i] = i;
+    d_byEnd = d_byStart;
+    std::sort( d_byStart.begin(), d_byStart.end(), ScopeStartLess(&d_scopes) );
+    std::sort( d_byEnd.begin(), d_byEnd.end(), ScopeEndLess(&d_scopes) );
+}
+
+Expression*SourceIndex::find(quint32 line, quint16 col, Scope** scopePtr) const
+{
+    // the first identifier in visit order on this line which includes col
+    int lo = 0, hi = d_idents.size();
+    while( lo < hi )
+    {
+        const int mid = ( lo + hi ) / 2;
+        if( d_idents[mid].d_row < line )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for( int i = lo; i < d_idents.size() && d_idents[i].d_row == line; i++ )
+    {
+        const Ident& id = d_idents[i];
+        if( col >= id.d_col && col <= id.d_end )
+        {
+            if( scopePtr )
+                *scopePtr = id.d_scope;
+            return id.d_ex;
+        }
+    }
+    if( scopePtr == 0 )
+        return 0;
+
+    // Scopes are nested, so a scope covering line either encloses the last scope starting on or before line,
+    // or it starts or ends on line; of these candidates the one with the smallest row span is taken
+    int best = -1;
+    hi = d_byStart.size();
+    lo = 0;
+    while( lo < hi )
+    {
+        const int mid = ( lo + hi ) / 2;
+        if( d_scopes[d_byStart[mid]].d_scope->d_loc.d_row <= line )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    QList<int> cands;
+    if( lo > 0 )
+    {
+        for( int i = d_byStart[lo-1]; i != -1; i = d_scopes[i].d_parent )
+            cands << i;
+        for( int i = lo - 2; i >= 0 && d_scopes[d_byStart[i]].d_scope->d_loc.d_row == line; i-- )
+            cands << d_byStart[i];
+    }
+    lo = 0;
+    hi = d_byEnd.size();
+    while( lo < hi )
+    {
+        const int mid = ( lo + hi ) / 2;
+        if( d_scopes[d_byEnd[mid]].d_scope->d_end.d_row < line )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for( int i = lo; i < d_byEnd.size() && d_scopes[d_byEnd[i]].d_scope->d_end.d_row == line; i++ )
+        cands << d_byEnd[i];
+    foreach( int i, cands )
+    {
+        Scope* s = d_scopes[i].d_scope;
+        if( !scopeCovers(s,line,col) )
+            continue;
+        if( best == -1 )
+            best = i;
+        else
+        {
+            Scope* b = d_scopes[best].d_scope;
+            const int sSpan = s->d_end.d_row - s->d_loc.d_row;
+            const int bSpan = b->d_end.d_row - b->d_loc.d_row;
+            if( sSpan < bSpan || ( sSpan == bSpan && d_scopes[i].d_order > d_scopes[best].d_order ) )
+                best = i;
+        }
+    }
+    *scopePtr = best == -1 ? 0 : d_scopes[best].d_scope;
+    return 0;
+}
+
+Expression*SourceIndex::scan(Module* m, quint32 line, quint16 col, Scope** scopePtr)
 {
     Q_ASSERT(m);
 
@@ -1015,8 +1228,55 @@ Project::FileMod Project::findFile(const QString& file) const
     return qMakePair( f.data(), f->d_mod.data() );
 }
 
-ExpList Project::getUsage(Named* n) const
+ExpList Project::getUsage(Named* n)
 {
+    if( d_mdl->isSkeleton() )
+    {
+        // the uses in lazy bodies are not yet known; only the bodies which can see n are parsed
+        Procedure* outer = 0;
+        for( Scope* s = n->d_scope; s && s->getTag() == Thing::T_Procedure; s = s->d_scope )
+            outer = cast<Procedure*>(s);
+        Module* m = n->getModule();
+        if( outer )
+        {
+            if( hasLazyBodies(outer) )
+            {
+                d_mdl->materialize(outer);
+                d_index.remove(m);
+            }
+        }else if( m && !n->isPublic() && n->getTag() != Thing::T_Module )
+        {
+            if( m->d_isValidated && !m->d_source.isEmpty() )
+            {
+                d_mdl->materialize(m);
+                d_index.remove(m);
+            }
+        }else if( m )
+        {
+            // a public symbol can only be used in m and in the modules depending on it, directly or not
+            QList<Module*> todo;
+            QSet<Module*> seen;
+            todo << m;
+            seen << m;
+            while( !todo.isEmpty() )
+            {
+                Module* cur = todo.takeFirst();
+                if( cur->d_isValidated && !cur->d_source.isEmpty() )
+                {
+                    d_mdl->materialize(cur);
+                    d_index.remove(cur);
+                }
+                foreach( Module* user, cur->d_usedBy )
+                {
+                    if( !seen.contains(user) )
+                    {
+                        seen << user;
+                        todo << user;
+                    }
+                }
+            }
+        }
+    }
     const Model::XRef& xref = d_mdl->getXref();
     return xref.value(n);
 }
@@ -1119,6 +1379,11 @@ bool Project::printTreeShaken(const QString& module, const QString& fileName)
     FileRef f = d_files.value(module);
     if( f->d_mod.isNull() )
         return false;
+    if( d_mdl->hasLazyBodies() )
+    {
+        d_mdl->materialize();
+        d_index.clear();
+    }
     Ref<Module> m = d_mdl->treeShaken(f->d_mod.data());
     QFile out(fileName);
     if( !out.open(QIODevice::WriteOnly) )
@@ -1273,6 +1538,7 @@ int Project::findPackage(const VirtualPath& path) const
 
 bool Project::parse(bool incremental)
 {
+    d_index.clear();
     d_modules.clear();
     bool res = false;
     if( incremental )
@@ -1292,6 +1558,14 @@ bool Project::parse(bool incremental)
         d_mdl->setOptions(d_options);
         res = d_mdl->parseFiles( fgs );
     }
+    fillModules();
+    emit sigReparsed();
+    return res;
+}
+
+void Project::fillModules()
+{
+    d_modules.clear();
     QList<Module*> mods = d_mdl->getDepOrder();
     foreach( Module* m, mods )
     {
@@ -1318,11 +1592,59 @@ bool Project::parse(bool incremental)
             Q_ASSERT( false );
         }
     }
+}
+
+Project* Project::createSnapshot(QObject* parent) const
+{
+    Project* p = new Project(parent);
+    for( int i = 0; i < d_groups.size(); i++ )
+    {
+        p->addPackagePath(d_groups[i].d_package);
+        for( int j = 0; j < d_groups[i].d_files.size(); j++ )
+            p->addFile(d_groups[i].d_files[j]->d_filePath, d_groups[i].d_package);
+    }
+    p->d_filePath = d_filePath;
+    p->d_suffixes = d_suffixes;
+    p->d_options = d_options;
+    p->d_workingDir = d_workingDir;
+    p->d_buildDir = d_buildDir;
+    p->d_main = d_main;
+    p->d_useBuiltInOakwood = d_useBuiltInOakwood;
+    p->d_useBuiltInObSysInner = d_useBuiltInObSysInner;
+    p->d_optimize = d_optimize;
+    p->d_dirty = d_dirty;
+    p->d_mdl->setInt16(d_mdl->getInt16());
+    p->d_mdl->setThreadCount(d_mdl->getThreadCount());
+    p->d_mdl->setSkeleton(d_mdl->isSkeleton());
+    p->d_mdl->getErrs()->setShowWarnings(d_mdl->getErrs()->showWarnings());
+    p->d_mdl->getErrs()->setReportToConsole(d_mdl->getErrs()->reportToConsole());
+    p->d_mdl->getFc()->copyFrom(*d_mdl->getFc());
+    return p;
+}
+
+void Project::adopt(Project* snapshot)
+{
+    Q_ASSERT( snapshot && snapshot != this );
+    Model* mdl = snapshot->d_mdl;
+    snapshot->d_mdl = d_mdl;
+    d_mdl->setParent(snapshot);
+    d_mdl = mdl;
+    d_mdl->setParent(this);
+    // keep the edits made to the FileCache since the snapshot was taken
+    d_mdl->getFc()->copyFrom(*snapshot->d_mdl->getFc());
+
+    d_index.clear();
+    snapshot->d_index.clear();
+    snapshot->d_modules.clear();
+    for( FileHash::const_iterator i = snapshot->d_files.begin(); i != snapshot->d_files.end(); ++i )
+        i.value()->d_mod = 0;
+    for( FileHash::const_iterator i = d_files.begin(); i != d_files.end(); ++i )
+        i.value()->d_mod = 0;
+    fillModules();
     emit sigReparsed();
-    return res;
 }
 
-QList<Module*> Project::getModulesToGenerate(bool includeTemplates) const
+QList<Module*> Project::getModulesToGenerate(bool includeTemplates)
 {
     QList<Module*> res;
     FileHash::const_iterator i;
@@ -1352,6 +1674,12 @@ QList<Module*> Project::getModulesToGenerate(bool includeTemplates) const
 #endif
     foreach( Module* m, mods )
     {
+        if( !m->d_synthetic && m->d_isValidated && !m->d_source.isEmpty() )
+        {
+            // left from a skeleton parse; errors in the bodies set d_hasErrors of m
+            d_mdl->materialize(m);
+            d_index.remove(m);
+        }
         if( m->d_synthetic )
             ; // NOP
         else if( m->d_isDef || m->d_metaParams.isEmpty() )
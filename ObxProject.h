@@ -22,6 +22,7 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QVector>
 #include <QExplicitlySharedDataPointer>
 #include <Oberon/ObxAst.h>
 
@@ -38,6 +39,39 @@ namespace Obx
     class Model;
     struct Module;
 
+    class SourceIndex
+    {
+        // The identifier expressions and scopes of a module sorted by source position, so that a lookup
+        // doesn't have to walk the whole AST; find() returns the same as scan().
+    public:
+        SourceIndex() {}
+        explicit SourceIndex( Module* );
+        Expression* find( quint32 line, quint16 col, Scope** = 0 ) const;
+        static Expression* scan( Module*, quint32 line, quint16 col, Scope** = 0 );
+        Module* getModule() const { return d_mod.data(); }
+        int getIdentCount() const { return d_idents.size(); }
+
+        struct Ident
+        {
+            quint32 d_row, d_col, d_end, d_order;
+            Expression* d_ex;
+            Scope* d_scope;
+            bool operator<( const Ident& rhs ) const
+                { return d_row < rhs.d_row || ( d_row == rhs.d_row && d_order < rhs.d_order ); }
+        };
+        struct ScopePos
+        {
+            Scope* d_scope;
+            int d_parent; // index in d_scopes or -1
+            quint32 d_order;
+        };
+    private:
+        Ref<Module> d_mod;
+        QVector<Ident> d_idents; // sorted by row and visit order
+        QVector<ScopePos> d_scopes; // in visit order
+        QVector<int> d_byStart, d_byEnd; // indices into d_scopes sorted by start row/col and end row
+    };
+
     class Project : public QObject
     {
 #ifndef QT_NO_QOBJECT
@@ -97,6 +131,8 @@ namespace Obx
         void setOptions( const QByteArrayList& );
         bool getInt16() const;
         void setInt16(bool);
+        bool getOptimize() const { return d_optimize; }
+        void setOptimize(bool on) { d_optimize = on; } // run the Optimizer in the generators; not saved
 
         bool addFile(const QString& filePath, const VirtualPath& package = QByteArrayList() );
         bool removeFile( const QString& filePath );
@@ -104,18 +140,23 @@ namespace Obx
         bool removePackagePath( const VirtualPath& path );
 
         bool parse(bool incremental = false);
+        // a project with the same files and settings, a copy of the FileCache and a model of its own, so it can
+        // be parsed and generated on another thread while this project stays usable
+        Project* createSnapshot( QObject* parent = 0 ) const;
+        void adopt( Project* snapshot ); // take over the parsed model of the snapshot; the snapshot gets ours
 
         const FileHash& getFiles() const { return d_files; }
         const FileGroups& getFileGroups() const { return d_groups; }
         FileGroup getRootFileGroup() const;
         FileGroup findFileGroup(const VirtualPath& package ) const;
-        QList<Module*> getModulesToGenerate(bool includeTemplates=false) const; // in exec/depencency order
+        QList<Module*> getModulesToGenerate(bool includeTemplates=false); // in exec/depencency order; parses their lazy bodies
         FileMod findFile( const QString& file ) const;
         Model* getMdl() const { return d_mdl; }
 
-        Expression* findSymbolBySourcePos(const QString& file, quint32 line, quint16 col, Scope** = 0 ) const;
-        Expression* findSymbolBySourcePos(Module*, quint32 line, quint16 col, Scope** scopePtr) const;
-        ExpList getUsage( Named* ) const;
+        // the lookups parse the lazy bodies they need (skeleton mode), therefore not const
+        Expression* findSymbolBySourcePos(const QString& file, quint32 line, quint16 col, Scope** = 0 );
+        Expression* findSymbolBySourcePos(Module*, quint32 line, quint16 col, Scope** scopePtr);
+        ExpList getUsage( Named* );
         bool printTreeShaken( const QString& module, const QString& fileName );
         bool printImportDependencies(const QString& fileName , bool pruned);
 
@@ -131,10 +172,12 @@ namespace Obx
         QStringList findFiles(const QDir& , bool recursive = false);
         void touch();
         int findPackage(const VirtualPath& path ) const;
+        void fillModules();
         // bool generate( Module* );
     private:
         Model* d_mdl;
 
+        QHash<Module*,SourceIndex> d_index; // built on first lookup, cleared by parse() and when lazy bodies are parsed
         FileHash d_files;
         ModuleHash d_modules;
         FileGroups d_groups;
@@ -146,6 +189,7 @@ namespace Obx
         bool d_dirty;
         bool d_useBuiltInOakwood;
         bool d_useBuiltInObSysInner;
+        bool d_optimize;
     };
 }
 
@@ -0,0 +1,205 @@
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "ObxTrace.h"
+#include "ObxAst.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+#include <QHash>
+#include <algorithm>
+using namespace Obx;
+
+bool Trace::s_enabled = false;
+
+struct TraceEvent
+{
+    const char* d_phase;
+    QByteArray d_module;
+    qint64 d_start, d_dur; // ns since Trace::setEnabled
+    int d_tid;
+};
+
+static QMutex s_lock;
+static QElapsedTimer s_clock;
+static QList<TraceEvent> s_events;
+static QHash<Qt::HANDLE,int> s_threads; // thread id -> small number in order of appearance
+
+Trace::Scope::Scope(const char* phase, Module* m):d_on(false)
+{
+    if( s_enabled )
+        begin( phase, m ? m->getName() : QByteArray() );
+}
+
+Trace::Scope::Scope(const char* phase, const QString& filePath):d_on(false)
+{
+    if( s_enabled )
+        begin( phase, QFileInfo(filePath).baseName().toUtf8() );
+}
+
+void Trace::Scope::begin(const char* phase, const QByteArray& module)
+{
+    d_on = true;
+    d_phase = phase;
+    d_module = module;
+    d_start = now();
+}
+
+Trace::Scope::~Scope()
+{
+    if( d_on && s_enabled )
+        record( d_phase, d_module, d_start, now() );
+}
+
+void Trace::setEnabled(bool on)
+{
+    QMutexLocker lock(&s_lock);
+    s_events.clear();
+    s_threads.clear();
+    if( on )
+        s_clock.start();
+    s_enabled = on;
+}
+
+void Trace::clear()
+{
+    QMutexLocker lock(&s_lock);
+    s_events.clear();
+    s_threads.clear();
+}
+
+qint64 Trace::now()
+{
+    return s_clock.nsecsElapsed();
+}
+
+void Trace::record(const char* phase, const QByteArray& module, qint64 start, qint64 end)
+{
+    TraceEvent e;
+    e.d_phase = phase;
+    e.d_module = module;
+    e.d_start = start;
+    e.d_dur = end - start;
+    const Qt::HANDLE tid = QThread::currentThreadId();
+    QMutexLocker lock(&s_lock);
+    QHash<Qt::HANDLE,int>::const_iterator i = s_threads.find(tid);
+    if( i == s_threads.end() )
+        i = s_threads.insert(tid, s_threads.size() + 1);
+    e.d_tid = i.value();
+    s_events.append(e);
+}
+
+static QByteArray escaped( QByteArray str )
+{
+    str.replace('\\', "\\\\");
+    str.replace('"', "\\\"");
+    return str;
+}
+
+bool Trace::write(const QString& filePath)
+{
+    QFile f(filePath);
+    if( !f.open(QIODevice::WriteOnly) )
+        return false;
+    QMutexLocker lock(&s_lock);
+    QTextStream out(&f);
+    out.setCodec("UTF-8");
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+    for( int i = 0; i < s_events.size(); i++ )
+    {
+        const TraceEvent& e = s_events[i];
+        // complete events, timestamps in microseconds
+        out << "{\"name\":\"" << e.d_phase << "\",\"cat\":\"obx\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.d_tid
+            << ",\"ts\":" << QByteArray::number( e.d_start / 1000.0, 'f', 3 )
+            << ",\"dur\":" << QByteArray::number( e.d_dur / 1000.0, 'f', 3 )
+            << ",\"args\":{\"module\":\"" << escaped(e.d_module) << "\"}}"
+            << ( i + 1 < s_events.size() ? "," : "" ) << endl;
+    }
+    out << "]}" << endl;
+    return true;
+}
+
+qint64 Trace::getTotal(const char* phase)
+{
+    QMutexLocker lock(&s_lock);
+    qint64 res = 0;
+    foreach( const TraceEvent& e, s_events )
+    {
+        if( qstrcmp( e.d_phase, phase ) == 0 )
+            res += e.d_dur;
+    }
+    return res;
+}
+
+struct TracePhase
+{
+    QByteArray d_name;
+    int d_count;
+    qint64 d_total, d_max;
+    TracePhase():d_count(0),d_total(0),d_max(0){}
+};
+
+static bool slowerPhase( const TracePhase& lhs, const TracePhase& rhs )
+{
+    return lhs.d_total > rhs.d_total;
+}
+
+static bool slowerEvent( const TraceEvent& lhs, const TraceEvent& rhs )
+{
+    return lhs.d_dur > rhs.d_dur;
+}
+
+static QString ms( qint64 ns )
+{
+    return QString::number( ns / 1000000.0, 'f', 2 );
+}
+
+void Trace::printSummary(QTextStream& out, int topN)
+{
+    QMutexLocker lock(&s_lock);
+    QHash<QByteArray,TracePhase> phases;
+    foreach( const TraceEvent& e, s_events )
+    {
+        TracePhase& p = phases[e.d_phase];
+        p.d_name = e.d_phase;
+        p.d_count++;
+        p.d_total += e.d_dur;
+        p.d_max = qMax( p.d_max, e.d_dur );
+    }
+    QList<TracePhase> byTime = phases.values();
+    std::sort( byTime.begin(), byTime.end(), slowerPhase );
+    out << "phase                count   total [ms]     max [ms]" << endl;
+    foreach( const TracePhase& p, byTime )
+        out << QString("%1 %2 %3 %4").arg(QString(p.d_name), -16).arg(p.d_count, 9)
+               .arg(ms(p.d_total), 12).arg(ms(p.d_max), 12) << endl;
+
+    QList<TraceEvent> events = s_events;
+    std::sort( events.begin(), events.end(), slowerEvent );
+    out << "slowest " << qMin( topN, events.size() ) << " of " << events.size() << " phases by module:" << endl;
+    out << "     [ms] phase            thread module" << endl;
+    for( int i = 0; i < events.size() && i < topN; i++ )
+    {
+        const TraceEvent& e = events[i];
+        out << QString("%1 %2 %3 %4").arg(ms(e.d_dur), 9).arg(QString(e.d_phase), -16).arg(e.d_tid, 6)
+               .arg(QString::fromUtf8(e.d_module)) << endl;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef OBXTRACE_H
+#define OBXTRACE_H
+
+/*
+* Copyright 2021 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the Oberon+ parser/code model library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QByteArray>
+#include <QString>
+
+class QTextStream;
+
+namespace Obx
+{
+    struct Module;
+
+    class Trace
+    {
+        // Records how long each compiler phase takes per module and thread. Disabled by default; a
+        // Trace::Scope then only tests a flag. The events can be written as Chrome trace event JSON
+        // (chrome://tracing, ui.perfetto.dev). Scopes nest, so the time of a phase includes the time
+        // of the phases it calls.
+    public:
+        class Scope
+        {
+        public:
+            Scope( const char* phase, Module* );
+            Scope( const char* phase, const QString& filePath );
+            ~Scope();
+        private:
+            void begin( const char* phase, const QByteArray& module );
+            const char* d_phase;
+            QByteArray d_module;
+            qint64 d_start;
+            bool d_on;
+        };
+
+        static void setEnabled( bool on ); // also starts the clock and clears the recorded events
+        static bool isEnabled() { return s_enabled; }
+        static void clear();
+        static bool write( const QString& filePath );
+        static void printSummary( QTextStream&, int topN = 10 );
+        static qint64 getTotal( const char* phase ); // ns, summed over all modules and threads
+    private:
+        friend class Scope;
+        static void record( const char* phase, const QByteArray& module, qint64 start, qint64 end );
+        static qint64 now();
+        static bool s_enabled;
+    };
+}
+
+#endif // OBXTRACE_H
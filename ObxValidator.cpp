@@ -19,7 +19,11 @@
 
 #include "ObxEvaluator.h"
 #include "ObxValidator.h"
+#include "ObxParser.h"
+#include "ObLexer.h"
+#include "ObxTrace.h"
 #include <QtDebug>
+#include <QMutex>
 #include <limits>
 using namespace Obx;
 using namespace Ob;
@@ -32,6 +36,10 @@ using namespace Ob;
 //#define OBX_SUPPORT_BYTE_CHAR_INT8_COMPAT // TEST
 //#define OBX_SUPPORT_VAR_BYTE_ARRAY_TO_ANY_COMPAT // TEST
 
+// Model::validateLevels runs several validators concurrently; this lock guards the few places where
+// a validator writes to declarations which may belong to an imported module
+static QMutex s_sharedLock;
+
 struct ValidatorImp : public AstVisitor
 {
     struct VlaChecker : public AstVisitor
@@ -91,8 +99,10 @@ struct ValidatorImp : public AstVisitor
     QList< QPair<Type*,Type*> > deferExtensionCheck;
     bool returnValueFound;
     bool selfRefBroken;
+    bool deferBodies; // leave the lazy bodies of a skeleton to visitDeferred
 
-    ValidatorImp():err(0),mod(0),curTypeDecl(0),prevStat(0),returnValueFound(false),selfRefBroken(false) {}
+    ValidatorImp():err(0),mod(0),curTypeDecl(0),prevStat(0),returnValueFound(false),selfRefBroken(false),
+        deferBodies(false) {}
 
     //////// Scopes
 
@@ -270,7 +280,13 @@ struct ValidatorImp : public AstVisitor
             }
         }
         visitStats( me->d_body );
+        checkProcValues();
+
+        levels.pop_back();
+    }
 
+    void checkProcValues()
+    {
         foreach( Expression* e, deferProcCheck )
         {
             Named* p = e->getIdent();
@@ -279,7 +295,23 @@ struct ValidatorImp : public AstVisitor
                 error( e->d_loc, Validator::tr("this procedure depends on the environment and cannot be assigned"));
         }
         deferProcCheck.clear();
+    }
 
+    void visitDeferred( Scope* me )
+    {
+        // the bodies left by deferBodies in the same order as visitScope and visitBody, i.e. nested ones first
+        levels.push_back(me);
+        foreach( const Ref<Named>& n, me->d_order )
+        {
+            if( n->getTag() == Thing::T_Procedure )
+                visitDeferred( cast<Procedure*>(n.data()) );
+        }
+        if( me->getTag() == Thing::T_Procedure )
+        {
+            Procedure* p = cast<Procedure*>(me);
+            if( p->hasLazyBody() && Parser::parseBody(p, err) )
+                visitStatements(p);
+        }
         levels.pop_back();
     }
 
@@ -323,12 +355,12 @@ struct ValidatorImp : public AstVisitor
         }
 #endif
         Record* r = cast<Record*>(t);
-        if( r->find( me->d_name, false ) )
+        if( r->find( me->d_nameId, false ) )
             error( me->d_loc, Validator::tr("name is not unique in record"));
         else
         {
             r->d_methods << me;
-            r->d_names[ me->d_name.constData() ] = me;
+            r->d_names[ me->d_nameId ] = me;
             me->d_receiverRec = r;
             Named* decl = r->findDecl();
             Q_ASSERT( decl );
@@ -344,7 +376,7 @@ struct ValidatorImp : public AstVisitor
         if( me->d_receiverRec && me->d_receiverRec->d_baseRec )
         {
             // check wheter base has a method with this name and the signature is compatible
-            Named* n = me->d_receiverRec->d_baseRec->find( me->d_name, true );
+            Named* n = me->d_receiverRec->d_baseRec->find( me->d_nameId, true );
             if( n == 0 )
                 return; // this is no override
             if( n->getTag() != Thing::T_Procedure )
@@ -353,7 +385,10 @@ struct ValidatorImp : public AstVisitor
                 return;
             }
             me->d_super = cast<Procedure*>(n);
-            me->d_super->d_subs.append(me);
+            {
+                QMutexLocker lock(&s_sharedLock);
+                me->d_super->d_subs.append(me);
+            }
             if( !matchingFormalParamLists( me->d_super->getProcType(), me->getProcType()
                                #ifdef OBX_BBOX
                                            // NOTE: this is no longer official Oberon+
@@ -401,8 +436,19 @@ struct ValidatorImp : public AstVisitor
             connectSuperSubBoundProc(me);
         }
 
+        bool parsed = true;
+        if( me->hasLazyBody() && !deferBodies )
+            parsed = Parser::parseBody(me, err);
+
         levels.push_back(me);
         visitScope(me); // also handles formal parameters
+        if( parsed && !me->hasLazyBody() )
+            visitStatements(me);
+        levels.pop_back();
+    }
+
+    void visitStatements( Procedure* me )
+    {
         returnValueFound = false;
         visitStats( me->d_body );
 
@@ -430,8 +476,6 @@ struct ValidatorImp : public AstVisitor
             else if( !pt->d_return.isNull() && !returnValueFound )
                 error( me->d_loc, Validator::tr("procedure is expected to return a value"));
         }
-
-        levels.pop_back();
     }
 
     void visit( Procedure* me )
@@ -482,7 +526,7 @@ struct ValidatorImp : public AstVisitor
     void visit( IdentLeaf* me )
     {
         Q_ASSERT( !levels.isEmpty() );
-        me->d_ident = levels.back().scope->find( me->d_name );
+        me->d_ident = levels.back().scope->find( me->d_nameId );
         // me->d_mod = mod;
         if( me->d_ident.isNull() )
         {
@@ -532,7 +576,7 @@ struct ValidatorImp : public AstVisitor
                 error( imp->d_loc, Validator::tr("cannot resolve identifier '%1'").arg(me->d_name.constData()));
                 return;
             }
-            Named* modVar = imp->d_mod->find( me->d_name, false );
+            Named* modVar = imp->d_mod->find( me->d_nameId, false );
             if( modVar == 0 )
             {
                 error( me->d_loc,Validator::tr("cannot resolve identifier '%1' in imported module '%2'")
@@ -583,7 +627,7 @@ struct ValidatorImp : public AstVisitor
             if( prevT && prevT->getTag() == Thing::T_Record )
             {
                 Record* r = cast<Record*>(prevT);
-                Named* field = r->find(me->d_name, true);
+                Named* field = r->find(me->d_nameId, true);
                 if( field == 0 )
                 {
                     error( me->d_loc, Validator::tr("there is no member named '%1'").arg(me->d_name.constData()) );
@@ -1291,6 +1335,7 @@ struct ValidatorImp : public AstVisitor
         if( td && td->getTag() == Thing::T_Record )
         {
             Record* r = cast<Record*>(td);
+            QMutexLocker lock(&s_sharedLock);
             bool changed = false;
             if( ( isPointer && !isVarParam ) || ( !isPointer && isVarParam ) )
             {
@@ -1746,7 +1791,10 @@ struct ValidatorImp : public AstVisitor
                 }else
                 {
                     if( p->d_decl && p->d_decl->getTag() == Thing::T_Procedure )
+                    {
+                        QMutexLocker lock(&s_sharedLock);
                         p->d_decl->d_used = true;
+                    }
                     me->d_type = p->d_return.data();
                     if( me->d_type.isNull() )
                         me->d_type = bt.d_noType;
@@ -1896,7 +1944,7 @@ struct ValidatorImp : public AstVisitor
                                 if( p->d_receiver.data() == id1 )
                                 {
                                     Named* super = p->d_receiverRec && p->d_receiverRec->d_baseRec ?
-                                                p->d_receiverRec->d_baseRec->find(p->d_name, true) : 0;
+                                                p->d_receiverRec->d_baseRec->find(p->d_nameId, true) : 0;
                                     if( super && super->getTag() == Thing::T_Procedure )
                                         me->d_type = p->d_type.data();
                                     else
@@ -2421,6 +2469,7 @@ struct ValidatorImp : public AstVisitor
             if( base && base->getTag() == Thing::T_Record)
             {
                 me->d_baseRec = cast<Record*>(base);
+                QMutexLocker lock(&s_sharedLock);
                 me->d_baseRec->d_subRecs.append(me);
             }else
                 error( me->d_base->d_loc, Validator::tr("base type must be a record") );
@@ -2441,6 +2490,7 @@ struct ValidatorImp : public AstVisitor
                 if( baseRec->d_baseRec == me )
                 {
                     error( me->d_base->d_loc, Validator::tr("record cannot be its own base type") );
+                    QMutexLocker lock(&s_sharedLock);
                     baseRec->d_baseRec->d_subRecs.removeAll(baseRec);
                     baseRec->d_baseRec = 0; // to avoid infinite loop in code using the AST
                     break;
@@ -2476,7 +2526,7 @@ struct ValidatorImp : public AstVisitor
             }
 #endif
 
-            Named* found = me->d_baseRec ? me->d_baseRec->find( f->d_name, true ) : 0;
+            Named* found = me->d_baseRec ? me->d_baseRec->find( f->d_nameId, true ) : 0;
             if( found  )
             {
 #if 0 // #ifdef OBX_BBOX
@@ -2982,6 +3032,7 @@ struct ValidatorImp : public AstVisitor
                 }else
                 {
                     deferProcCheck.append(rhs);
+                    QMutexLocker lock(&s_sharedLock);
                     n->d_used = true;
                 }
 
@@ -4298,7 +4349,7 @@ struct ValidatorImp : public AstVisitor
     }
 };
 
-bool Validator::check(Module* m, const BaseTypes& bt, Ob::Errors* err, Instantiator* insts)
+bool Validator::check(Module* m, const BaseTypes& bt, Ob::Errors* err, Instantiator* insts, bool deferBodies)
 {
     Q_ASSERT( m != 0 && err != 0 );
 
@@ -4307,21 +4358,72 @@ bool Validator::check(Module* m, const BaseTypes& bt, Ob::Errors* err, Instantia
 
     const quint32 errCount = err->getErrCount();
 
+    Trace::Scope trace("validate", m);
+
     ValidatorImp imp;
     imp.err = err;
     imp.bt = bt;
     imp.bt.check();
     imp.mod = m;
     imp.insts = insts;
+    imp.deferBodies = deferBodies;
     m->accept(&imp);
 
     m->d_isValidated = true;
+    if( !deferBodies )
+        m->d_source.clear(); // all bodies are parsed
 
     m->d_hasErrors = ( err->getErrCount() - errCount ) != 0;
 
     return !m->d_hasErrors;
 }
 
+bool Validator::checkDeferred(Scope* s, const BaseTypes& bt, Ob::Errors* err, Instantiator* insts)
+{
+    Q_ASSERT( s != 0 && err != 0 );
+    Module* m = s->getModule();
+    if( m == 0 || !m->d_isValidated || m->d_source.isEmpty() )
+        return false;
+
+    const quint32 errCount = err->getErrCount();
+
+    Trace::Scope trace("validate bodies", m);
+
+    ValidatorImp imp;
+    imp.err = err;
+    imp.bt = bt;
+    imp.bt.check();
+    imp.mod = m;
+    imp.insts = insts;
+    QList<Scope*> outer;
+    Scope* o = s;
+    while( o != m )
+    {
+        o = o->d_scope;
+        outer.prepend(o);
+    }
+    foreach( Scope* l, outer )
+        imp.levels.push_back(l);
+    imp.visitDeferred(s);
+    if( s == m )
+    {
+        foreach( const Ref<Named>& n, m->d_order )
+        {
+            if( n->getTag() == Thing::T_Procedure && ( n->d_upvalSource || n->d_upvalIntermediate || n->d_upvalSink ) )
+            {
+                QSet<Procedure*> visited;
+                imp.collectNonLocals( cast<Procedure*>(n.data()), visited );
+            }
+        }
+        m->d_source.clear(); // all bodies are parsed
+    }
+    imp.checkProcValues();
+
+    if( err->getErrCount() != errCount )
+        m->d_hasErrors = true;
+    return !m->d_hasErrors;
+}
+
 bool Validator::includesType(quint8 lhs, quint8 rhs)
 {
     if( lhs == rhs )
@@ -53,8 +53,11 @@ namespace Obx
             void check() const;
         };
 
-        // assumes imports are already resolved
-        static bool check( Module*, const BaseTypes&, Ob::Errors*, Instantiator*);
+        // assumes imports are already resolved; deferBodies leaves the bodies not yet parsed by a skeleton
+        // parse (see Parser::setSkeleton) to checkDeferred
+        static bool check( Module*, const BaseTypes&, Ob::Errors*, Instantiator*, bool deferBodies = false );
+        // parses and validates the deferred bodies of a Module or of a Procedure including its nested ones
+        static bool checkDeferred( Scope*, const BaseTypes&, Ob::Errors*, Instantiator* );
 
         static bool includesType( quint8 lhs, quint8 rhs ); // lhs, rhs: Type::BT
         static QPair<quint8,bool> inclusiveType( quint8 lhs, quint8 rhs ); // lhs, rhs, return: Type::BT; bool: no information loss
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Plays session.txt to OBXLSP and compares the responses with expected.txt
+# usage: run.sh [-record] path/to/OBXLSP
+# Each line of session.txt is one JSON-RPC message which is sent with a Content-Length header; each line of
+# expected.txt is one message the server must answer with, in this order. @ROOT@ stands for the file URI of
+# this directory, which must not contain characters escaped in URIs.
+# With -record the responses of the given OBXLSP are written to expected.txt instead; review them before
+# committing. The whole session is written to a file first so the server sees all edits at once and the
+# debounced reparse happens at the same point on every run.
+
+record=0
+if [ "$1" = "-record" ]; then
+    record=1
+    shift
+fi
+if [ $# -ne 1 ]; then
+    echo "usage: run.sh [-record] path/to/OBXLSP" >&2
+    exit 2
+fi
+lsp=$1
+dir=$(cd "$(dirname "$0")" && pwd -P)
+root="file://$dir"
+in=${TMPDIR:-/tmp}/obxlsp_session_in.$$
+out=${TMPDIR:-/tmp}/obxlsp_session.$$
+
+if [ $record -eq 0 ] && [ ! -f "$dir/expected.txt" ]; then
+    echo "no expected.txt; run 'run.sh -record $lsp' first" >&2
+    exit 2
+fi
+
+sed "s|@ROOT@|$root|g" "$dir/session.txt" | while IFS= read -r msg; do
+    printf 'Content-Length: %d\r\n\r\n%s' "$(printf '%s' "$msg" | wc -c)" "$msg"
+done > "$in"
+"$lsp" "$dir/Hello.obx" < "$in" 2>/dev/null | tr -d '\r' | sed 's/Content-Length: [0-9]*//g' | grep -v '^$' > "$out"
+
+if [ $record -eq 1 ]; then
+    sed "s|$root|@ROOT@|g" "$out" > "$dir/expected.txt"
+    echo "recorded $(wc -l < "$dir/expected.txt") responses to expected.txt"
+    status=0
+elif sed "s|@ROOT@|$root|g" "$dir/expected.txt" | diff - "$out"; then
+    echo "OBXLSP session passed"
+    status=0
+else
+    echo "OBXLSP session failed" >&2
+    status=1
+fi
+rm -f "$in" "$out"
+exit $status
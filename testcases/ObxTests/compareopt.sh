@@ -0,0 +1,70 @@
+#!/bin/sh
+# Compiles each test module to C with and without -O, runs both programs and compares their output
+# usage: compareopt.sh path/to/OBXMC [test.obx ...]
+# Without test files all *.obx of this directory are used. Each module is compiled with the built-in Oakwood
+# modules and run as the main module; the modules it imports must be named like it plus a lower case letter
+# (e.g. Devirt1a.obx for Devirt1.obx) and are compiled with it. Tests which don't compile or build that way
+# without -O are listed as skipped. The programs are built with cc as in the generated build.txt and get
+# 10 seconds to run. The path of this directory must not contain blanks.
+
+if [ $# -lt 1 ]; then
+    echo "usage: compareopt.sh path/to/OBXMC [test.obx ...]" >&2
+    exit 2
+fi
+mc=$(cd "$(dirname "$1")" && pwd -P)/$(basename "$1")
+shift
+dir=$(cd "$(dirname "$0")" && pwd -P)
+if [ $# -eq 0 ]; then
+    set -- "$dir"/*.obx
+fi
+tmp=${TMPDIR:-/tmp}/obx_compareopt.$$
+passed=0
+failed=0
+skipped=0
+
+# build: mode file name; leaves the program output in $tmp/mode.txt, returns 1 if it could not be built
+build()
+{
+    out="$tmp/$1"
+    rm -rf "$out"
+    mkdir -p "$out"
+    if [ "$1" = opt ]; then
+        opt=-O
+    else
+        opt=
+    fi
+    imports=
+    for m in "${2%.obx}"[a-z].obx; do
+        [ -f "$m" ] && imports="$imports $m"
+    done
+    "$mc" -c $opt -oak -main="$3" -out="$out" "$2" $imports > "$out.log" 2>&1 || return 1
+    ( cd "$out" && cc -O0 --std=c99 -w *.c -lm -o prog ) >> "$out.log" 2>&1 || return 1
+    ( cd "$out" && timeout 10 ./prog ) > "$tmp/$1.txt" 2>&1
+    echo "exit $?" >> "$tmp/$1.txt"
+    return 0
+}
+
+mkdir -p "$tmp"
+for f in "$@"; do
+    name=$(basename "$f" .obx)
+    if ! build plain "$f" "$name"; then
+        echo "skipped $name"
+        skipped=$((skipped + 1))
+        continue
+    fi
+    if ! build opt "$f" "$name"; then
+        echo "FAILED $name: does not compile or build with -O" >&2
+        cat "$tmp/opt.log" >&2
+        failed=$((failed + 1))
+    elif ! diff "$tmp/plain.txt" "$tmp/opt.txt" > "$tmp/diff.txt"; then
+        echo "FAILED $name: the output differs with -O" >&2
+        cat "$tmp/diff.txt" >&2
+        failed=$((failed + 1))
+    else
+        passed=$((passed + 1))
+    fi
+done
+rm -rf "$tmp"
+
+echo "$passed passed, $failed failed, $skipped skipped"
+[ $failed -eq 0 ]